@@ -23,6 +23,7 @@
 
 #include "Border.h"
 #include "BorderFile.h"
+#include "CaretOMP.h"
 #include "GiftiLabelTable.h"
 #include "GiftiMetaData.h"
 #include "SurfaceFile.h"
@@ -30,6 +31,8 @@
 #include "SurfaceProjectionBarycentric.h"
 #include "SignedDistanceHelper.h"
 
+#include <vector>
+
 using namespace caret;
 using namespace std;
 
@@ -89,26 +92,49 @@ AlgorithmBorderResample::AlgorithmBorderResample(ProgressObject* myProgObj, cons
         borderOut->addBorderMetadataKey(borderIn->getBorderMetadataKey(m));//rely on the keys being in order added
     }
     int numBorders = borderIn->getNumberOfBorders();
-    CaretPointer<SignedDistanceHelper> myHelp = newAdjust.getSignedDistanceHelper();
-    for (int i = 0; i < numBorders; ++i)
+    vector<int> bordersToResample;
+    vector<int64_t> borderStart;//index into allCoords / 3 of each resampled border's first point
+    vector<float> allCoords;
+    for (int i = 0; i < numBorders; ++i)//unproject every point first, so the nearest triangle searches can be done in one parallel batch
     {
         const Border* inputBorder = borderIn->getBorder(i);
         if (inputBorder->getStructure() != curSphere->getStructure()) continue;
-        CaretPointer<Border> outputBorder(new Border());//in case something throws
-        outputBorder->setName(inputBorder->getName());
-        outputBorder->setClassName(inputBorder->getClassName());
-        outputBorder->setClosed(inputBorder->isClosed());
+        bordersToResample.push_back(i);
+        borderStart.push_back(allCoords.size() / 3);
         int numPoints = inputBorder->getNumberOfPoints();
         for (int j = 0; j < numPoints; ++j)
         {
-            CaretPointer<SurfaceProjectedItem> outPoint(new SurfaceProjectedItem());//ditto
             float coord[3];
             const SurfaceProjectedItem* myItem = inputBorder->getPoint(j);
             if (!myItem->getBarycentricProjection()->isValid()) throw AlgorithmException("input file has a border point without barycentric projection");//because we never want to use van essen projection or straight coords
             bool valid = myItem->getBarycentricProjection()->unprojectToSurface(curAdjust, coord, 0.0f, true);//should really be "from" surface - "true" makes it not use the signed distance above surface, if present
             if (!valid) throw AlgorithmException("input file has a border point that is invalid for the current sphere");
-            BarycentricInfo myBaryInfo;
-            myHelp->barycentricWeights(coord, myBaryInfo);
+            allCoords.insert(allCoords.end(), coord, coord + 3);
+        }
+    }
+    const int64_t numAllPoints = allCoords.size() / 3;
+    vector<BarycentricInfo> allBaryInfo(numAllPoints);
+#pragma omp CARET_PAR
+    {
+        CaretPointer<SignedDistanceHelper> myHelp = newAdjust.getSignedDistanceHelper();//helpers share the search tree
+#pragma omp CARET_FOR schedule(dynamic, 64)
+        for (int64_t p = 0; p < numAllPoints; ++p)
+        {
+            myHelp->barycentricWeights(allCoords.data() + p * 3, allBaryInfo[p]);
+        }
+    }
+    for (int b = 0; b < (int)bordersToResample.size(); ++b)//border objects are made serially, in the original order
+    {
+        const Border* inputBorder = borderIn->getBorder(bordersToResample[b]);
+        CaretPointer<Border> outputBorder(new Border());//in case something throws
+        outputBorder->setName(inputBorder->getName());
+        outputBorder->setClassName(inputBorder->getClassName());
+        outputBorder->setClosed(inputBorder->isClosed());
+        int numPoints = inputBorder->getNumberOfPoints();
+        for (int j = 0; j < numPoints; ++j)
+        {
+            CaretPointer<SurfaceProjectedItem> outPoint(new SurfaceProjectedItem());//ditto
+            const BarycentricInfo& myBaryInfo = allBaryInfo[borderStart[b] + j];
             outPoint->setStructure(inputBorder->getStructure());
             outPoint->getBarycentricProjection()->setTriangleNodes(myBaryInfo.nodes);
             outPoint->getBarycentricProjection()->setTriangleAreas(myBaryInfo.baryWeights);
@@ -408,61 +408,36 @@ void AlgorithmCiftiAverageDenseROI::processSurfaceComponent(vector<vector<double
         return;
     }
     if (myRoi->getNumberOfNodes() != brainModelsMap.getSurfaceNumberOfNodes(myStruct)) throw AlgorithmException("cifti number of vertices does not match roi");
-    int rowSize = myXml.getDimensionLength(CiftiXML::ALONG_ROW);
-    vector<float> rowScratch(rowSize);
-    CaretAssert(rowScratch.size() == accum[0].size());
+    CaretAssert(myXml.getDimensionLength(CiftiXML::ALONG_ROW) == (int64_t)accum[0].size());
     vector<CiftiBrainModelsMap::SurfaceMap> myMap = brainModelsMap.getSurfaceMap(myStruct);
     int mapSize = (int)myMap.size();
     int numMaps = myRoi->getNumberOfMaps();
-    if (myAreas == NULL)
+    vector<int64_t> rowIndices;
+    vector<float> weights;//numMaps per used row
+    for (int i = 0; i < mapSize; ++i)
     {
-        for (int i = 0; i < mapSize; ++i)
+        const int& myNode = myMap[i].m_surfaceNode;
+        bool used = false;
+        for (int m = 0; m < numMaps; ++m)
         {
-            const int& myNode = myMap[i].m_surfaceNode;
-            bool dataLoaded = false;
-            for (int m = 0; m < numMaps; ++m)
-            {
-                const float roiVal = myRoi->getValue(myNode, m);
-                if (roiVal != 0.0f)
-                {
-                    if (!dataLoaded)
-                    {
-                        myCifti->getRow(rowScratch.data(), myMap[i].m_ciftiIndex);
-                        dataLoaded = true;
-                    }
-                    for (int j = 0; j < rowSize; ++j)
-                    {
-                        accum[m][j] += rowScratch[j] * roiVal;
-                    }
-                    denom[m] += roiVal;
-                }
-            }
+            if (myRoi->getValue(myNode, m) != 0.0f) used = true;
         }
-    } else {
-        for (int i = 0; i < mapSize; ++i)
+        if (!used) continue;
+        rowIndices.push_back(myMap[i].m_ciftiIndex);
+        for (int m = 0; m < numMaps; ++m)
         {
-            const int& myNode = myMap[i].m_surfaceNode;
-            bool dataLoaded = false;
-            for (int m = 0; m < numMaps; ++m)
+            const float roiVal = myRoi->getValue(myNode, m);
+            float weight = 0.0f;
+            if (roiVal != 0.0f)
             {
-                const float& roiVal = myRoi->getValue(myNode, m);
-                if (roiVal != 0.0f)
-                {
-                    const float weight = roiVal * myAreas[myMap[i].m_surfaceNode];
-                    if (!dataLoaded)
-                    {
-                        myCifti->getRow(rowScratch.data(), myMap[i].m_ciftiIndex);
-                        dataLoaded = true;
-                    }
-                    for (int j = 0; j < rowSize; ++j)
-                    {
-                        accum[m][j] += rowScratch[j] * weight;
-                    }
-                    denom[m] += weight;
-                }
+                weight = roiVal;
+                if (myAreas != NULL) weight *= myAreas[myNode];
+                denom[m] += weight;
             }
+            weights.push_back(weight);
         }
     }
+    myCifti->addWeightedRows(accum, rowIndices, weights);//reads rows in file order, with adjacent rows read together
 }
 
 void AlgorithmCiftiAverageDenseROI::verifyVolumeComponent(const CiftiFile* myCifti, const VolumeFile* volROI)
@@ -479,34 +454,30 @@ void AlgorithmCiftiAverageDenseROI::processVolumeComponent(vector<vector<double>
     CaretAssert(myXml.getMappingType(CiftiXML::ALONG_COLUMN) == CiftiMappingType::BRAIN_MODELS);//should be checked in the algorithm constructor
     const CiftiBrainModelsMap& brainModelsMap = myXml.getBrainModelsMap(CiftiXML::ALONG_COLUMN);
     if (!volROI->matchesVolumeSpace(brainModelsMap.getVolumeSpace())) throw AlgorithmException("cifti files don't match the ROI volume's space");
-    int rowSize = myXml.getDimensionLength(CiftiXML::ALONG_ROW);
-    vector<float> rowScratch(rowSize);
-    CaretAssert(rowScratch.size() == accum[0].size());
+    CaretAssert(myXml.getDimensionLength(CiftiXML::ALONG_ROW) == (int64_t)accum[0].size());
     vector<CiftiBrainModelsMap::VolumeMap> myMap = brainModelsMap.getFullVolumeMap();
     int mapSize = (int)myMap.size();
     int numMaps = volROI->getNumberOfMaps();
+    vector<int64_t> rowIndices;
+    vector<float> weights;//numMaps per used row
     for (int i = 0; i < mapSize; ++i)
     {
-        bool dataLoaded = false;
         if (!volROI->indexValid(myMap[i].m_ijk)) throw AlgorithmException("cifti file lists invalid voxels");
+        bool used = false;
+        for (int m = 0; m < numMaps; ++m)
+        {
+            if (volROI->getValue(myMap[i].m_ijk, m) != 0.0f) used = true;
+        }
+        if (!used) continue;
+        rowIndices.push_back(myMap[i].m_ciftiIndex);
         for (int m = 0; m < numMaps; ++m)
         {
             const float& roiVal = volROI->getValue(myMap[i].m_ijk, m);
-            if (roiVal != 0.0f)
-            {
-                if (!dataLoaded)
-                {
-                    myCifti->getRow(rowScratch.data(), myMap[i].m_ciftiIndex);
-                    dataLoaded = true;
-                }
-                for (int j = 0; j < rowSize; ++j)
-                {
-                    accum[m][j] += rowScratch[j] * roiVal;
-                }
-                denom[m] += roiVal;
-            }
+            denom[m] += roiVal;
+            weights.push_back(roiVal);
         }
     }
+    myCifti->addWeightedRows(accum, rowIndices, weights);
 }
 
 void AlgorithmCiftiAverageDenseROI::processCifti(vector<vector<double> >& accum, vector<double>& denom, const CiftiFile* myCifti, const CiftiFile* ciftiROI,
@@ -515,10 +486,11 @@ void AlgorithmCiftiAverageDenseROI::processCifti(vector<vector<double> >& accum,
     const CiftiXML& myXml = myCifti->getCiftiXML();//same along columns for data and roi, we already checked
     CaretAssert(myXml.getMappingType(CiftiXML::ALONG_COLUMN) == CiftiMappingType::BRAIN_MODELS);//should be checked in the algorithm constructor
     const CiftiBrainModelsMap& brainModelsMap = myXml.getBrainModelsMap(CiftiXML::ALONG_COLUMN);
-    int rowSize = myXml.getDimensionLength(CiftiXML::ALONG_ROW);
     vector<StructureEnum::Enum> surfList = brainModelsMap.getSurfaceStructureList();
     int numMaps = ciftiROI->getNumberOfColumns();
-    vector<float> dataScratch(rowSize), roiScratch(numMaps);
+    vector<float> roiScratch(numMaps);
+    vector<int64_t> rowIndices;
+    vector<float> weights;//numMaps per used row
     for (int s = 0; s < (int)surfList.size(); ++s)
     {
         const float* myAreas = NULL;
@@ -538,54 +510,22 @@ void AlgorithmCiftiAverageDenseROI::processCifti(vector<vector<double> >& accum,
         }
         vector<CiftiBrainModelsMap::SurfaceMap> myMap = brainModelsMap.getSurfaceMap(surfList[s]);
         int mapSize = (int)myMap.size();
-        if (myAreas != NULL)
+        for (int i = 0; i < mapSize; ++i)
         {
-            for (int i = 0; i < mapSize; ++i)
+            ciftiROI->getRow(roiScratch.data(), myMap[i].m_ciftiIndex);
+            bool used = false;
+            for (int m = 0; m < numMaps; ++m)//ROI maps, not cifti mapping
             {
-                ciftiROI->getRow(roiScratch.data(), myMap[i].m_ciftiIndex);
-                const float& thisArea = myAreas[myMap[i].m_surfaceNode];
-                bool dataLoaded = false;
-                for (int m = 0; m < numMaps; ++m)//ROI maps, not cifti mapping
-                {
-                    const float& roiValue = roiScratch[m];
-                    if (roiValue != 0.0f)
-                    {
-                        if (!dataLoaded)
-                        {
-                            myCifti->getRow(dataScratch.data(), i);
-                            dataLoaded = true;
-                        }
-                        const float weight = roiValue * thisArea;
-                        for (int j = 0; j < rowSize; ++j)
-                        {
-                            accum[m][j] += dataScratch[j] * weight;
-                        }
-                        denom[m] += weight;
-                    }
-                }
+                if (roiScratch[m] != 0.0f) used = true;
             }
-        } else {
-            for (int i = 0; i < mapSize; ++i)
+            if (!used) continue;
+            rowIndices.push_back(myMap[i].m_ciftiIndex);
+            for (int m = 0; m < numMaps; ++m)
             {
-                ciftiROI->getRow(roiScratch.data(), myMap[i].m_ciftiIndex);
-                bool dataLoaded = false;
-                for (int m = 0; m < numMaps; ++m)//ROI maps, not cifti mapping
-                {
-                    const float& roiValue = roiScratch[m];
-                    if (roiValue != 0.0f)
-                    {
-                        if (!dataLoaded)
-                        {
-                            myCifti->getRow(dataScratch.data(), i);
-                            dataLoaded = true;
-                        }
-                        for (int j = 0; j < rowSize; ++j)
-                        {
-                            accum[m][j] += dataScratch[j] * roiValue;
-                        }
-                        denom[m] += roiValue;
-                    }
-                }
+                float weight = roiScratch[m];
+                if (weight != 0.0f && myAreas != NULL) weight *= myAreas[myMap[i].m_surfaceNode];
+                denom[m] += weight;
+                weights.push_back(weight);
             }
         }
     }
@@ -594,25 +534,20 @@ void AlgorithmCiftiAverageDenseROI::processCifti(vector<vector<double> >& accum,
     for (int i = 0; i < mapSize; ++i)
     {
         ciftiROI->getRow(roiScratch.data(), myMap[i].m_ciftiIndex);
-        bool dataLoaded = false;
+        bool used = false;
         for (int m = 0; m < numMaps; ++m)//ROI maps, not cifti mapping
         {
-            const float& roiValue = roiScratch[m];
-            if (roiValue != 0.0f)
-            {
-                if (!dataLoaded)
-                {
-                    myCifti->getRow(dataScratch.data(), i);
-                    dataLoaded = true;
-                }
-                for (int j = 0; j < rowSize; ++j)
-                {
-                    accum[m][j] += dataScratch[j] * roiValue;
-                }
-                denom[m] += roiValue;
-            }
+            if (roiScratch[m] != 0.0f) used = true;
+        }
+        if (!used) continue;
+        rowIndices.push_back(myMap[i].m_ciftiIndex);
+        for (int m = 0; m < numMaps; ++m)
+        {
+            denom[m] += roiScratch[m];
+            weights.push_back(roiScratch[m]);
         }
     }
+    myCifti->addWeightedRows(accum, rowIndices, weights);
 }
 
 float AlgorithmCiftiAverageDenseROI::getAlgorithmInternalWeight()
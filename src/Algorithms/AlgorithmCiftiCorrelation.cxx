@@ -30,6 +30,7 @@
 #include "CaretOMP.h"
 #include "FileInformation.h"
 #include "CaretPointer.h"
+#include "CaretProfiler.h"
 #include "dot_wrapper.h"
 #include <fstream>
 #include <utility>
@@ -85,7 +86,10 @@ OperationParameters* AlgorithmCiftiCorrelation::getParameters()
         "When using the -fisher-z option, the output is NOT a Z-score, it is artanh(r), to do further math on this output, consider using -cifti-math.\n\n" +
         "Restricting the memory usage will make it calculate the output in chunks, and if the input file size is more than 70% of the memory limit, " +
         "it will also read through the input file as rows are required, resulting in several passes through the input file (once per chunk).  " +
-        "Memory limit does not need to be an integer, you may also specify 0 to calculate a single output row at a time (this may be very slow)."
+        "Memory limit does not need to be an integer, you may also specify 0 to calculate a single output row at a time (this may be very slow).\n\n" +
+        "To write a compact output file, use the -cifti-output-datatype global option with an integer type, for instance INT8 for a quarter of the size of the default float32, " +
+        "or INT16 for half.  " +
+        "Unless -fisher-z or -covariance is specified, the output range is then set to [-1, 1] automatically if -cifti-output-range is not given."
     );
     return ret;
 }
@@ -174,6 +178,24 @@ void AlgorithmCiftiCorrelation::useParameters(OperationParameters* myParams, Pro
     }
     bool noDemean = myParams->getOptionalParameter(7)->m_present;
     bool covariance = myParams->getOptionalParameter(8)->m_present;
+    if (!fisherZ && !covariance && !myCiftiOut->isWritingDataScaled())
+    {//correlation is bounded, so an integer output type can be used as a compact encoding without the user working out the range
+        switch (myCiftiOut->getWritingDataType())
+        {
+            case NIFTI_TYPE_INT8:
+            case NIFTI_TYPE_UINT8:
+            case NIFTI_TYPE_INT16:
+            case NIFTI_TYPE_UINT16:
+            case NIFTI_TYPE_INT32:
+            case NIFTI_TYPE_UINT32:
+            case NIFTI_TYPE_INT64:
+            case NIFTI_TYPE_UINT64:
+                myCiftiOut->setWritingDataTypeAndScaling(myCiftiOut->getWritingDataType(), -1.0, 1.0);
+                break;
+            default:
+                break;
+        }
+    }
     if (roiOverrideMode)
     {
         if (ciftiRoiMode)
@@ -240,6 +262,7 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             }
         }
         int curRow = 0;//because we can't trust the order threads hit the critical section
+        CaretProfilerScope blockScope("correlate row block", "omp");
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int i = 0; i < numRows; ++i)
         {
@@ -270,10 +293,13 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
                 }
             }
         }
+        blockScope.end();
+        CaretProfilerScope writeScope("write row block");
         for (int i = startrow; i < endrow; ++i)
         {
             myCiftiOut->setRow(outRows[i - startrow], i);
         }
+        writeScope.end();
         if (!cacheFullInput)
         {
             clearCache();//tell the cache we are going to preload a different set of rows now
@@ -428,6 +454,7 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             }
             indexReverse[ciftiIndexList[i].first] = i;
         }
+        CaretProfilerScope blockScope("correlate row block", "omp");
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int i = 0; i < numRows; ++i)
         {
@@ -458,11 +485,14 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
                 }
             }
         }
+        blockScope.end();
+        CaretProfilerScope writeScope("write row block");
         for (int i = startrow; i < endrow; ++i)
         {
             myCiftiOut->setRow(outRows[i - startrow], ciftiIndexList[i].second);
             indexReverse[ciftiIndexList[i].first] = -1;
         }
+        writeScope.end();
         if (!cacheFullInput)
         {
             clearCache();//tell the cache we are going to preload a different set of rows now
@@ -20,7 +20,7 @@
 
 #include "AlgorithmCiftiCorrelationGradient.h"
 #include "AlgorithmException.h"
-#include "AlgorithmMetricGradient.h"
+#include "MetricGradientObject.h"
 #include "MetricSmoothingObject.h"
 #include "AlgorithmVolumeGradient.h"
 #include "CaretLogger.h"
@@ -285,12 +285,14 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
     vector<CiftiSurfaceMap> myMap;
     myXML.getSurfaceMapForColumns(myMap, myStructure);
     int mapSize = (int)myMap.size();
+    int numSurfNodes = mySurf->getNumberOfNodes();
     vector<double> accum(mapSize, 0.0);
     int numCacheRows = mapSize;
     bool cacheFullInput = true;
     if (memLimitGB >= 0.0f)
     {
-        numCacheRows = numRowsForMem(memLimitGB, m_numCols * sizeof(float), (mySurf->getNumberOfNodes() * (sizeof(float) * 8 + 1)) / 8, mapSize, cacheFullInput);
+        numCacheRows = numRowsForMem(memLimitGB, m_numCols * sizeof(float), (numSurfNodes * (sizeof(float) * 8 + 1)) / 8, mapSize, cacheFullInput,
+                                     numSurfNodes * sizeof(float) * 2 + mapSize * sizeof(double));//per-thread smoothing and gradient scratch, and accumulators
     }
     if (numCacheRows > mapSize)
     {
@@ -309,7 +311,7 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
         areaData = myAreas->getValuePointerForColumn(0);
     }
     MetricFile myRoi;
-    myRoi.setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), 1);
+    myRoi.setNumberOfNodesAndColumns(numSurfNodes, 1);
     myRoi.initializeColumn(0);
     vector<int> rowsToCache;
     for (int i = 0; i < mapSize; ++i)
@@ -320,6 +322,7 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
             rowsToCache.push_back(myMap[i].m_ciftiIndex);
         }
     }
+    const float* roiColumn = myRoi.getValuePointerForColumn(0);
     if (cacheFullInput)
     {
         cacheRows(rowsToCache);
@@ -329,6 +332,8 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
     {
         mySmooth.grabNew(new MetricSmoothingObject(mySurf, surfKern, &myRoi, MetricSmoothingObject::GEO_GAUSS_AREA, areaData));//computes the smoothing weights only once per surface
     }
+    MetricGradientObject myGradient(mySurf, areaData);//likewise for the gradient geometry
+    vector<float> computeTile;
     for (int startpos = 0; startpos < mapSize; startpos += numCacheRows)
     {
         int endpos = startpos + numCacheRows;
@@ -342,61 +347,36 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
             }
             cacheRows(rowsToCache);
         }
-        int curRow = 0;//because we can't trust the order threads hit the critical section
-        MetricFile computeMetric;
-        computeMetric.setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), endpos - startpos);
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < mapSize; ++i)
+        int numTileCols = endpos - startpos;
+        computeTile.assign(((int64_t)numSurfNodes) * numTileCols, 0.0f);
+        correlateSurfaceTile(myMap, startpos, endpos, numSurfNodes, computeTile.data(), NULL);
+#pragma omp CARET_PAR
         {
-            float movingRrs;
-            const float* movingRow;
-            int myrow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myMap[myrow].m_ciftiIndex, movingRrs);
-            }
-            for (int j = startpos; j < endpos; ++j)
+            vector<float> smoothScratch(numSurfNodes), gradScratch(numSurfNodes);
+            vector<double> myAccum(mapSize, 0.0);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int j = 0; j < numTileCols; ++j)
             {
-                if (myrow >= startpos && myrow < endpos)
+                const float* myCol = computeTile.data() + ((int64_t)numSurfNodes) * j;
+                if (surfKern > 0.0f)
                 {
-                    if (j >= myrow)
+                    mySmooth->smoothArray(myCol, smoothScratch.data());
+                    myCol = smoothScratch.data();
+                }
+                myGradient.gradientArray(myCol, gradScratch.data(), roiColumn);
+                for (int i = 0; i < mapSize; ++i)
+                {
+                    if (roiColumn[myMap[i].m_surfaceNode] > 0.0f)
                     {
-                        float cacheRrs;
-                        const float* cacheRow = getRow(myMap[j].m_ciftiIndex, cacheRrs, true);
-                        float result = correlate(movingRow, movingRrs, cacheRow, cacheRrs);
-                        computeMetric.setValue(myMap[myrow].m_surfaceNode, j - startpos, result);
-                        computeMetric.setValue(myMap[j].m_surfaceNode, myrow - startpos, result);
+                        myAccum[i] += gradScratch[myMap[i].m_surfaceNode];
                     }
-                } else {
-                    float cacheRrs;
-                    const float* cacheRow = getRow(myMap[j].m_ciftiIndex, cacheRrs, true);
-                    float result = correlate(movingRow, movingRrs, cacheRow, cacheRrs);
-                    computeMetric.setValue(myMap[myrow].m_surfaceNode, j - startpos, result);
                 }
             }
-        }
-        int numMetricCols = endpos - startpos;
-        MetricFile outputMetric, outputMetric2;
-        for (int j = 0; j < numMetricCols; ++j)
-        {
-            const float* myCol;
-            if (surfKern > 0.0f)
-            {
-                mySmooth->smoothColumn(&computeMetric, j, &outputMetric);
-                AlgorithmMetricGradient(NULL, mySurf, &outputMetric, &outputMetric2, NULL, -1.0f, &myRoi, false, -1, myAreas);
-                myCol = outputMetric2.getValuePointerForColumn(0);
-            } else {
-                AlgorithmMetricGradient(NULL, mySurf, &computeMetric, &outputMetric, NULL, -1.0f, &myRoi, false, j, myAreas);
-                myCol = outputMetric.getValuePointerForColumn(0);
-            }
-            for (int i = 0; i < mapSize; ++i)
+#pragma omp critical
             {
-                const float* roiColumn = myRoi.getValuePointerForColumn(0);
-                if (roiColumn[myMap[i].m_surfaceNode] > 0.0f)
+                for (int i = 0; i < mapSize; ++i)
                 {
-                    accum[i] += myCol[myMap[i].m_surfaceNode];
+                    accum[i] += myAccum[i];
                 }
             }
         }
@@ -413,13 +393,15 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
     vector<CiftiSurfaceMap> myMap;
     myXML.getSurfaceMapForColumns(myMap, myStructure);
     int mapSize = (int)myMap.size();
+    int numSurfNodes = mySurf->getNumberOfNodes();
     vector<double> accum(mapSize, 0.0);
     vector<int32_t> accumCount(mapSize, 0);
     int numCacheRows = mapSize;
     bool cacheFullInput = true;
     if (memLimitGB >= 0.0f)
     {
-        numCacheRows = numRowsForMem(memLimitGB, m_numCols * sizeof(float), (mySurf->getNumberOfNodes() * (sizeof(float) * 8 + 1)) / 8, mapSize, cacheFullInput);
+        numCacheRows = numRowsForMem(memLimitGB, m_numCols * sizeof(float), (numSurfNodes * (sizeof(float) * 8 + 1)) / 8, mapSize, cacheFullInput,
+                                     numSurfNodes * sizeof(float) * 3 + mapSize * (sizeof(double) + sizeof(int32_t)));//per-thread scratch, exclusion roi, and accumulators
     }
     if (numCacheRows > mapSize)
     {
@@ -439,10 +421,9 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
     }
     CaretPointer<GeodesicHelperBase> myGeoBase(new GeodesicHelperBase(mySurf, areaData));//can't really have SurfaceFile cache ones with corrected areas
     MetricFile myRoi;
-    myRoi.setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), 1);
+    myRoi.setNumberOfNodesAndColumns(numSurfNodes, 1);
     myRoi.initializeColumn(0);
     vector<vector<bool> > roiLookup(numCacheRows);//this gets bit compressed
-    vector<bool> origRoi(mySurf->getNumberOfNodes());
     vector<vector<int32_t> > excludeNodes(numCacheRows);
     vector<int> rowsToCache;
     for (int i = 0; i < mapSize; ++i)
@@ -453,6 +434,7 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
             rowsToCache.push_back(myMap[i].m_ciftiIndex);
         }
     }
+    const float* roiColumn = myRoi.getValuePointerForColumn(0);
     if (cacheFullInput)
     {
         cacheRows(rowsToCache);
@@ -462,6 +444,8 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
     {
         mySmooth.grabNew(new MetricSmoothingObject(mySurf, surfKern, &myRoi, MetricSmoothingObject::GEO_GAUSS_AREA, areaData));//computes the smoothing weights only once per surface
     }
+    MetricGradientObject myGradient(mySurf, areaData);//likewise for the gradient geometry
+    vector<float> computeTile;
     for (int startpos = 0; startpos < mapSize; startpos += numCacheRows)
     {
         int endpos = startpos + numCacheRows;
@@ -475,7 +459,6 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
             }
             cacheRows(rowsToCache);
         }
-        int numSurfNodes = mySurf->getNumberOfNodes();
 #pragma omp CARET_PAR
         {
             vector<float> distances;
@@ -489,7 +472,7 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
                 lookupRef.resize(numSurfNodes);
                 for (int j = 0; j < numSurfNodes; ++j)
                 {
-                    lookupRef[j] = (myRoi.getValue(j, 0) > 0.0f);
+                    lookupRef[j] = (roiColumn[j] > 0.0f);
                 }
                 int numExclude = excludeRef.size();
                 for (int j = 0; j < numExclude; ++j)
@@ -498,76 +481,50 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
                 }
             }
         }
-        int curRow = 0;//because we can't trust the order threads hit the critical section
-        MetricFile computeMetric;
-        computeMetric.setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), endpos - startpos);
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < mapSize; ++i)
+        int numTileCols = endpos - startpos;
+        computeTile.assign(((int64_t)numSurfNodes) * numTileCols, 0.0f);
+        correlateSurfaceTile(myMap, startpos, endpos, numSurfNodes, computeTile.data(), &roiLookup);
+#pragma omp CARET_PAR
         {
-            float movingRrs;
-            const float* movingRow;
-            int myrow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myMap[myrow].m_ciftiIndex, movingRrs);
-            }
-            for (int j = startpos; j < endpos; ++j)
+            vector<float> smoothScratch(numSurfNodes), gradScratch(numSurfNodes);
+            vector<float> excludeRoi(roiColumn, roiColumn + numSurfNodes);
+            vector<double> myAccum(mapSize, 0.0);
+            vector<int32_t> myAccumCount(mapSize, 0);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int j = 0; j < numTileCols; ++j)
             {
-                if (roiLookup[j - startpos][myMap[myrow].m_surfaceNode])
+                int numExclude = (int)excludeNodes[j].size();
+                for (int k = 0; k < numExclude; ++k)
                 {
-                    if (myrow >= startpos && myrow < endpos)
+                    excludeRoi[excludeNodes[j][k]] = 0.0f;//exclude the nodes near the seed node
+                }
+                const float* myCol = computeTile.data() + ((int64_t)numSurfNodes) * j;
+                if (surfKern > 0.0f)
+                {
+                    mySmooth->smoothArray(myCol, smoothScratch.data(), excludeRoi.data());
+                    myCol = smoothScratch.data();
+                }
+                myGradient.gradientArray(myCol, gradScratch.data(), excludeRoi.data());
+                for (int i = 0; i < mapSize; ++i)
+                {
+                    if (excludeRoi[myMap[i].m_surfaceNode] > 0.0f)
                     {
-                        if (j >= myrow)
-                        {
-                            float cacheRrs;
-                            const float* cacheRow = getRow(myMap[j].m_ciftiIndex, cacheRrs, true);
-                            float result = correlate(movingRow, movingRrs, cacheRow, cacheRrs);
-                            computeMetric.setValue(myMap[myrow].m_surfaceNode, j - startpos, result);
-                            computeMetric.setValue(myMap[j].m_surfaceNode, myrow - startpos, result);
-                        }
-                    } else {
-                        float cacheRrs;
-                        const float* cacheRow = getRow(myMap[j].m_ciftiIndex, cacheRrs, true);
-                        float result = correlate(movingRow, movingRrs, cacheRow, cacheRrs);
-                        computeMetric.setValue(myMap[myrow].m_surfaceNode, j - startpos, result);
+                        myAccum[i] += gradScratch[myMap[i].m_surfaceNode];
+                        myAccumCount[i] += 1;
                     }
                 }
-            }
-        }
-        int numMetricCols = endpos - startpos;
-        MetricFile outputMetric, outputMetric2;
-        MetricFile excludeRoi = myRoi;
-        for (int j = 0; j < numMetricCols; ++j)
-        {
-            int numExclude = (int)excludeNodes[j].size();
-            const float* myCol;
-            for (int k = 0; k < numExclude; ++k)
-            {
-                excludeRoi.setValue(excludeNodes[j][k], 0, 0.0f);//exclude the nodes near the seed node
-            }
-            if (surfKern > 0.0f)
-            {
-                mySmooth->smoothColumn(&computeMetric, j, &outputMetric, &excludeRoi);
-                AlgorithmMetricGradient(NULL, mySurf, &outputMetric, &outputMetric2, NULL, -1.0f, &excludeRoi, false, -1, myAreas);
-                myCol = outputMetric2.getValuePointerForColumn(0);
-            } else {
-                AlgorithmMetricGradient(NULL, mySurf, &computeMetric, &outputMetric, NULL, -1.0f, &excludeRoi, false, j, myAreas);
-                myCol = outputMetric.getValuePointerForColumn(0);
-            }
-            for (int i = 0; i < mapSize; ++i)
-            {
-                const float* roiColumn = excludeRoi.getValuePointerForColumn(0);
-                if (roiColumn[myMap[i].m_surfaceNode] > 0.0f)
+                for (int k = 0; k < numExclude; ++k)
                 {
-                    accum[i] += myCol[myMap[i].m_surfaceNode];
-                    accumCount[i] += 1;//less dubious looking than ++accumCount[i]
+                    excludeRoi[excludeNodes[j][k]] = roiColumn[excludeNodes[j][k]];//and set them back to original roi afterwards, instead of a full reinitialize
                 }
             }
-            for (int k = 0; k < numExclude; ++k)
+#pragma omp critical
             {
-                excludeRoi.setValue(excludeNodes[j][k], 0, myRoi.getValue(excludeNodes[j][k], 0));//and set them back to original roi afterwards, instead of a full reinitialize
+                for (int i = 0; i < mapSize; ++i)
+                {
+                    accum[i] += myAccum[i];
+                    accumCount[i] += myAccumCount[i];
+                }
             }
         }
     }
@@ -582,6 +539,70 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
     }
 }
 
+void AlgorithmCiftiCorrelationGradient::correlateSurfaceTile(const vector<CiftiSurfaceMap>& myMap, const int& startpos, const int& endpos, const int& numSurfNodes,
+                                                             float* tileOut, const vector<vector<bool> >* roiLookup)
+{//correlate every row in the structure against the cached rows [startpos, endpos), writing directly into a node-major tile, one column per cached row
+    int mapSize = (int)myMap.size();
+    int blockRows = getReadBlockRows();
+    vector<vector<float> > blockStorage(blockRows);
+    vector<const float*> blockPtrs(blockRows);
+    vector<int> toAdjust;
+    for (int blockStart = 0; blockStart < mapSize; blockStart += blockRows)
+    {
+        int blockEnd = min(blockStart + blockRows, mapSize);
+        toAdjust.clear();
+        for (int i = blockStart; i < blockEnd; ++i)
+        {//read uncached rows of the block sequentially, and do the rest of the work in parallel
+            int ciftiIndex = myMap[i].m_ciftiIndex;
+            if (m_rowInfo[ciftiIndex].m_cacheIndex != -1)
+            {
+                blockPtrs[i - blockStart] = m_rowCache[m_rowInfo[ciftiIndex].m_cacheIndex].m_row.data();
+            } else {
+                vector<float>& storageRef = blockStorage[i - blockStart];
+                storageRef.resize(m_numCols);
+                m_inputCifti->getRow(storageRef.data(), ciftiIndex);
+                blockPtrs[i - blockStart] = storageRef.data();
+                toAdjust.push_back(i);
+            }
+        }
+        int numAdjust = (int)toAdjust.size();
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int k = 0; k < numAdjust; ++k)
+        {
+            adjustRow(blockStorage[toAdjust[k] - blockStart].data(), myMap[toAdjust[k]].m_ciftiIndex);
+        }
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int myrow = blockStart; myrow < blockEnd; ++myrow)
+        {
+            const float* movingRow = blockPtrs[myrow - blockStart];
+            float movingRrs = m_rowInfo[myMap[myrow].m_ciftiIndex].m_rootResidSqr;
+            int64_t rowNode = myMap[myrow].m_surfaceNode;
+            bool inTile = (myrow >= startpos && myrow < endpos);
+            for (int j = (inTile ? myrow : startpos); j < endpos; ++j)
+            {//inside the tile, each pair is computed once and written to both places
+                if (roiLookup != NULL && !(*roiLookup)[j - startpos][rowNode]) continue;
+                float cacheRrs;
+                const float* cacheRow = getRow(myMap[j].m_ciftiIndex, cacheRrs, true);
+                float result = correlate(movingRow, movingRrs, cacheRow, cacheRrs);
+                tileOut[((int64_t)numSurfNodes) * (j - startpos) + rowNode] = result;
+                if (inTile)
+                {
+                    tileOut[((int64_t)numSurfNodes) * (myrow - startpos) + myMap[j].m_surfaceNode] = result;
+                }
+            }
+        }
+    }
+}
+
+int AlgorithmCiftiCorrelationGradient::getReadBlockRows()
+{
+#ifdef CARET_OMP
+    return 2 * omp_get_max_threads();
+#else
+    return 2;
+#endif
+}
+
 void AlgorithmCiftiCorrelationGradient::processVolumeComponent(StructureEnum::Enum& myStructure, const float& volKern, const float& memLimitGB)
 {
     const CiftiXMLOld& myXML = m_inputCifti->getCiftiXMLOld();
@@ -1070,11 +1091,17 @@ float* AlgorithmCiftiCorrelationGradient::getTempRow()
 #endif
 }
 
-int AlgorithmCiftiCorrelationGradient::numRowsForMem(const float& memLimitGB, const int64_t& inrowBytes, const int64_t& outrowBytes, const int& numRows, bool& cacheFullInput)
+int AlgorithmCiftiCorrelationGradient::numRowsForMem(const float& memLimitGB, const int64_t& inrowBytes, const int64_t& outrowBytes, const int& numRows, bool& cacheFullInput,
+                                                     const int64_t& perThreadBytes)
 {
     int64_t targetBytes = (int64_t)(memLimitGB * 1024 * 1024 * 1024);
     if (m_inputCifti->isInMemory()) targetBytes -= numRows * inrowBytes;//count in-memory input against the total too
     targetBytes -= numRows * sizeof(RowInfo) + 2 * outrowBytes;//storage for mean, stdev, and info about caching, output structures
+#ifdef CARET_OMP
+    targetBytes -= perThreadBytes * omp_get_max_threads();
+#else
+    targetBytes -= perThreadBytes;
+#endif
     if (targetBytes < 1)
     {
         cacheFullInput = false;//the most memory conservation possible, though it will take a LOT of time and do a LOT of IO
@@ -1087,11 +1114,7 @@ int AlgorithmCiftiCorrelationGradient::numRowsForMem(const float& memLimitGB, co
         if (numRowsFull < 1) numRowsFull = 1;
         int64_t fullPasses = numRows / numRowsFull;
         int64_t fullCorrSkip = (fullPasses * numRowsFull * (numRowsFull - 1) + (numRows - fullPasses * numRowsFull) * (numRows - fullPasses * numRowsFull - 1)) / 2;
-#ifdef CARET_OMP
-        targetBytes -= inrowBytes * omp_get_max_threads();
-#else
-        targetBytes -= inrowBytes;//1 row in memory that isn't a reference to cache
-#endif
+        targetBytes -= inrowBytes * getReadBlockRows();//rows in memory that aren't references to cache
         int64_t numPassesPartial = ((outrowBytes + inrowBytes) * numRows + targetBytes - 1) / targetBytes;//break the partial cached passes up equally, to use less memory, and so we don't get an anemic pass at the end
         if (numPassesPartial < 1)
         {
@@ -1116,11 +1139,7 @@ int AlgorithmCiftiCorrelationGradient::numRowsForMem(const float& memLimitGB, co
     } else {//if we can't cache the whole thing, split passes evenly
         cacheFullInput = false;
         int64_t div = max((int64_t)1, (outrowBytes + inrowBytes) * numRows);
-#ifdef CARET_OMP
-        targetBytes -= inrowBytes * omp_get_max_threads();
-#else
-        targetBytes -= inrowBytes;//1 row in memory that isn't a reference to cache
-#endif
+        targetBytes -= inrowBytes * getReadBlockRows();//rows in memory that aren't references to cache
         int64_t numPassesPartial = (targetBytes + div - 1) / targetBytes;
         int ret = (numRows + numPassesPartial - 1) / numPassesPartial;
         if (ret < 1) ret = 1;//sanitize, just in case
@@ -27,6 +27,8 @@
 
 namespace caret {
     
+    struct CiftiSurfaceMap;
+    
     class AlgorithmCiftiCorrelationGradient : public AbstractAlgorithm
     {
         AlgorithmCiftiCorrelationGradient();
@@ -61,7 +63,11 @@ namespace caret {
         float* getTempRow();
         float correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2);
         void init(const CiftiFile* input, const bool& undoFisherInput, const bool& applyFisher, const bool& covariance);
-        int numRowsForMem(const float& memLimitGB, const int64_t& inrowBytes, const int64_t& outrowBytes, const int& numRows, bool& cacheFullInput);
+        int numRowsForMem(const float& memLimitGB, const int64_t& inrowBytes, const int64_t& outrowBytes, const int& numRows, bool& cacheFullInput,
+                          const int64_t& perThreadBytes = 0);
+        static int getReadBlockRows();//number of uncached rows to read sequentially before correlating them in parallel
+        void correlateSurfaceTile(const std::vector<CiftiSurfaceMap>& myMap, const int& startpos, const int& endpos, const int& numSurfNodes,
+                                  float* tileOut, const std::vector<std::vector<bool> >* roiLookup);
         //void processSurfaceComponentLocal(StructureEnum::Enum& myStructure, const float& surfKern, const float& memLimitGB, SurfaceFile* mySurf);
         void processSurfaceComponent(StructureEnum::Enum& myStructure, const float& surfKern, const float& memLimitGB, SurfaceFile* mySurf, const MetricFile* myAreas);
         void processSurfaceComponent(StructureEnum::Enum& myStructure, const float& surfKern, const float& surfExclude, const float& memLimitGB, SurfaceFile* mySurf, const MetricFile* myAreas);
@@ -21,6 +21,7 @@
 #include "AlgorithmCiftiParcellate.h"
 #include "AlgorithmException.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
@@ -237,6 +238,177 @@ void AlgorithmCiftiParcellate::useParameters(OperationParameters* myParams, Prog
                              includeEmpty, emptyFillValue, emptyMaskOut);
 }
 
+namespace
+{
+    //reductions that are a weighted sum of the data can be done as a sparse parcel by brainordinate matrix multiply, without gathering the values
+    bool canParcellateLinear(const ReductionEnum::Enum& method, const float& excludeLow, const float& excludeHigh, const bool& onlyNumeric, const bool& isLabel)
+    {
+        if (isLabel || onlyNumeric || (excludeLow > 0.0f && excludeHigh > 0.0f)) return false;
+        return (method == ReductionEnum::MEAN || method == ReductionEnum::SUM);
+    }
+    
+    struct ParcelMatrix
+    {//stored both by parcel (CSR, for parcellating along rows) and by dense index (for streaming rows when parcellating along columns)
+        vector<int64_t> m_parcelStart;//numParcels + 1
+        vector<int64_t> m_indices;
+        vector<float> m_weights;
+        vector<double> m_divisor;//count or sum of weights for mean, 1 for sum, 0 for empty parcels
+        vector<int> m_indexToParcel;
+        vector<float> m_indexWeight;
+    };
+    
+    //parcelWeights is in the same order as the dense indices within each parcel, as built by the constructors
+    void makeParcelMatrix(const vector<int>& indexToParcel, const int& numParcels, const vector<vector<float> >* parcelWeights, const ReductionEnum::Enum& method, ParcelMatrix& matOut)
+    {
+        int64_t numIndices = (int64_t)indexToParcel.size();
+        matOut.m_indexToParcel = indexToParcel;
+        matOut.m_indexWeight.assign(numIndices, 1.0f);
+        matOut.m_parcelStart.assign(numParcels + 1, 0);
+        for (int64_t i = 0; i < numIndices; ++i)
+        {
+            if (indexToParcel[i] != -1) ++matOut.m_parcelStart[indexToParcel[i] + 1];
+        }
+        for (int p = 0; p < numParcels; ++p)
+        {
+            matOut.m_parcelStart[p + 1] += matOut.m_parcelStart[p];
+        }
+        matOut.m_indices.resize(matOut.m_parcelStart[numParcels]);
+        matOut.m_weights.resize(matOut.m_parcelStart[numParcels]);
+        matOut.m_divisor.assign(numParcels, 0.0);
+        vector<int64_t> parcelPos(numParcels, 0);
+        for (int64_t i = 0; i < numIndices; ++i)
+        {
+            int parcel = indexToParcel[i];
+            if (parcel == -1) continue;
+            float weight = 1.0f;
+            if (parcelWeights != NULL)
+            {
+                CaretAssertVectorIndex((*parcelWeights)[parcel], parcelPos[parcel]);
+                weight = (*parcelWeights)[parcel][parcelPos[parcel]];
+            }
+            int64_t pos = matOut.m_parcelStart[parcel] + parcelPos[parcel];
+            matOut.m_indices[pos] = i;
+            matOut.m_weights[pos] = weight;
+            matOut.m_indexWeight[i] = weight;
+            matOut.m_divisor[parcel] += weight;
+            ++parcelPos[parcel];
+        }
+        for (int p = 0; p < numParcels; ++p)
+        {
+            if (parcelPos[p] == 0) continue;//leave empty parcels as 0
+            if (method == ReductionEnum::SUM) matOut.m_divisor[p] = 1.0;
+        }
+    }
+    
+    void doLinearParcellation(const CiftiFile* myCiftiIn, const int& direction, CiftiFile* myCiftiOut, const ParcelMatrix& parcelMatrix, const float& emptyFillVal)
+    {
+        const CiftiXML& myInputXML = myCiftiIn->getCiftiXML();
+        vector<int64_t> dims = myInputXML.getDimensions();
+        int numParcels = (int)parcelMatrix.m_divisor.size();
+        int64_t numCols = dims[0];
+        const int64_t BLOCK_ROWS = 64;//read this many rows sequentially, then compute on them in parallel
+        if (direction == CiftiXML::ALONG_ROW)
+        {
+            vector<vector<int64_t> > blockIndices;
+            vector<float> blockIn(BLOCK_ROWS * numCols), blockOut(BLOCK_ROWS * numParcels);
+            MultiDimIterator<int64_t> iter(vector<int64_t>(dims.begin() + 1, dims.end()));
+            while (!iter.atEnd())
+            {
+                blockIndices.clear();
+                for (; !iter.atEnd() && (int64_t)blockIndices.size() < BLOCK_ROWS; ++iter)
+                {
+                    myCiftiIn->getRow(blockIn.data() + blockIndices.size() * numCols, *iter);
+                    blockIndices.push_back(*iter);
+                }
+                int64_t numBlockRows = (int64_t)blockIndices.size();
+#pragma omp CARET_PARFOR schedule(dynamic)
+                for (int64_t r = 0; r < numBlockRows; ++r)
+                {
+                    const float* inRow = blockIn.data() + r * numCols;
+                    float* outRow = blockOut.data() + r * numParcels;
+                    for (int p = 0; p < numParcels; ++p)
+                    {
+                        int64_t start = parcelMatrix.m_parcelStart[p], end = parcelMatrix.m_parcelStart[p + 1];
+                        if (start == end)
+                        {
+                            outRow[p] = emptyFillVal;
+                            continue;
+                        }
+                        double accum = 0.0;
+                        for (int64_t k = start; k < end; ++k)
+                        {
+                            accum += inRow[parcelMatrix.m_indices[k]] * parcelMatrix.m_weights[k];
+                        }
+                        outRow[p] = accum / parcelMatrix.m_divisor[p];
+                    }
+                }
+                for (int64_t r = 0; r < numBlockRows; ++r)
+                {
+                    myCiftiOut->setRow(blockOut.data() + r * numParcels, blockIndices[r]);
+                }
+            }
+        } else {
+            vector<int64_t> otherDims = dims;
+            otherDims.erase(otherDims.begin() + direction);//direction being parcellated
+            otherDims.erase(otherDims.begin());//row
+            vector<double> accum(((int64_t)numParcels) * numCols);
+            vector<float> blockIn(BLOCK_ROWS * numCols), scratchOutRow(numCols);
+            vector<int64_t> blockRows;
+            for (MultiDimIterator<int64_t> iter(otherDims); !iter.atEnd(); ++iter)
+            {
+                vector<int64_t> indices(dims.size() - 1);//we need to add the parcellated direction index back into the index list to use it in getRow/setRow
+                for (int i = 0; i < (int)otherDims.size(); ++i)
+                {
+                    if (i < direction - 1)
+                    {
+                        indices[i] = (*iter)[i];
+                    } else {
+                        indices[i + 1] = (*iter)[i];
+                    }
+                }
+                accum.assign(accum.size(), 0.0);
+                int64_t i = 0;
+                while (i < dims[direction])
+                {//stream the rows in file order, each row is added into the accumulator of its parcel
+                    blockRows.clear();
+                    for (; i < dims[direction] && (int64_t)blockRows.size() < BLOCK_ROWS; ++i)
+                    {
+                        if (parcelMatrix.m_indexToParcel[i] == -1) continue;
+                        indices[direction - 1] = i;
+                        myCiftiIn->getRow(blockIn.data() + blockRows.size() * numCols, indices);
+                        blockRows.push_back(i);
+                    }
+                    int64_t numBlockRows = (int64_t)blockRows.size();
+#pragma omp CARET_PARFOR schedule(static)
+                    for (int64_t c = 0; c < numCols; ++c)
+                    {//split by column so that no two threads touch the same accumulator, and each element is still summed in row order
+                        for (int64_t r = 0; r < numBlockRows; ++r)
+                        {
+                            int64_t index = blockRows[r];
+                            accum[parcelMatrix.m_indexToParcel[index] * numCols + c] += blockIn[r * numCols + c] * parcelMatrix.m_indexWeight[index];
+                        }
+                    }
+                }
+                for (int p = 0; p < numParcels; ++p)
+                {
+                    indices[direction - 1] = p;
+                    if (parcelMatrix.m_parcelStart[p] == parcelMatrix.m_parcelStart[p + 1])
+                    {
+                        scratchOutRow.assign(numCols, emptyFillVal);
+                    } else {
+                        const double* accumRow = accum.data() + ((int64_t)p) * numCols;
+                        for (int64_t c = 0; c < numCols; ++c)
+                        {
+                            scratchOutRow[c] = accumRow[c] / parcelMatrix.m_divisor[p];
+                        }
+                    }
+                    myCiftiOut->setRow(scratchOutRow.data(), indices);
+                }
+            }
+        }
+    }
+}
+
 AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const CiftiFile* myCiftiLabel, const int& direction, CiftiFile* myCiftiOut,
                                                    const ReductionEnum::Enum& method, const float& excludeLow, const float& excludeHigh, const bool& onlyNumeric,
                                                    const bool& includeEmpty, const float& emptyFillVal, CiftiFile* emptyMaskOut) : AbstractAlgorithm(myProgObj)
@@ -323,6 +495,13 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
     {
         CaretLogWarning(ReductionEnum::toName(method) + " reduction requested while parcellating label data");
     }
+    if (canParcellateLinear(method, excludeLow, excludeHigh, onlyNumeric, isLabel))
+    {
+        ParcelMatrix parcelMatrix;
+        makeParcelMatrix(indexToParcel, numParcels, NULL, method, parcelMatrix);
+        doLinearParcellation(myCiftiIn, direction, myCiftiOut, parcelMatrix, emptyFillVal);
+        return;
+    }
     if (direction == CiftiXML::ALONG_ROW)
     {
         vector<float> scratchOutRow(numParcels);
@@ -351,6 +530,7 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
                     }
                 }
             }
+#pragma omp CARET_PARFOR schedule(dynamic)
             for (int j = 0; j < numParcels; ++j)
             {
                 CaretAssert(parcelCounts[j] == (int64_t)parcelData[j].size());
@@ -436,6 +616,7 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
                 vector<vector<float> >& parcelRef = parcelData[i];
                 if (count > 0 && (method != ReductionEnum::SAMPSTDEV || count > 1))
                 {
+#pragma omp CARET_PARFOR schedule(dynamic)
                     for (int j = 0; j < numCols; ++j)
                     {
                         CaretAssert((int64_t)parcelRef[j].size() == count);
@@ -520,6 +701,13 @@ namespace
             }
             emptyMaskOut->setColumn(emptyMaskData.data(), 0);
         }
+        if (canParcellateLinear(method, excludeLow, excludeHigh, onlyNumeric, isLabel))
+        {
+            ParcelMatrix parcelMatrix;
+            makeParcelMatrix(indexToParcel, numParcels, &parcelWeights, method, parcelMatrix);
+            doLinearParcellation(myCiftiIn, direction, myCiftiOut, parcelMatrix, emptyFillVal);
+            return;
+        }
         int64_t numCols = myInputXML.getDimensionLength(CiftiXML::ALONG_ROW);
         vector<float> scratchRow(numCols);
         if (direction == CiftiXML::ALONG_ROW)
@@ -550,6 +738,7 @@ namespace
                         }
                     }
                 }
+#pragma omp CARET_PARFOR schedule(dynamic)
                 for (int j = 0; j < numParcels; ++j)
                 {
                     CaretAssert(parcelWeights[j].size() == parcelData[j].size());
@@ -635,6 +824,7 @@ namespace
                     vector<vector<float> >& parcelRef = parcelData[i];
                     if (count > 0 && (method != ReductionEnum::SAMPSTDEV || count > 1))
                     {
+#pragma omp CARET_PARFOR schedule(dynamic)
                         for (int j = 0; j < numCols; ++j)
                         {
                             CaretAssert((int64_t)parcelRef[j].size() == count);
@@ -108,22 +108,34 @@ AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const Cift
     vector<int64_t> inDims = inputXML.getDimensions();
     if (direction == CiftiXML::ALONG_ROW)
     {
-        vector<float> scratchInRow(inDims[0]);
-        for (MultiDimIterator<int64_t> iter(vector<int64_t>(inDims.begin() + 1, inDims.end())); !iter.atEnd(); ++iter)
-        {// + 1 to exclude row dimension, because getRow/setRow
-            ciftiIn->getRow(scratchInRow.data(), *iter);
-            float result = -1;
-            if (onlyNumeric)
+        const int64_t BLOCK_ROWS = 64;//read a block of rows, then reduce them in parallel
+        vector<float> scratchInRows(BLOCK_ROWS * inDims[0]), results(BLOCK_ROWS);
+        vector<vector<int64_t> > blockIndices;
+        blockIndices.reserve(BLOCK_ROWS);
+        MultiDimIterator<int64_t> iter(vector<int64_t>(inDims.begin() + 1, inDims.end()));// + 1 to exclude row dimension, because getRow/setRow
+        while (!iter.atEnd())
+        {
+            blockIndices.clear();
+            for (; !iter.atEnd() && (int64_t)blockIndices.size() < BLOCK_ROWS; ++iter)
+            {
+                ciftiIn->getRow(scratchInRows.data() + blockIndices.size() * inDims[0], *iter);
+                blockIndices.push_back(*iter);
+            }
+            int64_t numInBlock = (int64_t)blockIndices.size();
+            ReductionOperation::reduceRows(scratchInRows.data(), numInBlock, inDims[0], inDims[0], myReduce, results.data(), onlyNumeric);
+            for (int64_t i = 0; i < numInBlock; ++i)
             {
-                result = ReductionOperation::reduceOnlyNumeric(scratchInRow.data(), inDims[0], myReduce);
-            } else {
-                result = ReductionOperation::reduce(scratchInRow.data(), inDims[0], myReduce);
+                ciftiOut->setRow(&(results[i]), blockIndices[i]);//if reducing along row, length of output row is 1
             }
-            ciftiOut->setRow(&result, *iter);//if reducing along row, length of output row is 1
         }
     } else {
-        vector<vector<float> > scratchInRows(inDims[direction], vector<float>(inDims[0]));
-        vector<float> outRow(inDims[0]), reduceScratch(inDims[direction]);//reduction isn't along row, so out rows will be same length as in rows
+        vector<float> scratchInRows(inDims[direction] * inDims[0]);
+        vector<const float*> rowPointers(inDims[direction]);
+        for (int64_t i = 0; i < inDims[direction]; ++i)
+        {
+            rowPointers[i] = scratchInRows.data() + i * inDims[0];
+        }
+        vector<float> outRow(inDims[0]);//reduction isn't along row, so out rows will be same length as in rows
         vector<int64_t> otherDims = inDims;
         otherDims.erase(otherDims.begin() + direction);//direction isn't 0
         otherDims.erase(otherDims.begin());//remove row direction because getRow/setRow
@@ -134,21 +146,9 @@ AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const Cift
             for (int64_t i = 0; i < inDims[direction]; ++i)
             {
                 indexvec[direction - 1] = i;
-                ciftiIn->getRow(scratchInRows[i].data(), indexvec);
-            }
-            for (int64_t i = 0; i < inDims[0]; ++i)
-            {
-                for (int64_t j = 0; j < inDims[direction]; ++j)
-                {//need reduction input in contiguous array
-                    reduceScratch[j] = scratchInRows[j][i];
-                }
-                if (onlyNumeric)
-                {
-                    outRow[i] = ReductionOperation::reduceOnlyNumeric(reduceScratch.data(), inDims[direction], myReduce);
-                } else {
-                    outRow[i] = ReductionOperation::reduce(reduceScratch.data(), inDims[direction], myReduce);
-                }
+                ciftiIn->getRow(scratchInRows.data() + i * inDims[0], indexvec);
             }
+            ReductionOperation::reduceColumns(rowPointers.data(), inDims[direction], inDims[0], myReduce, outRow.data(), onlyNumeric);//reduces across the rows without transposing
             indexvec[direction - 1] = 0;//only one element along reduce output direction
             ciftiOut->setRow(outRow.data(), indexvec);
         }
@@ -171,16 +171,34 @@ AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const Cift
     vector<int64_t> inDims = inputXML.getDimensions();
     if (direction == CiftiXML::ALONG_ROW)
     {
-        vector<float> scratchInRow(inDims[0]);
-        for (MultiDimIterator<int64_t> iter(vector<int64_t>(inDims.begin() + 1, inDims.end())); !iter.atEnd(); ++iter)
-        {// + 1 to exclude row dimension, because getRow/setRow
-            ciftiIn->getRow(scratchInRow.data(), *iter);
-            float result = ReductionOperation::reduceExcludeDev(scratchInRow.data(), inDims[0], myReduce, sigmaBelow, sigmaAbove);
-            ciftiOut->setRow(&result, *iter);//if reducing along row, length of output row is 1
+        const int64_t BLOCK_ROWS = 64;//read a block of rows, then reduce them in parallel
+        vector<float> scratchInRows(BLOCK_ROWS * inDims[0]), results(BLOCK_ROWS);
+        vector<vector<int64_t> > blockIndices;
+        blockIndices.reserve(BLOCK_ROWS);
+        MultiDimIterator<int64_t> iter(vector<int64_t>(inDims.begin() + 1, inDims.end()));// + 1 to exclude row dimension, because getRow/setRow
+        while (!iter.atEnd())
+        {
+            blockIndices.clear();
+            for (; !iter.atEnd() && (int64_t)blockIndices.size() < BLOCK_ROWS; ++iter)
+            {
+                ciftiIn->getRow(scratchInRows.data() + blockIndices.size() * inDims[0], *iter);
+                blockIndices.push_back(*iter);
+            }
+            int64_t numInBlock = (int64_t)blockIndices.size();
+            ReductionOperation::reduceRowsExcludeDev(scratchInRows.data(), numInBlock, inDims[0], inDims[0], myReduce, sigmaBelow, sigmaAbove, results.data());
+            for (int64_t i = 0; i < numInBlock; ++i)
+            {
+                ciftiOut->setRow(&(results[i]), blockIndices[i]);//if reducing along row, length of output row is 1
+            }
         }
     } else {
-        vector<vector<float> > scratchInRows(inDims[direction], vector<float>(inDims[0]));
-        vector<float> outRow(inDims[0]), reduceScratch(inDims[direction]);//reduction isn't along row, so out rows will be same length as in rows
+        vector<float> scratchInRows(inDims[direction] * inDims[0]);
+        vector<const float*> rowPointers(inDims[direction]);
+        for (int64_t i = 0; i < inDims[direction]; ++i)
+        {
+            rowPointers[i] = scratchInRows.data() + i * inDims[0];
+        }
+        vector<float> outRow(inDims[0]);//reduction isn't along row, so out rows will be same length as in rows
         vector<int64_t> otherDims = inDims;
         otherDims.erase(otherDims.begin() + direction);//direction isn't 0
         otherDims.erase(otherDims.begin());//remove row direction because getRow/setRow
@@ -191,16 +209,9 @@ AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const Cift
             for (int64_t i = 0; i < inDims[direction]; ++i)
             {
                 indexvec[direction - 1] = i;
-                ciftiIn->getRow(scratchInRows[i].data(), indexvec);
-            }
-            for (int64_t i = 0; i < inDims[0]; ++i)
-            {
-                for (int64_t j = 0; j < inDims[direction]; ++j)
-                {//need reduction input in contiguous array
-                    reduceScratch[j] = scratchInRows[j][i];
-                }
-                outRow[i] = ReductionOperation::reduceExcludeDev(reduceScratch.data(), inDims[direction], myReduce, sigmaBelow, sigmaAbove);
+                ciftiIn->getRow(scratchInRows.data() + i * inDims[0], indexvec);
             }
+            ReductionOperation::reduceColumnsExcludeDev(rowPointers.data(), inDims[direction], inDims[0], myReduce, sigmaBelow, sigmaAbove, outRow.data());//reduces across the rows without transposing
             indexvec[direction - 1] = 0;//only one element along reduce output direction
             ciftiOut->setRow(outRow.data(), indexvec);
         }
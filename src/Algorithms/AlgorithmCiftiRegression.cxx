@@ -0,0 +1,250 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AlgorithmCiftiRegression.h"
+#include "AlgorithmException.h"
+
+#include "CaretLogger.h"
+#include "CiftiFile.h"
+
+#include <QRegExp>
+#include <QStringList>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+using namespace caret;
+using namespace std;
+
+AString AlgorithmCiftiRegression::getCommandSwitch()
+{
+    return "-cifti-regression";
+}
+
+AString AlgorithmCiftiRegression::getShortDescription()
+{
+    return "REGRESS A DESIGN MATRIX OUT OF CIFTI TIMESERIES";
+}
+
+OperationParameters* AlgorithmCiftiRegression::getParameters()
+{
+    OperationParameters* ret = new OperationParameters();
+    ret->addCiftiParameter(1, "cifti-in", "the input cifti file, with timepoints along rows");
+    
+    ret->addStringParameter(2, "design", "text file of regressors, one line per timepoint, one column per regressor");
+    
+    ret->addCiftiOutputParameter(3, "cifti-out", "output - the residuals");
+    
+    ParameterComponent* keepOpt = ret->createRepeatableParameter(4, "-keep", "include a design column in the regression, but don't remove it");
+    keepOpt->addIntegerParameter(1, "column", "the 1-based column number in the design file");
+    
+    OptionalParameter* betasOpt = ret->createOptionalParameter(5, "-betas", "output the regression coefficients");
+    betasOpt->addCiftiOutputParameter(1, "betas-out", "the coefficients, as a dscalar file, the last map is the intercept");
+    
+    ret->setHelpText(
+        AString("Fits the design to every row of the input by least squares, and removes the fitted contribution of each design column ") +
+        "that isn't specified with -keep.  " +
+        "An intercept column is always added to the design and is never removed, and the removed columns are demeaned before their fitted contribution is subtracted, so the mean of each row is unchanged.  " +
+        "The fit is precomputed once with a QR decomposition, and rows are processed in blocks without loading the entire input into memory."
+    );
+    return ret;
+}
+
+void AlgorithmCiftiRegression::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
+{
+    CiftiFile* myCifti = myParams->getCifti(1);
+    DenseMatrix design = readDesignFile(myParams->getString(2));
+    CiftiFile* myCiftiOut = myParams->getOutputCifti(3);
+    vector<int> keepColumns;
+    const vector<ParameterComponent*>& keepInstances = *(myParams->getRepeatableParameterInstances(4));
+    for (int i = 0; i < (int)keepInstances.size(); ++i)
+    {
+        int64_t column = keepInstances[i]->getInteger(1);
+        if (column < 1 || column > design.getNumberOfColumns()) throw AlgorithmException("-keep column " + AString::number(column) + " is not in the design file");
+        keepColumns.push_back((int)column - 1);
+    }
+    CiftiFile* myBetasOut = NULL;
+    OptionalParameter* betasOpt = myParams->getOptionalParameter(5);
+    if (betasOpt->m_present)
+    {
+        myBetasOut = betasOpt->getOutputCifti(1);
+    }
+    AlgorithmCiftiRegression(myProgObj, myCifti, design, myCiftiOut, keepColumns, myBetasOut);
+}
+
+AlgorithmCiftiRegression::AlgorithmCiftiRegression(ProgressObject* myProgObj, const CiftiFile* myCifti, const DenseMatrix& design, CiftiFile* myCiftiOut,
+                                                   const vector<int>& keepColumns, CiftiFile* myBetasOut) : AbstractAlgorithm(myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    const CiftiXML& myXML = myCifti->getCiftiXML();
+    if (myXML.getNumberOfDimensions() != 2) throw AlgorithmException("regression only supports 2D cifti");
+    const int64_t rowLength = myXML.getDimensionLength(CiftiXML::ALONG_ROW), numRows = myXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
+    if (design.getNumberOfRows() != rowLength)
+    {
+        throw AlgorithmException("design has " + AString::number(design.getNumberOfRows()) + " rows, but the input has " + AString::number(rowLength) + " timepoints");
+    }
+    DenseMatrix solverTranspose, removeDesignTranspose;
+    vector<int> removeColumns;
+    prepareDesign(design, keepColumns, solverTranspose, removeDesignTranspose, removeColumns);
+    const int numRegressors = (int)solverTranspose.getNumberOfColumns(), numRemove = (int)removeColumns.size();
+    myCiftiOut->setCiftiXML(myXML);
+    if (myBetasOut != NULL)
+    {
+        CiftiXML betasXML = myXML;
+        CiftiScalarsMap betasMap;
+        betasMap.setLength(numRegressors);
+        for (int i = 0; i < numRegressors - 1; ++i)
+        {
+            betasMap.setMapName(i, "column " + AString::number(i + 1));
+        }
+        betasMap.setMapName(numRegressors - 1, "intercept");
+        betasXML.setMap(CiftiXML::ALONG_ROW, betasMap);
+        myBetasOut->setCiftiXML(betasXML);
+    }
+    const int64_t BLOCK_ROWS = 512;//input block is 512 x timepoints, so a 4800 timepoint block is under 10MB
+    DenseMatrix inBlock(BLOCK_ROWS, rowLength), betasBlock, removeBlock(BLOCK_ROWS, numRemove), fitted;
+    for (int64_t blockStart = 0; blockStart < numRows; blockStart += BLOCK_ROWS)
+    {
+        const int64_t blockSize = min(BLOCK_ROWS, numRows - blockStart);
+        if (blockSize != inBlock.getNumberOfRows())
+        {//last block
+            inBlock.resize(blockSize, rowLength, true);
+            removeBlock.resize(blockSize, numRemove, true);
+        }
+        for (int64_t i = 0; i < blockSize; ++i)
+        {
+            myCifti->getRow(inBlock.getRow(i), blockStart + i);
+        }
+        DenseMatrix::multiply(inBlock, solverTranspose, betasBlock);//every row's coefficients at once
+        if (numRemove > 0)
+        {
+            for (int64_t i = 0; i < blockSize; ++i)
+            {
+                const float* betasRow = betasBlock.getRow(i);
+                float* removeRow = removeBlock.getRow(i);
+                for (int k = 0; k < numRemove; ++k)
+                {
+                    removeRow[k] = betasRow[removeColumns[k]];
+                }
+            }
+            DenseMatrix::multiply(removeBlock, removeDesignTranspose, fitted);
+            for (int64_t i = 0; i < blockSize; ++i)
+            {
+                float* inRow = inBlock.getRow(i);
+                const float* fittedRow = fitted.getRow(i);
+                for (int64_t t = 0; t < rowLength; ++t)
+                {
+                    inRow[t] -= fittedRow[t];
+                }
+            }
+        }
+        for (int64_t i = 0; i < blockSize; ++i)
+        {
+            myCiftiOut->setRow(inBlock.getRow(i), blockStart + i);
+            if (myBetasOut != NULL)
+            {
+                myBetasOut->setRow(betasBlock.getRow(i), blockStart + i);
+            }
+        }
+        myProgress.reportProgress(((float)(blockStart + blockSize)) / numRows);
+    }
+}
+
+DenseMatrix AlgorithmCiftiRegression::readDesignFile(const AString& fileName)
+{
+    ifstream designFile(fileName.toLocal8Bit().constData());
+    if (!designFile.good()) throw AlgorithmException("failed to open design file '" + fileName + "'");
+    vector<vector<float> > designData;
+    string designLine;
+    while (designFile)
+    {
+        getline(designFile, designLine);
+        QStringList tokens = QString(designLine.c_str()).split(QRegExp("\\s+"), QString::SkipEmptyParts);
+        if (tokens.empty()) break;//in case there are extra newlines on the end
+        if (!designData.empty() && (int)designData.back().size() != tokens.size())
+            throw AlgorithmException("design file is not a rectangular matrix, starting at line " + AString::number(designData.size() + 1));
+        designData.push_back(vector<float>());
+        for (int i = 0; i < tokens.size(); ++i)
+        {
+            bool ok = false;
+            designData.back().push_back(tokens[i].toFloat(&ok));
+            if (!ok) throw AlgorithmException("design file contains non-number '" + tokens[i] + "'");
+        }
+    }
+    if (designData.empty() || designData[0].empty()) throw AlgorithmException("design file contains no data");
+    return DenseMatrix(designData);
+}
+
+void AlgorithmCiftiRegression::prepareDesign(const DenseMatrix& design, const vector<int>& keepColumns, DenseMatrix& solverTransposeOut,
+                                             DenseMatrix& removeDesignTransposeOut, vector<int>& removeColumnsOut)
+{
+    const int64_t numTimepoints = design.getNumberOfRows(), numColumns = design.getNumberOfColumns();
+    DenseMatrix withIntercept = design;
+    withIntercept.resize(numTimepoints, numColumns + 1);
+    for (int64_t t = 0; t < numTimepoints; ++t)
+    {
+        withIntercept(t, numColumns) = 1.0f;
+    }
+    if (numTimepoints < numColumns + 1) throw AlgorithmException("design has more regressors (including the intercept) than timepoints");
+    DenseMatrix solver;
+    if (!withIntercept.pseudoInverse(solver)) throw AlgorithmException("design matrix is rank deficient, check the regressors for linear independence and constant columns");
+    solverTransposeOut = solver.transpose();//timepoints x regressors, so a block of rows times this gives their coefficients
+    vector<bool> keep(numColumns, false);
+    for (int i = 0; i < (int)keepColumns.size(); ++i)
+    {
+        if (keepColumns[i] < 0 || keepColumns[i] >= numColumns) throw AlgorithmException("keep column " + AString::number(keepColumns[i] + 1) + " is not in the design");
+        keep[keepColumns[i]] = true;
+    }
+    removeColumnsOut.clear();
+    for (int i = 0; i < numColumns; ++i)
+    {
+        if (!keep[i]) removeColumnsOut.push_back(i);
+    }
+    if (removeColumnsOut.empty()) CaretLogWarning("all design columns are kept, output will be the same as the input");
+    const int numRemove = (int)removeColumnsOut.size();
+    removeDesignTransposeOut.resize(numRemove, numTimepoints, true);
+    for (int k = 0; k < numRemove; ++k)
+    {//demeaned, the intercept absorbs the difference, so removing these doesn't change the mean
+        double accum = 0.0;
+        for (int64_t t = 0; t < numTimepoints; ++t)
+        {
+            accum += design(t, removeColumnsOut[k]);
+        }
+        const float columnMean = accum / numTimepoints;
+        float* outRow = removeDesignTransposeOut.getRow(k);
+        for (int64_t t = 0; t < numTimepoints; ++t)
+        {
+            outRow[t] = design(t, removeColumnsOut[k]) - columnMean;
+        }
+    }
+}
+
+float AlgorithmCiftiRegression::getAlgorithmInternalWeight()
+{
+    return 1.0f;//override this if needed, if the progress bar isn't smooth
+}
+
+float AlgorithmCiftiRegression::getSubAlgorithmWeight()
+{
+    //return AlgorithmInsertNameHere::getAlgorithmWeight();//if you use a subalgorithm
+    return 0.0f;
+}
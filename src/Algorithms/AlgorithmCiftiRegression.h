@@ -0,0 +1,57 @@
+#ifndef __ALGORITHM_CIFTI_REGRESSION_H__
+#define __ALGORITHM_CIFTI_REGRESSION_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AbstractAlgorithm.h"
+#include "DenseMatrix.h"
+
+#include <vector>
+
+namespace caret {
+    
+    class AlgorithmCiftiRegression : public AbstractAlgorithm
+    {
+        AlgorithmCiftiRegression();
+    protected:
+        static float getSubAlgorithmWeight();
+        static float getAlgorithmInternalWeight();
+    public:
+        ///design has one row per timepoint, an intercept column is added internally and is never removed, keepColumns are 0-based
+        AlgorithmCiftiRegression(ProgressObject* myProgObj, const CiftiFile* myCifti, const DenseMatrix& design, CiftiFile* myCiftiOut,
+                                 const std::vector<int>& keepColumns = std::vector<int>(), CiftiFile* myBetasOut = NULL);
+        static OperationParameters* getParameters();
+        static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
+        static AString getCommandSwitch();
+        static AString getShortDescription();
+        
+        ///read whitespace separated text, one line per timepoint, shared with -volume-regression
+        static DenseMatrix readDesignFile(const AString& fileName);
+        ///add the intercept column, precompute the least squares solver with QR, and set up the part of the design to remove
+        static void prepareDesign(const DenseMatrix& design, const std::vector<int>& keepColumns, DenseMatrix& solverTransposeOut,
+                                  DenseMatrix& removeDesignTransposeOut, std::vector<int>& removeColumnsOut);
+    };
+
+    typedef TemplateAutoOperation<AlgorithmCiftiRegression> AutoAlgorithmCiftiRegression;
+
+}
+
+#endif //__ALGORITHM_CIFTI_REGRESSION_H__
@@ -20,8 +20,14 @@
 
 #include "AlgorithmCiftiTranspose.h"
 #include "AlgorithmException.h"
+#include "CaretLogger.h"
 #include "CiftiFile.h"
 
+#include <QTemporaryFile>
+
+#include <algorithm>
+#include <vector>
+
 using namespace caret;
 using namespace std;
 
@@ -47,7 +53,10 @@ OperationParameters* AlgorithmCiftiTranspose::getParameters()
     
     ret->setHelpText(
         AString("The input must be a 2-dimensional cifti file.  ") +
-        "The output is a cifti file where every row in the input is a column in the output."
+        "The output is a cifti file where every row in the input is a column in the output.\n\n" +
+        "If -mem-limit is specified and the input is too large to transpose in a few passes within that much memory, " +
+        "the input is instead read once in large blocks and transposed through a temporary file, in the directory given by the TMPDIR environment variable, " +
+        "which will be as large as the output."
     );
     return ret;
 }
@@ -82,36 +91,118 @@ AlgorithmCiftiTranspose::AlgorithmCiftiTranspose(ProgressObject* myProgObj, cons
     outXML.setMap(0, *(inXML.getMap(1)));
     outXML.setMap(1, *(inXML.getMap(0)));
     ciftiOut->setCiftiXML(outXML);
-    int rowSize = outXML.getDimensionLength(CiftiXML::ALONG_ROW), colSize = outXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
+    int64_t rowSize = outXML.getDimensionLength(CiftiXML::ALONG_ROW), colSize = outXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
     int64_t outRowBytes = rowSize * sizeof(float);
-    int numCacheRows = colSize;
+    int64_t numCacheRows = colSize;
     if (memLimitGB >= 0.0f)
     {
         numCacheRows = memLimitGB * 1024 * 1024 * 1024 / outRowBytes;
         if (numCacheRows < 1) numCacheRows = 1;
         if (numCacheRows > colSize) numCacheRows = colSize;
+        int64_t numPasses = (colSize + numCacheRows - 1) / numCacheRows;
+        if (numPasses > 2 && !ciftiIn->isInMemory())
+        {//each pass reads the entire input, so past 2 passes, spilling to disk does less IO
+            transposeOutOfCore(ciftiIn, ciftiOut, (int64_t)(memLimitGB * 1024 * 1024 * 1024));
+            return;
+        }
     }
     vector<vector<float> > cacheRows(numCacheRows, vector<float>(rowSize));
     vector<float> scratchInRow(colSize);
-    for (int i = 0; i < colSize; i += numCacheRows)//loop through cache chunks
+    for (int64_t i = 0; i < colSize; i += numCacheRows)//loop through cache chunks
     {
-        int end = i + numCacheRows;
+        int64_t end = i + numCacheRows;
         if (end > colSize) end = colSize;
-        for (int j = 0; j < rowSize; ++j)//loop through all input rows
+        for (int64_t j = 0; j < rowSize; ++j)//loop through all input rows
         {
             ciftiIn->getRow(scratchInRow.data(), j);
-            for (int k = i; k < end; ++k)
+            for (int64_t k = i; k < end; ++k)
             {
                 cacheRows[k - i][j] = scratchInRow[k];
             }
         }
-        for (int k = i; k < end; ++k)
+        for (int64_t k = i; k < end; ++k)
         {
             ciftiOut->setRow(cacheRows[k - i].data(), k);
         }
     }
 }
 
+void AlgorithmCiftiTranspose::transposeOutOfCore(const CiftiFile* ciftiIn, CiftiFile* ciftiOut, const int64_t& memLimitBytes)
+{//phase 1 reads blocks of input rows in order, and writes each block transposed to a temporary file as a "panel"
+    //phase 2 reads the same range of output rows from every panel as one contiguous read, and writes output rows in order
+    const int64_t TILE = 64;//tile size for in-memory transposes, to use the cache well
+    const vector<int64_t>& inDims = ciftiIn->getDimensions();
+    int64_t inRowLength = inDims[0], numInRows = inDims[1];//output row length is numInRows
+    int64_t panelRows = memLimitBytes / (2 * inRowLength * sizeof(float));//input block plus its transpose
+    if (panelRows < 1) panelRows = 1;
+    if (panelRows > numInRows) panelRows = numInRows;
+    QTemporaryFile tempFile;
+    if (!tempFile.open()) throw AlgorithmException("failed to create temporary file for transpose: " + tempFile.errorString());
+    CaretLogInfo("transposing through temporary file '" + tempFile.fileName() + "'");
+    vector<float> inBlock(panelRows * inRowLength), transBlock(panelRows * inRowLength);
+    for (int64_t panelStart = 0; panelStart < numInRows; panelStart += panelRows)
+    {
+        int64_t panelHeight = min(panelRows, numInRows - panelStart);
+        for (int64_t r = 0; r < panelHeight; ++r)
+        {
+            ciftiIn->getRow(inBlock.data() + r * inRowLength, panelStart + r);
+        }
+        for (int64_t kbase = 0; kbase < inRowLength; kbase += TILE)
+        {
+            int64_t kend = min(kbase + TILE, inRowLength);
+            for (int64_t rbase = 0; rbase < panelHeight; rbase += TILE)
+            {
+                int64_t rend = min(rbase + TILE, panelHeight);
+                for (int64_t k = kbase; k < kend; ++k)
+                {
+                    for (int64_t r = rbase; r < rend; ++r)
+                    {
+                        transBlock[k * panelHeight + r] = inBlock[r * inRowLength + k];
+                    }
+                }
+            }
+        }
+        int64_t panelBytes = panelHeight * inRowLength * sizeof(float);
+        if (tempFile.write((const char*)transBlock.data(), panelBytes) != panelBytes)
+        {
+            throw AlgorithmException("failed to write to temporary file for transpose: " + tempFile.errorString());
+        }
+    }
+    vector<float>().swap(inBlock);//release phase 1 memory
+    vector<float>().swap(transBlock);
+    int64_t chunkRows = memLimitBytes / ((numInRows + panelRows) * sizeof(float));//output rows, plus the read buffer for one panel
+    if (chunkRows < 1) chunkRows = 1;
+    if (chunkRows > inRowLength) chunkRows = inRowLength;
+    vector<float> outBlock(chunkRows * numInRows), readBuffer(chunkRows * panelRows);
+    for (int64_t chunkStart = 0; chunkStart < inRowLength; chunkStart += chunkRows)
+    {
+        int64_t chunkHeight = min(chunkRows, inRowLength - chunkStart);
+        for (int64_t panelStart = 0; panelStart < numInRows; panelStart += panelRows)
+        {
+            int64_t panelHeight = min(panelRows, numInRows - panelStart);
+            int64_t offset = (panelStart * inRowLength + chunkStart * panelHeight) * sizeof(float);
+            int64_t readBytes = chunkHeight * panelHeight * sizeof(float);
+            if (!tempFile.seek(offset) || tempFile.read((char*)readBuffer.data(), readBytes) != readBytes)
+            {
+                throw AlgorithmException("failed to read from temporary file for transpose: " + tempFile.errorString());
+            }
+            for (int64_t k = 0; k < chunkHeight; ++k)
+            {
+                const float* source = readBuffer.data() + k * panelHeight;
+                float* dest = outBlock.data() + k * numInRows + panelStart;
+                for (int64_t r = 0; r < panelHeight; ++r)
+                {
+                    dest[r] = source[r];
+                }
+            }
+        }
+        for (int64_t k = 0; k < chunkHeight; ++k)
+        {
+            ciftiOut->setRow(outBlock.data() + k * numInRows, chunkStart + k);
+        }
+    }
+}
+
 float AlgorithmCiftiTranspose::getAlgorithmInternalWeight()
 {
     return 1.0f;//override this if needed, if the progress bar isn't smooth
@@ -121,7 +121,12 @@ AlgorithmFociResample::AlgorithmFociResample(ProgressObject* myProgObj, const Fo
     *(fociOut->getClassColorTable()) = *(fociIn->getClassColorTable());
     *(fociOut->getNameColorTable()) = *(fociIn->getNameColorTable());
     *(fociOut->getFileMetaData()) = *(fociIn->getFileMetaData());
-    for (int i = 0; i < fociIn->getNumberOfFoci(); ++i)
+    const int numFoci = fociIn->getNumberOfFoci();
+    vector<CaretPointer<Focus> > newFoci(numFoci);
+    vector<SurfaceProjector*> batchProjectors;//project all foci as one batch, in file order, so perturbed foci use random numbers in the same order as one at a time
+    vector<Focus*> batchFoci;
+    vector<int32_t> batchIndices;
+    for (int i = 0; i < numFoci; ++i)
     {
         const Focus* thisFocus = fociIn->getFocus(i);
         if (thisFocus->getNumberOfProjections() < 1)
@@ -149,17 +154,23 @@ AlgorithmFociResample::AlgorithmFociResample(ProgressObject* myProgObj, const Fo
         }
         if (unprojFrom == NULL || myProj == NULL) throw AlgorithmException("focus '" + thisFocus->getName() + "' has structure " +
             StructureEnum::toName(thisFocus->getProjection(0)->getStructure()) + ", but surfaces for that structure were not specified");
-        CaretPointer<Focus> newFocus(new Focus(*thisFocus));//start with a copy
+        newFoci[i].grabNew(new Focus(*thisFocus));//start with a copy
         float xyz[3];
         bool result = thisFocus->getProjection(0)->getProjectedPosition(*unprojFrom, xyz, discardNormDist);
         if (!result) throw AlgorithmException("failed to unproject focus '" + thisFocus->getName() + "'");
-        newFocus->getProjection(0)->setStereotaxicXYZ(xyz);
-        myProj->projectFocus(i, newFocus);
+        newFoci[i]->getProjection(0)->setStereotaxicXYZ(xyz);
+        batchProjectors.push_back(myProj);
+        batchFoci.push_back(newFoci[i]);
+        batchIndices.push_back(i);
+    }
+    SurfaceProjector::projectFoci(batchProjectors, batchFoci, batchIndices);
+    for (int i = 0; i < numFoci; ++i)
+    {
         if (restoryXyz)
         {
-            newFocus->getProjection(0)->setStereotaxicXYZ(thisFocus->getProjection(0)->getStereotaxicXYZ());
+            newFoci[i]->getProjection(0)->setStereotaxicXYZ(fociIn->getFocus(i)->getProjection(0)->getStereotaxicXYZ());
         }
-        fociOut->addFocus(newFocus.releasePointer());
+        fociOut->addFocus(newFoci[i].releasePointer());
     }
 }
 
@@ -218,61 +218,87 @@ AlgorithmLabelToVolumeMapping::AlgorithmLabelToVolumeMapping(ProgressObject* myP
     myVolOut->reinitialize(myVolSpace, numCols, 1, SubvolumeAttributes::LABEL);
     vector<vector<VoxelWeight> > forwardWeights;
     RibbonMappingHelper::computeWeightsRibbon(forwardWeights, myVolSpace, innerSurf, outerSurf, NULL, subDivs, !thickColumn);
-    map<VoxelIJK, vector<pair<int, float> > > reverseWeights;
+    const int64_t* dims = myVolSpace.getDims();
+    const int64_t frameSize = dims[0] * dims[1] * dims[2];
+    vector<int64_t> voxelStarts(frameSize + 1, 0);//compressed sparse rows of (vertex, weight) for each voxel, instead of a map node and vector per voxel
     for (int i = 0; i < numNodes; ++i)
     {
         for (int v = 0; v < (int)forwardWeights[i].size(); ++v)
-        {//vectors initialize to empty
-            reverseWeights[VoxelIJK(forwardWeights[i][v].ijk)].push_back(pair<int, float>(i, forwardWeights[i][v].weight));
+        {
+            ++voxelStarts[myVolSpace.getIndex(forwardWeights[i][v].ijk) + 1];
         }
     }
-    const int64_t* dims = myVolSpace.getDims();
-    const int64_t frameSize = dims[0] * dims[1] * dims[2];
+    vector<int64_t> usedVoxels;
+    for (int64_t voxel = 0; voxel < frameSize; ++voxel)
+    {
+        if (voxelStarts[voxel + 1] != 0) usedVoxels.push_back(voxel);
+        voxelStarts[voxel + 1] += voxelStarts[voxel];
+    }
+    vector<pair<int, float> > reverseWeights(voxelStarts[frameSize]);
+    {
+        vector<int64_t> nextPos(voxelStarts.begin(), voxelStarts.end() - 1);
+        for (int i = 0; i < numNodes; ++i)
+        {//vertex order within each voxel is the same as before, so the float sums are too
+            for (int v = 0; v < (int)forwardWeights[i].size(); ++v)
+            {
+                reverseWeights[nextPos[myVolSpace.getIndex(forwardWeights[i][v].ijk)]++] = pair<int, float>(i, forwardWeights[i][v].weight);
+            }
+        }
+    }
+    forwardWeights.clear();
     const int32_t unlabeledVal = myLabel->getLabelTable()->getUnassignedLabelKey();
     vector<float> scratchFrame(frameSize, unlabeledVal);
+    const int64_t numUsed = (int64_t)usedVoxels.size();
     for (int m = 0; m < numCols; ++m)
     {
         const int32_t* colData = myLabel->getLabelKeyPointerForColumn(m);
-        for (map<VoxelIJK, vector<pair<int, float> > >::const_iterator iter = reverseWeights.begin(); iter != reverseWeights.end(); ++iter)
+#pragma omp CARET_PAR
         {
-            double totalWeight = 0.0;
-            map<int32_t, float> totals;
-            const vector<pair<int, float> >& vertWeightsRef = iter->second;
-            for (int i = 0; i < (int)vertWeightsRef.size(); ++i)
-            {
-                totalWeight += vertWeightsRef[i].second;
-                map<int32_t, float>::iterator iter2 = totals.find(colData[vertWeightsRef[i].first]);
-                if (iter2 == totals.end())
-                {//because floats don't initialize to 0
-                    totals[colData[vertWeightsRef[i].first]] = vertWeightsRef[i].second;
-                } else {
-                    iter2->second += vertWeightsRef[i].second;
-                }
-            }
-            float bestWeight = -1.0f;
-            int32_t bestLabel = unlabeledVal;
-            bool skipLoop = false;
-            if (!greedy)
+            vector<pair<int32_t, float> > totals;//few labels per voxel, linear search is faster than a map
+#pragma omp CARET_FOR schedule(dynamic, 1024)
+            for (int64_t u = 0; u < numUsed; ++u)
             {
-                if (thickColumn)
+                const int64_t voxel = usedVoxels[u];
+                double totalWeight = 0.0;
+                totals.clear();
+                for (int64_t w = voxelStarts[voxel]; w < voxelStarts[voxel + 1]; ++w)
                 {
-                    skipLoop = (totalWeight < 1.5);//slight hack: the thick column method basically counts every triangle three times
-                } else {
-                    skipLoop = (totalWeight < 0.5);
+                    totalWeight += reverseWeights[w].second;
+                    const int32_t thisKey = colData[reverseWeights[w].first];
+                    size_t t = 0;
+                    while (t < totals.size() && totals[t].first != thisKey) ++t;
+                    if (t == totals.size())
+                    {
+                        totals.push_back(pair<int32_t, float>(thisKey, reverseWeights[w].second));
+                    } else {
+                        totals[t].second += reverseWeights[w].second;
+                    }
                 }
-            }
-            if (!skipLoop)
-            {
-                for (map<int32_t, float>::iterator iter2 = totals.begin(); iter2 != totals.end(); ++iter2)
+                float bestWeight = -1.0f;
+                int32_t bestLabel = unlabeledVal;
+                bool skipLoop = false;
+                if (!greedy)
                 {
-                    if (iter2->second > bestWeight)
+                    if (thickColumn)
                     {
-                        bestWeight = iter2->second;
-                        bestLabel = iter2->first;
+                        skipLoop = (totalWeight < 1.5);//slight hack: the thick column method basically counts every triangle three times
+                    } else {
+                        skipLoop = (totalWeight < 0.5);
+                    }
+                }
+                if (!skipLoop)
+                {
+                    for (size_t t = 0; t < totals.size(); ++t)
+                    {//ties go to the lowest key, as when this was a map
+                        if (totals[t].second > bestWeight || (totals[t].second == bestWeight && totals[t].first < bestLabel))
+                        {
+                            bestWeight = totals[t].second;
+                            bestLabel = totals[t].first;
+                        }
                     }
                 }
+                scratchFrame[voxel] = bestLabel;
             }
-            scratchFrame[myVolSpace.getIndex(iter->first.m_ijk)] = bestLabel;
         }
         myVolOut->setFrame(scratchFrame.data(), m);
         *(myVolOut->getMapLabelTable(m)) = *(myLabel->getLabelTable());
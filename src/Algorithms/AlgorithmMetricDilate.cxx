@@ -24,6 +24,7 @@
 #include "CaretAssert.h"
 #include "CaretOMP.h"
 #include "GeodesicHelper.h"
+#include "GeodesicNeighborhood.h"
 #include "MetricFile.h"
 #include "PaletteColorMapping.h"
 #include "SurfaceFile.h"
@@ -589,10 +590,13 @@ void AlgorithmMetricDilate::precomputeStencils(vector<pair<int, StencilElem> >&
     myStencils.resize(badCount);//initializes all stencils to have empty lists
     badCount = 0;
     CaretPointer<GeodesicHelperBase> correctedBase;
+    const float* corrAreaData = NULL;
     if (corrAreas != NULL)
     {
-        correctedBase.grabNew(new GeodesicHelperBase(mySurf, corrAreas->getValuePointerForColumn(0)));//NOTE: myAreas also points to this when applicable
+        corrAreaData = corrAreas->getValuePointerForColumn(0);
+        correctedBase.grabNew(new GeodesicHelperBase(mySurf, corrAreaData));//NOTE: myAreas also points to this when applicable
     }
+    CaretPointer<const GeodesicNeighborhood> myGeoNeigh = GeodesicNeighborhood::getIfCached(mySurf, distance, corrAreaData);//usually only a few bad vertices, so don't compute neighborhoods for every vertex
 #pragma omp CARET_PAR
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
@@ -616,8 +620,27 @@ void AlgorithmMetricDilate::precomputeStencils(vector<pair<int, StencilElem> >&
                 }
                 myStencils[myIndex].first = i;
                 StencilElem& myElem = myStencils[myIndex].second;
-                float closestDist;
-                int closestNode = myGeoHelp->getClosestNodeInRoi(i, charRoi.data(), distance, closestDist);
+                float closestDist = -1.0f;
+                int closestNode = -1;
+                const int32_t* geoNodes = NULL;
+                const float* geoDists = NULL;
+                int64_t geoCount = 0;
+                if (myGeoNeigh != NULL)
+                {
+                    geoNodes = myGeoNeigh->getNeighbors(i);
+                    geoDists = myGeoNeigh->getDistances(i);
+                    geoCount = myGeoNeigh->getNeighborCount(i);
+                    for (int64_t j = 0; j < geoCount; ++j)
+                    {
+                        if (charRoi[geoNodes[j]] != 0 && (closestNode == -1 || geoDists[j] < closestDist))
+                        {
+                            closestNode = geoNodes[j];
+                            closestDist = geoDists[j];
+                        }
+                    }
+                } else {
+                    closestNode = myGeoHelp->getClosestNodeInRoi(i, charRoi.data(), distance, closestDist);
+                }
                 if (closestNode == -1)//check neighbors, to ensure we dilate by at least one node everywhere
                 {
                     const vector<int32_t>& nodeList = myTopoHelp->getNodeNeighbors(i);
@@ -637,7 +660,20 @@ void AlgorithmMetricDilate::precomputeStencils(vector<pair<int, StencilElem> >&
                 {
                     vector<int32_t> nodeList;
                     vector<float> distList;
-                    myGeoHelp->getNodesToGeoDist(i, closestDist * cutoffRatio, nodeList, distList);
+                    const float cutoffDist = closestDist * cutoffRatio;
+                    if (myGeoNeigh != NULL && cutoffDist <= myGeoNeigh->getDistance())
+                    {
+                        for (int64_t j = 0; j < geoCount; ++j)
+                        {
+                            if (geoDists[j] <= cutoffDist)
+                            {
+                                nodeList.push_back(geoNodes[j]);
+                                distList.push_back(geoDists[j]);
+                            }
+                        }
+                    } else {//not cached, or the cutoff reaches past the cached distance
+                        myGeoHelp->getNodesToGeoDist(i, cutoffDist, nodeList, distList);
+                    }
                     int numInRange = (int)nodeList.size();
                     myElem.m_weightsum = 0.0f;
                     for (int j = 0; j < numInRange; ++j)
@@ -712,10 +748,13 @@ void AlgorithmMetricDilate::precomputeNearest(vector<pair<int, int> >& myNearest
     myNearest.resize(badCount);
     badCount = 0;
     CaretPointer<GeodesicHelperBase> correctedBase;
+    const float* corrAreaData = NULL;
     if (corrAreas != NULL)
     {
-        correctedBase.grabNew(new GeodesicHelperBase(mySurf, corrAreas->getValuePointerForColumn(0)));//NOTE: myAreas also points to this when applicable
+        corrAreaData = corrAreas->getValuePointerForColumn(0);
+        correctedBase.grabNew(new GeodesicHelperBase(mySurf, corrAreaData));//NOTE: myAreas also points to this when applicable
     }
+    CaretPointer<const GeodesicNeighborhood> myGeoNeigh = GeodesicNeighborhood::getIfCached(mySurf, distance, corrAreaData);//same as above
 #pragma omp CARET_PAR
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
@@ -738,8 +777,27 @@ void AlgorithmMetricDilate::precomputeNearest(vector<pair<int, int> >& myNearest
                     ++badCount;
                 }
                 myNearest[myIndex].first = i;
-                float closestDist;
-                int closestNode = myGeoHelp->getClosestNodeInRoi(i, charRoi.data(), distance, closestDist);
+                float closestDist = -1.0f;
+                int closestNode = -1;
+                const int32_t* geoNodes = NULL;
+                const float* geoDists = NULL;
+                int64_t geoCount = 0;
+                if (myGeoNeigh != NULL)
+                {
+                    geoNodes = myGeoNeigh->getNeighbors(i);
+                    geoDists = myGeoNeigh->getDistances(i);
+                    geoCount = myGeoNeigh->getNeighborCount(i);
+                    for (int64_t j = 0; j < geoCount; ++j)
+                    {
+                        if (charRoi[geoNodes[j]] != 0 && (closestNode == -1 || geoDists[j] < closestDist))
+                        {
+                            closestNode = geoNodes[j];
+                            closestDist = geoDists[j];
+                        }
+                    }
+                } else {
+                    closestNode = myGeoHelp->getClosestNodeInRoi(i, charRoi.data(), distance, closestDist);
+                }
                 if (closestNode == -1)//check neighbors, to ensure we dilate by at least one node everywhere
                 {
                     const vector<int32_t>& nodeList = myTopoHelp->getNodeNeighbors(i);
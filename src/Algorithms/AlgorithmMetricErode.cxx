@@ -22,7 +22,7 @@
 #include "AlgorithmException.h"
 
 #include "CaretOMP.h"
-#include "GeodesicHelper.h"
+#include "GeodesicNeighborhood.h"
 #include "MetricFile.h"
 #include "PaletteColorMapping.h"
 #include "SurfaceFile.h"
@@ -109,35 +109,21 @@ namespace
     {
         int numNodes = mySurf->getNumberOfNodes();
         vector<vector<int32_t> > ret(numNodes);
-        CaretPointer<GeodesicHelperBase> myGeoBase;
-        if (corrAreas != NULL)
-        {
-            myGeoBase.grabNew(new GeodesicHelperBase(mySurf, corrAreas->getValuePointerForColumn(0)));
-        }
+        const float* corrAreaData = NULL;
+        if (corrAreas != NULL) corrAreaData = corrAreas->getValuePointerForColumn(0);
+        CaretPointer<const GeodesicNeighborhood> myGeoNeigh = GeodesicNeighborhood::get(mySurf, distance, corrAreaData);//shared with other algorithms using the same surface and distance
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();//we aren't using to depth, so share the topology helper
-#pragma omp CARET_PAR
-        {//use parallel here so each thread gets its own geodesic helper
-            CaretPointer<GeodesicHelper> myGeoHelp;
-            if (corrAreas == NULL)
-            {
-                myGeoHelp = mySurf->getGeodesicHelper();
-            } else {
-                myGeoHelp.grabNew(new GeodesicHelper(myGeoBase));
-            }
-#pragma omp CARET_FOR schedule(dynamic)
-            for (int i = 0; i < numNodes; ++i)
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int i = 0; i < numNodes; ++i)
+        {
+            if (roiCol == NULL || roiCol[i] > 0.0f)
             {
-                if (roiCol == NULL || roiCol[i] > 0.0f)
-                {
-                    vector<int32_t> geoNodes;
-                    vector<float> geoDists;
-                    myGeoHelp->getNodesToGeoDist(i, distance, geoNodes, geoDists);
-                    const vector<int32_t>& topoNodes = myTopoHelp->getNodeNeighbors(i);
-                    set<int32_t> mergeSet(geoNodes.begin(), geoNodes.end());
-                    mergeSet.insert(topoNodes.begin(), topoNodes.end());
-                    mergeSet.erase(i);//center of stencil is already 0 if stencil is used, so don't set it again
-                    ret[i] = vector<int32_t>(mergeSet.begin(), mergeSet.end());
-                }
+                const int32_t* geoNodes = myGeoNeigh->getNeighbors(i);
+                const vector<int32_t>& topoNodes = myTopoHelp->getNodeNeighbors(i);
+                set<int32_t> mergeSet(geoNodes, geoNodes + myGeoNeigh->getNeighborCount(i));
+                mergeSet.insert(topoNodes.begin(), topoNodes.end());
+                mergeSet.erase(i);//center of stencil is already 0 if stencil is used, so don't set it again
+                ret[i] = vector<int32_t>(mergeSet.begin(), mergeSet.end());
             }
         }
         return ret;
@@ -24,6 +24,7 @@
 #include "CaretHeap.h"
 #include "CaretOMP.h"
 #include "GeodesicHelper.h"
+#include "GeodesicNeighborhood.h"
 #include "MetricFile.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
@@ -406,8 +407,8 @@ void AlgorithmMetricExtrema::precomputeNeighborhoods(const SurfaceFile* mySurf,
     neighborhoods.clear();
     neighborhoods.resize(numNodes);
     CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();//can share this, we will only use 1-hop neighbors
-    CaretPointer<GeodesicHelper> myGeoHelp = mySurf->getGeodesicHelper();//must be thread-private
-    vector<float> junk;//also thread-private
+    CaretPointer<const GeodesicNeighborhood> myGeoNeigh = GeodesicNeighborhood::get(mySurf, distance);//shared with other algorithms using the same surface and distance
+#pragma omp CARET_PARFOR schedule(dynamic)
     for (int i = 0; i < numNodes; ++i)
     {
         if (roiColumn == NULL || roiColumn[i] > 0.0f)
@@ -431,7 +432,8 @@ void AlgorithmMetricExtrema::precomputeNeighborhoods(const SurfaceFile* mySurf,
                     continue;
                 }
             }
-            myGeoHelp->getNodesToGeoDist(i, distance, neighborhoods[i], junk);
+            const int32_t* geoNeighbors = myGeoNeigh->getNeighbors(i);
+            neighborhoods[i].assign(geoNeighbors, geoNeighbors + myGeoNeigh->getNeighborCount(i));
             int numelems = (int)neighborhoods[i].size();
             if (numelems < 7)
             {
@@ -675,6 +677,20 @@ void AlgorithmMetricExtrema::findExtremaConsolidate(const SurfaceFile* mySurf, c
     consolidateStep(mySurf, distance, tempExtrema, minima, maxima);
 }
 
+namespace
+{
+    void getConsolidateNeighbors(const GeodesicNeighborhood* myGeoNeigh, GeodesicHelper* myGeoHelp, const int32_t& node, const float& distance,
+                                 vector<int32_t>& neighbors, vector<float>& dists)
+    {//only use the shared neighborhoods when they already exist, consolidation only needs the extrema
+        if (myGeoNeigh != NULL)
+        {
+            myGeoNeigh->getNodesToGeoDist(node, neighbors, dists);
+        } else {
+            myGeoHelp->getNodesToGeoDist(node, distance, neighbors, dists);
+        }
+    }
+}
+
 void AlgorithmMetricExtrema::consolidateStep(const SurfaceFile* mySurf, const float& distance, vector<pair<int, int> > initExtrema[2], vector<int>& minima, vector<int>& maxima)
 {
     int numNodes = mySurf->getNumberOfNodes();
@@ -688,9 +704,10 @@ void AlgorithmMetricExtrema::consolidateStep(const SurfaceFile* mySurf, const fl
         vector<float> dists;
         vector<int32_t> neighbors;
         CaretPointer<GeodesicHelper> myGeoHelp = mySurf->getGeodesicHelper();
+        CaretPointer<const GeodesicNeighborhood> myGeoNeigh = GeodesicNeighborhood::getIfCached(mySurf, distance);
         for (int i = 0; i < numInitExtrema - 1; ++i)
         {
-            myGeoHelp->getNodesToGeoDist(initExtrema[sign][i].first, distance, neighbors, dists);//use smooth distance to get whether they are close enough
+            getConsolidateNeighbors(myGeoNeigh, myGeoHelp, initExtrema[sign][i].first, distance, neighbors, dists);//use smooth distance to get whether they are close enough
             int numInDist = (int)dists.size();
             for (int j = 0; j < numInDist; ++j)
             {
@@ -762,7 +779,7 @@ void AlgorithmMetricExtrema::consolidateStep(const SurfaceFile* mySurf, const fl
                 int newnode = pathnodes[walk - 1];
                 initExtrema[sign][extr1].first = newnode;
                 initExtrema[sign][extr1].second += weight2;//add the weights together
-                myGeoHelp->getNodesToGeoDist(newnode, distance, neighbors, dists);
+                getConsolidateNeighbors(myGeoNeigh, myGeoHelp, newnode, distance, neighbors, dists);
                 int numInDist = (int)dists.size();
                 for (int j = 0; j < numInDist; ++j)
                 {
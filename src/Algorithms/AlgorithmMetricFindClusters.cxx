@@ -22,11 +22,14 @@
 #include "AlgorithmException.h"
 
 #include "CaretLogger.h"
+#include "CaretOMP.h"
+#include "ConnectedComponents.h"
 #include "GeodesicHelper.h"
 #include "MetricFile.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 
+#include <algorithm>
 #include <vector>
 
 using namespace caret;
@@ -152,64 +155,40 @@ namespace
         double area;
     };
     
-    void processColumn(const float* data, const float* roiData, const float* nodeAreas, TopologyHelper* myTopoHelp, GeodesicHelper* myGeoHelp,
-                       const float& threshVal, const float& minArea, const bool& lessThan, const float& areaRatio, const float& distanceCutoff,
-                       float* outData, int& markVal)
+    void processColumn(const vector<int64_t>& labels, const int64_t& numComponents, const float* nodeAreas, GeodesicHelper* myGeoHelp,
+                       const float& minArea, const float& areaRatio, const float& distanceCutoff, float* outData, int& markVal)
     {
-        int numNodes = myTopoHelp->getNumberOfNodes();
-        vector<int> marked(numNodes, 0);
-        if (lessThan)
+        int numNodes = (int)labels.size();
+        vector<double> componentAreas(numComponents, 0.0);
+        for (int i = 0; i < numNodes; ++i)
         {
-            for (int i = 0; i < numNodes; ++i)
-            {
-                if ((roiData == NULL || roiData[i] > 0.0f) && data[i] < threshVal)
-                {
-                    marked[i] = 1;
-                }
-            }
-        } else {
-            for (int i = 0; i < numNodes; ++i)
-            {
-                if ((roiData == NULL || roiData[i] > 0.0f) && data[i] > threshVal)
-                {
-                    marked[i] = 1;
-                }
-            }
+            if (labels[i] != -1) componentAreas[labels[i]] += nodeAreas[i];
         }
         vector<Cluster> clusters;
+        vector<int> componentToCluster(numComponents, -1);//components are numbered in the order a flood fill in vertex order finds them, so marking order is unchanged
         float biggestSize = 0.0f;
         int biggestCluster = -1;
-        for (int i = 0; i < numNodes; ++i)
+        for (int64_t i = 0; i < numComponents; ++i)
         {
-            if (marked[i])
+            if (componentAreas[i] > minArea)
             {
-                Cluster newCluster;
-                newCluster.members.push_back(i);
-                marked[i] = 0;//unmark it when added to list to prevent multiples
-                for (int index = 0; index < (int)newCluster.members.size(); ++index)//NOTE: vector grows inside loop
+                if (componentAreas[i] > biggestSize)
                 {
-                    int node = newCluster.members[index];//keep list around so we can put it into the output immediately if it is large enough
-                    newCluster.area += nodeAreas[node];
-                    const vector<int32_t>& neighbors = myTopoHelp->getNodeNeighbors(node);
-                    int numNeigh = (int)neighbors.size();
-                    for (int n = 0; n < numNeigh; ++n)
-                    {
-                        const int32_t& neighbor = neighbors[n];
-                        if (marked[neighbor])
-                        {
-                            newCluster.members.push_back(neighbor);
-                            marked[neighbor] = 0;
-                        }
-                    }
+                    biggestSize = componentAreas[i];
+                    biggestCluster = (int)clusters.size();
                 }
-                if (newCluster.area > minArea)
+                componentToCluster[i] = (int)clusters.size();
+                clusters.push_back(Cluster());
+                clusters.back().area = componentAreas[i];
+            }
+        }
+        if (!clusters.empty())
+        {
+            for (int i = 0; i < numNodes; ++i)
+            {
+                if (labels[i] != -1 && componentToCluster[labels[i]] != -1)
                 {
-                    if (newCluster.area > biggestSize)
-                    {
-                        biggestSize = newCluster.area;
-                        biggestCluster = (int)clusters.size();
-                    }
-                    clusters.push_back(newCluster);
+                    clusters[componentToCluster[labels[i]]].members.push_back(i);
                 }
             }
         }
@@ -315,28 +294,42 @@ AlgorithmMetricFindClusters::AlgorithmMetricFindClusters(ProgressObject* myProgO
             myGeoHelp.grabNew(new GeodesicHelper(myGeoBase));
         }
     }
-    vector<int> toSearch;
     int markVal = startVal;//give each cluster a different value, including across maps
+    vector<int> columns;
     if (columnNum == -1)
     {
         myMetricOut->setNumberOfNodesAndColumns(numNodes, numCols);
-        myMetricOut->setStructure(mySurf->getStructure());
         for (int c = 0; c < numCols; ++c)
         {
-            myMetricOut->setColumnName(c, myMetric->getColumnName(c));
-            vector<float> outData(numNodes, 0.0f);
-            const float* data = myMetric->getValuePointerForColumn(c);
-            processColumn(data, roiData, nodeAreas, myTopoHelp, myGeoHelp, threshVal, minArea, lessThan, areaRatio, distanceCutoff, outData.data(), markVal);
-            myMetricOut->setValuesForColumn(c, outData.data());
+            columns.push_back(c);
         }
     } else {
         myMetricOut->setNumberOfNodesAndColumns(numNodes, 1);
-        myMetricOut->setStructure(mySurf->getStructure());
-        myMetricOut->setColumnName(0, myMetric->getColumnName(columnNum));
-        vector<float> outData(numNodes, 0.0f);
-        const float* data = myMetric->getValuePointerForColumn(columnNum);
-        processColumn(data, roiData, nodeAreas, myTopoHelp, myGeoHelp, threshVal, minArea, lessThan, areaRatio, distanceCutoff, outData.data(), markVal);
-        myMetricOut->setValuesForColumn(0, outData.data());
+        columns.push_back(columnNum);
+    }
+    myMetricOut->setStructure(mySurf->getStructure());
+    int numOutCols = (int)columns.size(), batchSize = 1;
+#ifdef CARET_OMP
+    batchSize = omp_get_max_threads();//label columns in parallel batches, then mark them in order
+#endif
+    for (int batchStart = 0; batchStart < numOutCols; batchStart += batchSize)
+    {
+        int batchEnd = min(batchStart + batchSize, numOutCols);
+        vector<const float*> batchData;
+        for (int i = batchStart; i < batchEnd; ++i)
+        {
+            batchData.push_back(myMetric->getValuePointerForColumn(columns[i]));
+        }
+        vector<vector<int64_t> > labels;
+        vector<int64_t> counts;
+        ConnectedComponents::thresholdAndLabelGraph(myTopoHelp, batchData, threshVal, lessThan, roiData, labels, counts);
+        for (int i = batchStart; i < batchEnd; ++i)
+        {
+            myMetricOut->setColumnName(i, myMetric->getColumnName(columns[i]));
+            vector<float> outData(numNodes, 0.0f);
+            processColumn(labels[i - batchStart], counts[i - batchStart], nodeAreas, myGeoHelp, minArea, areaRatio, distanceCutoff, outData.data(), markVal);
+            myMetricOut->setValuesForColumn(i, outData.data());
+        }
     }
     if (endVal != NULL) *endVal = markVal;
 }
@@ -89,20 +89,14 @@ AlgorithmMetricReduce::AlgorithmMetricReduce(ProgressObject* myProgObj, const Me
     metricOut->setNumberOfNodesAndColumns(numNodes, 1);
     metricOut->setStructure(metricIn->getStructure());
     metricOut->setColumnName(0, ReductionEnum::toName(myReduce));
-    vector<float> scratch(numCols);
-    for (int node = 0; node < numNodes; ++node)
+    vector<const float*> columns(numCols);
+    for (int col = 0; col < numCols; ++col)
     {
-        for (int col = 0; col < numCols; ++col)
-        {
-            scratch[col] = metricIn->getValue(node, col);
-        }
-        if (onlyNumeric)
-        {
-            metricOut->setValue(node, 0, ReductionOperation::reduceOnlyNumeric(scratch.data(), numCols, myReduce));
-        } else {
-            metricOut->setValue(node, 0, ReductionOperation::reduce(scratch.data(), numCols, myReduce));
-        }
+        columns[col] = metricIn->getValuePointerForColumn(col);
     }
+    vector<float> outCol(numNodes);
+    ReductionOperation::reduceColumns(columns.data(), numCols, numNodes, myReduce, outCol.data(), onlyNumeric);//reduces across columns without gathering per vertex
+    metricOut->setValuesForColumn(0, outCol.data());
 }
 
 AlgorithmMetricReduce::AlgorithmMetricReduce(ProgressObject* myProgObj, const MetricFile* metricIn, const ReductionEnum::Enum& myReduce, MetricFile* metricOut, const float& sigmaBelow, const float& sigmaAbove) : AbstractAlgorithm(myProgObj)
@@ -114,15 +108,14 @@ AlgorithmMetricReduce::AlgorithmMetricReduce(ProgressObject* myProgObj, const Me
     metricOut->setNumberOfNodesAndColumns(numNodes, 1);
     metricOut->setStructure(metricIn->getStructure());
     metricOut->setColumnName(0, ReductionEnum::toName(myReduce));
-    vector<float> scratch(numCols);
-    for (int node = 0; node < numNodes; ++node)
+    vector<const float*> columns(numCols);
+    for (int col = 0; col < numCols; ++col)
     {
-        for (int col = 0; col < numCols; ++col)
-        {
-            scratch[col] = metricIn->getValue(node, col);
-        }
-        metricOut->setValue(node, 0, ReductionOperation::reduceExcludeDev(scratch.data(), numCols, myReduce, sigmaBelow, sigmaAbove));
+        columns[col] = metricIn->getValuePointerForColumn(col);
     }
+    vector<float> outCol(numNodes);
+    ReductionOperation::reduceColumnsExcludeDev(columns.data(), numCols, numNodes, myReduce, sigmaBelow, sigmaAbove, outCol.data());
+    metricOut->setValuesForColumn(0, outCol.data());
 }
 
 float AlgorithmMetricReduce::getAlgorithmInternalWeight()
@@ -21,7 +21,7 @@
 #include "AlgorithmMetricRegression.h"
 #include "AlgorithmException.h"
 
-#include "FloatMatrix.h"
+#include "DenseMatrix.h"
 #include "MetricFile.h"
 #include "PaletteColorMapping.h"
 
@@ -201,86 +201,70 @@ AlgorithmMetricRegression::AlgorithmMetricRegression(ProgressObject* myProgObj,
             demeanCol(thisMetric->getValuePointerForColumn(thisCol), numNodes, roiData, regressCols.back());
         }
     }
-    FloatMatrix xtrans(regressCols);//use naive matrix math - not particularly efficient, but it works
-    regressCols.clear();//don't need this any more, should call destructor on each member vector and release the memory
-    xtrans = xtrans.concatVert(FloatMatrix::ones(1, numUsedNodes));//add constant term
-    FloatMatrix toInvert = xtrans * xtrans.transpose();
-    int invertSize = toInvert.getNumberOfRows();
-    //a bit of a hack, but it should work, though this causes the work of inversion to be done twice
-    if (toInvert.reducedRowEchelon()[invertSize - 1][invertSize - 1] != 1.0f) throw AlgorithmException("regression encountered a non-invertible matrix, check your inputs for linear independence");
-    FloatMatrix solver = toInvert.inverse() * xtrans;//do most of the math in temporaries
-    if (myColumn == -1)
+    const int numRegressors = (int)regressCols.size() + 1;//add constant term
+    if (numUsedNodes < numRegressors) throw AlgorithmException("regression has more regressors (including the constant term) than vertices");
+    DenseMatrix design(numUsedNodes, numRegressors);//one row per vertex
+    for (int k = 0; k < numRegressors - 1; ++k)
     {
-        myMetricOut->setNumberOfNodesAndColumns(numNodes, numColumns);
-        myMetricOut->setStructure(myMetricIn->getStructure());
-        for (int i = 0; i < numColumns; ++i)
+        for (int m = 0; m < numUsedNodes; ++m)
         {
-            myMetricOut->setColumnName(i, myMetricIn->getColumnName(i) + " regressed");
-            *(myMetricOut->getPaletteColorMapping(i)) = *(myMetricIn->getPaletteColorMapping(i));
-            FloatMatrix y(numUsedNodes, 1);//create column vector for input - note that column vectors are extremely inefficient currently, as is copying the data...
-            const float* data = myMetricIn->getValuePointerForColumn(i);
-            int m = 0;
-            for (int j = 0; j < numNodes; ++j)
-            {
-                if (roiData == NULL || roiData[j] > 0.0f)
-                {
-                    y[m][0] = data[j];
-                    ++m;
-                }
-            }
-            FloatMatrix regressed = solver * y;
-            vector<float> outscratch(numNodes);
-            m = 0;
-            for (int j = 0; j < numNodes; ++j)
-            {
-                if (roiData == NULL || roiData[j] > 0.0f)
-                {
-                    outscratch[j] = data[j];
-                    for (int k = 0; k < removeCount; ++k)
-                    {
-                        outscratch[j] -= regressed[k][0] * xtrans[k][m];
-                    }
-                    ++m;
-                } else {
-                    outscratch[j] = 0.0f;
-                }
-            }
-            myMetricOut->setValuesForColumn(i, outscratch.data());
+            design(m, k) = regressCols[k][m];
         }
+    }
+    regressCols.clear();//don't need this any more, should call destructor on each member vector and release the memory
+    for (int m = 0; m < numUsedNodes; ++m)
+    {
+        design(m, numRegressors - 1) = 1.0f;
+    }
+    vector<int> outColumns;
+    if (myColumn == -1)
+    {
+        for (int i = 0; i < numColumns; ++i) outColumns.push_back(i);
     } else {
-        myMetricOut->setNumberOfNodesAndColumns(numNodes, 1);
-        myMetricOut->setStructure(myMetricIn->getStructure());
-        myMetricOut->setColumnName(0, myMetricIn->getColumnName(myColumn) + " regressed");
-        *(myMetricOut->getPaletteColorMapping(0)) = *(myMetricIn->getPaletteColorMapping(myColumn));
-        FloatMatrix y(numUsedNodes, 1);//create column vector for input - note that column vectors are extremely inefficient currently, as is copying the data...
-        const float* data = myMetricIn->getValuePointerForColumn(myColumn);
+        outColumns.push_back(myColumn);
+    }
+    const int numOutColumns = (int)outColumns.size();
+    DenseMatrix y(numUsedNodes, numOutColumns);//solve all columns at once against the same decomposition
+    for (int i = 0; i < numOutColumns; ++i)
+    {
+        const float* data = myMetricIn->getValuePointerForColumn(outColumns[i]);
         int m = 0;
         for (int j = 0; j < numNodes; ++j)
         {
             if (roiData == NULL || roiData[j] > 0.0f)
             {
-                y[m][0] = data[j];
+                y(m, i) = data[j];
                 ++m;
             }
         }
-        FloatMatrix regressed = solver * y;
-        vector<float> outscratch(numNodes);
-        m = 0;
+    }
+    DenseMatrix beta;//QR on the design, rather than LU on the normal equations, so nearly dependent regressors are caught instead of amplified
+    if (!design.qrSolve(y, beta)) throw AlgorithmException("regression encountered a non-invertible matrix, check your inputs for linear independence");
+    myMetricOut->setNumberOfNodesAndColumns(numNodes, numOutColumns);
+    myMetricOut->setStructure(myMetricIn->getStructure());
+    vector<float> outscratch(numNodes);
+    for (int i = 0; i < numOutColumns; ++i)
+    {
+        myMetricOut->setColumnName(i, myMetricIn->getColumnName(outColumns[i]) + " regressed");
+        *(myMetricOut->getPaletteColorMapping(i)) = *(myMetricIn->getPaletteColorMapping(outColumns[i]));
+        const float* data = myMetricIn->getValuePointerForColumn(outColumns[i]);
+        int m = 0;
         for (int j = 0; j < numNodes; ++j)
         {
             if (roiData == NULL || roiData[j] > 0.0f)
             {
+                const float* designRow = design.getRow(m);
                 outscratch[j] = data[j];
                 for (int k = 0; k < removeCount; ++k)
                 {
-                    outscratch[j] -= regressed[k][0] * xtrans[k][m];
+                    outscratch[j] -= beta(k, i) * designRow[k];
                 }
                 ++m;
             } else {
                 outscratch[j] = 0.0f;
             }
         }
-        myMetricOut->setValuesForColumn(0, outscratch.data());
+        myMetricOut->setValuesForColumn(i, outscratch.data());
     }
 }
 
@@ -21,11 +21,14 @@
 #include "AlgorithmMetricRemoveIslands.h"
 #include "AlgorithmException.h"
 
+#include "CaretOMP.h"
+#include "CaretPointer.h"
+#include "ConnectedComponents.h"
 #include "MetricFile.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 
-#include <utility>
+#include <algorithm>
 #include <vector>
 
 using namespace caret;
@@ -92,68 +95,49 @@ AlgorithmMetricRemoveIslands::AlgorithmMetricRemoveIslands(ProgressObject* myPro
     int numCols = myMetric->getNumberOfColumns();
     myMetricOut->setNumberOfNodesAndColumns(numNodes, numCols);
     myMetricOut->setStructure(myMetric->getStructure());
-    for (int col = 0; col < numCols; ++col)
+    CaretPointer<TopologyHelper> myHelp = mySurf->getTopologyHelper();
+    int batchSize = 1;
+#ifdef CARET_OMP
+    batchSize = omp_get_max_threads();//label columns in parallel batches, a single column is labeled in parallel instead
+#endif
+    for (int batchStart = 0; batchStart < numCols; batchStart += batchSize)
     {
-        vector<pair<float, vector<int> > > areas;
-        vector<int> used(numNodes, 0);
-        CaretPointer<TopologyHelper> myHelp = mySurf->getTopologyHelper();
-        const float* roiData = myMetric->getValuePointerForColumn(col);
-        myMetricOut->setColumnName(col, myMetric->getColumnName(col));
-        for (int i = 0; i < numNodes; ++i)
+        int batchEnd = min(batchStart + batchSize, numCols);
+        vector<const float*> batchData;
+        for (int col = batchStart; col < batchEnd; ++col)
         {
-            if (used[i] == 0 && roiData[i] > 0.0f)
-            {
-                areas.push_back(make_pair(0.0f, vector<int>()));
-                vector<int>& thisAreaMembers = areas.back().second;
-                float& thisSurfArea = areas.back().first;
-                thisAreaMembers.push_back(i);
-                thisSurfArea += areaData[i];
-                used[i] = 1;
-                vector<int> mystack;
-                mystack.push_back(i);
-                while (!mystack.empty())
-                {
-                    int curnode = mystack.back();
-                    mystack.pop_back();
-                    const vector<int32_t>& neighbors = myHelp->getNodeNeighbors(curnode);
-                    int numNeigh = (int)neighbors.size();
-                    for (int j = 0; j < numNeigh; ++j)
-                    {
-                        int thisneigh = neighbors[j];
-                        if (used[thisneigh] == 0 && roiData[thisneigh] > 0.0f)
-                        {
-                            used[thisneigh] = 1;
-                            thisAreaMembers.push_back(thisneigh);
-                            thisSurfArea += areaData[thisneigh];
-                            mystack.push_back(thisneigh);
-                        }
-                    }
-                }
-            }
+            batchData.push_back(myMetric->getValuePointerForColumn(col));
         }
-        vector<float> outscratch(numNodes, 0.0f);
-        int numAreas = (int)areas.size();
-        if (numAreas > 0)
+        vector<vector<int64_t> > labels;
+        vector<int64_t> counts;
+        ConnectedComponents::thresholdAndLabelGraph(myHelp, batchData, 0.0f, false, NULL, labels, counts);
+        for (int col = batchStart; col < batchEnd; ++col)
         {
-            int bestIndex = 0;
-            float bestArea = areas[0].first;
-            for (int i = 1; i < numAreas; ++i)
+            const vector<int64_t>& colLabels = labels[col - batchStart];
+            myMetricOut->setColumnName(col, myMetric->getColumnName(col));
+            vector<double> areas(counts[col - batchStart], 0.0);
+            for (int i = 0; i < numNodes; ++i)
             {
-                float thisArea = (int)areas[i].first;
-                if (thisArea > bestArea)
+                if (colLabels[i] != -1) areas[colLabels[i]] += areaData[i];
+            }
+            int64_t bestIndex = -1;
+            for (int64_t i = 0; i < (int64_t)areas.size(); ++i)
+            {
+                if (bestIndex == -1 || areas[i] > areas[bestIndex])//first one wins ties
                 {
                     bestIndex = i;
-                    bestArea = thisArea;
                 }
             }
-            const vector<int>& thisArea = areas[bestIndex].second;
-            int numAreaNodes = (int)thisArea.size();
-            for (int i = 0; i < numAreaNodes; ++i)
+            vector<float> outscratch(numNodes, 0.0f);
+            if (bestIndex != -1)
             {
-                outscratch[thisArea[i]] = 1.0f;//make it into a simple 0/1 metric, even if it wasn't before
+                for (int i = 0; i < numNodes; ++i)
+                {
+                    if (colLabels[i] == bestIndex) outscratch[i] = 1.0f;//make it into a simple 0/1 metric, even if it wasn't before
+                }
             }
+            myMetricOut->setValuesForColumn(col, outscratch.data());
         }
-        myMetricOut->setValuesForColumn(col, outscratch.data());
     }
 }
 
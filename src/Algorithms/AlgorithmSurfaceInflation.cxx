@@ -27,7 +27,9 @@
 #include "BoundingBox.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "SurfaceFile.h"
+#include "SurfaceSmoothingObject.h"
 
 using namespace caret;
 
@@ -138,6 +140,18 @@ AlgorithmSurfaceInflation::AlgorithmSurfaceInflation(ProgressObject* myProgObj,
                                                      const float inflationFactorIn)
    : AbstractAlgorithm(myProgObj)
 {
+    if (cycles > 0) {
+        if ((strength < 0.0)
+            || (strength > 1.0)) {
+            throw AlgorithmException("Invalid smoothing strength outside [0.0, 1.0]: "
+                                     + QString::number(strength, 'f', 5));
+        }
+        if (iterations <= 0) {
+            throw AlgorithmException("Invalid iterations value [1, infinity]: "
+                                     + QString::number(iterations));
+        }
+    }
+    
     std::vector<ProgressObject*> subAlgProgress;
     if (myProgObj != NULL) {
         subAlgProgress.resize(cycles);
@@ -165,6 +179,15 @@ AlgorithmSurfaceInflation::AlgorithmSurfaceInflation(ProgressObject* myProgObj,
     
     const int32_t numberOfNodes = outputSurfaceFile->getNumberOfNodes();
     
+    /*
+     * Topology does not change between cycles, so capture the neighbors
+     * once and keep the coordinates in arrays until all cycles are done
+     */
+    SurfaceSmoothingObject smoothingObject(outputSurfaceFile);
+    const float* coordData = outputSurfaceFile->getCoordinateData();
+    std::vector<float> coords(coordData, coordData + numberOfNodes * 3);
+    std::vector<float> coordsScratch(numberOfNodes * 3);
+    
     for (int iCycle = 0; iCycle < cycles; iCycle++) {
         /*
          * Smooth
@@ -174,19 +197,24 @@ AlgorithmSurfaceInflation::AlgorithmSurfaceInflation(ProgressObject* myProgObj,
         {
             subProgress = subAlgProgress[iCycle];
         }
-        AlgorithmSurfaceSmoothing(subProgress,
-                                  outputSurfaceFile,
-                                  outputSurfaceFile,
-                                  strength,
-                                  iterations);
+        {
+            LevelProgress smoothProgress(subProgress);
+            for (int32_t iter = 1; iter <= iterations; iter++) {
+                smoothingObject.smoothIteration(&coords[0],
+                                                &coordsScratch[0],
+                                                strength);
+                coords.swap(coordsScratch);
+                smoothProgress.reportProgress(static_cast<float>(iter)
+                                              / static_cast<float>(iterations));
+            }
+        }
         
         /*
          * Inflate
          */
-        float xyz[3];
+#pragma omp CARET_PARFOR schedule(static, 1024)
         for (int32_t iNode = 0; iNode < numberOfNodes; iNode++) {
-            outputSurfaceFile->getCoordinate(iNode,
-                                             xyz);
+            float* xyz = &coords[iNode * 3];
             
             const float x = xyz[0] / anatomicalRangeX;
             const float y = xyz[1] / anatomicalRangeY;
@@ -198,15 +226,16 @@ AlgorithmSurfaceInflation::AlgorithmSurfaceInflation(ProgressObject* myProgObj,
             xyz[0] *= scale;
             xyz[1] *= scale;
             xyz[2] *= scale;
-            
-            outputSurfaceFile->setCoordinate(iNode,
-                                             xyz);
         }
         
         myProgress.reportProgress(static_cast<float>(iCycle +1)
                                   / static_cast<float>(cycles));
     }
     
+    if (numberOfNodes > 0) {
+        outputSurfaceFile->setCoordinates(&coords[0]);
+    }
+    
     outputSurfaceFile->computeNormals();
 }
 
@@ -22,10 +22,10 @@
 #include "AlgorithmException.h"
 
 #include "GiftiLabelTable.h"
+#include "LabelIndexRuns.h"
 #include "VolumeFile.h"
+#include "VolumeFrameWriter.h"
 
-#include <cmath>
-#include <map>
 #include <vector>
 
 using namespace caret;
@@ -48,11 +48,12 @@ OperationParameters* AlgorithmVolumeAllLabelsToROIs::getParameters()
     
     ret->addStringParameter(2, "map", "the number or name of the label map to use");
     
-    ret->addVolumeOutputParameter(3, "volume-out", "the output volume file");
+    ret->addVolumeFramesOutputParameter(3, "volume-out", "the output volume file");
     
     ret->setHelpText(
         AString("The output volume has a frame for each label in the specified input frame, other than the ??? label, ") +
-        "each of which contains an ROI of all voxels that are set to the corresponding label."
+        "each of which contains an ROI of all voxels that are set to the corresponding label.  " +
+        "Frames are written to the output file as they are made, so only one frame of the output is in memory at a time."
     );
     return ret;
 }
@@ -67,12 +68,17 @@ void AlgorithmVolumeAllLabelsToROIs::useParameters(OperationParameters* myParams
         throw AlgorithmException("invalid map number or name specified");
     }
     VolumeFile* myVolOut = myParams->getOutputVolume(3);
-    AlgorithmVolumeAllLabelsToROIs(myProgObj, myLabel, whichMap, myVolOut);
+    const AString& outFileName = myParams->getOutputVolumeFramesFileName(3);
+    if (outFileName.isEmpty())
+    {
+        AlgorithmVolumeAllLabelsToROIs(myProgObj, myLabel, whichMap, myVolOut);
+    } else {
+        AlgorithmVolumeAllLabelsToROIs(myProgObj, myLabel, whichMap, outFileName, myVolOut->getFileMetaData());
+    }
 }
 
-AlgorithmVolumeAllLabelsToROIs::AlgorithmVolumeAllLabelsToROIs(ProgressObject* myProgObj, const VolumeFile* myLabel, const int& whichMap, VolumeFile* myVolOut) : AbstractAlgorithm(myProgObj)
+void AlgorithmVolumeAllLabelsToROIs::getOutputKeys(const VolumeFile* myLabel, const int& whichMap, vector<int32_t>& keysOut, vector<AString>& namesOut)
 {
-    LevelProgress myProgress(myProgObj);
     if (myLabel->getType() != SubvolumeAttributes::LABEL)
     {
         throw AlgorithmException("input volume must be a label volume");
@@ -84,40 +90,65 @@ AlgorithmVolumeAllLabelsToROIs::AlgorithmVolumeAllLabelsToROIs(ProgressObject* m
     const GiftiLabelTable* myTable = myLabel->getMapLabelTable(whichMap);
     int32_t unusedKey = myTable->getUnassignedLabelKey();//WARNING: this actually MODIFIES the label table if the ??? key doesn't exist
     set<int32_t> myKeys = myTable->getKeys();
-    int numKeys = (int)myKeys.size();
-    if (numKeys < 2)
+    if (myKeys.size() < 2)
     {
         throw AlgorithmException("label table doesn't contain any keys besides the ??? key");
     }
-    map<int32_t, int> keyToMap;//lookup from keys to subvolume
+    keysOut.clear();
+    namesOut.clear();
+    for (set<int32_t>::iterator iter = myKeys.begin(); iter != myKeys.end(); ++iter)
+    {
+        if (*iter == unusedKey) continue;//skip the ??? key
+        keysOut.push_back(*iter);
+        namesOut.push_back(myTable->getLabelName(*iter));
+    }
+}
+
+AlgorithmVolumeAllLabelsToROIs::AlgorithmVolumeAllLabelsToROIs(ProgressObject* myProgObj, const VolumeFile* myLabel, const int& whichMap, VolumeFile* myVolOut) : AbstractAlgorithm(myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    vector<int32_t> outKeys;
+    vector<AString> outNames;
+    getOutputKeys(myLabel, whichMap, outKeys, outNames);
+    const int numOut = (int)outKeys.size();
     vector<int64_t> outDims = myLabel->getOriginalDimensions();
     outDims.resize(4);
-    outDims[3] = numKeys - 1;//don't include the ??? key
+    outDims[3] = numOut;
     myVolOut->reinitialize(outDims, myLabel->getSform());
-    myVolOut->setValueAllVoxels(0.0f);
-    int counter = 0;
-    for (set<int32_t>::iterator iter = myKeys.begin(); iter != myKeys.end(); ++iter)
+    const int64_t frameSize = outDims[0] * outDims[1] * outDims[2];
+    LabelIndexRuns myRuns(myLabel->getFrame(whichMap), frameSize);//one pass over the input, instead of a key lookup per voxel
+    vector<float> scratchFrame(frameSize, 0.0f);
+    for (int i = 0; i < numOut; ++i)
     {
-        if (*iter == unusedKey) continue;//skip the ??? key
-        keyToMap[*iter] = counter;
-        myVolOut->setMapName(counter, myTable->getLabelName(*iter));
-        ++counter;
+        myVolOut->setMapName(i, outNames[i]);
+        myRuns.fillRuns(outKeys[i], scratchFrame.data(), 1.0f);
+        myVolOut->setFrame(scratchFrame.data(), i);
+        myRuns.fillRuns(outKeys[i], scratchFrame.data(), 0.0f);//rezero only what we set
     }
-    for (int64_t k = 0; k < outDims[2]; ++k)//because we need to set voxels in the output, rather than in a temporary frame, for single pass without duplicating the memory
+}
+
+AlgorithmVolumeAllLabelsToROIs::AlgorithmVolumeAllLabelsToROIs(ProgressObject* myProgObj, const VolumeFile* myLabel, const int& whichMap, const AString& outFileName,
+                                                               const GiftiMetaData* outFileMetaData) : AbstractAlgorithm(myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    vector<int32_t> outKeys;
+    vector<AString> outNames;
+    getOutputKeys(myLabel, whichMap, outKeys, outNames);
+    const int numOut = (int)outKeys.size();
+    vector<int64_t> spatialDims = myLabel->getOriginalDimensions();
+    spatialDims.resize(3);
+    VolumeFrameWriter myWriter(outFileName, spatialDims, myLabel->getSform(), outNames, SubvolumeAttributes::ANATOMY, outFileMetaData);
+    const int64_t frameSize = spatialDims[0] * spatialDims[1] * spatialDims[2];
+    LabelIndexRuns myRuns(myLabel->getFrame(whichMap), frameSize);
+    vector<float> scratchFrame(frameSize, 0.0f);
+    for (int i = 0; i < numOut; ++i)
     {
-        for (int64_t j = 0; j < outDims[1]; ++j)
-        {
-            for (int64_t i = 0; i < outDims[0]; ++i)
-            {
-                int32_t thisKey = (int32_t)floor(myLabel->getValue(i, j, k, whichMap) + 0.5f);
-                map<int32_t, int>::iterator iter = keyToMap.find(thisKey);
-                if (iter != keyToMap.end())
-                {
-                    myVolOut->setValue(1.0f, i, j, k, iter->second);
-                }
-            }
-        }
+        myRuns.fillRuns(outKeys[i], scratchFrame.data(), 1.0f);
+        myWriter.writeFrame(scratchFrame.data());
+        myRuns.fillRuns(outKeys[i], scratchFrame.data(), 0.0f);
+        myProgress.reportProgress(((float)(i + 1)) / numOut);
     }
+    myWriter.close();
 }
 
 float AlgorithmVolumeAllLabelsToROIs::getAlgorithmInternalWeight()
@@ -23,16 +23,24 @@
 
 #include "AbstractAlgorithm.h"
 
+#include <vector>
+
 namespace caret {
     
+    class GiftiMetaData;
+    
     class AlgorithmVolumeAllLabelsToROIs : public AbstractAlgorithm
     {
         AlgorithmVolumeAllLabelsToROIs();
+        static void getOutputKeys(const VolumeFile* myLabel, const int& whichMap, std::vector<int32_t>& keysOut, std::vector<AString>& namesOut);
     protected:
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
     public:
         AlgorithmVolumeAllLabelsToROIs(ProgressObject* myProgObj, const VolumeFile* myLabel, const int& whichMap, VolumeFile* myVolOut);
+        ///writes each frame to the file as it is made, so the output is never held in memory
+        AlgorithmVolumeAllLabelsToROIs(ProgressObject* myProgObj, const VolumeFile* myLabel, const int& whichMap, const AString& outFileName,
+                                       const GiftiMetaData* outFileMetaData = NULL);
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
@@ -21,13 +21,10 @@
 #include "AlgorithmVolumeDilate.h"
 
 #include "AlgorithmException.h"
-#include "CaretHeap.h"
 #include "CaretLogger.h"
 #include "CaretOMP.h"
-#include "FloatMatrix.h"
-#include "Vector3D.h"
 #include "VolumeFile.h"
-#include "VoxelIJK.h"
+#include "VolumeNeighborhood.h"
 
 #include <cmath>
 #include <map>
@@ -151,72 +148,22 @@ AlgorithmVolumeDilate::AlgorithmVolumeDilate(ProgressObject* myProgObj, const Vo
     {
         isLabelData = true;
     }
-    vector<vector<float> > volSpace = volIn->getSform();
-    Vector3D ivec, jvec, kvec, origin, ijorth, jkorth, kiorth;
-    FloatMatrix(volSpace).getAffineVectors(ivec, jvec, kvec, origin);
-    ijorth = ivec.cross(jvec).normal();//find the bounding box that encloses a sphere of radius kernBox
-    jkorth = jvec.cross(kvec).normal();
-    kiorth = kvec.cross(ivec).normal();
-    int irange = (int)floor(abs(distance / ivec.dot(jkorth)));
-    int jrange = (int)floor(abs(distance / jvec.dot(kiorth)));
-    int krange = (int)floor(abs(distance / kvec.dot(ijorth)));
-    if (irange < 1) irange = 1;//don't underflow
-    if (jrange < 1) jrange = 1;
-    if (krange < 1) krange = 1;
-    Vector3D kscratch, jscratch, iscratch;
-    vector<int> stencil;
+    int stencilFlags = VolumeNeighborhood::INCLUDE_FACE_NEIGHBORS;
+    if (myMethod == NEAREST) stencilFlags |= VolumeNeighborhood::SORT_BY_DISTANCE;//so we can stop at the first good voxel
+    VolumeNeighborhood neighborhood(myDims.data(), volIn->getSform(), distance, stencilFlags);
+    const vector<float>& stenDistances = neighborhood.getStencilDistances();
     vector<float> stenWeights;
-    for (int k = -krange; k <= krange; ++k)
+    if (myMethod == WEIGHTED)
     {
-        kscratch = kvec * k;
-        for (int j = -jrange; j <= jrange; ++j)
-        {
-            jscratch = kscratch + jvec * j;
-            for (int i = -irange; i <= irange; ++i)
-            {
-                if (k == 0 && j == 0 && i == 0) continue;
-                iscratch = jscratch + ivec * i;
-                float tempf = iscratch.length();
-                if (tempf <= distance || abs(i) + abs(j) + abs(k) == 1)
-                {
-                    stencil.push_back(i);
-                    stencil.push_back(j);
-                    stencil.push_back(k);
-                    switch (myMethod)
-                    {
-                        case NEAREST:
-                            stenWeights.push_back(tempf);
-                            break;
-                        case WEIGHTED:
-                            if (tempf == 0.0f) throw AlgorithmException("volume space is degenerate, aborting");
-                            stenWeights.push_back(1.0f / pow(tempf, exponent));
-                            break;
-                    }
-                }
-            }
-        }
-    }
-    if (myMethod == NEAREST)
-    {//sort the stencil by distance, so we can stop early
-        CaretSimpleMinHeap<VoxelIJK, float> myHeap;
-        int stencilSize = (int)stenWeights.size();
-        myHeap.reserve(stencilSize);
+        int stencilSize = (int)stenDistances.size();
+        stenWeights.resize(stencilSize);
         for (int i = 0; i < stencilSize; ++i)
         {
-            myHeap.push(VoxelIJK(stencil.data() + i * 3), stenWeights[i]);
-        }
-        stencil.clear();
-        stenWeights.clear();
-        while (!myHeap.isEmpty())
-        {
-            float tempf;
-            VoxelIJK myTriple = myHeap.pop(&tempf);
-            stenWeights.push_back(tempf);
-            stencil.push_back(myTriple.m_ijk[0]);
-            stencil.push_back(myTriple.m_ijk[1]);
-            stencil.push_back(myTriple.m_ijk[2]);
+            if (stenDistances[i] == 0.0f) throw AlgorithmException("volume space is degenerate, aborting");
+            stenWeights[i] = 1.0f / pow(stenDistances[i], exponent);
         }
     }
+    vector<FrameInfo> frames;//do all frames in one pass, so the neighborhood of each bad voxel is only visited once
     if (subvol == -1)
     {
         volOut->reinitialize(volIn->getOriginalDimensions(), volIn->getSform(), volIn->getNumberOfComponents(), volIn->getType());
@@ -230,6 +177,15 @@ AlgorithmVolumeDilate::AlgorithmVolumeDilate(ProgressObject* myProgObj, const Vo
             }
             volOut->setMapName(i, volIn->getMapName(i) + " dilate " + AString::number(distance));
         }
+        for (int s = 0; s < myDims[3]; ++s)
+        {
+            for (int c = 0; c < myDims[4]; ++c)
+            {
+                FrameInfo temp = { s, s, c, 0 };
+                if (isLabelData) temp.m_unlabeledKey = volIn->getMapLabelTable(s)->getUnassignedLabelKey();
+                frames.push_back(temp);
+            }
+        }
     } else {
         vector<int64_t> outDims = myDims;
         outDims.resize(3);
@@ -241,319 +197,219 @@ AlgorithmVolumeDilate::AlgorithmVolumeDilate(ProgressObject* myProgObj, const Vo
             *(volOut->getMapPaletteColorMapping(0)) = *(volIn->getMapPaletteColorMapping(subvol));
         }
         volOut->setMapName(0, volIn->getMapName(subvol) + " dilate " + AString::number(distance));
+        for (int c = 0; c < myDims[4]; ++c)
+        {
+            FrameInfo temp = { subvol, 0, c, 0 };
+            if (isLabelData) temp.m_unlabeledKey = volIn->getMapLabelTable(subvol)->getUnassignedLabelKey();
+            frames.push_back(temp);
+        }
     }
-    if (subvol == -1)
-    {
-        for (int s = 0; s < myDims[3]; ++s)
+    dilateFrames(volIn, frames, volOut, badRoi, dataRoi, myMethod, neighborhood, stenWeights);
+}
+
+void AlgorithmVolumeDilate::dilateFrames(const VolumeFile* volIn, const vector<FrameInfo>& frames, VolumeFile* volOut, const VolumeFile* badRoi,
+                                         const VolumeFile* dataRoi, const Method& myMethod, const VolumeNeighborhood& neighborhood, const vector<float>& stenWeights)
+{
+    const int64_t* myDims = neighborhood.getDimensions();
+    const int64_t frameSize = myDims[0] * myDims[1] * myDims[2];
+    const bool isLabelData = (volIn->getType() == SubvolumeAttributes::LABEL);
+    const int numFrames = (int)frames.size();
+    vector<const float*> inData(numFrames);
+    vector<float> scratchFrame;
+    for (int f = 0; f < numFrames; ++f)
+    {//start with a copy, so only the bad voxels need to be written
+        inData[f] = volIn->getFrame(frames[f].m_inFrame, frames[f].m_component);
+        if (isLabelData)
         {
-            for (int c = 0; c < myDims[4]; ++c)
+            scratchFrame.resize(frameSize);
+            for (int64_t v = 0; v < frameSize; ++v)
             {
-                if (isLabelData)
-                {
-                    dilateFrameLabel(volIn, s, c, volOut, s, badRoi, dataRoi, myMethod, stencil, stenWeights);
-                } else {
-                    dilateFrame(volIn, s, c, volOut, s, badRoi, dataRoi, myMethod, stencil, stenWeights);
-                }
+                scratchFrame[v] = (int32_t)floor(inData[f][v] + 0.5f);//fix non-integers
             }
+            volOut->setFrame(scratchFrame.data(), frames[f].m_outFrame, frames[f].m_component);
+        } else {
+            volOut->setFrame(inData[f], frames[f].m_outFrame, frames[f].m_component);
         }
-    } else {
-        for (int c = 0; c < myDims[4]; ++c)
+    }
+    const float* dataRoiFrame = NULL, *badRoiFrame = NULL;
+    if (dataRoi != NULL) dataRoiFrame = dataRoi->getFrame();
+    if (badRoi != NULL) badRoiFrame = badRoi->getFrame();
+    vector<char> goodMask;//padded, so stencil offsets never need a bounds check, 1 means inside the volume, in the data roi, and not in the bad roi
+    neighborhood.makePaddedMask(goodMask, dataRoiFrame);
+    if (badRoiFrame != NULL)
+    {
+        for (int64_t k = 0; k < myDims[2]; ++k)
         {
-            if (isLabelData)
+            for (int64_t j = 0; j < myDims[1]; ++j)
             {
-                dilateFrameLabel(volIn, subvol, c, volOut, 0, badRoi, dataRoi, myMethod, stencil, stenWeights);
-            } else {
-                dilateFrame(volIn, subvol, c, volOut, 0, badRoi, dataRoi, myMethod, stencil, stenWeights);
+                for (int64_t i = 0; i < myDims[0]; ++i)
+                {
+                    if (badRoiFrame[neighborhood.getFrameIndex(i, j, k)] > 0.0f) goodMask[neighborhood.getPaddedIndex(i, j, k)] = 0;
+                }
             }
         }
     }
-}
-
-void AlgorithmVolumeDilate::dilateFrame(const VolumeFile* volIn, const int& insubvol, const int& component, VolumeFile* volOut, const int& outsubvol,
-                                        const VolumeFile* badRoi, const VolumeFile* dataRoi, const Method& myMethod, const vector<int>& stencil, const vector<float>& stenWeights)
-{
-    vector<int64_t> myDims;
-    volIn->getDimensions(myDims);
-    int stensize = (int)stenWeights.size();
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int k = 0; k < myDims[2]; ++k)
+    const char* goodPtr = goodMask.data();
+    const int64_t* paddedOffsets = neighborhood.getPaddedOffsets(), *frameOffsets = neighborhood.getFrameOffsets();
+    const int stensize = (int)neighborhood.getStencilSize();
+    const vector<VolumeNeighborhood::Brick>& bricks = neighborhood.getBricks();
+    const int64_t numBricks = (int64_t)bricks.size();
+#pragma omp CARET_PAR
     {
-        for (int j = 0; j < myDims[1]; ++j)
+        vector<int64_t> goodIndices;//with a bad voxel roi, which neighbors are usable doesn't depend on the frame
+        vector<float> goodWeights;
+        map<int32_t, float> labelSums;
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t b = 0; b < numBricks; ++b)
         {
-            for (int i = 0; i < myDims[0]; ++i)
+            const VolumeNeighborhood::Brick& myBrick = bricks[b];
+            for (int64_t k = myBrick.m_start[2]; k < myBrick.m_end[2]; ++k)
             {
-                bool copy = true;
-                if (badRoi == NULL)
-                {
-                    copy = volIn->getValue(i, j, k, insubvol, component) != 0.0f || (dataRoi != NULL && !(dataRoi->getValue(i, j, k) > 0.0f));
-                } else {
-                    copy = !(badRoi->getValue(i, j, k) > 0.0f);//in case some clown uses NaNs as bad in an roi
-                }
-                if (copy)
+                for (int64_t j = myBrick.m_start[1]; j < myBrick.m_end[1]; ++j)
                 {
-                    volOut->setValue(volIn->getValue(i, j, k, insubvol, component), i, j, k, outsubvol, component);
-                } else {
-                    Vector3D voxcoord;
-                    volIn->indexToSpace(i, j, k, voxcoord);
-                    switch (myMethod)
+                    for (int64_t i = myBrick.m_start[0]; i < myBrick.m_end[0]; ++i)
                     {
-                        case NEAREST:
+                        const int64_t frameIndex = neighborhood.getFrameIndex(i, j, k), paddedIndex = neighborhood.getPaddedIndex(i, j, k);
+                        if (badRoiFrame != NULL)
                         {
-                            int best = -1;
-                            if (badRoi == NULL)
+                            if (!(badRoiFrame[frameIndex] > 0.0f)) continue;//in case some clown uses NaNs as bad in an roi
+                            goodIndices.clear();
+                            goodWeights.clear();
+                            for (int stenind = 0; stenind < stensize; ++stenind)
                             {
-                                for (int stenind = 0; stenind < stensize; ++stenind)
-                                {
-                                    int base = stenind * 3;
-                                    int64_t tempindex[3];
-                                    tempindex[0] = stencil[base] + i;
-                                    tempindex[1] = stencil[base + 1] + j;
-                                    tempindex[2] = stencil[base + 2] + k;
-                                    if (volIn->indexValid(tempindex))
-                                    {
-                                        if ((dataRoi == NULL || dataRoi->getValue(tempindex) > 0.0f) && volIn->getValue(tempindex, insubvol, component) != 0.0f)
-                                        {
-                                            best = stenind;
-                                            break;
-                                        }
-                                    }
-                                }
-                            } else {
-                                for (int stenind = 0; stenind < stensize; ++stenind)
+                                if (goodPtr[paddedIndex + paddedOffsets[stenind]])
                                 {
-                                    int base = stenind * 3;
-                                    int64_t tempindex[3];
-                                    tempindex[0] = stencil[base] + i;
-                                    tempindex[1] = stencil[base + 1] + j;
-                                    tempindex[2] = stencil[base + 2] + k;
-                                    if (volIn->indexValid(tempindex))
-                                    {
-                                        if ((dataRoi == NULL || dataRoi->getValue(tempindex) > 0.0f) && !(badRoi->getValue(tempindex) > 0.0f))
-                                        {
-                                            best = stenind;
-                                            break;
-                                        }
-                                    }
+                                    goodIndices.push_back(frameIndex + frameOffsets[stenind]);
+                                    if (myMethod == NEAREST) break;
+                                    goodWeights.push_back(stenWeights[stenind]);
                                 }
                             }
-                            if (best == -1)
-                            {
-                                volOut->setValue(0.0f, i, j, k, outsubvol, component);
-                            } else {
-                                int base = best * 3;
-                                int64_t tempindex[3];
-                                tempindex[0] = stencil[base] + i;
-                                tempindex[1] = stencil[base + 1] + j;
-                                tempindex[2] = stencil[base + 2] + k;
-                                volOut->setValue(volIn->getValue(tempindex, insubvol, component), i, j, k, outsubvol, component);
-                            }
-                            break;
-                        }
-                        case WEIGHTED:
-                        {
-                            double sum = 0.0, weightsum = 0.0;
-                            if (badRoi == NULL)
+                            const int numGood = (int)goodIndices.size();
+                            for (int f = 0; f < numFrames; ++f)
                             {
-                                for (int stenind = 0; stenind < stensize; ++stenind)
+                                const float* frameData = inData[f];
+                                float outVal = 0.0f;
+                                if (isLabelData)
                                 {
-                                    int base = stenind * 3;
-                                    int64_t tempindex[3];
-                                    tempindex[0] = stencil[base] + i;
-                                    tempindex[1] = stencil[base + 1] + j;
-                                    tempindex[2] = stencil[base + 2] + k;
-                                    if (volIn->indexValid(tempindex))
+                                    outVal = frames[f].m_unlabeledKey;
+                                    if (numGood > 0)
                                     {
-                                        float tempf = volIn->getValue(tempindex, insubvol, component);
-                                        if ((dataRoi == NULL || dataRoi->getValue(tempindex) > 0.0f) && tempf != 0.0f)
+                                        if (myMethod == NEAREST)
                                         {
-                                            float weight = stenWeights[stenind];
-                                            sum += weight * tempf;
-                                            weightsum += weight;
+                                            outVal = (int32_t)floor(frameData[goodIndices[0]] + 0.5f);//fix non-integers
+                                        } else {
+                                            labelSums.clear();
+                                            for (int g = 0; g < numGood; ++g)
+                                            {
+                                                labelSums[(int32_t)floor(frameData[goodIndices[g]] + 0.5f)] += goodWeights[g];
+                                            }
+                                            float bestSum = -1.0f;//weights should all be positive, so should the sums
+                                            for (map<int32_t, float>::iterator iter = labelSums.begin(); iter != labelSums.end(); ++iter)
+                                            {
+                                                if (iter->second > bestSum)
+                                                {
+                                                    outVal = iter->first;
+                                                    bestSum = iter->second;
+                                                }
+                                            }
                                         }
                                     }
-                                }
-                            } else {
-                                for (int stenind = 0; stenind < stensize; ++stenind)
-                                {
-                                    int base = stenind * 3;
-                                    int64_t tempindex[3];
-                                    tempindex[0] = stencil[base] + i;
-                                    tempindex[1] = stencil[base + 1] + j;
-                                    tempindex[2] = stencil[base + 2] + k;
-                                    if (volIn->indexValid(tempindex))
+                                } else {
+                                    if (numGood > 0)
                                     {
-                                        if ((dataRoi == NULL || dataRoi->getValue(tempindex) > 0.0f) && !(badRoi->getValue(tempindex) > 0.0f))
+                                        if (myMethod == NEAREST)
                                         {
-                                            float tempf = volIn->getValue(tempindex, insubvol, component);
-                                            float weight = stenWeights[stenind];
-                                            sum += weight * tempf;
-                                            weightsum += weight;
+                                            outVal = frameData[goodIndices[0]];
+                                        } else {
+                                            double sum = 0.0, weightsum = 0.0;
+                                            for (int g = 0; g < numGood; ++g)
+                                            {
+                                                sum += goodWeights[g] * frameData[goodIndices[g]];
+                                                weightsum += goodWeights[g];
+                                            }
+                                            if (weightsum != 0.0) outVal = sum / weightsum;
                                         }
                                     }
                                 }
+                                volOut->setValue(outVal, i, j, k, frames[f].m_outFrame, frames[f].m_component);
                             }
-                            if (weightsum != 0.0)
+                        } else {
+                            if (!goodPtr[paddedIndex]) continue;//outside the data roi is never bad
+                            for (int f = 0; f < numFrames; ++f)
                             {
-                                volOut->setValue(sum / weightsum, i, j, k, outsubvol, component);
-                            } else {
-                                volOut->setValue(0.0f, i, j, k, outsubvol, component);
-                            }
-                            break;
-                        }
-                    }
-                }
-            }
-        }
-    }
-}
-
-void AlgorithmVolumeDilate::dilateFrameLabel(const VolumeFile* volIn, const int& insubvol, const int& component, VolumeFile* volOut, const int& outsubvol,
-                                             const VolumeFile* badRoi, const VolumeFile* dataRoi, const Method& myMethod, const vector<int>& stencil, const vector<float>& stenWeights)
-{
-    vector<int64_t> myDims;
-    volIn->getDimensions(myDims);
-    int stensize = (int)stenWeights.size();
-    int32_t unlabeledKey = volIn->getMapLabelTable(insubvol)->getUnassignedLabelKey();
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int k = 0; k < myDims[2]; ++k)
-    {
-        for (int j = 0; j < myDims[1]; ++j)
-        {
-            for (int i = 0; i < myDims[0]; ++i)
-            {
-                bool copy = true;
-                int32_t keyIn = floor(volIn->getValue(i, j, k, insubvol, component) + 0.5f);//fix non-integers
-                if (badRoi == NULL)
-                {
-                    copy = keyIn != unlabeledKey || (dataRoi != NULL && !(dataRoi->getValue(i, j, k) > 0.0f));
-                } else {
-                    copy = !(badRoi->getValue(i, j, k) > 0.0f);//in case some clown uses NaNs as bad in an roi
-                }
-                if (copy)
-                {
-                    volOut->setValue(keyIn, i, j, k, outsubvol, component);
-                } else {
-                    Vector3D voxcoord;
-                    volIn->indexToSpace(i, j, k, voxcoord);
-                    switch (myMethod)
-                    {
-                        case NEAREST:
-                        {
-                            int best = -1;
-                            if (badRoi == NULL)
-                            {
-                                for (int stenind = 0; stenind < stensize; ++stenind)
+                                const float* frameData = inData[f];
+                                if (isLabelData)
                                 {
-                                    int base = stenind * 3;
-                                    int64_t tempindex[3];
-                                    tempindex[0] = stencil[base] + i;
-                                    tempindex[1] = stencil[base + 1] + j;
-                                    tempindex[2] = stencil[base + 2] + k;
-                                    if (volIn->indexValid(tempindex))
+                                    const int32_t unlabeledKey = frames[f].m_unlabeledKey;
+                                    if ((int32_t)floor(frameData[frameIndex] + 0.5f) != unlabeledKey) continue;
+                                    int32_t outVal = unlabeledKey;
+                                    if (myMethod == NEAREST)
                                     {
-                                        if ((dataRoi == NULL || dataRoi->getValue(tempindex) > 0.0f) && volIn->getValue(tempindex, insubvol, component) != 0.0f)
+                                        for (int stenind = 0; stenind < stensize; ++stenind)
                                         {
-                                            best = stenind;
-                                            break;
+                                            if (goodPtr[paddedIndex + paddedOffsets[stenind]] && frameData[frameIndex + frameOffsets[stenind]] != 0.0f)
+                                            {
+                                                outVal = (int32_t)floor(frameData[frameIndex + frameOffsets[stenind]] + 0.5f);//fix non-integers
+                                                break;
+                                            }
                                         }
-                                    }
-                                }
-                            } else {
-                                for (int stenind = 0; stenind < stensize; ++stenind)
-                                {
-                                    int base = stenind * 3;
-                                    int64_t tempindex[3];
-                                    tempindex[0] = stencil[base] + i;
-                                    tempindex[1] = stencil[base + 1] + j;
-                                    tempindex[2] = stencil[base + 2] + k;
-                                    if (volIn->indexValid(tempindex))
-                                    {
-                                        if ((dataRoi == NULL || dataRoi->getValue(tempindex) > 0.0f) && !(badRoi->getValue(tempindex) > 0.0f))
+                                    } else {
+                                        labelSums.clear();
+                                        for (int stenind = 0; stenind < stensize; ++stenind)
                                         {
-                                            best = stenind;
-                                            break;
+                                            if (goodPtr[paddedIndex + paddedOffsets[stenind]])
+                                            {
+                                                int32_t tempKey = (int32_t)floor(frameData[frameIndex + frameOffsets[stenind]] + 0.5f);//fix non-integers
+                                                if (tempKey != unlabeledKey) labelSums[tempKey] += stenWeights[stenind];
+                                            }
                                         }
-                                    }
-                                }
-                            }
-                            if (best == -1)
-                            {
-                                volOut->setValue(unlabeledKey, i, j, k, outsubvol, component);
-                            } else {
-                                int base = best * 3;
-                                int64_t tempindex[3];
-                                tempindex[0] = stencil[base] + i;
-                                tempindex[1] = stencil[base + 1] + j;
-                                tempindex[2] = stencil[base + 2] + k;
-                                volOut->setValue((int32_t)floor(volIn->getValue(tempindex, insubvol, component) + 0.5f), i, j, k, outsubvol, component);//fix non-integers
-                            }//yes, the cast is undefined for silly things like NaN that shouldn't be in a label file, but so are the other paths - we just want consistency between behavior of old and new values
-                            break;
-                        }
-                        case WEIGHTED:
-                        {
-                            map<int32_t, float> labelSums;
-                            if (badRoi == NULL)
-                            {
-                                for (int stenind = 0; stenind < stensize; ++stenind)
-                                {
-                                    int base = stenind * 3;
-                                    int64_t tempindex[3];
-                                    tempindex[0] = stencil[base] + i;
-                                    tempindex[1] = stencil[base + 1] + j;
-                                    tempindex[2] = stencil[base + 2] + k;
-                                    if (volIn->indexValid(tempindex))
-                                    {
-                                        int32_t tempKey = floor(volIn->getValue(tempindex, insubvol, component) + 0.5f);//fix non-integers
-                                        if ((dataRoi == NULL || dataRoi->getValue(tempindex) > 0.0f) && tempKey != unlabeledKey)
+                                        float bestSum = -1.0f;
+                                        for (map<int32_t, float>::iterator iter = labelSums.begin(); iter != labelSums.end(); ++iter)
                                         {
-                                            float weight = stenWeights[stenind];
-                                            map<int32_t, float>::iterator iter = labelSums.find(tempKey);
-                                            if (iter == labelSums.end())
+                                            if (iter->second > bestSum)
                                             {
-                                                labelSums[tempKey] = weight;
-                                            } else {
-                                                iter->second += weight;
+                                                outVal = iter->first;
+                                                bestSum = iter->second;
                                             }
                                         }
                                     }
-                                }
-                            } else {
-                                for (int stenind = 0; stenind < stensize; ++stenind)
-                                {
-                                    int base = stenind * 3;
-                                    int64_t tempindex[3];
-                                    tempindex[0] = stencil[base] + i;
-                                    tempindex[1] = stencil[base + 1] + j;
-                                    tempindex[2] = stencil[base + 2] + k;
-                                    if (volIn->indexValid(tempindex))
+                                    volOut->setValue(outVal, i, j, k, frames[f].m_outFrame, frames[f].m_component);
+                                } else {
+                                    if (frameData[frameIndex] != 0.0f) continue;
+                                    float outVal = 0.0f;
+                                    if (myMethod == NEAREST)
                                     {
-                                        if ((dataRoi == NULL || dataRoi->getValue(tempindex) > 0.0f) && !(badRoi->getValue(tempindex) > 0.0f))
+                                        for (int stenind = 0; stenind < stensize; ++stenind)
+                                        {
+                                            if (goodPtr[paddedIndex + paddedOffsets[stenind]])//only read the frame when the mask says the neighbor is inside the volume
+                                            {
+                                                float tempf = frameData[frameIndex + frameOffsets[stenind]];
+                                                if (tempf != 0.0f)
+                                                {
+                                                    outVal = tempf;
+                                                    break;
+                                                }
+                                            }
+                                        }
+                                    } else {
+                                        double sum = 0.0, weightsum = 0.0;
+                                        for (int stenind = 0; stenind < stensize; ++stenind)
                                         {
-                                            int32_t tempKey = floor(volIn->getValue(tempindex, insubvol, component) + 0.5f);//fix non-integers
-                                            float weight = stenWeights[stenind];
-                                            map<int32_t, float>::iterator iter = labelSums.find(tempKey);
-                                            if (iter == labelSums.end())
+                                            if (goodPtr[paddedIndex + paddedOffsets[stenind]])
                                             {
-                                                labelSums[tempKey] = weight;
-                                            } else {
-                                                iter->second += weight;
+                                                float tempf = frameData[frameIndex + frameOffsets[stenind]];
+                                                if (tempf != 0.0f)
+                                                {
+                                                    sum += stenWeights[stenind] * tempf;
+                                                    weightsum += stenWeights[stenind];
+                                                }
                                             }
                                         }
+                                        if (weightsum != 0.0) outVal = sum / weightsum;
                                     }
+                                    volOut->setValue(outVal, i, j, k, frames[f].m_outFrame, frames[f].m_component);
                                 }
                             }
-                            int32_t outVal = unlabeledKey;
-                            float bestSum = -1.0f;//weights should all be positive, so should the sums
-                            for (map<int32_t, float>::iterator iter = labelSums.begin(); iter != labelSums.end(); ++iter)
-                            {
-                                if (iter->second > bestSum)
-                                {
-                                    outVal = iter->first;
-                                    bestSum = iter->second;
-                                }
-                            }
-                            volOut->setValue(outVal, i, j, k, outsubvol, component);
-                            break;
                         }
                     }
                 }
@@ -25,6 +25,8 @@
 
 namespace caret {
     
+    class VolumeNeighborhood;
+    
     class AlgorithmVolumeDilate : public AbstractAlgorithm
     {
         AlgorithmVolumeDilate();
@@ -44,10 +46,13 @@ namespace caret {
         static AString getCommandSwitch();
         static AString getShortDescription();
     private:
-        void dilateFrame(const VolumeFile* volIn, const int& insubvol, const int& component, VolumeFile* volOut, const int& outsubvol, const VolumeFile* badRoi,
-                         const VolumeFile* dataRoi, const Method& myMethod, const std::vector<int>& stencil, const std::vector<float>& stenWeights);
-        void dilateFrameLabel(const VolumeFile* volIn, const int& insubvol, const int& component, VolumeFile* volOut, const int& outsubvol, const VolumeFile* badRoi,
-                              const VolumeFile* dataRoi, const Method& myMethod, const std::vector<int>& stencil, const std::vector<float>& stenWeights);
+        struct FrameInfo
+        {
+            int m_inFrame, m_outFrame, m_component;
+            int32_t m_unlabeledKey;
+        };
+        void dilateFrames(const VolumeFile* volIn, const std::vector<FrameInfo>& frames, VolumeFile* volOut, const VolumeFile* badRoi,
+                          const VolumeFile* dataRoi, const Method& myMethod, const VolumeNeighborhood& neighborhood, const std::vector<float>& stenWeights);
     };
 
     typedef TemplateAutoOperation<AlgorithmVolumeDilate> AutoAlgorithmVolumeDilate;
@@ -21,8 +21,12 @@
 #include "AlgorithmVolumeErode.h"
 #include "AlgorithmException.h"
 
+#include "CaretOMP.h"
 #include "CaretPointLocator.h"
+#include "CaretPointer.h"
+#include "Vector3D.h"
 #include "VolumeFile.h"
+#include "VolumeNeighborhood.h"
 
 #include <algorithm>
 #include <cmath>
@@ -86,20 +90,13 @@ void AlgorithmVolumeErode::useParameters(OperationParameters* myParams, Progress
 
 namespace
 {
-    void erodeFrame(const VolumeFile* volIn, const int& inFrame, const int& component, const float& distance, VolumeFile* volOut, const int& outFrame, const VolumeFile* roiVol)
+    const int64_t MAX_STENCIL_SIZE = 1000;//a kept voxel scans the whole stencil, so for larger distances a point locator query is faster
+    
+    //if useLocator, the neighborhood only holds the face neighbors (when they are needed), and the distance test uses a point locator of the empty voxels
+    void erodeFrame(const VolumeFile* volIn, const int& inFrame, const int& component, const float& distance, VolumeFile* volOut, const int& outFrame,
+                    const VolumeFile* roiVol, const VolumeNeighborhood& neighborhood, const bool& useLocator)
     {
-        int neighbors[] = { 0, 0, -1,
-                            0, -1, 0,
-                            -1, 0, 0,
-                            1, 0, 0,
-                            0, 1, 0,
-                            0, 0, 1 };
-        Vector3D ivec, jvec, kvec, origin;
-        volIn->getVolumeSpace().getSpacingVectors(ivec, jvec, kvec, origin);
-        float minSpacing = min(min(ivec.length(), jvec.length()), kvec.length());
-        bool checkNeighbors = (minSpacing > distance);
-        vector<int64_t> myDims;
-        volIn->getDimensions(myDims);
+        const int64_t* myDims = neighborhood.getDimensions();
         const float* inData = volIn->getFrame(inFrame, component), *roiData = NULL;
         float emptyVal = 0.0f;
         bool labelData = false;
@@ -109,71 +106,81 @@ namespace
             labelData = true;
         }
         if (roiVol != NULL) roiData = roiVol->getFrame();
-        vector<float> scratchFrame(inData, inData + myDims[0] * myDims[1] * myDims[2]);//start with a copy, then zero what we don't need
-        vector<float> coordList;
+        vector<char> emptyMask;//padded, 1 means inside the volume, inside the roi, and empty
+        neighborhood.initPaddedMask(emptyMask);
+#pragma omp CARET_PARFOR schedule(static)
         for (int64_t k = 0; k < myDims[2]; ++k)
         {
             for (int64_t j = 0; j < myDims[1]; ++j)
             {
                 for (int64_t i = 0; i < myDims[0]; ++i)
                 {
-                    int64_t flatIndex = volIn->getIndex(i, j, k);
+                    int64_t flatIndex = neighborhood.getFrameIndex(i, j, k);
                     if (roiData == NULL || roiData[flatIndex] > 0.0f)
                     {
                         if (labelData)
                         {
-                            if (floor(inData[flatIndex] + 0.5f) == emptyVal)
-                            {
-                                float coord[3];
-                                volIn->indexToSpace(i, j, k, coord);
-                                coordList.insert(coordList.end(), coord, coord + 3);
-                            }
+                            if (floor(inData[flatIndex] + 0.5f) == emptyVal) emptyMask[neighborhood.getPaddedIndex(i, j, k)] = 1;
                         } else {
-                            if (inData[flatIndex] == 0.0f)
-                            {
-                                float coord[3];
-                                volIn->indexToSpace(i, j, k, coord);
-                                coordList.insert(coordList.end(), coord, coord + 3);
-                            }
+                            if (inData[flatIndex] == 0.0f) emptyMask[neighborhood.getPaddedIndex(i, j, k)] = 1;
                         }
                     }
                 }
             }
         }
-        CaretPointLocator myLocator(coordList.data(), coordList.size() / 3);
-        for (int64_t k = 0; k < myDims[2]; ++k)
+        vector<float> scratchFrame(inData, inData + myDims[0] * myDims[1] * myDims[2]);//start with a copy, then zero what we don't need
+        const char* emptyPtr = emptyMask.data();
+        CaretPointer<CaretPointLocator> myLocator;
+        if (useLocator)
         {
-            for (int64_t j = 0; j < myDims[1]; ++j)
+            vector<float> coordList;
+            for (int64_t k = 0; k < myDims[2]; ++k)
             {
-                for (int64_t i = 0; i < myDims[0]; ++i)
+                for (int64_t j = 0; j < myDims[1]; ++j)
+                {
+                    for (int64_t i = 0; i < myDims[0]; ++i)
+                    {
+                        if (emptyPtr[neighborhood.getPaddedIndex(i, j, k)])
+                        {
+                            float coord[3];
+                            volIn->indexToSpace(i, j, k, coord);
+                            coordList.insert(coordList.end(), coord, coord + 3);
+                        }
+                    }
+                }
+            }
+            myLocator.grabNew(new CaretPointLocator(coordList.data(), coordList.size() / 3));
+        }
+        const int64_t* paddedOffsets = neighborhood.getPaddedOffsets();
+        const int stensize = (int)neighborhood.getStencilSize();
+        const bool checkCenter = (distance > 0.0f);//the center voxel is in range of itself unless the distance is zero
+        const vector<VolumeNeighborhood::Brick>& bricks = neighborhood.getBricks();
+        const int64_t numBricks = (int64_t)bricks.size();
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t b = 0; b < numBricks; ++b)
+        {
+            const VolumeNeighborhood::Brick& myBrick = bricks[b];
+            for (int64_t k = myBrick.m_start[2]; k < myBrick.m_end[2]; ++k)
+            {
+                for (int64_t j = myBrick.m_start[1]; j < myBrick.m_end[1]; ++j)
                 {
-                    float coord[3];
-                    volIn->indexToSpace(i, j, k, coord);
-                    if (myLocator.anyInRange(coord, distance))
+                    for (int64_t i = myBrick.m_start[0]; i < myBrick.m_end[0]; ++i)
                     {
-                        scratchFrame[volIn->getIndex(i, j, k)] = emptyVal;//this is used for both label and normal data, use the variable
-                    } else if (checkNeighbors) {
-                        for (int neigh = 0; neigh < 18; neigh += 3)
+                        const int64_t paddedIndex = neighborhood.getPaddedIndex(i, j, k);
+                        bool erode = checkCenter && emptyPtr[paddedIndex];
+                        if (useLocator && !erode)
+                        {
+                            float coord[3];
+                            volIn->indexToSpace(i, j, k, coord);
+                            erode = myLocator->anyInRange(coord, distance);
+                        }
+                        for (int stenind = 0; !erode && stenind < stensize; ++stenind)
+                        {
+                            erode = (emptyPtr[paddedIndex + paddedOffsets[stenind]] != 0);
+                        }
+                        if (erode)
                         {
-                            if (volIn->indexValid(i + neighbors[neigh], j + neighbors[neigh + 1], k + neighbors[neigh + 2]))
-                            {
-                                int64_t flatIndex = volIn->getIndex(i + neighbors[neigh], j + neighbors[neigh + 1], k + neighbors[neigh + 2]);
-                                if (roiData == NULL || roiData[flatIndex] > 0.0f)
-                                {
-                                    if (labelData)
-                                    {
-                                        if (floor(inData[flatIndex] + 0.5f) == emptyVal)
-                                        {
-                                            scratchFrame[volIn->getIndex(i, j, k)] = emptyVal;
-                                        }
-                                    } else {
-                                        if (inData[flatIndex] == 0.0f)
-                                        {
-                                            scratchFrame[volIn->getIndex(i, j, k)] = 0.0f;
-                                        }
-                                    }
-                                }
-                            }
+                            scratchFrame[neighborhood.getFrameIndex(i, j, k)] = emptyVal;//this is used for both label and normal data, use the variable
                         }
                     }
                 }
@@ -200,6 +207,14 @@ AlgorithmVolumeErode::AlgorithmVolumeErode(ProgressObject* myProgObj, const Volu
     {
         throw AlgorithmException("roi volume space does not match input volume");
     }
+    Vector3D ivec, jvec, kvec, origin;
+    volIn->getVolumeSpace().getSpacingVectors(ivec, jvec, kvec, origin);
+    float minSpacing = min(min(ivec.length(), jvec.length()), kvec.length());
+    int stencilFlags = VolumeNeighborhood::EXCLUDE_AT_DISTANCE;//voxels exactly at the distance are not eroded
+    if (minSpacing > distance) stencilFlags |= VolumeNeighborhood::INCLUDE_FACE_NEIGHBORS;
+    const float PI = 3.141592654f, voxelVolume = abs(ivec.dot(jvec.cross(kvec)));
+    const bool useLocator = (4.0f / 3.0f * PI * distance * distance * distance > MAX_STENCIL_SIZE * voxelVolume);//estimated stencil size
+    VolumeNeighborhood neighborhood(myDims.data(), volIn->getSform(), (useLocator ? 0.0f : distance), stencilFlags);//zero distance leaves only the face neighbors, if requested
     if (subvol == -1)
     {
         volOut->reinitialize(volIn->getOriginalDimensions(), volIn->getSform(), volIn->getNumberOfComponents(), volIn->getType());
@@ -217,7 +232,7 @@ AlgorithmVolumeErode::AlgorithmVolumeErode(ProgressObject* myProgObj, const Volu
         {
             for (int c = 0; c < myDims[4]; ++c)
             {
-                erodeFrame(volIn, s, c, distance, volOut, s, roiVol);
+                erodeFrame(volIn, s, c, distance, volOut, s, roiVol, neighborhood, useLocator);
             }
         }
     } else {
@@ -233,7 +248,7 @@ AlgorithmVolumeErode::AlgorithmVolumeErode(ProgressObject* myProgObj, const Volu
         volOut->setMapName(0, volIn->getMapName(subvol) + " dilate " + AString::number(distance));
         for (int c = 0; c < myDims[4]; ++c)
         {
-            erodeFrame(volIn, subvol, c, distance, volOut, 0, roiVol);
+            erodeFrame(volIn, subvol, c, distance, volOut, 0, roiVol, neighborhood, useLocator);
         }
     }
 }
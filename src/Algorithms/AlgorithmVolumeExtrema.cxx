@@ -25,6 +25,7 @@
 #include "CaretLogger.h"
 #include "CaretOMP.h"
 #include "VolumeFile.h"
+#include "VolumeNeighborhood.h"
 #include <cmath>
 #include <utility>
 #include <vector>
@@ -368,46 +369,15 @@ AlgorithmVolumeExtrema::AlgorithmVolumeExtrema(ProgressObject* myProgObj, const
 
 void AlgorithmVolumeExtrema::precomputeStencil(const VolumeFile* myVolIn, const float& distance)
 {
-    m_stencil.clear();
-    const vector<vector<float> >& volSpace = myVolIn->getSform();
-    Vector3D ivec, jvec, kvec, origin;
-    ivec[0] = volSpace[0][0]; jvec[0] = volSpace[0][1]; kvec[0] = volSpace[0][2]; origin[0] = volSpace[0][3];
-    ivec[1] = volSpace[1][0]; jvec[1] = volSpace[1][1]; kvec[1] = volSpace[1][2]; origin[1] = volSpace[1][3];
-    ivec[2] = volSpace[2][0]; jvec[2] = volSpace[2][1]; kvec[2] = volSpace[2][2]; origin[2] = volSpace[2][3];
-    Vector3D ijorth = ivec.cross(jvec).normal();//find the bounding box that encloses a sphere of radius kernBox
-    Vector3D jkorth = jvec.cross(kvec).normal();
-    Vector3D kiorth = kvec.cross(ivec).normal();
-    m_irange = (int)floor(abs(distance / ivec.dot(jkorth)));//these are member variables so we can avoid testing for things outside the volume bounding box when the stencil is
-    m_jrange = (int)floor(abs(distance / jvec.dot(kiorth)));// guaranteed within the bounding box
-    m_krange = (int)floor(abs(distance / kvec.dot(ijorth)));
-    if (m_irange < 1) m_irange = 1;//don't underflow
-    if (m_jrange < 1) m_jrange = 1;
-    if (m_krange < 1) m_krange = 1;
-    float dist2 = distance * distance;//don't require square root calls
-    VoxelIJK tempVox;
-    bool ichange = false, jchange = false, kchange = false;//ensure that stencil is 3D, not degenerate
-    for (int k = -m_krange; k <= m_krange; ++k)//generate the stencil list in the same index order as the volume file
-    {
-        Vector3D kpart = k * kvec;
-        tempVox.m_ijk[2] = k;
-        for (int j = -m_jrange; j <= m_jrange; ++j)
-        {
-            Vector3D jpart = (j * jvec) + kpart;//I could do an extra test here, or recompute the range, but we only do this once, so whatever
-            tempVox.m_ijk[1] = j;
-            for (int i = -m_irange; i <= m_irange; ++i)
-            {
-                if (k == 0 && j == 0 && i == 0) continue;//skip the center voxel
-                if ((jpart + (i * ivec)).lengthsquared() <= dist2)
-                {
-                    tempVox.m_ijk[0] = i;
-                    m_stencil.push_back(tempVox);
-                    if (k != 0) kchange = true;
-                    if (j != 0) jchange = true;
-                    if (i != 0) ichange = true;
-                }
-            }
-        }
-    }
+    vector<int64_t> myDims;
+    myVolIn->getDimensions(myDims);
+    VolumeNeighborhood neighborhood(myDims.data(), myVolIn->getSform(), distance);//same index order as the volume file
+    m_stencil = neighborhood.getStencilIJK();
+    const int* range = neighborhood.getRange();//these are member variables so we can avoid bounds checks when the stencil is guaranteed within the volume
+    m_irange = range[0];
+    m_jrange = range[1];
+    m_krange = range[2];
+    bool ichange = (m_irange != 0), jchange = (m_jrange != 0), kchange = (m_krange != 0);//ensure that stencil is 3D, not degenerate
     if (!ichange || !jchange || !kchange)
     {
         CaretLogWarning("distance too small, stencil did not use all 3 dimensions, substituting in 6-neighbor stencil");
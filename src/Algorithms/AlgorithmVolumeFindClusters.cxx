@@ -23,11 +23,14 @@
 
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretPointer.h"
 #include "CaretPointLocator.h"
+#include "ConnectedComponents.h"
 #include "VolumeFile.h"
 #include "VoxelIJK.h"
 
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
@@ -135,84 +138,46 @@ void AlgorithmVolumeFindClusters::useParameters(OperationParameters* myParams, P
 
 namespace
 {
-    void processSubvol(const float* inFrame, VolumeFile* volOut, const int64_t& outSubvol, const int64_t& outComponent, const float& threshValue, const float& minVolume,
-                       const bool& lessThan, const float* roiFrame, const float& sizeRatio, const float& distanceCutoff, int& markVal)
+    void processSubvol(const vector<int64_t>& labels, const vector<int64_t>& sizes, VolumeFile* volOut, const int64_t& outSubvol, const int64_t& outComponent,
+                       const float& minVolume, const float& sizeRatio, const float& distanceCutoff, int& markVal)
     {
         vector<int64_t> dims = volOut->getDimensions();
-        int64_t frameSize = dims[0] * dims[1] * dims[2];
         const VolumeSpace& mySpace = volOut->getVolumeSpace();
         Vector3D ivec, jvec, kvec, origin;
         mySpace.getSpacingVectors(ivec, jvec, kvec, origin);
         float voxelVolume = abs(ivec.dot(jvec.cross(kvec)));
         int64_t minVoxels = (int64_t)ceil(minVolume / voxelVolume);
-        vector<VoxelIJK> neighbors;
-        neighbors.push_back(VoxelIJK(1, 0, 0));
-        neighbors.push_back(VoxelIJK(-1, 0, 0));
-        neighbors.push_back(VoxelIJK(0, 1, 0));
-        neighbors.push_back(VoxelIJK(0, -1, 0));
-        neighbors.push_back(VoxelIJK(0, 0, 1));
-        neighbors.push_back(VoxelIJK(0, 0, -1));
-        vector<char> marked(frameSize, 0);
-        if (lessThan)
+        int64_t numComponents = (int64_t)sizes.size();
+        vector<int64_t> componentToCluster(numComponents, -1);//components are numbered in the order a flood fill in index order finds them, so marking order is unchanged
+        vector<vector<VoxelIJK> > clusters;
+        size_t biggestCount = 0;
+        int64_t biggestCluster = -1;
+        for (int64_t i = 0; i < numComponents; ++i)
         {
-            for (int64_t i = 0; i < frameSize; ++i)
-            {
-                if ((roiFrame == NULL || roiFrame[i] > 0.0f) && inFrame[i] < threshValue)
-                {
-                    marked[i] = 1;
-                }
-            }
-        } else {
-            for (int64_t i = 0; i < frameSize; ++i)
+            if (sizes[i] >= minVoxels)
             {
-                if ((roiFrame == NULL || roiFrame[i] > 0.0f) && inFrame[i] > threshValue)
+                if ((size_t)sizes[i] > biggestCount)
                 {
-                    marked[i] = 1;
+                    biggestCount = sizes[i];
+                    biggestCluster = (int64_t)clusters.size();
                 }
+                componentToCluster[i] = (int64_t)clusters.size();
+                clusters.push_back(vector<VoxelIJK>());
+                clusters.back().reserve(sizes[i]);
             }
         }
-        vector<vector<VoxelIJK> > clusters;
-        size_t biggestCount = 0;
-        int64_t biggestCluster = -1;
-        for (int64_t k = 0; k < dims[2]; ++k)
+        if (!clusters.empty())
         {
-            for (int64_t j = 0; j < dims[1]; ++j)
+            for (int64_t k = 0; k < dims[2]; ++k)
             {
-                for (int64_t i = 0; i < dims[0]; ++i)
+                for (int64_t j = 0; j < dims[1]; ++j)
                 {
-                    int64_t myIndex = mySpace.getIndex(i, j, k);
-                    if (marked[myIndex])
+                    for (int64_t i = 0; i < dims[0]; ++i)
                     {
-                        vector<VoxelIJK> voxelList;
-                        voxelList.push_back(VoxelIJK(i, j, k));
-                        marked[myIndex] = 0;//don't let voxels get duplicated in the list
-                        for (int64_t index = 0; index < (int64_t)voxelList.size(); ++index)//NOTE: vector grows inside loop
+                        const int64_t& myLabel = labels[mySpace.getIndex(i, j, k)];
+                        if (myLabel != -1 && componentToCluster[myLabel] != -1)
                         {
-                            const VoxelIJK& thisVoxel = voxelList[index];
-                            for (int n = 0; n < (int)neighbors.size(); ++n)
-                            {
-                                VoxelIJK neighVox(thisVoxel.m_ijk[0] + neighbors[n].m_ijk[0],
-                                                    thisVoxel.m_ijk[1] + neighbors[n].m_ijk[1],
-                                                    thisVoxel.m_ijk[2] + neighbors[n].m_ijk[2]);
-                                if (mySpace.indexValid(neighVox.m_ijk))
-                                {
-                                    int64_t neighIndex = mySpace.getIndex(neighVox.m_ijk);
-                                    if (marked[neighIndex])
-                                    {
-                                        voxelList.push_back(neighVox);
-                                        marked[neighIndex] = 0;
-                                    }
-                                }
-                            }
-                        }
-                        if ((int64_t)voxelList.size() >= minVoxels)
-                        {
-                            if (voxelList.size() > biggestCount)
-                            {
-                                biggestCount = voxelList.size();
-                                biggestCluster = (int64_t)clusters.size();
-                            }
-                            clusters.push_back(voxelList);
+                            clusters[componentToCluster[myLabel]].push_back(VoxelIJK(i, j, k));
                         }
                     }
                 }
@@ -305,6 +270,8 @@ AlgorithmVolumeFindClusters::AlgorithmVolumeFindClusters(ProgressObject* myProgO
     }
     vector<int64_t> dims = volIn->getDimensions();
     int markVal = startVal;
+    vector<const float*> inFrames;//label frames in parallel batches, then mark them in order
+    vector<int64_t> outSubvols, outComponents;
     if (subvolNum == -1)
     {
         volOut->reinitialize(volIn->getOriginalDimensions(), volIn->getSform(), dims[4]);
@@ -313,8 +280,9 @@ AlgorithmVolumeFindClusters::AlgorithmVolumeFindClusters(ProgressObject* myProgO
         {
             for (int64_t s = 0; s < dims[3]; ++s)
             {
-                const float* inFrame = volIn->getFrame(s, c);
-                processSubvol(inFrame, volOut, s, c, threshValue, minVolume, lessThan, roiFrame, sizeRatio, distanceCutoff, markVal);
+                inFrames.push_back(volIn->getFrame(s, c));
+                outSubvols.push_back(s);
+                outComponents.push_back(c);
             }
         }
     } else {
@@ -324,8 +292,25 @@ AlgorithmVolumeFindClusters::AlgorithmVolumeFindClusters(ProgressObject* myProgO
         volOut->setValueAllVoxels(0.0f);
         for (int64_t c = 0; c < dims[4]; ++c)
         {
-            const float* inFrame = volIn->getFrame(subvolNum, c);
-            processSubvol(inFrame, volOut, 0, c, threshValue, minVolume, lessThan, roiFrame, sizeRatio, distanceCutoff, markVal);
+            inFrames.push_back(volIn->getFrame(subvolNum, c));
+            outSubvols.push_back(0);
+            outComponents.push_back(c);
+        }
+    }
+    int64_t numFrames = (int64_t)inFrames.size(), batchSize = 1;
+#ifdef CARET_OMP
+    batchSize = omp_get_max_threads();//limits memory used by labels, a single frame is labeled in parallel instead
+#endif
+    for (int64_t batchStart = 0; batchStart < numFrames; batchStart += batchSize)
+    {
+        int64_t batchEnd = min(batchStart + batchSize, numFrames);
+        vector<const float*> batchFrames(inFrames.begin() + batchStart, inFrames.begin() + batchEnd);
+        vector<vector<int64_t> > labels, sizes;
+        vector<int64_t> counts;
+        ConnectedComponents::thresholdAndLabelGrid(dims.data(), batchFrames, threshValue, lessThan, roiFrame, labels, counts, &sizes);
+        for (int64_t i = batchStart; i < batchEnd; ++i)
+        {
+            processSubvol(labels[i - batchStart], sizes[i - batchStart], volOut, outSubvols[i], outComponents[i], minVolume, sizeRatio, distanceCutoff, markVal);
         }
     }
     if (endVal != NULL) *endVal = markVal;
@@ -0,0 +1,181 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AlgorithmVolumeRegression.h"
+#include "AlgorithmException.h"
+
+#include "AlgorithmCiftiRegression.h"
+#include "CaretOMP.h"
+#include "VolumeFile.h"
+
+#include <algorithm>
+
+using namespace caret;
+using namespace std;
+
+AString AlgorithmVolumeRegression::getCommandSwitch()
+{
+    return "-volume-regression";
+}
+
+AString AlgorithmVolumeRegression::getShortDescription()
+{
+    return "REGRESS A DESIGN MATRIX OUT OF VOLUME TIMESERIES";
+}
+
+OperationParameters* AlgorithmVolumeRegression::getParameters()
+{
+    OperationParameters* ret = new OperationParameters();
+    ret->addVolumeParameter(1, "volume-in", "the input 4D volume");
+    
+    ret->addStringParameter(2, "design", "text file of regressors, one line per frame, one column per regressor");
+    
+    ret->addVolumeOutputParameter(3, "volume-out", "output - the residuals");
+    
+    ParameterComponent* keepOpt = ret->createRepeatableParameter(4, "-keep", "include a design column in the regression, but don't remove it");
+    keepOpt->addIntegerParameter(1, "column", "the 1-based column number in the design file");
+    
+    OptionalParameter* betasOpt = ret->createOptionalParameter(5, "-betas", "output the regression coefficients");
+    betasOpt->addVolumeOutputParameter(1, "betas-out", "the coefficients, one frame per design column, the last frame is the intercept");
+    
+    ret->setHelpText(
+        AString("Fits the design to the timeseries of every voxel by least squares, and removes the fitted contribution of each design column ") +
+        "that isn't specified with -keep.  " +
+        "An intercept column is always added to the design and is never removed, and the removed columns are demeaned before their fitted contribution is subtracted, so the mean of each voxel is unchanged.  " +
+        "The fit is precomputed once with a QR decomposition."
+    );
+    return ret;
+}
+
+void AlgorithmVolumeRegression::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
+{
+    VolumeFile* myVol = myParams->getVolume(1);
+    DenseMatrix design = AlgorithmCiftiRegression::readDesignFile(myParams->getString(2));
+    VolumeFile* myVolOut = myParams->getOutputVolume(3);
+    vector<int> keepColumns;
+    const vector<ParameterComponent*>& keepInstances = *(myParams->getRepeatableParameterInstances(4));
+    for (int i = 0; i < (int)keepInstances.size(); ++i)
+    {
+        int64_t column = keepInstances[i]->getInteger(1);
+        if (column < 1 || column > design.getNumberOfColumns()) throw AlgorithmException("-keep column " + AString::number(column) + " is not in the design file");
+        keepColumns.push_back((int)column - 1);
+    }
+    VolumeFile* myBetasOut = NULL;
+    OptionalParameter* betasOpt = myParams->getOptionalParameter(5);
+    if (betasOpt->m_present)
+    {
+        myBetasOut = betasOpt->getOutputVolume(1);
+    }
+    AlgorithmVolumeRegression(myProgObj, myVol, design, myVolOut, keepColumns, myBetasOut);
+}
+
+AlgorithmVolumeRegression::AlgorithmVolumeRegression(ProgressObject* myProgObj, const VolumeFile* myVol, const DenseMatrix& design, VolumeFile* myVolOut,
+                                                     const vector<int>& keepColumns, VolumeFile* myBetasOut) : AbstractAlgorithm(myProgObj)
+{
+    LevelProgress myProgress(myProgObj, 1.0f, 0.1f);
+    vector<int64_t> myDims;
+    myVol->getDimensions(myDims);
+    if (myDims[4] != 1) throw AlgorithmException("regression does not support multi-component volumes");
+    const int64_t numFrames = myDims[3], frameSize = myDims[0] * myDims[1] * myDims[2];
+    if (design.getNumberOfRows() != numFrames)
+    {
+        throw AlgorithmException("design has " + AString::number(design.getNumberOfRows()) + " rows, but the input has " + AString::number(numFrames) + " frames");
+    }
+    DenseMatrix solverTranspose, removeDesignTranspose;
+    vector<int> removeColumns;
+    AlgorithmCiftiRegression::prepareDesign(design, keepColumns, solverTranspose, removeDesignTranspose, removeColumns);
+    const int numRegressors = (int)solverTranspose.getNumberOfColumns(), numRemove = (int)removeColumns.size();
+    vector<const float*> inFrames(numFrames);
+    for (int64_t t = 0; t < numFrames; ++t)
+    {
+        inFrames[t] = myVol->getFrame(t);
+    }
+    //frames are contiguous per timepoint, so gather voxel blocks into rows, and compute all coefficient maps first
+    const int64_t BLOCK_VOXELS = 512;
+    DenseMatrix betas(numRegressors, frameSize);//regressors x voxels, small compared to the input
+    const int64_t numBlocks = (frameSize + BLOCK_VOXELS - 1) / BLOCK_VOXELS;
+#pragma omp CARET_PAR
+    {
+        DenseMatrix inBlock, betasBlock;
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t block = 0; block < numBlocks; ++block)
+        {
+            const int64_t blockStart = block * BLOCK_VOXELS, blockSize = min(BLOCK_VOXELS, frameSize - blockStart);
+            inBlock.resize(blockSize, numFrames, true);
+            for (int64_t t = 0; t < numFrames; ++t)
+            {
+                const float* frameData = inFrames[t] + blockStart;
+                for (int64_t v = 0; v < blockSize; ++v)
+                {
+                    inBlock(v, t) = frameData[v];
+                }
+            }
+            DenseMatrix::multiply(inBlock, solverTranspose, betasBlock);//already parallel over blocks, multiply won't nest threads
+            for (int k = 0; k < numRegressors; ++k)
+            {
+                float* betasRow = betas.getRow(k) + blockStart;
+                for (int64_t v = 0; v < blockSize; ++v)
+                {
+                    betasRow[v] = betasBlock(v, k);
+                }
+            }
+        }
+    }
+    myProgress.reportProgress(0.5f);
+    myVolOut->reinitialize(myVol, numFrames);
+    vector<float> outFrame(frameSize);
+    for (int64_t t = 0; t < numFrames; ++t)
+    {//residual frames are the input frame minus a weighted sum of removed coefficient maps
+        const float* inFrame = inFrames[t];
+#pragma omp CARET_PARFOR schedule(static)
+        for (int64_t v = 0; v < frameSize; ++v)
+        {
+            double fitted = 0.0;
+            for (int k = 0; k < numRemove; ++k)
+            {
+                fitted += removeDesignTranspose(k, t) * betas(removeColumns[k], v);
+            }
+            outFrame[v] = inFrame[v] - fitted;
+        }
+        myVolOut->setFrame(outFrame.data(), t);
+        myProgress.reportProgress(0.5f + 0.5f * (t + 1) / numFrames);
+    }
+    if (myBetasOut != NULL)
+    {
+        myBetasOut->reinitialize(myVol, numRegressors);
+        for (int k = 0; k < numRegressors; ++k)
+        {
+            myBetasOut->setFrame(betas.getRow(k), k);
+            myBetasOut->setMapName(k, (k == numRegressors - 1 ? AString("intercept") : "column " + AString::number(k + 1)));
+        }
+    }
+}
+
+float AlgorithmVolumeRegression::getAlgorithmInternalWeight()
+{
+    return 1.0f;//override this if needed, if the progress bar isn't smooth
+}
+
+float AlgorithmVolumeRegression::getSubAlgorithmWeight()
+{
+    //return AlgorithmInsertNameHere::getAlgorithmWeight();//if you use a subalgorithm
+    return 0.0f;
+}
@@ -85,6 +85,7 @@
 #include "DisplayPropertiesVolume.h"
 #include "ElapsedTimer.h"
 #include "EventAnnotationColorBarGet.h"
+#include "EventGraphicsOpenGLCreateTextureName.h"
 #include "EventManager.h"
 #include "EventModelSurfaceGet.h"
 #include "EventNodeIdentificationColorsGetFromCharts.h"
@@ -100,6 +101,7 @@
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
 #include "GraphicsEngineDataOpenGL.h"
+#include "GraphicsOpenGLTextureName.h"
 #include "GraphicsPrimitiveV3fC4ub.h"
 #include "GraphicsPrimitiveV3f.h"
 #include "GraphicsShape.h"
@@ -143,6 +145,7 @@
 #include "SurfaceProjectedItem.h"
 #include "SurfaceProjectionBarycentric.h"
 #include "SurfaceProjectionVanEssen.h"
+#include "SurfaceRayIntersector.h"
 #include "SurfaceSelectionModel.h"
 #include "TopologyHelper.h"
 #include "VolumeFile.h"
@@ -173,6 +176,10 @@ BrainOpenGLFixedPipeline::BrainOpenGLFixedPipeline(BrainOpenGLTextRenderInterfac
     m_shapeCylinder = NULL;
     m_shapeCube   = NULL;
     m_shapeCubeRounded = NULL;
+    m_volumeSliceTextureName = NULL;
+    m_volumeSliceTextureDimensions[0] = 0;
+    m_volumeSliceTextureDimensions[1] = 0;
+    m_volumeSliceMaximumTextureSize = 0;
     this->surfaceNodeColoring = new SurfaceNodeColoring();
     m_brain = NULL;
     m_clippingPlaneGroup = NULL;
@@ -207,6 +214,10 @@ BrainOpenGLFixedPipeline::~BrainOpenGLFixedPipeline()
         delete m_shapeCubeRounded;
         m_shapeCubeRounded = NULL;
     }
+    if (m_volumeSliceTextureName != NULL) {
+        delete m_volumeSliceTextureName;
+        m_volumeSliceTextureName = NULL;
+    }
     if (this->surfaceNodeColoring != NULL) {
         delete this->surfaceNodeColoring;
         this->surfaceNodeColoring = NULL;
@@ -755,6 +766,120 @@ BrainOpenGLFixedPipeline::drawTabHighlighting(const float width,
     }
 }
 
+/**
+ * Make sure the texture used for drawing orthogonal volume slices
+ * exists in the current OpenGL context and test that a slice fits
+ * in it.  The texture and the maximum texture size are kept so that
+ * they are not created and queried for every slice that is drawn.
+ *
+ * @param numberOfColumns
+ *    Number of columns in the slice.
+ * @param numberOfRows
+ *    Number of rows in the slice.
+ * @return
+ *    True if the slice can be drawn with the texture, false if there is
+ *    no OpenGL context or the slice is larger than the maximum texture size.
+ */
+bool
+BrainOpenGLFixedPipeline::isVolumeSliceTextureSizeValid(const int64_t numberOfColumns,
+                                                        const int64_t numberOfRows)
+{
+    void* contextPointer = getContextSharingGroupPointer();
+    if (contextPointer == NULL) {
+        return false;
+    }
+    
+    if (m_volumeSliceTextureName != NULL) {
+        if (m_volumeSliceTextureName->getOpenGLContextPointer() != contextPointer) {
+            /*
+             * Deletion is deferred until its own context is current
+             */
+            delete m_volumeSliceTextureName;
+            m_volumeSliceTextureName = NULL;
+        }
+    }
+    
+    if (m_volumeSliceTextureName == NULL) {
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE,
+                      &m_volumeSliceMaximumTextureSize);
+        
+        EventGraphicsOpenGLCreateTextureName createEvent;
+        EventManager::get()->sendEvent(createEvent.getPointer());
+        m_volumeSliceTextureName = createEvent.getOpenGLTextureName();
+        if (m_volumeSliceTextureName == NULL) {
+            return false;
+        }
+        
+        glPushAttrib(GL_TEXTURE_BIT);
+        glBindTexture(GL_TEXTURE_2D, m_volumeSliceTextureName->getTextureName());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glPopAttrib();
+        
+        m_volumeSliceTextureDimensions[0] = 0;
+        m_volumeSliceTextureDimensions[1] = 0;
+    }
+    
+    if ((numberOfColumns > m_volumeSliceMaximumTextureSize)
+        || (numberOfRows > m_volumeSliceMaximumTextureSize)) {
+        return false;
+    }
+    
+    return true;
+}
+
+/**
+ * Bind the volume slice texture and load a slice's coloring into it.
+ * If the slice has the same dimensions as the previous slice, the
+ * texture's storage is reused and only its content is replaced.
+ * Must be preceded by a successful call to isVolumeSliceTextureSizeValid().
+ *
+ * @param numberOfColumns
+ *    Number of columns in the slice.
+ * @param numberOfRows
+ *    Number of rows in the slice.
+ * @param rgba
+ *    RGBA coloring for the slice, by rows with column varying fastest.
+ */
+void
+BrainOpenGLFixedPipeline::loadVolumeSliceTexture(const int64_t numberOfColumns,
+                                                 const int64_t numberOfRows,
+                                                 const uint8_t* rgba)
+{
+    CaretAssert(m_volumeSliceTextureName);
+    
+    glBindTexture(GL_TEXTURE_2D, m_volumeSliceTextureName->getTextureName());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    
+    if ((numberOfColumns == m_volumeSliceTextureDimensions[0])
+        && (numberOfRows == m_volumeSliceTextureDimensions[1])) {
+        glTexSubImage2D(GL_TEXTURE_2D,
+                        0,
+                        0,
+                        0,
+                        numberOfColumns,
+                        numberOfRows,
+                        GL_RGBA,
+                        GL_UNSIGNED_BYTE,
+                        rgba);
+    }
+    else {
+        glTexImage2D(GL_TEXTURE_2D,
+                     0,
+                     GL_RGBA,
+                     numberOfColumns,
+                     numberOfRows,
+                     0,
+                     GL_RGBA,
+                     GL_UNSIGNED_BYTE,
+                     rgba);
+        m_volumeSliceTextureDimensions[0] = numberOfColumns;
+        m_volumeSliceTextureDimensions[1] = numberOfRows;
+    }
+}
+
 /**
  * Draw the chart coordinate space annotations.
  *
@@ -2012,52 +2137,67 @@ BrainOpenGLFixedPipeline::drawSurfaceTriangles(Surface* surface,
             break;
     }
     
+    /*
+     * Find the triangle under the mouse on the CPU when possible so
+     * that the surface does not need to be rendered with ID colors.
+     */
+    int32_t triangleIndex = -1;
+    float depth = -1.0;
+    bool triangleFromRayCastFlag = false;
     if (isSelect) {
+        triangleFromRayCastFlag = getSurfaceTriangleWithRayCast(surface,
+                                                                triangleIndex,
+                                                                depth);
+    }
+    
+    if (isSelect
+        && ( ! triangleFromRayCastFlag)) {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     }
     
     uint8_t rgba[4];
     
-    glBegin(GL_TRIANGLES);
-    for (int32_t i = 0; i < numTriangles; i++) {
-        const int32_t i3 = i * 3;
-        const int32_t n1 = triangles[i3];
-        const int32_t n2 = triangles[i3+1];
-        const int32_t n3 = triangles[i3+2];
+    if ( ! triangleFromRayCastFlag) {
+        glBegin(GL_TRIANGLES);
+        for (int32_t i = 0; i < numTriangles; i++) {
+            const int32_t i3 = i * 3;
+            const int32_t n1 = triangles[i3];
+            const int32_t n2 = triangles[i3+1];
+            const int32_t n3 = triangles[i3+2];
         
-        if (isSelect) {
-            this->colorIdentification->addItem(rgba, SelectionItemDataTypeEnum::SURFACE_TRIANGLE, i);
-            glColor3ubv(rgba);
-            glNormal3fv(&normals[n1*3]);
-            glVertex3fv(&coordinates[n1*3]);
-            glNormal3fv(&normals[n2*3]);
-            glVertex3fv(&coordinates[n2*3]);
-            glNormal3fv(&normals[n3*3]);
-            glVertex3fv(&coordinates[n3*3]);
-        }
-        else {
-            glColor4fv(&nodeColoringRGBA[n1*4]);
-            glNormal3fv(&normals[n1*3]);
-            glVertex3fv(&coordinates[n1*3]);
-            glColor4fv(&nodeColoringRGBA[n2*4]);
-            glNormal3fv(&normals[n2*3]);
-            glVertex3fv(&coordinates[n2*3]);
-            glColor4fv(&nodeColoringRGBA[n3*4]);
-            glNormal3fv(&normals[n3*3]);
-            glVertex3fv(&coordinates[n3*3]);
+            if (isSelect) {
+                this->colorIdentification->addItem(rgba, SelectionItemDataTypeEnum::SURFACE_TRIANGLE, i);
+                glColor3ubv(rgba);
+                glNormal3fv(&normals[n1*3]);
+                glVertex3fv(&coordinates[n1*3]);
+                glNormal3fv(&normals[n2*3]);
+                glVertex3fv(&coordinates[n2*3]);
+                glNormal3fv(&normals[n3*3]);
+                glVertex3fv(&coordinates[n3*3]);
+            }
+            else {
+                glColor4fv(&nodeColoringRGBA[n1*4]);
+                glNormal3fv(&normals[n1*3]);
+                glVertex3fv(&coordinates[n1*3]);
+                glColor4fv(&nodeColoringRGBA[n2*4]);
+                glNormal3fv(&normals[n2*3]);
+                glVertex3fv(&coordinates[n2*3]);
+                glColor4fv(&nodeColoringRGBA[n3*4]);
+                glNormal3fv(&normals[n3*3]);
+                glVertex3fv(&coordinates[n3*3]);
+            }
         }
+        glEnd();
     }
-    glEnd();
     
     if (isSelect) {
-        int32_t triangleIndex = -1;
-        float depth = -1.0;
-        this->getIndexFromColorSelection(SelectionItemDataTypeEnum::SURFACE_TRIANGLE, 
-                                         this->mouseX, 
-                                         this->mouseY,
-                                         triangleIndex,
-                                         depth);
-        
+        if ( ! triangleFromRayCastFlag) {
+            this->getIndexFromColorSelection(SelectionItemDataTypeEnum::SURFACE_TRIANGLE,
+                                             this->mouseX,
+                                             this->mouseY,
+                                             triangleIndex,
+                                             depth);
+        }
         
         if (triangleIndex >= 0) {
             bool isTriangleIdAccepted = false;
@@ -2407,6 +2547,96 @@ BrainOpenGLFixedPipeline::drawSurfaceNodes(Surface* surface,
 }
 
 
+/**
+ * Find the surface triangle under the mouse by casting a ray from the
+ * mouse position through the surface's cached triangle hierarchy,
+ * instead of rendering the triangles with identification colors.
+ *
+ * @param surface
+ *    Surface that is tested.
+ * @param triangleIndexOut
+ *    Index of triangle under the mouse or negative if none.
+ * @param depthOut
+ *    Window depth of the intersection, same as the depth buffer value.
+ * @return
+ *    True if the ray cast was performed (even if no triangle was hit).
+ *    False if clipping or culling is active so that the ray cast
+ *    may not match what is displayed and color identification
+ *    must be used.
+ */
+bool
+BrainOpenGLFixedPipeline::getSurfaceTriangleWithRayCast(const Surface* surface,
+                                                        int32_t& triangleIndexOut,
+                                                        float& depthOut)
+{
+    triangleIndexOut = -1;
+    depthOut = -1.0;
+    
+    for (int32_t i = 0; i < 6; i++) {
+        if (glIsEnabled(GL_CLIP_PLANE0 + i)) {
+            return false;
+        }
+    }
+    if (glIsEnabled(GL_CULL_FACE)) {
+        return false;
+    }
+    
+    GLdouble modelviewMatrix[16];
+    glGetDoublev(GL_MODELVIEW_MATRIX, modelviewMatrix);
+    GLdouble projectionMatrix[16];
+    glGetDoublev(GL_PROJECTION_MATRIX, projectionMatrix);
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    
+    /*
+     * Ray passes through center of the pixel that would be read
+     * from the frame buffer, from the near to the far clipping plane.
+     */
+    const double windowX = this->mouseX + 0.5;
+    const double windowY = this->mouseY + 0.5;
+    double nearXYZ[3];
+    double farXYZ[3];
+    if ( ! gluUnProject(windowX, windowY, 0.0,
+                        modelviewMatrix, projectionMatrix, viewport,
+                        &nearXYZ[0], &nearXYZ[1], &nearXYZ[2])) {
+        return false;
+    }
+    if ( ! gluUnProject(windowX, windowY, 1.0,
+                        modelviewMatrix, projectionMatrix, viewport,
+                        &farXYZ[0], &farXYZ[1], &farXYZ[2])) {
+        return false;
+    }
+    const double direction[3] = {
+        farXYZ[0] - nearXYZ[0],
+        farXYZ[1] - nearXYZ[1],
+        farXYZ[2] - nearXYZ[2]
+    };
+    
+    CaretPointer<const SurfaceRayIntersector> intersector = surface->getRayIntersector();
+    double rayT = 0.0;
+    const int32_t triangleIndex = intersector->intersect(nearXYZ,
+                                                         direction,
+                                                         0.0,
+                                                         1.0,
+                                                         &rayT);
+    if (triangleIndex >= 0) {
+        const double hitXYZ[3] = {
+            nearXYZ[0] + rayT * direction[0],
+            nearXYZ[1] + rayT * direction[1],
+            nearXYZ[2] + rayT * direction[2]
+        };
+        double windowXYZ[3];
+        if (gluProject(hitXYZ[0], hitXYZ[1], hitXYZ[2],
+                       modelviewMatrix, projectionMatrix, viewport,
+                       &windowXYZ[0], &windowXYZ[1], &windowXYZ[2])) {
+            triangleIndexOut = triangleIndex;
+            depthOut = windowXYZ[2];
+        }
+    }
+    
+    return true;
+}
+
 /**
  * Draw a surface triangles with vertex arrays.
  * @param surface
@@ -59,6 +59,7 @@ namespace caret {
     class FastStatistics;
     class DisplayPropertiesFiberOrientation;
     class FiberOrientation;
+    class GraphicsOpenGLTextureName;
     class SelectionItem;
     class SelectionManager;
     class IdentificationWithColor;
@@ -208,6 +209,10 @@ namespace caret {
         void drawSurfaceTriangles(Surface* surface,
                                   const float* nodeColoringRGBA);
         
+        bool getSurfaceTriangleWithRayCast(const Surface* surface,
+                                           int32_t& triangleIndexOut,
+                                           float& depthOut);
+        
         void drawSurfaceNodeAttributes(Surface* surface);
         
         void drawSurfaceBorderBeingDrawn(const Surface* surface);
@@ -506,6 +511,13 @@ namespace caret {
                                  const float height,
                                  const float rgb[3]);
         
+        bool isVolumeSliceTextureSizeValid(const int64_t numberOfColumns,
+                                           const int64_t numberOfRows);
+        
+        void loadVolumeSliceTexture(const int64_t numberOfColumns,
+                                    const int64_t numberOfRows,
+                                    const uint8_t* rgba);
+        
         /** Index of window */
         int32_t m_windowIndex = -1;
         
@@ -580,6 +592,15 @@ namespace caret {
         /** Cylinder symbol */
         BrainOpenGLShapeCylinder* m_shapeCylinder;
         
+        /** Texture reused by every orthogonal volume slice drawn as a texture */
+        GraphicsOpenGLTextureName* m_volumeSliceTextureName;
+        
+        /** Columns and rows last loaded into the volume slice texture */
+        int64_t m_volumeSliceTextureDimensions[2];
+        
+        /** Maximum texture size of the context that owns the volume slice texture */
+        GLint m_volumeSliceMaximumTextureSize;
+        
         std::list<FiberOrientation*> m_fiberOrientationsForDrawing;
         
         double inverseRotationMatrix[16];
@@ -3903,6 +3903,25 @@ BrainOpenGLVolumeObliqueSliceDrawing::drawOrthogonalSliceVoxels(const float slic
                                                          const int32_t mapIndex,
                                                          const uint8_t sliceOpacity)
 {
+    /*
+     * Identification needs every voxel drawn with its own
+     * identification color, so only normal drawing may use
+     * a texture.
+     */
+    if ( ! m_identificationModeFlag) {
+        if (BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceVoxelsTexture(sliceNormalVector,
+                                                                            coordinate,
+                                                                            rowStep,
+                                                                            columnStep,
+                                                                            numberOfColumns,
+                                                                            numberOfRows,
+                                                                            sliceRGBA,
+                                                                            sliceOpacity,
+                                                                            m_fixedPipelineDrawing)) {
+            return;
+        }
+    }
+    
     /*
      * There are two ways to draw the voxels.
      *
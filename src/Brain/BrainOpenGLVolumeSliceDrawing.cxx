@@ -4710,6 +4710,25 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceVoxels(const float sliceNormal
         return;
     }
     
+    /*
+     * Identification needs every voxel drawn with its own
+     * identification color, so only normal drawing may use
+     * a texture.
+     */
+    if ( ! m_identificationModeFlag) {
+        if (drawOrthogonalSliceVoxelsTexture(sliceNormalVector,
+                                             coordinate,
+                                             rowStep,
+                                             columnStep,
+                                             numberOfColumns,
+                                             numberOfRows,
+                                             sliceRGBA,
+                                             sliceOpacity,
+                                             m_fixedPipelineDrawing)) {
+            return;
+        }
+    }
+    
     /*
      * There are two ways to draw the voxels.
      *
@@ -4785,6 +4804,119 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceVoxels(const float sliceNormal
     
 }
 
+/**
+ * Draw the voxels in an orthogonal slice as one textured quad.
+ *
+ * The slice coloring is loaded into a two-dimensional texture that uses
+ * nearest filtering so that voxels appear identical to voxels drawn
+ * with quads.  Only four vertices are sent to OpenGL instead of four
+ * vertices for every voxel.  Voxels that are not displayed (zero alpha)
+ * are discarded with the alpha test so that they do not modify the
+ * depth buffer, just as they are not drawn when using quads.
+ *
+ * @param sliceNormalVector
+ *    Normal vector of the slice plane.
+ * @param coordinate
+ *    Coordinate of first voxel in the slice (bottom left as begin viewed)
+ * @param rowStep
+ *    Three-dimensional step to next row.
+ * @param columnStep
+ *    Three-dimensional step to next column.
+ * @param numberOfColumns
+ *    Number of columns in the slice.
+ * @param numberOfRows
+ *    Number of rows in the slice.
+ * @param sliceRGBA
+ *    RGBA coloring for voxels in the slice.
+ * @param sliceOpacity
+ *    Opacity from the overlay.
+ * @param fixedPipelineDrawing
+ *    The fixed pipeline drawing, which owns the texture that is reused
+ *    for every slice.
+ * @return
+ *    True if the slice was drawn, false if the slice is too large
+ *    for a texture and must be drawn with quads.
+ */
+bool
+BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceVoxelsTexture(const float sliceNormalVector[3],
+                                                                const float coordinate[3],
+                                                                const float rowStep[3],
+                                                                const float columnStep[3],
+                                                                const int64_t numberOfColumns,
+                                                                const int64_t numberOfRows,
+                                                                const std::vector<uint8_t>& sliceRGBA,
+                                                                const uint8_t sliceOpacity,
+                                                                BrainOpenGLFixedPipeline* fixedPipelineDrawing)
+{
+    CaretAssert(fixedPipelineDrawing);
+    if ( ! fixedPipelineDrawing->isVolumeSliceTextureSizeValid(numberOfColumns,
+                                                               numberOfRows)) {
+        return false;
+    }
+    
+    /*
+     * Coloring is stored by rows with column varying fastest,
+     * which is the layout OpenGL uses for a texture whose
+     * S-axis is columns and T-axis is rows.
+     * Use overlay's opacity for displayed voxels.
+     */
+    const int64_t numberOfVoxels = numberOfColumns * numberOfRows;
+    CaretAssert(static_cast<int64_t>(sliceRGBA.size()) >= (numberOfVoxels * 4));
+    std::vector<uint8_t> textureRGBA(sliceRGBA.begin(),
+                                     sliceRGBA.begin() + (numberOfVoxels * 4));
+    for (int64_t i = 0; i < numberOfVoxels; i++) {
+        const int64_t alphaOffset = (i * 4) + 3;
+        if (textureRGBA[alphaOffset] > 0) {
+            textureRGBA[alphaOffset] = sliceOpacity;
+        }
+    }
+    
+    glPushAttrib(GL_ENABLE_BIT
+                 | GL_TEXTURE_BIT
+                 | GL_COLOR_BUFFER_BIT);
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    
+    fixedPipelineDrawing->loadVolumeSliceTexture(numberOfColumns,
+                                                 numberOfRows,
+                                                 &textureRGBA[0]);
+    
+    /*
+     * Modulate with white so that lighting, when enabled,
+     * affects the slice as it affects quads.
+     */
+    glEnable(GL_TEXTURE_2D);
+    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    glEnable(GL_ALPHA_TEST);
+    glAlphaFunc(GL_GREATER, 0.0);
+    
+    float topLeft[3], bottomRight[3], topRight[3];
+    for (int32_t i = 0; i < 3; i++) {
+        topLeft[i]     = coordinate[i] + rowStep[i] * numberOfRows;
+        bottomRight[i] = coordinate[i] + columnStep[i] * numberOfColumns;
+        topRight[i]    = topLeft[i] + columnStep[i] * numberOfColumns;
+    }
+    
+    glColor4f(1.0, 1.0, 1.0, 1.0);
+    glBegin(GL_QUADS);
+    glNormal3fv(sliceNormalVector);
+    glTexCoord2f(0.0, 0.0);
+    glVertex3fv(coordinate);
+    glTexCoord2f(1.0, 0.0);
+    glVertex3fv(bottomRight);
+    glTexCoord2f(1.0, 1.0);
+    glVertex3fv(topRight);
+    glTexCoord2f(0.0, 1.0);
+    glVertex3fv(topLeft);
+    glEnd();
+    
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    glPopClientAttrib();
+    glPopAttrib();
+    
+    return true;
+}
+
 /**
  * Draw the voxels in an orthogonal slice with single quads.
  *
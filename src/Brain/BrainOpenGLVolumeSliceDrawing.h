@@ -280,6 +280,16 @@ namespace caret {
                                        const int32_t mapIndex,
                                        const uint8_t sliceOpacity);
         
+        static bool drawOrthogonalSliceVoxelsTexture(const float sliceNormalVector[3],
+                                                     const float coordinate[3],
+                                                     const float rowStep[3],
+                                                     const float columnStep[3],
+                                                     const int64_t numberOfColumns,
+                                                     const int64_t numberOfRows,
+                                                     const std::vector<uint8_t>& sliceRGBA,
+                                                     const uint8_t sliceOpacity,
+                                                     BrainOpenGLFixedPipeline* fixedPipelineDrawing);
+        
         void drawOrthogonalSliceVoxelsSingleQuads(const float sliceNormalVector[3],
                                        const float coordinate[3],
                                        const float rowStep[3],
@@ -23,6 +23,8 @@
 #include "CiftiConnectivityMatrixDataFileManager.h"
 #undef __CIFTI_CONNECTIVITY_MATRIX_DATA_FILE_MANAGER_DECLARE__
 
+#include <set>
+
 #include "Brain.h"
 #include "CaretAssert.h"
 #include "CiftiConnectivityMatrixParcelFile.h"
@@ -37,6 +39,7 @@
 #include "ScenePrimitiveArray.h"
 #include "Surface.h"
 #include "SurfaceFile.h"
+#include "TopologyHelper.h"
 
 using namespace caret;
 
@@ -55,6 +58,9 @@ using namespace caret;
 CiftiConnectivityMatrixDataFileManager::CiftiConnectivityMatrixDataFileManager()
 : CaretObject()
 {
+    m_previousLoadedStructure = StructureEnum::INVALID;
+    m_previousLoadedSurfaceNumberOfNodes = -1;
+    m_previousLoadedNodeIndex = -1;
 }
 
 /**
@@ -260,6 +266,13 @@ CiftiConnectivityMatrixDataFileManager::loadDataForSurfaceNode(Brain* brain,
                                         ciftiMatrixFiles);
     
     
+    std::vector<int32_t> prefetchNodeIndices;
+    if ( ! ciftiMatrixFiles.empty()) {
+        getSurfaceNodesToPrefetch(surfaceFile,
+                                  nodeIndex,
+                                  prefetchNodeIndices);
+    }
+    
     bool haveData = false;
     for (std::vector<CiftiMappableConnectivityMatrixDataFile*>::iterator iter = ciftiMatrixFiles.begin();
          iter != ciftiMatrixFiles.end();
@@ -278,6 +291,13 @@ CiftiConnectivityMatrixDataFileManager::loadDataForSurfaceNode(Brain* brain,
             cmf->updateScalarColoringForMap(mapIndex);
             haveData = true;
             
+            /*
+             * Read ahead rows for where the mouse is likely to go next
+             */
+            cmf->prefetchRowsForSurfaceNodes(surfaceFile->getNumberOfNodes(),
+                                             surfaceFile->getStructure(),
+                                             prefetchNodeIndices);
+            
             if (rowIndex >= 0) {
                 /*
                  * Get row/column info for node
@@ -308,6 +328,82 @@ CiftiConnectivityMatrixDataFileManager::loadDataForSurfaceNode(Brain* brain,
     return haveData;
 }
 
+/**
+ * Get the nodes whose rows are likely to be loaded next, most likely first.
+ * When the previous node loaded was on the same surface, the mouse movement
+ * from it to the current node is extrapolated and the node nearest to the
+ * extrapolated position and its neighbors are first.  These are followed
+ * by the neighbors of the current node to a depth of two.
+ *
+ * @param surfaceFile
+ *    Surface File that contains the node.
+ * @param nodeIndex
+ *    Index of the node that was just loaded.
+ * @param nodeIndicesOut
+ *    Output with the nodes to prefetch.
+ */
+void
+CiftiConnectivityMatrixDataFileManager::getSurfaceNodesToPrefetch(const SurfaceFile* surfaceFile,
+                                                                  const int32_t nodeIndex,
+                                                                  std::vector<int32_t>& nodeIndicesOut)
+{
+    nodeIndicesOut.clear();
+    
+    const int32_t numberOfNodes = surfaceFile->getNumberOfNodes();
+    if ((nodeIndex < 0)
+        || (nodeIndex >= numberOfNodes)) {
+        return;
+    }
+    
+    CaretPointer<TopologyHelper> topologyHelper = surfaceFile->getTopologyHelper();
+    std::set<int32_t> nodesAdded;
+    nodesAdded.insert(nodeIndex);
+    
+    if ((m_previousLoadedStructure == surfaceFile->getStructure())
+        && (m_previousLoadedSurfaceNumberOfNodes == numberOfNodes)
+        && (m_previousLoadedNodeIndex >= 0)
+        && (m_previousLoadedNodeIndex < numberOfNodes)
+        && (m_previousLoadedNodeIndex != nodeIndex)) {
+        const float* previousXYZ = surfaceFile->getCoordinate(m_previousLoadedNodeIndex);
+        const float* currentXYZ  = surfaceFile->getCoordinate(nodeIndex);
+        const float predictedXYZ[3] = {
+            currentXYZ[0] + (currentXYZ[0] - previousXYZ[0]),
+            currentXYZ[1] + (currentXYZ[1] - previousXYZ[1]),
+            currentXYZ[2] + (currentXYZ[2] - previousXYZ[2])
+        };
+        const int32_t predictedNodeIndex = surfaceFile->closestNode(predictedXYZ);
+        if (predictedNodeIndex >= 0) {
+            if (nodesAdded.insert(predictedNodeIndex).second) {
+                nodeIndicesOut.push_back(predictedNodeIndex);
+            }
+            const std::vector<int32_t>& predictedNeighbors = topologyHelper->getNodeNeighbors(predictedNodeIndex);
+            for (std::vector<int32_t>::const_iterator iter = predictedNeighbors.begin();
+                 iter != predictedNeighbors.end();
+                 iter++) {
+                if (nodesAdded.insert(*iter).second) {
+                    nodeIndicesOut.push_back(*iter);
+                }
+            }
+        }
+    }
+    
+    std::vector<int32_t> neighbors;
+    topologyHelper->getNodeNeighborsToDepth(nodeIndex,
+                                            2,
+                                            neighbors);
+    for (std::vector<int32_t>::const_iterator iter = neighbors.begin();
+         iter != neighbors.end();
+         iter++) {
+        if (nodesAdded.insert(*iter).second) {
+            nodeIndicesOut.push_back(*iter);
+        }
+    }
+    
+    m_previousLoadedStructure = surfaceFile->getStructure();
+    m_previousLoadedSurfaceNumberOfNodes = numberOfNodes;
+    m_previousLoadedNodeIndex = nodeIndex;
+}
+
 /**
  * Load data for each of the given surface node indices and average the data.
  * @param brain
@@ -23,6 +23,7 @@
 
 
 #include "CaretObject.h"
+#include "StructureEnum.h"
 #include "VoxelIJK.h"
 
 namespace caret {
@@ -84,7 +85,20 @@ namespace caret {
         void getDisplayedConnectivityMatrixFiles(Brain* brain,
                                                  std::vector<CiftiMappableConnectivityMatrixDataFile*>& ciftiMatrixFilesOut) const;
 
+        void getSurfaceNodesToPrefetch(const SurfaceFile* surfaceFile,
+                                       const int32_t nodeIndex,
+                                       std::vector<int32_t>& nodeIndicesOut);
+        
         // ADD_NEW_MEMBERS_HERE
+
+        /** Structure of the node loaded previously, used to predict mouse movement */
+        StructureEnum::Enum m_previousLoadedStructure;
+        
+        /** Number of nodes in surface of the node loaded previously */
+        int32_t m_previousLoadedSurfaceNumberOfNodes;
+        
+        /** Index of the node loaded previously */
+        int32_t m_previousLoadedNodeIndex;
     };
     
 #ifdef __CIFTI_CONNECTIVITY_MATRIX_DATA_FILE_MANAGER_DECLARE__
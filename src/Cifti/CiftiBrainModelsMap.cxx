@@ -21,6 +21,7 @@
 #include "CiftiBrainModelsMap.h"
 
 #include "DataFileException.h"
+#include "VoxelIJK.h"
 
 #include <QStringList>
 
@@ -57,6 +58,7 @@ void CiftiBrainModelsMap::addSurfaceModel(const int64_t& numberOfNodes, const St
     myModel.setupSurface(getNextStart());//do internal setup - also does error checking
     m_modelsInfo.push_back(myModel);
     m_surfUsed[structure] = m_modelsInfo.size() - 1;
+    m_lookupsValid = false;
 }
 
 void CiftiBrainModelsMap::BrainModelPriv::setupSurface(const int64_t& start)
@@ -73,7 +75,6 @@ void CiftiBrainModelsMap::BrainModelPriv::setupSurface(const int64_t& start)
     }
     m_modelEnd = start + listSize;//one after last
     vector<bool> used(m_surfaceNumberOfNodes, false);
-    m_nodeToIndexLookup = vector<int64_t>(m_surfaceNumberOfNodes, -1);//reset all to -1 to start
     for (int64_t i = 0; i < listSize; ++i)
     {
         if (m_nodeIndices[i] < 0)
@@ -89,8 +90,8 @@ void CiftiBrainModelsMap::BrainModelPriv::setupSurface(const int64_t& start)
             throw DataFileException("vertex list contains reused index");
         }
         used[m_nodeIndices[i]] = true;
-        m_nodeToIndexLookup[m_nodeIndices[i]] = start + i;
     }
+    m_nodeToIndexLookup.clear();//built later by setupLookups(), if needed
 }
 
 void CiftiBrainModelsMap::addVolumeModel(const StructureEnum::Enum& structure, const vector<int64_t>& ijkList)
@@ -118,9 +119,17 @@ void CiftiBrainModelsMap::addVolumeModel(const StructureEnum::Enum& structure, c
         }
         dims = m_volSpace.getDims();
     }
-    CaretCompact3DLookup<std::pair<int64_t, StructureEnum::Enum> > tempLookup = m_voxelToIndexLookup;//a copy of the lookup should be faster than other methods of checking for overlap and repeat
+    vector<VoxelIJK> allVoxels;//sorting is faster than building the lookup just to check for overlap and repeat, and the lookup may never be needed
+    for (map<StructureEnum::Enum, int>::const_iterator iter = m_volUsed.begin(); iter != m_volUsed.end(); ++iter)
+    {
+        const vector<int64_t>& otherList = m_modelsInfo[iter->second].m_voxelIndicesIJK;
+        for (size_t index3 = 0; index3 < otherList.size(); index3 += 3)
+        {
+            allVoxels.push_back(VoxelIJK(otherList.data() + index3));
+        }
+    }
     int64_t nextStart = getNextStart();
-    for (int64_t index = 0; index < numElems; ++index)//do all error checking before adding to lookup
+    for (int64_t index = 0; index < numElems; ++index)//do all error checking before adding the model
     {
         int64_t index3 = index * 3;
         if (ijkList[index3] < 0 || ijkList[index3 + 1] < 0 || ijkList[index3 + 2] < 0)
@@ -134,13 +143,14 @@ void CiftiBrainModelsMap::addVolumeModel(const StructureEnum::Enum& structure, c
             throw DataFileException("found invalid index triple in voxel list: (" + AString::number(ijkList[index3]) + ", "
                                   + AString::number(ijkList[index3 + 1]) + ", " + AString::number(ijkList[index3 + 2]) + ")");
         }
-        if (tempLookup.find(ijkList[index3], ijkList[index3 + 1], ijkList[index3 + 2]) != NULL)
-        {
-            throw DataFileException("volume models may not reuse voxels, either internally or from other structures");
-        }
-        tempLookup.at(ijkList[index3], ijkList[index3 + 1], ijkList[index3 + 2]) = pair<int64_t, StructureEnum::Enum>(nextStart + index, structure);
+        allVoxels.push_back(VoxelIJK(ijkList.data() + index3));
+    }
+    sort(allVoxels.begin(), allVoxels.end());
+    if (adjacent_find(allVoxels.begin(), allVoxels.end()) != allVoxels.end())
+    {
+        throw DataFileException("volume models may not reuse voxels, either internally or from other structures");
     }
-    m_voxelToIndexLookup = tempLookup;
+    m_lookupsValid = false;
     BrainModelPriv myModel;
     myModel.m_type = VOXELS;
     myModel.m_brainStructure = structure;
@@ -157,10 +167,60 @@ void CiftiBrainModelsMap::clear()
     m_haveVolumeSpace = false;
     m_ignoreVolSpace = false;
     m_voxelToIndexLookup.clear();
+    m_lookupsValid = false;
     m_surfUsed.clear();
     m_volUsed.clear();
 }
 
+CiftiBrainModelsMap::CiftiBrainModelsMap(const CiftiBrainModelsMap& rhs) : CiftiMappingType(rhs)
+{
+    m_lookupsValid = false;
+    *this = rhs;
+}
+
+CiftiBrainModelsMap& CiftiBrainModelsMap::operator=(const CiftiBrainModelsMap& rhs)
+{
+    if (this == &rhs) return *this;
+    CaretMutexLocker locked(&rhs.m_lookupMutex);//don't copy lookups that are half built
+    m_volSpace = rhs.m_volSpace;
+    m_haveVolumeSpace = rhs.m_haveVolumeSpace;
+    m_ignoreVolSpace = rhs.m_ignoreVolSpace;
+    m_modelsInfo = rhs.m_modelsInfo;
+    m_surfUsed = rhs.m_surfUsed;
+    m_volUsed = rhs.m_volUsed;
+    m_voxelToIndexLookup = rhs.m_voxelToIndexLookup;
+    m_lookupsValid.store(rhs.m_lookupsValid.load(memory_order_relaxed), memory_order_release);//the mutex orders the read
+    return *this;
+}
+
+void CiftiBrainModelsMap::setupLookups() const
+{
+    CaretMutexLocker locked(&m_lookupMutex);
+    if (m_lookupsValid.load(memory_order_relaxed)) return;//another thread built them while we waited, the mutex orders this read
+    m_voxelToIndexLookup.clear();
+    int numModels = (int)m_modelsInfo.size();
+    for (int i = 0; i < numModels; ++i)
+    {
+        const BrainModelPriv& myModel = m_modelsInfo[i];
+        if (myModel.m_type == SURFACE)
+        {
+            myModel.m_nodeToIndexLookup.assign(myModel.m_surfaceNumberOfNodes, -1);
+            int64_t listSize = (int64_t)myModel.m_nodeIndices.size();
+            for (int64_t j = 0; j < listSize; ++j)
+            {
+                myModel.m_nodeToIndexLookup[myModel.m_nodeIndices[j]] = myModel.m_modelStart + j;
+            }
+        } else {
+            int64_t numElems = (int64_t)myModel.m_voxelIndicesIJK.size() / 3;
+            for (int64_t j = 0; j < numElems; ++j)
+            {
+                m_voxelToIndexLookup.insert(myModel.m_voxelIndicesIJK.data() + j * 3, pair<int64_t, StructureEnum::Enum>(myModel.m_modelStart + j, myModel.m_brainStructure));
+            }
+        }
+    }
+    m_lookupsValid.store(true, memory_order_release);//publish the lookups to the unlocked tests
+}
+
 int64_t CiftiBrainModelsMap::getIndexForNode(const int64_t& node, const StructureEnum::Enum& structure) const
 {
     CaretAssert(node >= 0);
@@ -172,6 +232,7 @@ int64_t CiftiBrainModelsMap::getIndexForNode(const int64_t& node, const Structur
     CaretAssertVectorIndex(m_modelsInfo, iter->second);
     const BrainModelPriv& myModel = m_modelsInfo[iter->second];
     if (node >= myModel.m_surfaceNumberOfNodes) return -1;
+    if (!m_lookupsValid.load(memory_order_acquire)) setupLookups();
     CaretAssertVectorIndex(myModel.m_nodeToIndexLookup, node);
     return myModel.m_nodeToIndexLookup[node];
 }
@@ -183,6 +244,7 @@ int64_t CiftiBrainModelsMap::getIndexForVoxel(const int64_t* ijk, StructureEnum:
 
 int64_t CiftiBrainModelsMap::getIndexForVoxel(const int64_t& i, const int64_t& j, const int64_t& k, StructureEnum::Enum* structureOut) const
 {
+    if (!m_lookupsValid.load(memory_order_acquire)) setupLookups();
     const pair<int64_t, StructureEnum::Enum>* iter = m_voxelToIndexLookup.find(i, j, k);//the lookup tolerates weirdness like negatives
     if (iter == NULL) return -1;
     if (structureOut != NULL) *structureOut = iter->second;
@@ -892,20 +954,13 @@ vector<int64_t> CiftiBrainModelsMap::ParseHelperModel::readIndexArray(QXmlStream
     vector<int64_t> ret;
     QString text = xml.readElementText();//raises error if it encounters a start element
     if (xml.hasError()) return ret;
-    QStringList separated = text.split(QRegExp("\\s+"), QString::SkipEmptyParts);
-    int64_t numElems = separated.size();
-    ret.reserve(numElems);
+    ret = CiftiMappingType::parseIndexArray(text);
+    int64_t numElems = (int64_t)ret.size();
     for (int64_t i = 0; i < numElems; ++i)
     {
-        bool ok = false;
-        ret.push_back(separated[i].toLongLong(&ok));
-        if (!ok)
-        {
-            throw DataFileException("found noninteger in index array: " + separated[i]);
-        }
-        if (ret.back() < 0)
+        if (ret[i] < 0)
         {
-            throw DataFileException("found negative integer in index array: " + separated[i]);
+            throw DataFileException("found negative integer in index array: " + QString::number(ret[i]));
         }
     }
     return ret;
@@ -928,24 +983,31 @@ void CiftiBrainModelsMap::writeXML1(QXmlStreamWriter& xml) const
             xml.writeAttribute("ModelType", "CIFTI_MODEL_TYPE_SURFACE");
             xml.writeAttribute("SurfaceNumberOfNodes", QString::number(myModel.m_surfaceNumberOfNodes));
             xml.writeStartElement("NodeIndices");
-            QString text = "";
+            QString text;
             int64_t numNodes = (int64_t)myModel.m_nodeIndices.size();
+            text.reserve(numNodes * 6);
             for (int64_t j = 0; j < numNodes; ++j)
             {
-                if (j != 0) text += " ";
-                text += QString::number(myModel.m_nodeIndices[j]);
+                if (j != 0) text += QLatin1Char(' ');
+                CiftiMappingType::appendIndex(text, myModel.m_nodeIndices[j]);
             }
             xml.writeCharacters(text);
             xml.writeEndElement();
         } else {
             xml.writeAttribute("ModelType", "CIFTI_MODEL_TYPE_VOXELS");
             xml.writeStartElement("VoxelIndicesIJK");
-            QString text = "";
+            QString text;
             int64_t listSize = (int64_t)myModel.m_voxelIndicesIJK.size();
             CaretAssert(listSize % 3 == 0);
+            text.reserve(listSize * 3);
             for (int64_t j = 0; j < listSize; j += 3)
             {
-                text += QString::number(myModel.m_voxelIndicesIJK[j]) + " " + QString::number(myModel.m_voxelIndicesIJK[j + 1]) + " " + QString::number(myModel.m_voxelIndicesIJK[j + 2]) + "\n";
+                CiftiMappingType::appendIndex(text, myModel.m_voxelIndicesIJK[j]);
+                text += QLatin1Char(' ');
+                CiftiMappingType::appendIndex(text, myModel.m_voxelIndicesIJK[j + 1]);
+                text += QLatin1Char(' ');
+                CiftiMappingType::appendIndex(text, myModel.m_voxelIndicesIJK[j + 2]);
+                text += QLatin1Char('\n');
             }
             xml.writeCharacters(text);
             xml.writeEndElement();
@@ -975,24 +1037,31 @@ void CiftiBrainModelsMap::writeXML2(QXmlStreamWriter& xml) const
             xml.writeAttribute("ModelType", "CIFTI_MODEL_TYPE_SURFACE");
             xml.writeAttribute("SurfaceNumberOfVertices", QString::number(myModel.m_surfaceNumberOfNodes));
             xml.writeStartElement("VertexIndices");
-            QString text = "";
+            QString text;
             int64_t numNodes = (int64_t)myModel.m_nodeIndices.size();
+            text.reserve(numNodes * 6);
             for (int64_t j = 0; j < numNodes; ++j)
             {
-                if (j != 0) text += " ";
-                text += QString::number(myModel.m_nodeIndices[j]);
+                if (j != 0) text += QLatin1Char(' ');
+                CiftiMappingType::appendIndex(text, myModel.m_nodeIndices[j]);
             }
             xml.writeCharacters(text);
             xml.writeEndElement();
         } else {
             xml.writeAttribute("ModelType", "CIFTI_MODEL_TYPE_VOXELS");
             xml.writeStartElement("VoxelIndicesIJK");
-            QString text = "";
+            QString text;
             int64_t listSize = (int64_t)myModel.m_voxelIndicesIJK.size();
             CaretAssert(listSize % 3 == 0);
+            text.reserve(listSize * 3);
             for (int64_t j = 0; j < listSize; j += 3)
             {
-                text += QString::number(myModel.m_voxelIndicesIJK[j]) + " " + QString::number(myModel.m_voxelIndicesIJK[j + 1]) + " " + QString::number(myModel.m_voxelIndicesIJK[j + 2]) + "\n";
+                CiftiMappingType::appendIndex(text, myModel.m_voxelIndicesIJK[j]);
+                text += QLatin1Char(' ');
+                CiftiMappingType::appendIndex(text, myModel.m_voxelIndicesIJK[j + 1]);
+                text += QLatin1Char(' ');
+                CiftiMappingType::appendIndex(text, myModel.m_voxelIndicesIJK[j + 2]);
+                text += QLatin1Char('\n');
             }
             xml.writeCharacters(text);
             xml.writeEndElement();
@@ -24,9 +24,11 @@
 #include "CiftiMappingType.h"
 
 #include "CaretCompact3DLookup.h"
+#include "CaretMutex.h"
 #include "StructureEnum.h"
 #include "VolumeSpace.h"
 
+#include <atomic>
 #include <map>
 #include <utility>
 #include <vector>
@@ -88,7 +90,9 @@ namespace caret
         const std::vector<int64_t>& getVoxelList(const StructureEnum::Enum& structure) const;
         std::vector<ModelInfo> getModelInfo() const;
         
-        CiftiBrainModelsMap() { m_haveVolumeSpace = false; m_ignoreVolSpace = false; }
+        CiftiBrainModelsMap() { m_haveVolumeSpace = false; m_ignoreVolSpace = false; m_lookupsValid = false; }
+        CiftiBrainModelsMap(const CiftiBrainModelsMap& rhs);//explicit, because the source may be building its lookups in another thread
+        CiftiBrainModelsMap& operator=(const CiftiBrainModelsMap& rhs);
         void addSurfaceModel(const int64_t& numberOfNodes, const StructureEnum::Enum& structure, const float* roi = NULL);
         void addSurfaceModel(const int64_t& numberOfNodes, const StructureEnum::Enum& structure, const std::vector<int64_t>& nodeList);
         void addVolumeModel(const StructureEnum::Enum& structure, const std::vector<int64_t>& ijkList);
@@ -115,7 +119,7 @@ namespace caret
             std::vector<int64_t> m_voxelIndicesIJK;
             
             int64_t m_modelStart, m_modelEnd;//stuff only needed for optimization - models are kept in sorted order by their index ranges
-            std::vector<int64_t> m_nodeToIndexLookup;
+            mutable std::vector<int64_t> m_nodeToIndexLookup;//built on first use by setupLookups()
             bool operator==(const BrainModelPriv& rhs) const;
             bool operator!=(const BrainModelPriv& rhs) const { return !((*this) == rhs); }
             void setupSurface(const int64_t& start);
@@ -124,7 +128,10 @@ namespace caret
         bool m_haveVolumeSpace, m_ignoreVolSpace;//second is needed for parsing cifti-1
         std::vector<BrainModelPriv> m_modelsInfo;
         std::map<StructureEnum::Enum, int> m_surfUsed, m_volUsed;
-        CaretCompact3DLookup<std::pair<int64_t, StructureEnum::Enum> > m_voxelToIndexLookup;//make one unified lookup rather than separate lookups per volume structure
+        mutable CaretCompact3DLookup<std::pair<int64_t, StructureEnum::Enum> > m_voxelToIndexLookup;//make one unified lookup rather than separate lookups per volume structure
+        mutable std::atomic<bool> m_lookupsValid;//lookups are only built when first needed, many uses (copying mappings to a new file, writing) never need them - set with release after building, tested with acquire outside the mutex
+        mutable CaretMutex m_lookupMutex;
+        void setupLookups() const;
         int64_t getNextStart() const;
         struct ParseHelperModel
         {//specifically to allow the parsed elements to be sorted before using addSurfaceModel/addVolumeModel
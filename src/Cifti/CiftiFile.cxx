@@ -24,33 +24,77 @@
 #include "CaretAssert.h"
 #include "CaretHttpManager.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "DataFileException.h"
 #include "FileInformation.h"
 #include "MultiDimArray.h"
 #include "MultiDimIterator.h"
 #include "NiftiIO.h"
 
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <deque>
+
 using namespace std;
 using namespace caret;
 
 //private implementation classes
 namespace
 {
+    ///queues rows for writing and writes them on a background thread, so that computation doesn't wait on conversion and file I/O
+    class AsyncRowWriter : public QThread
+    {
+        struct Block
+        {
+            vector<int64_t> m_indexSelect;//of the first row
+            int64_t m_numRows;//consecutive along the first selected dimension
+            vector<float> m_data;
+            Block() { m_numRows = 0; }
+            void swap(Block& rhs) { m_indexSelect.swap(rhs.m_indexSelect); std::swap(m_numRows, rhs.m_numRows); m_data.swap(rhs.m_data); }
+        };
+        static const int64_t BLOCK_BYTES = 4 << 20;//rows are written in blocks of about this size
+        static const size_t MAX_QUEUED_BLOCKS = 4;//bounds memory use, when the disk can't keep up, setRow waits
+        NiftiIO* m_nifti;
+        const int64_t m_rowLength;
+        QMutex m_mutex;//protects everything below
+        QWaitCondition m_workReady, m_workDone;
+        Block m_filling;
+        deque<Block> m_queue;
+        bool m_busy, m_stop, m_failed;
+        AString m_error;
+        void queueFillingLocked();
+    protected:
+        void run();
+    public:
+        AsyncRowWriter(NiftiIO* nifti, const int64_t& rowLength);
+        ~AsyncRowWriter();
+        void addRow(const float* dataIn, const vector<int64_t>& indexSelect);
+        void flush();//waits until everything is written, throws the first write error
+    };
+    
     class CiftiOnDiskImpl : public CiftiFile::WriteImplInterface
     {
         mutable NiftiIO m_nifti;//because file objects aren't stateless (current position), so reading "changes" them
         CiftiXML m_xml;//because we need to parse it to set up the dimensions anyway
+        mutable CaretPointer<AsyncRowWriter> m_writer;//only exists after the first setRow, must be flushed before any other file access
+        void flushWriter() const { if (m_writer != NULL) m_writer->flush(); }
     public:
         CiftiOnDiskImpl(const QString& filename);//read-only
         CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, const CiftiVersion& version, const bool& swapEndian,
                         const int16_t& datatype, const bool& rescale, const double& minval, const double& maxval);//make new empty file with read/write
+        ~CiftiOnDiskImpl();
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
         void getColumn(float* dataOut, const int64_t& index) const;
+        void getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const;
         const CiftiXML& getCiftiXML() const { return m_xml; }
         QString getFilename() const { return m_nifti.getFilename(); }
         bool isSwapped() const { return m_nifti.getHeader().isSwapped(); }
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);
+        void flush() { flushWriter(); }
         void close();
     };
     
@@ -107,6 +151,117 @@ CiftiFile::WriteImplInterface::~WriteImplInterface()
 {
 }
 
+AsyncRowWriter::AsyncRowWriter(NiftiIO* nifti, const int64_t& rowLength) : m_nifti(nifti), m_rowLength(rowLength)
+{
+    m_busy = false;
+    m_stop = false;
+    m_failed = false;
+    start();
+}
+
+AsyncRowWriter::~AsyncRowWriter()
+{
+    {
+        QMutexLocker locked(&m_mutex);
+        m_stop = true;
+        m_workReady.wakeAll();
+    }
+    wait();//the thread writes everything already queued before it exits
+}
+
+void AsyncRowWriter::addRow(const float* dataIn, const vector<int64_t>& indexSelect)
+{
+    QMutexLocker locked(&m_mutex);
+    if (m_failed) throw DataFileException(m_error);
+    bool append = (m_filling.m_numRows > 0 && m_filling.m_indexSelect.size() == indexSelect.size() &&
+                   indexSelect[0] == m_filling.m_indexSelect[0] + m_filling.m_numRows);
+    for (size_t i = 1; append && i < indexSelect.size(); ++i)
+    {
+        if (indexSelect[i] != m_filling.m_indexSelect[i]) append = false;
+    }
+    if (!append)
+    {
+        if (m_filling.m_numRows > 0) queueFillingLocked();
+        m_filling.m_indexSelect = indexSelect;
+        m_filling.m_data.reserve(max(m_rowLength, BLOCK_BYTES / (int64_t)sizeof(float)));
+    }
+    m_filling.m_data.insert(m_filling.m_data.end(), dataIn, dataIn + m_rowLength);
+    ++m_filling.m_numRows;
+    if ((int64_t)(m_filling.m_data.size() * sizeof(float)) >= BLOCK_BYTES) queueFillingLocked();
+}
+
+void AsyncRowWriter::queueFillingLocked()
+{
+    while (m_queue.size() >= MAX_QUEUED_BLOCKS && !m_failed)
+    {
+        m_workDone.wait(&m_mutex);
+    }
+    if (m_failed) throw DataFileException(m_error);
+    m_queue.push_back(Block());
+    m_queue.back().swap(m_filling);
+    m_workReady.wakeAll();
+}
+
+void AsyncRowWriter::flush()
+{
+    QMutexLocker locked(&m_mutex);
+    if (m_filling.m_numRows > 0) queueFillingLocked();
+    while ((!m_queue.empty() || m_busy) && !m_failed)
+    {
+        m_workDone.wait(&m_mutex);
+    }
+    if (m_failed) throw DataFileException(m_error);
+}
+
+void AsyncRowWriter::run()
+{
+    Block current;
+    while (true)
+    {
+        {
+            QMutexLocker locked(&m_mutex);
+            while (m_queue.empty() && !m_stop)
+            {
+                m_workReady.wait(&m_mutex);
+            }
+            if (m_queue.empty()) return;//only stop once everything queued is written
+            current.swap(m_queue.front());
+            m_queue.pop_front();
+            m_busy = true;
+        }
+        AString error;
+        try
+        {
+            m_nifti->writeDataRange(current.m_data.data(), 5, current.m_indexSelect, current.m_numRows);//5 means 4 reserved (space and time) plus the first cifti dimension
+        } catch (CaretException& e) {
+            error = e.whatString();
+            if (error == "") error = "unknown error while writing cifti file";
+        } catch (std::exception& e) {
+            error = e.what();
+            if (error == "") error = "unknown error while writing cifti file";
+        }
+        QMutexLocker locked(&m_mutex);
+        m_busy = false;
+        if (error != "" && !m_failed)
+        {
+            m_failed = true;
+            m_error = error;
+            m_queue.clear();//nothing after a failed write can be trusted
+        }
+        m_workDone.wakeAll();
+    }
+}
+
+void CiftiFile::ReadImplInterface::getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const
+{
+    vector<int64_t> indexSelect(1);
+    for (int64_t i = 0; i < numRows; ++i)
+    {
+        indexSelect[0] = firstRow + i;
+        getRow(dataOut + i * rowLength, indexSelect, false);
+    }
+}
+
 CiftiFile::CiftiFile(const QString& fileName)
 {
     m_endianPref = NATIVE;
@@ -336,6 +491,74 @@ void CiftiFile::getRow(float* dataOut, const int64_t& index) const
     getRow(dataOut, index, false);//once CiftiInterface is gone, we can collapse this into a default value
 }
 
+void CiftiFile::addWeightedRows(vector<vector<double> >& sumsInOut, const vector<int64_t>& rowIndices, const vector<float>& weights) const
+{
+    if (m_dims.empty()) throw DataFileException("addWeightedRows called on uninitialized CiftiFile");
+    if (m_dims.size() != 2) throw DataFileException("addWeightedRows called on non-2D CiftiFile");
+    const int64_t numSums = (int64_t)sumsInOut.size(), numIndices = (int64_t)rowIndices.size();
+    const int64_t rowLength = m_dims[0], numRows = m_dims[1];
+    CaretAssert((int64_t)weights.size() == numIndices * numSums);
+    for (int64_t s = 0; s < numSums; ++s)
+    {
+        CaretAssert((int64_t)sumsInOut[s].size() == rowLength);
+    }
+    if (m_readingImpl == NULL || numSums == 0 || numIndices == 0) return;//same pretend-matrix logic as getRow, all zeros adds nothing
+    vector<pair<int64_t, int64_t> > sorted;//row, position in rowIndices
+    sorted.reserve(numIndices);
+    for (int64_t i = 0; i < numIndices; ++i)
+    {
+        if (rowIndices[i] < 0 || rowIndices[i] >= numRows) throw DataFileException("row index out of range in addWeightedRows");
+        bool used = false;
+        for (int64_t s = 0; s < numSums; ++s)
+        {
+            if (weights[i * numSums + s] != 0.0f) used = true;
+        }
+        if (used) sorted.push_back(make_pair(rowIndices[i], i));//don't read rows that wouldn't change anything
+    }
+    sort(sorted.begin(), sorted.end());//also keeps repeated rows in their original order
+    const int64_t MAX_GAP = 8;//reading a few unused rows is cheaper than another seek
+    const int64_t maxBlockRows = max((int64_t)1, (int64_t)((8 << 20) / (rowLength * sizeof(float))));//8MB of floats per read
+    vector<float> block;
+    size_t start = 0;
+    while (start < sorted.size())
+    {
+        const int64_t firstRow = sorted[start].first;
+        size_t end = start + 1;
+        while (end < sorted.size() && sorted[end].first - sorted[end - 1].first <= MAX_GAP && sorted[end].first - firstRow < maxBlockRows)
+        {
+            ++end;
+        }
+        const int64_t blockRows = sorted[end - 1].first - firstRow + 1;
+        block.resize(blockRows * rowLength);
+        m_readingImpl->getRows(block.data(), firstRow, blockRows, rowLength);
+        const int64_t numUsed = (int64_t)(end - start);
+        const int64_t CHUNK_SIZE = 1024;
+        const int64_t numChunks = (rowLength + CHUNK_SIZE - 1) / CHUNK_SIZE;
+#pragma omp CARET_PARFOR schedule(static)
+        for (int64_t chunk = 0; chunk < numChunks; ++chunk)//each thread owns a range of columns, so the order of additions doesn't depend on thread count
+        {
+            const int64_t chunkStart = chunk * CHUNK_SIZE, chunkEnd = min(chunkStart + CHUNK_SIZE, rowLength);
+            for (int64_t u = 0; u < numUsed; ++u)
+            {
+                const pair<int64_t, int64_t>& thisUse = sorted[start + u];
+                const float* rowData = block.data() + (thisUse.first - firstRow) * rowLength;
+                const float* rowWeights = weights.data() + thisUse.second * numSums;
+                for (int64_t s = 0; s < numSums; ++s)
+                {
+                    const float thisWeight = rowWeights[s];
+                    if (thisWeight == 0.0f) continue;
+                    double* sumData = sumsInOut[s].data();
+                    for (int64_t j = chunkStart; j < chunkEnd; ++j)
+                    {
+                        sumData[j] += rowData[j] * thisWeight;
+                    }
+                }
+            }
+        }
+        start = end;
+    }
+}
+
 int64_t CiftiFile::getNumberOfRows() const
 {
     if (m_dims.empty()) throw DataFileException("getNumberOfRows called on uninitialized CiftiFile");
@@ -404,6 +627,7 @@ void CiftiFile::copyImplData(const ReadImplInterface* from, WriteImplInterface*
         from->getRow(scratchRow.data(), *iter, false);
         to->setRow(scratchRow.data(), *iter);
     }
+    to->flush();//surface write errors here, rather than in a destructor
 }
 
 CiftiMemoryImpl::CiftiMemoryImpl(const CiftiXML& xml)
@@ -658,22 +882,52 @@ CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, c
     m_xml = xml;
 }
 
+CiftiOnDiskImpl::~CiftiOnDiskImpl()
+{
+    if (m_writer != NULL)
+    {
+        try
+        {
+            m_writer->flush();
+        } catch (CaretException& e) {//can't throw from a destructor, and close() wasn't called to surface the error
+            CaretLogSevere("error writing cifti file '" + getFilename() + "': " + e.whatString());
+        }
+        m_writer.grabNew(NULL);//stop the thread before m_nifti goes away
+    }
+}
+
 void CiftiOnDiskImpl::close()
 {
+    if (m_writer != NULL)
+    {
+        CaretPointer<AsyncRowWriter> writer = m_writer;
+        m_writer.grabNew(NULL);//don't try to flush again in the destructor
+        writer->flush();//throws the first write error, if any
+    }
     m_nifti.close();//lets this throw when there is a writing problem
 }//don't bother resetting m_xml, this instance is about to be destroyed
 
 
 void CiftiOnDiskImpl::getRow(float* dataOut, const vector<int64_t>& indexSelect, const bool& tolerateShortRead) const
 {
+    flushWriter();
     m_nifti.readData(dataOut, 5, indexSelect, tolerateShortRead);//5 means 4 reserved (space and time) plus the first cifti dimension
 }
 
+void CiftiOnDiskImpl::getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t&) const
+{
+    CaretAssert(m_xml.getNumberOfDimensions() == 2);//otherwise this shouldn't be called
+    flushWriter();
+    vector<int64_t> indexSelect(1, firstRow);
+    m_nifti.readDataRange(dataOut, 5, indexSelect, numRows);//one seek and read for the whole range
+}
+
 void CiftiOnDiskImpl::getColumn(float* dataOut, const int64_t& index) const
 {
     CaretAssert(m_xml.getNumberOfDimensions() == 2);//otherwise this shouldn't be called
     CaretAssert(index >= 0 && index < m_xml.getDimensionLength(CiftiXML::ALONG_ROW));
     CaretLogFine("getColumn called on CiftiOnDiskImpl, this will be slow");//generate logging messages at a low priority
+    flushWriter();
     vector<int64_t> indexSelect(2);
     indexSelect[0] = index;
     int64_t colLength = m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN);
@@ -686,7 +940,11 @@ void CiftiOnDiskImpl::getColumn(float* dataOut, const int64_t& index) const
 
 void CiftiOnDiskImpl::setRow(const float* dataIn, const vector<int64_t>& indexSelect)
 {
-    m_nifti.writeData(dataIn, 5, indexSelect);
+    if (m_writer == NULL)
+    {
+        m_writer.grabNew(new AsyncRowWriter(&m_nifti, m_xml.getDimensionLength(CiftiXML::ALONG_ROW)));
+    }
+    m_writer->addRow(dataIn, indexSelect);//copies the row, conversion and writing happen on the writer's thread
 }
 
 void CiftiOnDiskImpl::setColumn(const float* dataIn, const int64_t& index)
@@ -694,6 +952,7 @@ void CiftiOnDiskImpl::setColumn(const float* dataIn, const int64_t& index)
     CaretAssert(m_xml.getNumberOfDimensions() == 2);//otherwise this shouldn't be called
     CaretAssert(index >= 0 && index < m_xml.getDimensionLength(CiftiXML::ALONG_ROW));
     CaretLogFine("setColumn called on CiftiOnDiskImpl, this will be slow");//generate logging messages at a low priority
+    flushWriter();//so queued rows don't overwrite this column later
     vector<int64_t> indexSelect(2);
     indexSelect[0] = index;
     int64_t colLength = m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN);
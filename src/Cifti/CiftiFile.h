@@ -78,9 +78,13 @@ namespace caret
         ///data type and scaling options - should be set before setRow, etc, to avoid rewriting of file
         void setWritingDataTypeNoScaling(const int16_t& type = NIFTI_TYPE_FLOAT32);
         void setWritingDataTypeAndScaling(const int16_t& type, const double& minval, const double& maxval);
+        int16_t getWritingDataType() const { return m_writingDataType; }
+        bool isWritingDataScaled() const { return m_doWriteScaling; }
         
         void getRow(float* dataOut, const int64_t& index, const bool& tolerateShortRead) const;//backwards compatibility for old CiftiFile/CiftiInterface
         void getRow(float* dataOut, const int64_t& index) const;
+        ///for 2D only: adds rowIndices[i] times weights[i * sumsInOut.size() + s] into sumsInOut[s] (each row length), reads adjacent rows together in sorted order and sums in parallel
+        void addWeightedRows(std::vector<std::vector<double> >& sumsInOut, const std::vector<int64_t>& rowIndices, const std::vector<float>& weights) const;
         int64_t getNumberOfRows() const;
         int64_t getNumberOfColumns() const;
         
@@ -91,6 +95,7 @@ namespace caret
         public:
             virtual void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const = 0;
             virtual void getColumn(float* dataOut, const int64_t& index) const = 0;
+            virtual void getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const;//2D only, consecutive rows, default calls getRow for each
             virtual bool isInMemory() const { return false; }
             virtual ~ReadImplInterface();
         };
@@ -101,6 +106,7 @@ namespace caret
             virtual void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect) = 0;
             virtual void setColumn(const float* dataIn, const int64_t& index) = 0;
             virtual void close() {}
+            virtual void flush() {}//for implementations that write asynchronously, wait for it to finish and throw any errors
             virtual ~WriteImplInterface();
         };
     private:
@@ -21,6 +21,9 @@
 #include "CiftiMappingType.h"
 
 #include "CaretAssert.h"
+#include "DataFileException.h"
+
+using namespace std;
 
 using namespace caret;
 
@@ -70,3 +73,62 @@ void CiftiMappingType::clearMutablesModified() const
 {
     //nothing
 }
+
+vector<int64_t> CiftiMappingType::parseIndexArray(const QString& text)
+{
+    vector<int64_t> ret;
+    const QChar* data = text.constData();
+    const int length = text.size();
+    int numTokens = 0;
+    for (int pos = 0; pos < length; ++pos)//count first so that we allocate once
+    {
+        if (!data[pos].isSpace() && (pos == 0 || data[pos - 1].isSpace())) ++numTokens;
+    }
+    ret.reserve(numTokens);
+    int pos = 0;
+    while (true)
+    {
+        while (pos < length && data[pos].isSpace()) ++pos;//same separators as splitting on \s+
+        if (pos == length) break;
+        const int start = pos;
+        int64_t value = 0;
+        bool simple = true;
+        while (pos < length && !data[pos].isSpace())
+        {
+            const ushort thisChar = data[pos].unicode();
+            if (thisChar >= '0' && thisChar <= '9' && pos - start < 18)//18 digits can't overflow
+            {
+                value = value * 10 + (thisChar - '0');
+            } else {
+                simple = false;
+            }
+            ++pos;
+        }
+        if (!simple)//signs, very long numbers, or garbage: let Qt decide, so we accept exactly what we used to
+        {
+            QString token(data + start, pos - start);
+            bool ok = false;
+            value = token.toLongLong(&ok);
+            if (!ok)
+            {
+                throw DataFileException("found noninteger in index array: " + token);
+            }
+        }
+        ret.push_back(value);
+    }
+    return ret;
+}
+
+void CiftiMappingType::appendIndex(QString& text, const int64_t& value)
+{
+    char buffer[24];
+    int pos = 24;
+    uint64_t magnitude = (value < 0) ? (0 - (uint64_t)value) : (uint64_t)value;
+    do
+    {
+        buffer[--pos] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) buffer[--pos] = '-';
+    text.append(QLatin1String(buffer + pos, 24 - pos));
+}
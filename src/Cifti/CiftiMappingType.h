@@ -27,6 +27,8 @@
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
+#include <vector>
+
 namespace caret
 {
     class CiftiMappingType
@@ -57,6 +59,11 @@ namespace caret
         virtual ~CiftiMappingType();
         
         static QString mappingTypeToName(const MappingType& type);
+        
+        ///parse whitespace-separated integers without splitting into a string list, throws on nonintegers
+        static std::vector<int64_t> parseIndexArray(const QString& text);
+        ///append the decimal representation of an index, for building index array text without temporaries
+        static void appendIndex(QString& text, const int64_t& value);
     };
 }
 
@@ -24,7 +24,6 @@
 #include "CaretLogger.h"
 
 #include <QStringList>
-#include <QRegExp>
 
 using namespace std;
 using namespace caret;
@@ -628,19 +627,7 @@ vector<int64_t> CiftiParcelsMap::readIndexArray(QXmlStreamReader& xml)
     vector<int64_t> ret;
     QString text = xml.readElementText();//raises error if it encounters a start element
     if (xml.hasError()) return ret;
-    QStringList separated = text.split(QRegExp("\\s+"), QString::SkipEmptyParts);
-    int64_t numElems = separated.size();
-    ret.reserve(numElems);
-    for (int64_t i = 0; i < numElems; ++i)
-    {
-        bool ok = false;
-        ret.push_back(separated[i].toLongLong(&ok));
-        if (!ok)
-        {
-            throw DataFileException("found noninteger in index array: " + separated[i]);
-        }
-    }
-    return ret;
+    return parseIndexArray(text);
 }
 
 void CiftiParcelsMap::writeXML1(QXmlStreamWriter& xml) const
@@ -664,10 +651,18 @@ void CiftiParcelsMap::writeXML1(QXmlStreamWriter& xml) const
         if (numVoxels != 0)
         {
             xml.writeStartElement("VoxelIndicesIJK");
+            QString text;//one writeCharacters call per element, rather than per voxel
+            text.reserve(numVoxels * 9);
             for (set<VoxelIJK>::const_iterator iter = m_parcels[i].m_voxelIndices.begin(); iter != m_parcels[i].m_voxelIndices.end(); ++iter)
             {
-                xml.writeCharacters(QString::number(iter->m_ijk[0]) + " " + QString::number(iter->m_ijk[1]) + " " + QString::number(iter->m_ijk[2]) + "\n");
+                appendIndex(text, iter->m_ijk[0]);
+                text += QLatin1Char(' ');
+                appendIndex(text, iter->m_ijk[1]);
+                text += QLatin1Char(' ');
+                appendIndex(text, iter->m_ijk[2]);
+                text += QLatin1Char('\n');
             }
+            xml.writeCharacters(text);
             xml.writeEndElement();
         }
         for (map<StructureEnum::Enum, set<int64_t> >::const_iterator iter = m_parcels[i].m_surfaceNodes.begin(); iter != m_parcels[i].m_surfaceNodes.end(); ++iter)
@@ -677,12 +672,16 @@ void CiftiParcelsMap::writeXML1(QXmlStreamWriter& xml) const
                 xml.writeStartElement("Nodes");
                 xml.writeAttribute("BrainStructure", StructureEnum::toCiftiName(iter->first));
                 set<int64_t>::const_iterator iter2 = iter->second.begin();//which also allows us to write the first one outside the loop, to not add whitespace on the front or back
-                xml.writeCharacters(QString::number(*iter2));
+                QString text;
+                text.reserve(iter->second.size() * 6);
+                appendIndex(text, *iter2);
                 ++iter2;
                 for (; iter2 != iter->second.end(); ++iter2)
                 {
-                    xml.writeCharacters(" " + QString::number(*iter2));
+                    text += QLatin1Char(' ');
+                    appendIndex(text, *iter2);
                 }
+                xml.writeCharacters(text);
                 xml.writeEndElement();
             }
         }
@@ -714,10 +713,18 @@ void CiftiParcelsMap::writeXML2(QXmlStreamWriter& xml) const
         if (numVoxels != 0)
         {
             xml.writeStartElement("VoxelIndicesIJK");
+            QString text;//one writeCharacters call per element, rather than per voxel
+            text.reserve(numVoxels * 9);
             for (set<VoxelIJK>::const_iterator iter = m_parcels[i].m_voxelIndices.begin(); iter != m_parcels[i].m_voxelIndices.end(); ++iter)
             {
-                xml.writeCharacters(QString::number(iter->m_ijk[0]) + " " + QString::number(iter->m_ijk[1]) + " " + QString::number(iter->m_ijk[2]) + "\n");
+                appendIndex(text, iter->m_ijk[0]);
+                text += QLatin1Char(' ');
+                appendIndex(text, iter->m_ijk[1]);
+                text += QLatin1Char(' ');
+                appendIndex(text, iter->m_ijk[2]);
+                text += QLatin1Char('\n');
             }
+            xml.writeCharacters(text);
             xml.writeEndElement();
         }
         for (map<StructureEnum::Enum, set<int64_t> >::const_iterator iter = m_parcels[i].m_surfaceNodes.begin(); iter != m_parcels[i].m_surfaceNodes.end(); ++iter)
@@ -727,12 +734,16 @@ void CiftiParcelsMap::writeXML2(QXmlStreamWriter& xml) const
                 xml.writeStartElement("Vertices");
                 xml.writeAttribute("BrainStructure", StructureEnum::toCiftiName(iter->first));
                 set<int64_t>::const_iterator iter2 = iter->second.begin();//which also allows us to write the first one outside the loop, to not add whitespace on the front or back
-                xml.writeCharacters(QString::number(*iter2));
+                QString text;
+                text.reserve(iter->second.size() * 6);
+                appendIndex(text, *iter2);
                 ++iter2;
                 for (; iter2 != iter->second.end(); ++iter2)
                 {
-                    xml.writeCharacters(" " + QString::number(*iter2));
+                    text += QLatin1Char(' ');
+                    appendIndex(text, *iter2);
                 }
+                xml.writeCharacters(text);
                 xml.writeEndElement();
             }
         }
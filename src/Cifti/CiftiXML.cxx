@@ -69,7 +69,12 @@ void CiftiXML::copyHelper(const CiftiXML& rhs)
     m_indexMaps.resize(numDims);
     for (int i = 0; i < numDims; ++i)
     {
-        m_indexMaps[i] = CaretPointer<CiftiMappingType>(rhs.m_indexMaps[i]->clone());
+        if (rhs.m_indexMaps[i] == NULL || isShareable(rhs.m_indexMaps[i]->getType()))
+        {
+            m_indexMaps[i] = rhs.m_indexMaps[i];//share, non-const access will make a private copy first
+        } else {
+            m_indexMaps[i] = CaretPointer<CiftiMappingType>(rhs.m_indexMaps[i]->clone());
+        }
     }
     m_parsedVersion = rhs.m_parsedVersion;
     m_fileMetaData = rhs.m_fileMetaData;
@@ -91,7 +96,7 @@ bool CiftiXML::operator==(const CiftiXML& rhs) const
     for (int i = 0; i < numDims; ++i)
     {
         const CiftiMappingType* left = getMap(i), *right = rhs.getMap(i);
-        if (left == NULL && right == NULL) continue;
+        if (left == right) continue;//shared mapping, or both NULL
         if (left == NULL || right == NULL) return false;//only one NULL, due to above test
         if ((*left) != (*right)) return false;//finally can dereference them
     }
@@ -105,7 +110,7 @@ bool CiftiXML::approximateMatch(const CiftiXML& rhs) const
     for (int i = 0; i < numDims; ++i)
     {
         const CiftiMappingType* left = getMap(i), *right = rhs.getMap(i);
-        if (left == NULL && right == NULL) continue;
+        if (left == right) continue;//shared mapping, or both NULL
         if (left == NULL || right == NULL) return false;//only one NULL, due to above test
         if (!left->approximateMatch(*right)) return false;//finally can dereference them
     }
@@ -121,9 +126,28 @@ const CiftiMappingType* CiftiXML::getMap(const int& direction) const
 CiftiMappingType* CiftiXML::getMap(const int& direction)
 {
     CaretAssertVectorIndex(m_indexMaps, direction);
+    if (m_indexMaps[direction] != NULL && m_indexMaps[direction].getReferenceCount() > 1)
+    {//shared with another CiftiXML, copy before allowing modification
+        m_indexMaps[direction] = CaretPointer<CiftiMappingType>(m_indexMaps[direction]->clone());
+    }
     return m_indexMaps[direction];
 }
 
+bool CiftiXML::isShareable(const CiftiMappingType::MappingType& type)
+{
+    switch (type)
+    {
+        case CiftiMappingType::BRAIN_MODELS:
+        case CiftiMappingType::PARCELS:
+        case CiftiMappingType::SERIES:
+            return true;
+        case CiftiMappingType::SCALARS:
+        case CiftiMappingType::LABELS:
+            return false;//these allow modifying names, metadata, palettes and label tables through const references
+    }
+    return false;
+}
+
 GiftiMetaData* CiftiXML::getFileMetaData() const
 {
     return &m_fileMetaData;
@@ -54,7 +54,7 @@ namespace caret
         int getNumberOfDimensions() const { return m_indexMaps.size(); }
         const CiftiVersion& getParsedVersion() const { return m_parsedVersion; }
         const CiftiMappingType* getMap(const int& direction) const;//can return null in unfilled XML object
-        CiftiMappingType* getMap(const int& direction);//can return null in unfilled XML object
+        CiftiMappingType* getMap(const int& direction);//can return null in unfilled XML object - NOTE: don't hold the returned pointer (or the references from the non-const getters below) across copying this object, as the copy shares the mapping
         GiftiMetaData* getFileMetaData() const;//HACK: allow modification of palette and metadata within XML without setting the xml on a file again
         PaletteColorMapping* getFilePalette() const;
         
@@ -100,12 +100,13 @@ namespace caret
         static int directionFromString(const QString& input);//convenience conversion function, throws on error
         static QString directionFromStringExplanation();//and explanation text
     private:
-        std::vector<CaretPointer<CiftiMappingType> > m_indexMaps;
+        std::vector<CaretPointer<CiftiMappingType> > m_indexMaps;//mappings without mutable members are shared between copies, non-const getMap() unshares
         CiftiVersion m_parsedVersion;
         mutable GiftiMetaData m_fileMetaData;//hack to allow metadata to be modified without allowing dimension-changing operations
         mutable CaretPointer<PaletteColorMapping> m_filePalette;
         
         void copyHelper(const CiftiXML& rhs);
+        static bool isShareable(const CiftiMappingType::MappingType& type);
         //parsing functions
         void parseCIFTI1(QXmlStreamReader& xml);
         void parseMatrix1(QXmlStreamReader& xml);
@@ -52,6 +52,7 @@
 #include "AlgorithmCiftiParcellate.h"
 #include "AlgorithmCiftiParcelMappingToLabel.h"
 #include "AlgorithmCiftiReduce.h"
+#include "AlgorithmCiftiRegression.h"
 #include "AlgorithmCiftiReorder.h"
 #include "AlgorithmCiftiReplaceStructure.h"
 #include "AlgorithmCiftiResample.h"
@@ -129,6 +130,7 @@
 #include "AlgorithmVolumeParcelResamplingGeneric.h"
 #include "AlgorithmVolumeParcelSmoothing.h"
 #include "AlgorithmVolumeReduce.h"
+#include "AlgorithmVolumeRegression.h"
 #include "AlgorithmVolumeRemoveIslands.h"
 #include "AlgorithmVolumeROIsFromExtrema.h"
 #include "AlgorithmVolumeSmoothing.h"
@@ -193,6 +195,7 @@
 #include "OperationMetricWeightedStats.h"
 #include "OperationNiftiInformation.h"
 #include "OperationProbtrackXDotConvert.h"
+#include "OperationProbtrackXDotConvertSparse.h"
 #include "OperationSceneFileMerge.h"
 #include "OperationSceneFileRelocate.h"
 #include "OperationSetMapName.h"
@@ -206,6 +209,7 @@
 #include "OperationSurfaceCutResample.h"
 #include "OperationSurfaceFlipNormals.h"
 #include "OperationSurfaceGeodesicDistance.h"
+#include "OperationSurfaceGeodesicDistanceAllToAll.h"
 #include "OperationSurfaceGeodesicROIs.h"
 #include "OperationSurfaceInformation.h"
 #include "OperationSurfaceNormals.h"
@@ -242,9 +246,14 @@
 #include "ProgramParameters.h"
 
 #include "CaretLogger.h"
+#include "CaretProfiler.h"
+#include "GeodesicNeighborhood.h"
+#include "SIMDConversion.h"
 #include "dot_wrapper.h"
 #include "StructureEnum.h"
 
+#include <QDir>
+
 #include <iostream>
 #include <map>
 
@@ -312,6 +321,7 @@ CommandOperationManager::CommandOperationManager()
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmCiftiParcellate()));
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmCiftiParcelMappingToLabel()));
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmCiftiReduce()));
+    this->commandOperations.push_back(new CommandParser(new AutoAlgorithmCiftiRegression()));
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmCiftiReorder()));
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmCiftiReplaceStructure()));
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmCiftiResample()));
@@ -390,6 +400,7 @@ CommandOperationManager::CommandOperationManager()
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmVolumeParcelResamplingGeneric()));
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmVolumeParcelSmoothing()));
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmVolumeReduce()));
+    this->commandOperations.push_back(new CommandParser(new AutoAlgorithmVolumeRegression()));
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmVolumeRemoveIslands()));
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmVolumeROIsFromExtrema()));
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmVolumeSmoothing()));
@@ -448,6 +459,7 @@ CommandOperationManager::CommandOperationManager()
     this->commandOperations.push_back(new CommandParser(new AutoOperationMetricWeightedStats()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationNiftiInformation()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationProbtrackXDotConvert()));
+    this->commandOperations.push_back(new CommandParser(new AutoOperationProbtrackXDotConvertSparse()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationSceneFileMerge()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationSceneFileRelocate()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationSetMapNames()));
@@ -462,6 +474,7 @@ CommandOperationManager::CommandOperationManager()
     this->commandOperations.push_back(new CommandParser(new AutoOperationSurfaceCutResample()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationSurfaceFlipNormals()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationSurfaceGeodesicDistance()));
+    this->commandOperations.push_back(new CommandParser(new AutoOperationSurfaceGeodesicDistanceAllToAll()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationSurfaceGeodesicROIs()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationSurfaceInformation()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationSurfaceNormals()));
@@ -576,6 +589,30 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
         {
             CaretLogWarning("SIMD type '" + DotSIMDEnum::toName(impl) + "' not supported (could be cpu, compiler, or build options), using '" + DotSIMDEnum::toName(retval) + "'");
         }
+        switch (impl)//also limit the file conversion kernels, they only have SSE2 and AVX2 versions
+        {
+            case DOT_NAIVE:
+                SIMDConversion::setImplementation(SIMDConversion::SCALAR);
+                break;
+            case DOT_SSE2:
+            case DOT_AVX://AVX without AVX2 has no 256 bit integer instructions, which the conversion kernels need
+                SIMDConversion::setImplementation(SIMDConversion::SSE2);
+                break;
+            default://setImplementation falls back if the cpu doesn't have AVX2
+                SIMDConversion::setImplementation(SIMDConversion::AVX2);
+                break;
+        }
+    }
+    AString profileFileName;
+    if (getGlobalOption(parameters, "-profile", 1, globalOptionArgs))
+    {
+        profileFileName = globalOptionArgs[0];
+        CaretProfiler::enable();
+    }
+    if (getGlobalOption(parameters, "-geodesic-cache", 1, globalOptionArgs))
+    {
+        if (!QDir(globalOptionArgs[0]).exists()) throw CommandException("geodesic cache directory '" + globalOptionArgs[0] + "' does not exist");
+        GeodesicNeighborhood::setCacheDirectory(globalOptionArgs[0]);
     }
     int16_t ciftiDType = NIFTI_TYPE_FLOAT32;
     bool ciftiScale = false;
@@ -670,7 +707,29 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
                 } else {
                     operation->setCiftiOutputDTypeNoScale(ciftiDType);
                 }
-                operation->execute(parameters, preventProvenance);
+                if (profileFileName != "")
+                {
+                    CaretProfilerScope commandScope(commandSwitch, "command");
+                    try
+                    {
+                        operation->execute(parameters, preventProvenance);
+                    } catch (...) {
+                        commandScope.end();
+                        try
+                        {
+                            CaretProfiler::writeTrace(profileFileName);//timings up to the error can still be useful
+                        } catch (CaretException& e) {//don't replace the command's error with the profile's
+                            CaretLogWarning("failed to write profile after command error: " + e.whatString());
+                        } catch (...) {
+                            CaretLogWarning("failed to write profile after command error");
+                        }
+                        throw;
+                    }
+                    commandScope.end();
+                    CaretProfiler::writeTrace(profileFileName);
+                } else {
+                    operation->execute(parameters, preventProvenance);
+                }
             }
         }
     }
@@ -706,6 +765,16 @@ AString CommandOperationManager::doCompletion(ProgramParameters& parameters, con
         }
         return ret;
     }
+    OptionInfo profileInfo = parseGlobalOption(parameters, "-profile", 1, globalOptionArgs, true);
+    if (profileInfo.specified && !profileInfo.complete)
+    {
+        return "fileglob *.json";
+    }
+    OptionInfo geoCacheInfo = parseGlobalOption(parameters, "-geodesic-cache", 1, globalOptionArgs, true);
+    if (geoCacheInfo.specified && !geoCacheInfo.complete)
+    {
+        return "fileglob */";//no file name ends in a slash, so this only offers directories
+    }
     OptionInfo ciftiDTypeInfo = parseGlobalOption(parameters, "-cifti-output-datatype", 1, globalOptionArgs, true);
     if (ciftiDTypeInfo.specified && !ciftiDTypeInfo.complete)
     {
@@ -716,7 +785,7 @@ AString CommandOperationManager::doCompletion(ProgramParameters& parameters, con
     {//can't tab complete a literal number
         return "";
     }
-    ret = "wordlist -disable-provenance\\ -logging\\ -simd\\ -cifti-output-datatype\\ -cifti-output-range";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
+    ret = "wordlist -disable-provenance\\ -logging\\ -simd\\ -profile\\ -geodesic-cache\\ -cifti-output-datatype\\ -cifti-output-range";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
     const uint64_t numberOfCommands = this->commandOperations.size();
     const uint64_t numberOfDeprecated = this->deprecatedOperations.size();
     if (!parameters.hasNext())
@@ -1089,8 +1158,8 @@ void CommandOperationManager::printGlobalOptions()
     cout << endl;//add a line after the logging types for readability
     //guide for wrap, assuming 80 columns:                                                  |
     cout << "   -simd <type>                      set the SIMD implementation to use" << endl;
-    cout << "                                        (currently used only for correlation," << endl;
-    cout << "                                        default AUTO which selects fastest" << endl;
+    cout << "                                        (used for correlation and for converting" << endl;
+    cout << "                                        file data, default AUTO which selects fastest" << endl;
     cout << "                                        supported), valid values are:" << endl;
     vector<DotSIMDEnum::Enum> simdTypes = DotSIMDEnum::getAllEnums();
     for (vector<DotSIMDEnum::Enum>::iterator iter = simdTypes.begin();
@@ -1099,6 +1168,20 @@ void CommandOperationManager::printGlobalOptions()
         cout << "         " << DotSIMDEnum::toName(*iter) << endl;
     }
     cout << endl;
+    //guide for wrap, assuming 80 columns:                                                  |
+    cout << "   -profile <file>                   write timing of each algorithm and task," << endl;
+    cout << "                                        bytes read and written per file, peak" << endl;
+    cout << "                                        memory, and the OpenMP thread limit to" << endl;
+    cout << "                                        <file>, in chrome trace event JSON format" << endl;
+    cout << "                                        (can be loaded in chrome://tracing or" << endl;
+    cout << "                                        perfetto)" << endl;
+    cout << endl;
+    cout << "   -geodesic-cache <directory>       save geodesic neighborhoods computed by" << endl;
+    cout << "                                        metric dilate, erode, and extrema to" << endl;
+    cout << "                                        <directory>, and reuse them in later" << endl;
+    cout << "                                        commands on the same surface, distance," << endl;
+    cout << "                                        and corrected areas" << endl;
+    cout << endl;
 }
 
 void CommandOperationManager::printCiftiHelp()
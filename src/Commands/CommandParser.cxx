@@ -348,8 +348,10 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::VOLUME:
                 {
+                    FileInformation myInfo(nextArg);
                     CaretPointer<VolumeFile> myFile(new VolumeFile());
                     myFile->readFile(nextArg);
+                    m_inputVolumeNames.insert(myInfo.getCanonicalFilePath());
                     if (m_doProvenance)
                     {
                         const GiftiMetaData* md = myFile->getFileMetaData();
@@ -863,6 +865,20 @@ void CommandParser::provenanceBeforeOperation(const vector<OutputAssoc>& outAsso
                 myFile->setCiftiXML(myXML, false);//tells it to use this new metadata, rather than copying metadata from the old XML (which is default so that provenance metadata persists through naive usage)
                 break;
             }
+            case OperationParametersEnum::VOLUME:
+            {
+                VolumeParameter* myVolParam = (VolumeParameter*)myParam;
+                if (myVolParam->m_framesFileName.isEmpty()) break;//in memory, gets provenance after the operation
+                GiftiMetaData* mymd = myVolParam->m_parameter->getFileMetaData();//the operation copies this into the file it writes
+                mymd->set(PROVENANCE_NAME, m_provenance);
+                mymd->set(PROGRAM_PROVENANCE_NAME, versionProvenance);
+                mymd->set(CWD_PROVENANCE_NAME, m_workingDir);
+                if (m_parentProvenance != "")
+                {
+                    mymd->set(PARENT_PROVENANCE_NAME, m_parentProvenance);
+                }
+                break;
+            }
             default:
                 break;
         }
@@ -974,6 +990,20 @@ void CommandParser::makeOnDiskOutputs(const vector<OutputAssoc>& outAssociation)
                 }
                 break;
             }
+            case OperationParametersEnum::VOLUME:
+            {
+                VolumeParameter* myVolParam = (VolumeParameter*)myParam;
+                if (!myVolParam->m_writeFrames) break;
+                FileInformation myInfo(outAssociation[i].m_fileName);
+                if (m_inputVolumeNames.find(myInfo.getCanonicalFilePath()) != m_inputVolumeNames.end())
+                {//so a failure partway through the operation doesn't destroy the input
+                    CaretLogInfo("Computing output file '" + outAssociation[i].m_fileName + "' in memory due to collision with input file");
+                    myVolParam->m_framesFileName = "";
+                } else {
+                    myVolParam->m_framesFileName = outAssociation[i].m_fileName;
+                }
+                break;
+            }
             default:
                 break;
         }
@@ -1038,6 +1068,7 @@ void CommandParser::writeOutput(const vector<OutputAssoc>& outAssociation)
             }
             case OperationParametersEnum::VOLUME:
             {
+                if (!((VolumeParameter*)myParam)->m_framesFileName.isEmpty()) break;//the operation already wrote it
                 VolumeFile* myFile = ((VolumeParameter*)myParam)->m_parameter;
                 myFile->writeFile(outAssociation[i].m_fileName);
                 break;
@@ -42,6 +42,7 @@ namespace caret {
         int16_t m_ciftiDType;
         const static AString PROVENANCE_NAME, PARENT_PROVENANCE_NAME, PROGRAM_PROVENANCE_NAME, CWD_PROVENANCE_NAME;//TODO: put this elsewhere?
         std::map<AString, const CiftiFile*> m_inputCiftiNames;
+        std::set<AString> m_inputVolumeNames;//volume outputs written by frames are kept in memory if they collide with an input
         struct OutputAssoc
         {//how the output is stored is up to the parser, in the GUI it should load into memory without writing to disk
             AString m_fileName;
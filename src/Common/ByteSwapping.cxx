@@ -27,12 +27,7 @@ using namespace caret;
 void 
 ByteSwapping::swapBytes(int16_t* n, const uint64_t numToSwap)
 {
-   for (uint64_t i = 0; i < numToSwap; i++) {
-      char* bytes = (char*)&n[i];
-      char  temp = bytes[0];
-      bytes[0] = bytes[1];
-      bytes[1] = temp;
-   }
+   SIMDConversion::swap16(n, numToSwap);
 }
 
 /**
@@ -50,16 +45,7 @@ ByteSwapping::swapBytes(uint16_t* n, const uint64_t numToSwap)
 void 
 ByteSwapping::swapBytes(int32_t* n, const uint64_t numToSwap)
 {
-   for (uint64_t i = 0; i < numToSwap; i++) {
-      char* bytes = (char*)&n[i];
-      char  temp = bytes[0];
-      bytes[0] = bytes[3];
-      bytes[3] = temp;
-
-      temp = bytes[1];
-      bytes[1] = bytes[2];
-      bytes[2] = temp;
-   }
+   SIMDConversion::swap32(n, numToSwap);
 }
 
 /**
@@ -77,24 +63,7 @@ ByteSwapping::swapBytes(uint32_t* n, const uint64_t numToSwap)
 void 
 ByteSwapping::swapBytes(int64_t* n, const uint64_t numToSwap)
 {
-   for (uint64_t i = 0; i < numToSwap; i++) {
-      char* bytes = (char*)&n[i];
-      char  temp = bytes[0];
-      bytes[0] = bytes[7];
-      bytes[7] = temp;
-
-      temp = bytes[1];
-      bytes[1] = bytes[6];
-      bytes[6] = temp;
-
-      temp = bytes[2];
-      bytes[2] = bytes[5];
-      bytes[5] = temp;
-
-      temp = bytes[3];
-      bytes[3] = bytes[4];
-      bytes[4] = temp;
-   }
+   SIMDConversion::swap64(n, numToSwap);
 }
 
 /**
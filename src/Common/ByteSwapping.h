@@ -21,6 +21,8 @@
  */
 /*LICENSE_END*/
 
+#include "SIMDConversion.h"
+
 #include <stdint.h>
 
 
@@ -89,10 +91,24 @@ namespace caret {
     template<typename T>
     void ByteSwapping::swapArray(T* toSwap, const uint64_t& count)
     {
-        if (sizeof(T) == 1) return;//ditto
-        for (uint64_t i = 0; i < count; ++i)
+        switch (sizeof(T))
         {
-            swap(toSwap[i]);
+            case 1:
+                return;//ditto
+            case 2:
+                SIMDConversion::swap16(toSwap, count);
+                return;
+            case 4:
+                SIMDConversion::swap32(toSwap, count);
+                return;
+            case 8:
+                SIMDConversion::swap64(toSwap, count);
+                return;
+            default:
+                for (uint64_t i = 0; i < count; ++i)
+                {
+                    swap(toSwap[i]);
+                }
         }
     }
 
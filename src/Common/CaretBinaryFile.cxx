@@ -27,13 +27,22 @@
 
 #include "CaretAssert.h"
 #include "CaretBinaryFile.h"
+#include "CaretBlockGzip.h"
 #include "CaretLogger.h"
+#include "CaretProfiler.h"
 #include "DataFileException.h"
 
 #include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
 #include "zlib.h"
 
 #include <algorithm>
+#include <cstring>
+#include <deque>
+#include <vector>
 
 using namespace caret;
 using namespace std;
@@ -42,12 +51,37 @@ using namespace std;
 namespace caret
 {
 #ifdef ZLIB_VERSION
+    //inflates ahead of the reader on its own thread, so decompression overlaps with whatever the caller does with the data
+    class ZFileReadAhead : public QThread
+    {
+        gzFile m_zfile;
+        QMutex m_mutex;
+        QWaitCondition m_changed;
+        deque<vector<char> > m_chunks;
+        bool m_stop, m_done, m_error;
+        const static int64_t CHUNK_SIZE, MAX_CHUNKS;
+    public:
+        ZFileReadAhead(gzFile zfile) { m_zfile = zfile; m_stop = false; m_done = false; m_error = false; }
+        void run();
+        bool getChunk(vector<char>& chunkOut);//false at end of file or error
+        bool hadError();
+        void stop();//must be called before anything else uses the gzFile
+    };
+    
+    const int64_t ZFileReadAhead::CHUNK_SIZE = 1<<22;
+    const int64_t ZFileReadAhead::MAX_CHUNKS = 16;//64MiB ahead
+
     class ZFileImpl : public CaretBinaryFile::ImplInterface
     {
         gzFile m_zfile;
-        const static int64_t CHUNK_SIZE;
+        const static int64_t CHUNK_SIZE, READ_AHEAD_MIN;
+        CaretPointer<ZFileReadAhead> m_readAhead;
+        vector<char> m_chunk;//from m_readAhead
+        int64_t m_chunkPos, m_readPos;//when reading, gztell is ahead of the caller
+        bool m_reading;
+        void stopReadAhead();
     public:
-        ZFileImpl() { m_zfile = NULL; }
+        ZFileImpl() { m_zfile = NULL; m_chunkPos = 0; m_readPos = 0; m_reading = false; }
         void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
         void close();
         void seek(const int64_t& position);
@@ -59,6 +93,7 @@ namespace caret
     };
     
     const int64_t ZFileImpl::CHUNK_SIZE = 1<<26;//64MiB, large enough for good performance, small enough for zlib, must convert to uint32
+    const int64_t ZFileImpl::READ_AHEAD_MIN = 1<<20;//don't start the thread for header reads
 #endif //ZLIB_VERSION
 
     class QFileImpl : public CaretBinaryFile::ImplInterface
@@ -118,7 +153,14 @@ void CaretBinaryFile::open(const QString& filename, const OpenMode& opmode)
     if (filename.endsWith(".gz"))
     {
 #ifdef ZLIB_VERSION
-        m_impl.grabNew(new ZFileImpl());
+        if (opmode == WRITE_TRUNCATE)
+        {//BGZF output is still ordinary multi-member gzip, but we can deflate it in parallel, and read it back in parallel
+            m_impl.grabNew(new BlockGzipWriteImpl());
+        } else if (opmode == READ && BlockGzip::isBlockGzip(filename)) {
+            m_impl.grabNew(new BlockGzipReadImpl());
+        } else {
+            m_impl.grabNew(new ZFileImpl());
+        }
 #else //ZLIB_VERSION
         throw DataFileException("can't open .gz file '" + filename + "', compiled without zlib support");
 #endif //ZLIB_VERSION
@@ -133,7 +175,15 @@ void CaretBinaryFile::read(void* dataOut, const int64_t& count, int64_t* numRead
 {
     CaretAssert(count >= 0);//not sure about allowing 0
     if (!getOpenForRead()) throw DataFileException("file is not open for reading");
-    m_impl->read(dataOut, count, numRead);
+    if (CaretProfiler::isEnabled())
+    {
+        int64_t actualRead = count;
+        m_impl->read(dataOut, count, numRead);
+        if (numRead != NULL) actualRead = *numRead;//if NULL, a short read would have thrown
+        CaretProfiler::addFileRead(m_impl->getFilename(), actualRead);
+    } else {
+        m_impl->read(dataOut, count, numRead);
+    }
 }
 
 void CaretBinaryFile::seek(const int64_t& position)
@@ -160,6 +210,7 @@ void CaretBinaryFile::write(const void* dataIn, const int64_t& count)
     CaretAssert(count >= 0);//not sure about allowing 0
     if (!getOpenForWrite()) throw DataFileException("file is not open for writing");
     m_impl->write(dataIn, count);
+    CaretProfiler::addFileWrite(m_impl->getFilename(), count);
 }
 
 #ifdef ZLIB_VERSION
@@ -197,11 +248,28 @@ void ZFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& o
         }//TODO: check gzerror and errno for more informative error messages
         throw DataFileException("failed to open compressed file '" + filename + "'");
     }
+#if ZLIB_VERNUM >= 0x1240
+    gzbuffer(m_zfile, 1<<18);//default is 8KiB
+#endif
+    m_reading = (opmode == CaretBinaryFile::READ);
+    m_chunk.clear();
+    m_chunkPos = 0;
+    m_readPos = 0;
+}
+
+void ZFileImpl::stopReadAhead()
+{
+    if (m_readAhead == NULL) return;
+    m_readAhead->stop();
+    m_readAhead.grabNew(NULL);
+    m_chunk.clear();
+    m_chunkPos = 0;
 }
 
 void ZFileImpl::close()
 {
     if (m_zfile == NULL) return;//happens when closed and then destroyed, error opening
+    stopReadAhead();
     if (gzclose(m_zfile) != 0) throw DataFileException("error closing compressed file '" + m_fileName + "'");
     m_zfile = NULL;
 }
@@ -211,13 +279,41 @@ void ZFileImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
     if (m_zfile == NULL) throw DataFileException("read called on unopened ZFileImpl");//shouldn't happen
     int64_t totalRead = 0;
     int readret = 0;//to preserve the info of the read that broke early
-    while (totalRead < count)
+    if (m_readAhead == NULL && count >= READ_AHEAD_MIN)
+    {
+        m_readAhead.grabNew(new ZFileReadAhead(m_zfile));
+        m_readAhead->start();
+    }
+    if (m_readAhead == NULL)
     {
-        int64_t iterSize = min(count - totalRead, CHUNK_SIZE);
-        readret = gzread(m_zfile, ((char*)dataOut) + totalRead, iterSize);
-        if (readret < 1) break;//0 or -1 indicate eof or error
-        totalRead += readret;
+        while (totalRead < count)
+        {
+            int64_t iterSize = min(count - totalRead, CHUNK_SIZE);
+            readret = gzread(m_zfile, ((char*)dataOut) + totalRead, iterSize);
+            if (readret < 1) break;//0 or -1 indicate eof or error
+            totalRead += readret;
+        }
+    } else {
+        while (totalRead < count)
+        {
+            if (m_chunkPos == (int64_t)m_chunk.size())
+            {
+                m_chunkPos = 0;
+                if (!m_readAhead->getChunk(m_chunk))
+                {
+                    m_chunk.clear();
+                    if (m_readAhead->hadError()) readret = -1;
+                    break;
+                }
+                continue;
+            }
+            int64_t toCopy = min(count - totalRead, (int64_t)m_chunk.size() - m_chunkPos);
+            memcpy(((char*)dataOut) + totalRead, m_chunk.data() + m_chunkPos, toCopy);
+            m_chunkPos += toCopy;
+            totalRead += toCopy;
+        }
     }
+    m_readPos += totalRead;
     if (numRead == NULL)
     {
         if (totalRead != count)
@@ -234,17 +330,30 @@ void ZFileImpl::seek(const int64_t& position)
 {
     if (m_zfile == NULL) throw DataFileException("seek called on unopened ZFileImpl");//shouldn't happen
     if (pos() == position) return;//slight hack, since gzseek is slow or nonfunctional for some cases, so don't try it unless necessary
+    if (m_readAhead != NULL)
+    {
+        int64_t chunkRemaining = (int64_t)m_chunk.size() - m_chunkPos;
+        if (position > m_readPos && position - m_readPos <= chunkRemaining)
+        {
+            m_chunkPos += position - m_readPos;
+            m_readPos = position;
+            return;
+        }
+        stopReadAhead();//gztell is now wherever the thread stopped, gzseek is absolute so that doesn't matter
+    }
 #if !defined(CARET_OS_MACOSX) && ZLIB_VERNUM > 0x1232
     int64_t ret = gzseek64(m_zfile, position, SEEK_SET);
 #else
     int64_t ret = gzseek(m_zfile, position, SEEK_SET);
 #endif
     if (ret != position) throw DataFileException("seek failed in compressed file '" + m_fileName + "'");
+    m_readPos = position;
 }
 
 int64_t ZFileImpl::pos()
 {
     if (m_zfile == NULL) throw DataFileException("pos called on unopened ZFileImpl");//shouldn't happen
+    if (m_reading) return m_readPos;
 #if !defined(CARET_OS_MACOSX) && ZLIB_VERNUM > 0x1232
     return gztell64(m_zfile);
 #else
@@ -266,6 +375,59 @@ void ZFileImpl::write(const void* dataIn, const int64_t& count)
     if (totalWritten != count) throw DataFileException("failed to write to compressed file '" + m_fileName + "'");
 }
 
+void ZFileReadAhead::run()
+{
+    while (true)
+    {
+        {
+            QMutexLocker locker(&m_mutex);
+            while (!m_stop && (int64_t)m_chunks.size() >= MAX_CHUNKS) m_changed.wait(&m_mutex);
+            if (m_stop) return;
+        }
+        vector<char> chunk(CHUNK_SIZE);
+        int readret = gzread(m_zfile, chunk.data(), CHUNK_SIZE);//the consumer doesn't touch the gzFile until stop() returns
+        QMutexLocker locker(&m_mutex);
+        if (readret < 1)
+        {
+            m_error = (readret < 0);
+            m_done = true;
+            m_changed.wakeAll();
+            return;
+        }
+        chunk.resize(readret);
+        m_chunks.push_back(vector<char>());
+        m_chunks.back().swap(chunk);
+        m_changed.wakeAll();
+    }
+}
+
+bool ZFileReadAhead::getChunk(vector<char>& chunkOut)
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_chunks.empty() && !m_done) m_changed.wait(&m_mutex);
+    if (m_chunks.empty()) return false;
+    chunkOut.swap(m_chunks.front());
+    m_chunks.pop_front();
+    m_changed.wakeAll();
+    return true;
+}
+
+bool ZFileReadAhead::hadError()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_error;
+}
+
+void ZFileReadAhead::stop()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stop = true;
+        m_changed.wakeAll();
+    }
+    wait();
+}
+
 ZFileImpl::~ZFileImpl()
 {
     try//throwing from a destructor is a bad idea
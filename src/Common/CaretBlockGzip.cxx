@@ -0,0 +1,416 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretBlockGzip.h"
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretLogger.h"
+#include "CaretOMP.h"
+#include "DataFileException.h"
+
+#include "zlib.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace caret;
+using namespace std;
+
+#ifdef ZLIB_VERSION
+
+namespace
+{
+    const int64_t HEADER_SIZE = 18;//what we write: the fixed gzip header, plus XLEN = 6 for the BC subfield
+    const int64_t TRAILER_SIZE = 8;//crc32 and isize
+    const int64_t MAX_BLOCK_SIZE = 65536;//BSIZE is stored minus 1 in 16 bits
+    const int64_t WRITE_BATCH_BLOCKS = 256;//about 16MiB of input per parallel deflate
+    const int64_t READ_BATCH_START = 1<<20;//compressed bytes, more than one block
+    const int64_t READ_BATCH_MAX = 1<<25;
+
+    uint32_t readLE32(const unsigned char* data)
+    {
+        return ((uint32_t)data[0]) | (((uint32_t)data[1]) << 8) | (((uint32_t)data[2]) << 16) | (((uint32_t)data[3]) << 24);
+    }
+
+    void writeLE32(unsigned char* data, const uint32_t& value)
+    {
+        data[0] = value & 0xff;
+        data[1] = (value >> 8) & 0xff;
+        data[2] = (value >> 16) & 0xff;
+        data[3] = (value >> 24) & 0xff;
+    }
+}
+
+const int64_t BlockGzip::MAX_BLOCK_INPUT = 0xff00;//same as htslib, leaves room for incompressible data
+
+bool BlockGzip::isBlockGzip(const QString& filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    char header[64];
+    int64_t numRead = file.read(header, 64);
+    if (numRead < 1) return false;
+    return getBlockSize(header, numRead) > 0;
+}
+
+int64_t BlockGzip::getBlockSize(const char* data, const int64_t& available, int64_t* headerSizeOut)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    if (available < 12) return 0;
+    if (bytes[0] != 31 || bytes[1] != 139 || bytes[2] != 8 || bytes[3] != 4) return -1;//FLG must be exactly FEXTRA, so the header ends with the extra field
+    const int64_t xlen = bytes[10] | (bytes[11] << 8);
+    const int64_t headerSize = 12 + xlen;
+    if (available < headerSize) return 0;
+    for (int64_t offset = 12; offset + 4 <= headerSize; )
+    {
+        const int64_t slen = bytes[offset + 2] | (bytes[offset + 3] << 8);
+        if (bytes[offset] == 'B' && bytes[offset + 1] == 'C' && slen == 2 && offset + 6 <= headerSize)
+        {
+            const int64_t blockSize = (bytes[offset + 4] | (bytes[offset + 5] << 8)) + 1;
+            if (blockSize < headerSize + TRAILER_SIZE) return -1;
+            if (headerSizeOut != NULL) *headerSizeOut = headerSize;
+            return blockSize;
+        }
+        offset += 4 + slen;
+    }
+    return -1;
+}
+
+bool BlockGzip::compressBlock(const char* dataIn, const int64_t& count, const int& level, vector<char>& blockOut)
+{
+    CaretAssert(count >= 0 && count <= MAX_BLOCK_INPUT);
+    z_stream stream;
+    memset(&stream, 0, sizeof(z_stream));
+    if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;//negative window bits for raw deflate, we write the gzip wrapper ourselves
+    const int64_t start = (int64_t)blockOut.size();
+    const int64_t bound = deflateBound(&stream, count);
+    blockOut.resize(start + HEADER_SIZE + bound + TRAILER_SIZE);
+    unsigned char* block = (unsigned char*)(blockOut.data() + start);
+    const unsigned char header[12] = { 31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0 };//deflate, FEXTRA, no mtime, unknown OS, XLEN = 6
+    memcpy(block, header, 12);
+    block[12] = 'B';
+    block[13] = 'C';
+    block[14] = 2;
+    block[15] = 0;
+    stream.next_in = (Bytef*)dataIn;
+    stream.avail_in = (uInt)count;
+    stream.next_out = block + HEADER_SIZE;
+    stream.avail_out = (uInt)bound;
+    int ret = deflate(&stream, Z_FINISH);
+    const int64_t compressedSize = bound - stream.avail_out;
+    deflateEnd(&stream);
+    if (ret != Z_STREAM_END) return false;
+    const int64_t blockSize = HEADER_SIZE + compressedSize + TRAILER_SIZE;
+    if (blockSize > MAX_BLOCK_SIZE) return false;//can't happen with MAX_BLOCK_INPUT, deflate's worst case expansion is small
+    block[16] = (blockSize - 1) & 0xff;
+    block[17] = ((blockSize - 1) >> 8) & 0xff;
+    writeLE32(block + HEADER_SIZE + compressedSize, crc32(crc32(0L, Z_NULL, 0), (const Bytef*)dataIn, (uInt)count));
+    writeLE32(block + HEADER_SIZE + compressedSize + 4, (uint32_t)count);
+    blockOut.resize(start + blockSize);
+    return true;
+}
+
+int64_t BlockGzip::getBlockInputSize(const char* block, const int64_t& blockSize)
+{
+    CaretAssert(blockSize >= TRAILER_SIZE);
+    return readLE32((const unsigned char*)(block + blockSize - 4));
+}
+
+bool BlockGzip::decompressBlock(const char* block, const int64_t& blockSize, char* dataOut)
+{
+    int64_t headerSize = 0;
+    if (getBlockSize(block, blockSize, &headerSize) != blockSize) return false;
+    const int64_t inputSize = getBlockInputSize(block, blockSize);
+    if (inputSize > MAX_BLOCK_SIZE) return false;
+    z_stream stream;
+    memset(&stream, 0, sizeof(z_stream));
+    if (inflateInit2(&stream, -15) != Z_OK) return false;
+    stream.next_in = (Bytef*)(block + headerSize);
+    stream.avail_in = (uInt)(blockSize - headerSize - TRAILER_SIZE);
+    stream.next_out = (Bytef*)dataOut;
+    stream.avail_out = (uInt)inputSize;
+    int ret = inflate(&stream, Z_FINISH);
+    const bool complete = (ret == Z_STREAM_END && stream.avail_out == 0);
+    inflateEnd(&stream);
+    if (!complete) return false;
+    const uint32_t crc = readLE32((const unsigned char*)(block + blockSize - TRAILER_SIZE));
+    return crc == crc32(crc32(0L, Z_NULL, 0), (const Bytef*)dataOut, (uInt)inputSize);
+}
+
+void BlockGzip::getEOFBlock(vector<char>& blockOut)
+{
+    const unsigned char eofBlock[28] = { 31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0, 27, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    blockOut.insert(blockOut.end(), (const char*)eofBlock, (const char*)eofBlock + 28);
+}
+
+BlockGzipReadImpl::BlockGzipReadImpl()
+{
+    m_compressedPos = 0;
+    m_bufferStart = 0;
+    m_bufferPos = 0;
+    m_batchSize = READ_BATCH_START;
+}
+
+void BlockGzipReadImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
+{
+    close();
+    m_fileName = filename;
+    if (opmode != CaretBinaryFile::READ) throw DataFileException("compressed file only supports READ and WRITE_TRUNCATE modes");
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        if (!m_file.exists()) throw DataFileException("failed to open compressed file '" + filename + "', file does not exist, or folder permissions prevent seeing it");
+        throw DataFileException("failed to open compressed file '" + filename + "'");
+    }
+}
+
+void BlockGzipReadImpl::close()
+{
+    m_file.close();
+    m_compressed.clear();
+    m_buffer.clear();
+    m_compressedPos = 0;
+    m_bufferStart = 0;
+    m_bufferPos = 0;
+    m_batchSize = READ_BATCH_START;
+}
+
+bool BlockGzipReadImpl::loadBatch(const int64_t& target)
+{//blocks that end at or before target are skipped without inflating, returns false at end of file
+    m_bufferStart += (int64_t)m_buffer.size();
+    m_buffer.clear();
+    m_bufferPos = 0;
+    while (true)
+    {
+        if (!m_file.seek(m_compressedPos)) throw DataFileException("seek failed in compressed file '" + m_fileName + "'");
+        m_compressed.resize(m_batchSize);
+        int64_t numRead = m_file.read(m_compressed.data(), m_batchSize);
+        if (numRead < 0) throw DataFileException("error while reading compressed file '" + m_fileName + "'");
+        if (numRead == 0) return false;
+        vector<int64_t> blockStarts, blockSizes, inputSizes;
+        for (int64_t offset = 0; offset < numRead; )
+        {
+            int64_t blockSize = BlockGzip::getBlockSize(m_compressed.data() + offset, numRead - offset);
+            if (blockSize < 0) throw DataFileException("compressed file '" + m_fileName + "' has a member that is not a valid BGZF block");
+            if (blockSize == 0 || blockSize > numRead - offset) break;//the rest is in the next batch
+            blockStarts.push_back(offset);
+            blockSizes.push_back(blockSize);
+            inputSizes.push_back(BlockGzip::getBlockInputSize(m_compressed.data() + offset, blockSize));
+            offset += blockSize;
+        }
+        if (blockStarts.empty()) throw DataFileException("premature end of file in compressed file '" + m_fileName + "'");//batches are always larger than a block
+        m_batchSize = min(m_batchSize * 2, READ_BATCH_MAX);
+        const int64_t numBlocks = (int64_t)blockStarts.size();
+        int64_t first = 0;
+        while (first < numBlocks && m_bufferStart + inputSizes[first] <= target)
+        {
+            m_bufferStart += inputSizes[first];
+            m_compressedPos += blockSizes[first];
+            ++first;
+        }
+        if (first == numBlocks) continue;
+        vector<int64_t> outStarts(numBlocks + 1, 0);
+        for (int64_t i = first; i < numBlocks; ++i)
+        {
+            outStarts[i + 1] = outStarts[i] + inputSizes[i];
+            m_compressedPos += blockSizes[i];
+        }
+        m_buffer.resize(outStarts[numBlocks]);
+        vector<char> failed(numBlocks, 0);
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t i = first; i < numBlocks; ++i)
+        {
+            if (!BlockGzip::decompressBlock(m_compressed.data() + blockStarts[i], blockSizes[i], m_buffer.data() + outStarts[i])) failed[i] = 1;
+        }
+        for (int64_t i = first; i < numBlocks; ++i)
+        {
+            if (failed[i]) throw DataFileException("error while reading compressed file '" + m_fileName + "', data is corrupt");
+        }
+        return true;
+    }
+}
+
+void BlockGzipReadImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
+{
+    if (!m_file.isOpen()) throw DataFileException("read called on unopened BlockGzipReadImpl");//shouldn't happen
+    int64_t total = 0;
+    while (total < count)
+    {
+        if (m_bufferPos == (int64_t)m_buffer.size())
+        {
+            if (!loadBatch(pos())) break;
+            continue;
+        }
+        int64_t toCopy = min(count - total, (int64_t)m_buffer.size() - m_bufferPos);
+        memcpy(((char*)dataOut) + total, m_buffer.data() + m_bufferPos, toCopy);
+        m_bufferPos += toCopy;
+        total += toCopy;
+    }
+    if (numRead == NULL)
+    {
+        if (total != count) throw DataFileException("premature end of file in compressed file '" + m_fileName + "'");
+    } else {
+        *numRead = total;
+    }
+}
+
+void BlockGzipReadImpl::seek(const int64_t& position)
+{
+    if (!m_file.isOpen()) throw DataFileException("seek called on unopened BlockGzipReadImpl");//shouldn't happen
+    if (position >= m_bufferStart && position <= m_bufferStart + (int64_t)m_buffer.size())
+    {
+        m_bufferPos = position - m_bufferStart;
+        return;
+    }
+    if (position < m_bufferStart)
+    {//start over, but we still don't need to inflate anything before the target
+        m_compressedPos = 0;
+        m_bufferStart = 0;
+        m_buffer.clear();
+        m_bufferPos = 0;
+    }
+    if (!loadBatch(position)) throw DataFileException("seek failed in compressed file '" + m_fileName + "'");
+    CaretAssert(position >= m_bufferStart && position < m_bufferStart + (int64_t)m_buffer.size());
+    m_bufferPos = position - m_bufferStart;
+}
+
+void BlockGzipReadImpl::write(const void*, const int64_t&)
+{
+    throw DataFileException("write called on compressed file '" + m_fileName + "' that was opened for reading");
+}
+
+BlockGzipWriteImpl::BlockGzipWriteImpl()
+{
+    m_written = 0;
+}
+
+void BlockGzipWriteImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
+{
+    close();
+    m_fileName = filename;
+    if (opmode != CaretBinaryFile::WRITE_TRUNCATE) throw DataFileException("compressed file only supports READ and WRITE_TRUNCATE modes");
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) throw DataFileException("failed to open compressed file '" + filename + "', unable to create file");
+    m_pending.reserve(WRITE_BATCH_BLOCKS * BlockGzip::MAX_BLOCK_INPUT);
+    m_written = 0;
+}
+
+void BlockGzipWriteImpl::close()
+{
+    if (!m_file.isOpen()) return;
+    try
+    {
+        flushBlocks(true);
+        vector<char> eofBlock;
+        BlockGzip::getEOFBlock(eofBlock);
+        writeToFile(eofBlock.data(), (int64_t)eofBlock.size());
+        if (!m_file.flush()) throw DataFileException("failed to write to compressed file '" + m_fileName + "'");
+    } catch (...) {//don't try again from the destructor
+        m_file.close();
+        m_pending.clear();
+        throw;
+    }
+    m_file.close();
+    m_pending.clear();
+}
+
+void BlockGzipWriteImpl::flushBlocks(const bool& all)
+{//without all, a partial last block is kept for the next write
+    const int64_t pendingSize = (int64_t)m_pending.size();
+    const int64_t numBlocks = (all ? pendingSize + BlockGzip::MAX_BLOCK_INPUT - 1 : pendingSize) / BlockGzip::MAX_BLOCK_INPUT;
+    if (numBlocks == 0) return;
+    vector<vector<char> > blocks(numBlocks);
+    vector<char> failed(numBlocks, 0);
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < numBlocks; ++i)
+    {
+        const int64_t start = i * BlockGzip::MAX_BLOCK_INPUT;
+        if (!BlockGzip::compressBlock(m_pending.data() + start, min(BlockGzip::MAX_BLOCK_INPUT, pendingSize - start), Z_DEFAULT_COMPRESSION, blocks[i])) failed[i] = 1;
+    }
+    for (int64_t i = 0; i < numBlocks; ++i)
+    {
+        if (failed[i]) throw DataFileException("failed to compress data for file '" + m_fileName + "'");
+        writeToFile(blocks[i].data(), (int64_t)blocks[i].size());
+    }
+    const int64_t consumed = min(numBlocks * BlockGzip::MAX_BLOCK_INPUT, pendingSize);
+    m_pending.erase(m_pending.begin(), m_pending.begin() + consumed);
+    m_written += consumed;
+}
+
+void BlockGzipWriteImpl::writeToFile(const char* data, const int64_t& count)
+{
+    int64_t total = 0;
+    while (total < count)
+    {
+        int64_t writeret = m_file.write(data + total, count - total);//never more than a batch at once
+        if (writeret < 1) break;
+        total += writeret;
+    }
+    if (total != count) throw DataFileException("failed to write to compressed file '" + m_fileName + "'");
+}
+
+void BlockGzipWriteImpl::write(const void* dataIn, const int64_t& count)
+{
+    if (!m_file.isOpen()) throw DataFileException("write called on unopened BlockGzipWriteImpl");//shouldn't happen
+    const int64_t batchInput = WRITE_BATCH_BLOCKS * BlockGzip::MAX_BLOCK_INPUT;
+    int64_t total = 0;
+    while (total < count)
+    {
+        int64_t toAdd = min(count - total, batchInput - (int64_t)m_pending.size());
+        m_pending.insert(m_pending.end(), ((const char*)dataIn) + total, ((const char*)dataIn) + total + toAdd);
+        total += toAdd;
+        if ((int64_t)m_pending.size() == batchInput) flushBlocks(false);
+    }
+}
+
+void BlockGzipWriteImpl::seek(const int64_t& position)
+{
+    if (!m_file.isOpen()) throw DataFileException("seek called on unopened BlockGzipWriteImpl");//shouldn't happen
+    const int64_t current = pos();
+    if (position == current) return;
+    if (position < current) throw DataFileException("seek failed in compressed file '" + m_fileName + "', can't seek backwards while writing");
+    vector<char> zeros(min(position - current, BlockGzip::MAX_BLOCK_INPUT), 0);//same as gzseek in write mode
+    for (int64_t remaining = position - current; remaining > 0; remaining -= (int64_t)zeros.size())
+    {
+        write(zeros.data(), min(remaining, (int64_t)zeros.size()));
+    }
+}
+
+void BlockGzipWriteImpl::read(void*, const int64_t&, int64_t*)
+{
+    throw DataFileException("read called on compressed file '" + m_fileName + "' that was opened for writing");
+}
+
+BlockGzipWriteImpl::~BlockGzipWriteImpl()
+{
+    try//throwing from a destructor is a bad idea
+    {
+        close();
+    } catch (CaretException& e) {
+        CaretLogSevere(e.whatString());
+    } catch (exception& e) {
+        CaretLogSevere(e.what());
+    } catch (...) {
+        CaretLogSevere("caught unknown exception type while closing a compressed file");
+    }
+}
+
+#endif //ZLIB_VERSION
@@ -0,0 +1,101 @@
+#ifndef __CARET_BLOCK_GZIP_H__
+#define __CARET_BLOCK_GZIP_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretBinaryFile.h"
+
+#include <QFile>
+
+#include <vector>
+
+namespace caret {
+
+    ///BGZF (blocked gzip, as used by htslib): a series of independent gzip members of at most 64KiB each, with the compressed size of each member in its header
+    ///this is still a valid multi-member gzip file to any other reader, but the blocks can be deflated and inflated in parallel
+    class BlockGzip
+    {
+        BlockGzip();
+    public:
+        static const int64_t MAX_BLOCK_INPUT;//uncompressed bytes per block
+
+        ///check the header of the first member, doesn't throw
+        static bool isBlockGzip(const QString& filename);
+
+        ///parse a block header, returns the total compressed size of the block, 0 if not enough bytes are available to tell, or -1 if it isn't a BGZF header
+        static int64_t getBlockSize(const char* data, const int64_t& available, int64_t* headerSizeOut = NULL);
+
+        ///compress up to MAX_BLOCK_INPUT bytes into one complete block, appended to blockOut, returns false on any error
+        static bool compressBlock(const char* dataIn, const int64_t& count, const int& level, std::vector<char>& blockOut);
+
+        ///uncompressed size of a complete block, from its trailer
+        static int64_t getBlockInputSize(const char* block, const int64_t& blockSize);
+
+        ///inflate one complete block into dataOut, which must have room for getBlockInputSize(), checks the crc, returns false on any error
+        static bool decompressBlock(const char* block, const int64_t& blockSize, char* dataOut);
+
+        ///the empty block that marks a complete file
+        static void getEOFBlock(std::vector<char>& blockOut);
+    };
+
+    ///read implementation that inflates batches of blocks in parallel, forward seeks skip blocks without inflating them
+    class BlockGzipReadImpl : public CaretBinaryFile::ImplInterface
+    {
+        QFile m_file;
+        std::vector<char> m_compressed, m_buffer;
+        int64_t m_compressedPos;//file position of the next block to load
+        int64_t m_bufferStart, m_bufferPos;//uncompressed position of m_buffer[0], and the read position within m_buffer
+        int64_t m_batchSize;//starts small so that reading only the header doesn't inflate much
+        bool loadBatch(const int64_t& target);
+    public:
+        BlockGzipReadImpl();
+        void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
+        void close();
+        void seek(const int64_t& position);
+        int64_t pos() { return m_bufferStart + m_bufferPos; }
+        int64_t size() { return -1; }
+        void read(void* dataOut, const int64_t& count, int64_t* numRead);
+        void write(const void* dataIn, const int64_t& count);
+    };
+
+    ///write implementation that deflates batches of blocks in parallel, seeking is only allowed forward (fills with zeros)
+    class BlockGzipWriteImpl : public CaretBinaryFile::ImplInterface
+    {
+        QFile m_file;
+        std::vector<char> m_pending;//input that hasn't been compressed yet
+        int64_t m_written;//uncompressed bytes already compressed and written
+        void flushBlocks(const bool& all);
+        void writeToFile(const char* data, const int64_t& count);
+    public:
+        BlockGzipWriteImpl();
+        void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
+        void close();
+        void seek(const int64_t& position);
+        int64_t pos() { return m_written + (int64_t)m_pending.size(); }
+        int64_t size() { return -1; }
+        void read(void* dataOut, const int64_t& count, int64_t* numRead);
+        void write(const void* dataIn, const int64_t& count);
+        ~BlockGzipWriteImpl();
+    };
+
+} //namespace caret
+
+#endif //__CARET_BLOCK_GZIP_H__
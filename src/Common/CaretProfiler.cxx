@@ -0,0 +1,251 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretProfiler.h"
+
+#include "CaretMutex.h"
+#include "CaretOMP.h"
+#include "DataFileException.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThread>
+
+#include <ctime>
+#include <map>
+#include <vector>
+
+#ifdef CARET_OS_WINDOWS
+#include "windows.h"
+#define PSAPI_VERSION 2 //use the kernel32 version, so we don't need to link psapi
+#include "psapi.h"
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace caret;
+using namespace std;
+
+bool CaretProfiler::s_enabled = false;
+
+namespace
+{
+    struct SpanEvent
+    {
+        AString m_name, m_category;
+        int m_thread;
+        int m_numThreads;//-1 when not an omp region
+        int64_t m_startMicros, m_durationMicros;
+        double m_cpuSeconds;
+    };
+    
+    struct FileBytes
+    {
+        int64_t m_read, m_written;
+        FileBytes() { m_read = 0; m_written = 0; }
+    };
+    
+    CaretMutex s_profileMutex;//protects everything below
+    QElapsedTimer s_profileTimer;
+    vector<SpanEvent> s_spans;
+    map<AString, FileBytes> s_fileBytes;
+    map<Qt::HANDLE, int> s_threadNumbers;//trace viewers want small integers for thread ids
+    
+    int getThreadNumber()
+    {//call with the mutex held
+        Qt::HANDLE myHandle = QThread::currentThreadId();
+        map<Qt::HANDLE, int>::iterator iter = s_threadNumbers.find(myHandle);
+        if (iter != s_threadNumbers.end()) return iter->second;
+        int ret = (int)s_threadNumbers.size();
+        s_threadNumbers[myHandle] = ret;
+        return ret;
+    }
+    
+    int64_t getMicros()
+    {
+        return s_profileTimer.nsecsElapsed() / 1000;
+    }
+    
+    double getProcessCpuSeconds()
+    {//includes all threads, so cpu / wall shows how parallel a span was
+#ifdef CARET_OS_WINDOWS
+        FILETIME creationTime, exitTime, kernelTime, userTime;//clock() is wall time on windows
+        if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) return 0.0;
+        ULARGE_INTEGER kernel100ns, user100ns;
+        kernel100ns.LowPart = kernelTime.dwLowDateTime;
+        kernel100ns.HighPart = kernelTime.dwHighDateTime;
+        user100ns.LowPart = userTime.dwLowDateTime;
+        user100ns.HighPart = userTime.dwHighDateTime;
+        return (kernel100ns.QuadPart + user100ns.QuadPart) / 1.0e7;
+#else
+        return ((double)clock()) / CLOCKS_PER_SEC;
+#endif
+    }
+    
+    AString jsonString(const AString& in)
+    {
+        AString ret = in;
+        ret.replace("\\", "\\\\");
+        ret.replace("\"", "\\\"");
+        ret.replace("\n", "\\n");
+        return "\"" + ret + "\"";
+    }
+}
+
+void CaretProfiler::enable()
+{
+    CaretMutexLocker locked(&s_profileMutex);
+    if (s_enabled) return;
+    s_profileTimer.start();
+    getThreadNumber();//make the main thread 0
+    s_enabled = true;
+}
+
+void CaretProfiler::addFileRead(const AString& fileName, const int64_t& bytes)
+{
+    if (!s_enabled) return;
+    CaretMutexLocker locked(&s_profileMutex);
+    s_fileBytes[fileName].m_read += bytes;
+}
+
+void CaretProfiler::addFileWrite(const AString& fileName, const int64_t& bytes)
+{
+    if (!s_enabled) return;
+    CaretMutexLocker locked(&s_profileMutex);
+    s_fileBytes[fileName].m_written += bytes;
+}
+
+int64_t CaretProfiler::getPeakResidentBytes()
+{
+#ifdef CARET_OS_WINDOWS
+    PROCESS_MEMORY_COUNTERS myCounters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &myCounters, sizeof(myCounters)))
+    {
+        return myCounters.PeakWorkingSetSize;
+    }
+    return -1;
+#else
+    struct rusage myUsage;
+    if (getrusage(RUSAGE_SELF, &myUsage) != 0) return -1;
+#ifdef CARET_OS_MACOSX
+    return myUsage.ru_maxrss;//bytes on mac
+#else
+    return ((int64_t)myUsage.ru_maxrss) * 1024;//kilobytes on linux
+#endif
+#endif
+}
+
+void CaretProfiler::writeTrace(const AString& fileName)
+{
+    if (!s_enabled) return;
+    int numThreads = 1;
+#ifdef CARET_OMP
+    numThreads = omp_get_max_threads();
+#endif
+    CaretMutexLocker locked(&s_profileMutex);
+    AString output = "{\n\"traceEvents\": [";
+    bool first = true;
+    for (map<Qt::HANDLE, int>::iterator iter = s_threadNumbers.begin(); iter != s_threadNumbers.end(); ++iter)
+    {
+        if (!first) output += ",";
+        first = false;
+        output += "\n{ \"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": " + AString::number(iter->second) +
+                  ", \"args\": { \"name\": " + jsonString(iter->second == 0 ? AString("main") : "thread " + AString::number(iter->second)) + " } }";
+    }
+    for (size_t i = 0; i < s_spans.size(); ++i)
+    {
+        const SpanEvent& thisSpan = s_spans[i];
+        output += ",\n{ \"ph\": \"X\", \"pid\": 1, \"tid\": " + AString::number(thisSpan.m_thread) +
+                  ", \"name\": " + jsonString(thisSpan.m_name) + ", \"cat\": " + jsonString(thisSpan.m_category) +
+                  ", \"ts\": " + AString::number(thisSpan.m_startMicros) + ", \"dur\": " + AString::number(thisSpan.m_durationMicros) +
+                  ", \"args\": { \"process_cpu_ms\": " + AString::number(thisSpan.m_cpuSeconds * 1000.0, 'f', 3);
+        if (thisSpan.m_numThreads > 0)
+        {
+            output += ", \"threads\": " + AString::number(thisSpan.m_numThreads);
+        }
+        output += " } }";
+    }
+    output += "\n],\n\"displayTimeUnit\": \"ms\",\n\"otherData\": {\n";
+    output += "  \"wall_seconds\": " + AString::number(getMicros() / 1000000.0, 'f', 6) + ",\n";
+    output += "  \"process_cpu_seconds\": " + AString::number(getProcessCpuSeconds(), 'f', 6) + ",\n";
+    output += "  \"peak_resident_bytes\": " + AString::number(getPeakResidentBytes()) + ",\n";
+    output += "  \"omp_max_threads\": " + AString::number(numThreads) + ",\n";
+    output += "  \"threads_seen\": " + AString::number(s_threadNumbers.size()) + ",\n";
+    output += "  \"files\": [";
+    first = true;
+    for (map<AString, FileBytes>::iterator iter = s_fileBytes.begin(); iter != s_fileBytes.end(); ++iter)
+    {
+        if (!first) output += ",";
+        first = false;
+        output += "\n    { \"name\": " + jsonString(iter->first) + ", \"bytes_read\": " + AString::number(iter->second.m_read) +
+                  ", \"bytes_written\": " + AString::number(iter->second.m_written) + " }";
+    }
+    output += "\n  ]\n}\n}\n";
+    QFile outFile(fileName);
+    if (!outFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        throw DataFileException("failed to open profile output file '" + fileName + "'");
+    }
+    QByteArray outBytes = output.toUtf8();
+    if (outFile.write(outBytes) != outBytes.size())
+    {
+        throw DataFileException("failed to write profile output file '" + fileName + "'");
+    }
+}
+
+CaretProfilerScope::CaretProfilerScope(const AString& name, const AString& category)
+{
+    m_active = false;
+    start(name, category);
+}
+
+void CaretProfilerScope::start(const AString& name, const AString& category)
+{
+    end();
+    if (!CaretProfiler::s_enabled) return;
+    m_name = name;
+    m_category = category;
+    m_startMicros = getMicros();
+    m_startCpuSeconds = getProcessCpuSeconds();
+    m_active = true;
+}
+
+void CaretProfilerScope::end()
+{
+    if (!m_active) return;
+    m_active = false;
+    SpanEvent thisSpan;
+    thisSpan.m_name = m_name;
+    thisSpan.m_category = m_category;
+    thisSpan.m_startMicros = m_startMicros;
+    thisSpan.m_durationMicros = getMicros() - m_startMicros;
+    thisSpan.m_cpuSeconds = getProcessCpuSeconds() - m_startCpuSeconds;
+    thisSpan.m_numThreads = -1;
+    if (m_category == "omp")
+    {
+        thisSpan.m_numThreads = 1;
+#ifdef CARET_OMP
+        thisSpan.m_numThreads = omp_get_max_threads();
+#endif
+    }
+    CaretMutexLocker locked(&s_profileMutex);
+    thisSpan.m_thread = getThreadNumber();
+    s_spans.push_back(thisSpan);
+}
@@ -0,0 +1,72 @@
+#ifndef __CARET_PROFILER_H__
+#define __CARET_PROFILER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+
+#include "stdint.h"
+
+namespace caret {
+
+    ///records wall and cpu time of spans, and bytes read/written per file, for the -profile global option
+    ///everything returns immediately when profiling is not enabled, and is safe to call from multiple threads
+    class CaretProfiler
+    {
+        static bool s_enabled;
+        CaretProfiler();
+    public:
+        static void enable();
+        static bool isEnabled() { return s_enabled; }
+        
+        static void addFileRead(const AString& fileName, const int64_t& bytes);
+        static void addFileWrite(const AString& fileName, const int64_t& bytes);
+        
+        ///peak resident memory of the process, -1 if unknown on this platform
+        static int64_t getPeakResidentBytes();
+        
+        ///write all recorded spans as chrome trace events (chrome://tracing, perfetto), plus per-file I/O and process totals
+        static void writeTrace(const AString& fileName);
+        
+        friend class CaretProfilerScope;
+    };
+    
+    ///times from start() (or construction with a name) to end() (or destruction), recorded as one trace event
+    ///category "omp" also records the OpenMP thread limit - parallel regions are not found automatically, each one to be timed needs a scope placed around it
+    class CaretProfilerScope
+    {
+        AString m_name, m_category;
+        int64_t m_startMicros;
+        double m_startCpuSeconds;
+        bool m_active;
+        CaretProfilerScope(const CaretProfilerScope&);
+        CaretProfilerScope& operator=(const CaretProfilerScope&);
+    public:
+        CaretProfilerScope() { m_active = false; }
+        CaretProfilerScope(const AString& name, const AString& category = "region");
+        void start(const AString& name, const AString& category = "region");
+        void end();
+        ~CaretProfilerScope() { end(); }
+    };
+
+}
+
+#endif //__CARET_PROFILER_H__
@@ -0,0 +1,584 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "DenseMatrix.h"
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretOMP.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    const int64_t ALIGN_FLOATS = 16;//64 bytes, a cache line and an AVX-512 register
+    //multiply block sizes: a ROW_BLOCK x COL_BLOCK double accumulator and an INNER_BLOCK x COL_BLOCK panel of the right matrix stay in L2
+    const int64_t ROW_BLOCK = 32, COL_BLOCK = 256, INNER_BLOCK = 128;
+    const int64_t PARALLEL_WORK = 1 << 20;//multiply-adds below which threading isn't worth it
+    
+    //LU with partial pivoting in place on an n x n row-major matrix, returns false on a zero pivot
+    bool luDecompose(vector<double>& lu, const int64_t& n, vector<int64_t>& pivots, int& swapSign)
+    {
+        pivots.resize(n);
+        swapSign = 1;
+        for (int64_t i = 0; i < n; ++i)
+        {
+            int64_t pivotRow = i;
+            double best = abs(lu[i * n + i]);
+            for (int64_t j = i + 1; j < n; ++j)
+            {
+                double test = abs(lu[j * n + i]);
+                if (test > best)
+                {
+                    best = test;
+                    pivotRow = j;
+                }
+            }
+            if (best == 0.0) return false;//like rref, expect linear dependence to show as an exact zero
+            pivots[i] = pivotRow;
+            if (pivotRow != i)
+            {
+                swap_ranges(lu.begin() + i * n, lu.begin() + (i + 1) * n, lu.begin() + pivotRow * n);
+                swapSign = -swapSign;
+            }
+            const double* pivotRowPtr = lu.data() + i * n;
+            const double invPivot = 1.0 / pivotRowPtr[i];
+            for (int64_t j = i + 1; j < n; ++j)
+            {
+                double* thisRow = lu.data() + j * n;
+                const double factor = thisRow[i] * invPivot;
+                thisRow[i] = factor;
+                if (factor == 0.0) continue;
+                for (int64_t k = i + 1; k < n; ++k)
+                {
+                    thisRow[k] -= factor * pivotRowPtr[k];
+                }
+            }
+        }
+        return true;
+    }
+    
+    //householder QR in place on a rows x cols row-major matrix, R ends up in the upper triangle, reflector k is stored at reflectorsOut[k * rows + i] for i >= k
+    //returns false if a column is linearly dependent on the previous ones to within float rounding, that is, if the part of it that isn't explained by the previous columns is negligible
+    bool householderQR(vector<double>& qr, const int64_t& rows, const int64_t& cols, vector<double>& reflectorsOut, vector<double>& reflectorNormsOut)
+    {
+        reflectorsOut.assign(rows * cols, 0.0);
+        reflectorNormsOut.assign(cols, 0.0);
+        vector<double> columnTolerance(cols, 0.0);
+        for (int64_t i = 0; i < rows; ++i)
+        {
+            for (int64_t k = 0; k < cols; ++k) columnTolerance[k] += qr[i * cols + k] * qr[i * cols + k];
+        }
+        const double relTolerance = numeric_limits<float>::epsilon() * rows;//input is float, so a dependent column still has rounding noise of this order
+        for (int64_t k = 0; k < cols; ++k) columnTolerance[k] = relTolerance * sqrt(columnTolerance[k]);
+        for (int64_t k = 0; k < cols; ++k)
+        {
+            double norm = 0.0;
+            for (int64_t i = k; i < rows; ++i) norm += qr[i * cols + k] * qr[i * cols + k];
+            norm = sqrt(norm);
+            //norm is |R_kk| after this reflection, compare to the whole column so scaling a regressor doesn't change the answer
+            if (!(norm > columnTolerance[k])) return false;//also catches NaN
+            const double alpha = (qr[k * cols + k] > 0.0 ? -norm : norm);
+            double* householder = reflectorsOut.data() + k * rows;
+            double vnorm = 0.0;
+            for (int64_t i = k; i < rows; ++i)
+            {
+                householder[i] = qr[i * cols + k];
+                if (i == k) householder[i] -= alpha;
+                vnorm += householder[i] * householder[i];
+            }
+            reflectorNormsOut[k] = vnorm;
+            if (vnorm == 0.0) continue;//column is already in the right form
+            for (int64_t j = k; j < cols; ++j)
+            {
+                double dot = 0.0;
+                for (int64_t i = k; i < rows; ++i) dot += householder[i] * qr[i * cols + j];
+                const double factor = 2.0 * dot / vnorm;
+                for (int64_t i = k; i < rows; ++i) qr[i * cols + j] -= factor * householder[i];
+            }
+        }
+        return true;
+    }
+}
+
+DenseMatrix::DenseMatrix()
+{
+    m_rows = 0;
+    m_cols = 0;
+    m_stride = 0;
+    m_offset = 0;
+}
+
+DenseMatrix::DenseMatrix(const int64_t& rows, const int64_t& cols, const float& initVal)
+{
+    allocate(rows, cols);
+    if (initVal != 0.0f) fill(initVal);
+}
+
+DenseMatrix::DenseMatrix(const vector<vector<float> >& matrixIn)
+{
+    int64_t rows = (int64_t)matrixIn.size(), cols = 0;
+    if (rows > 0) cols = (int64_t)matrixIn[0].size();
+    allocate(rows, cols);
+    for (int64_t i = 0; i < rows; ++i)
+    {
+        CaretAssert((int64_t)matrixIn[i].size() == cols);
+        copy(matrixIn[i].begin(), matrixIn[i].end(), getRow(i));
+    }
+}
+
+DenseMatrix::DenseMatrix(const DenseMatrix& right)
+{
+    m_rows = 0;
+    m_cols = 0;
+    m_stride = 0;
+    m_offset = 0;
+    *this = right;
+}
+
+DenseMatrix& DenseMatrix::operator=(const DenseMatrix& right)
+{
+    if (this == &right) return *this;
+    allocate(right.m_rows, right.m_cols);//vector storage may land on a different alignment, so recompute the offset rather than copying it
+    for (int64_t i = 0; i < m_rows; ++i)
+    {
+        const float* inRow = right.getRow(i);
+        copy(inRow, inRow + m_cols, getRow(i));
+    }
+    return *this;
+}
+
+void DenseMatrix::allocate(const int64_t& rows, const int64_t& cols)
+{
+    CaretAssert(rows >= 0 && cols >= 0);
+    m_rows = rows;
+    m_cols = cols;
+    if (rows == 0 || cols == 0)
+    {//keep the dimensions, FloatMatrix allows things like 3x0
+        m_stride = cols;
+        m_offset = 0;
+        m_storage.clear();
+        return;
+    }
+    if (cols < ALIGN_FLOATS)
+    {
+        m_stride = cols;//don't pad column vectors and small affines up to 16 floats per row
+    } else {
+        m_stride = ((cols + ALIGN_FLOATS - 1) / ALIGN_FLOATS) * ALIGN_FLOATS;
+    }
+    m_storage.assign(rows * m_stride + ALIGN_FLOATS, 0.0f);
+    uintptr_t address = (uintptr_t)m_storage.data();
+    uintptr_t misalign = address % (ALIGN_FLOATS * sizeof(float));
+    m_offset = (misalign == 0 ? 0 : (ALIGN_FLOATS * sizeof(float) - misalign) / sizeof(float));
+}
+
+void DenseMatrix::resize(const int64_t& rows, const int64_t& cols, const bool& destructive)
+{
+    if (rows == m_rows && cols == m_cols) return;
+    if (destructive)
+    {
+        allocate(rows, cols);
+        return;
+    }
+    DenseMatrix temp(rows, cols);
+    int64_t copyRows = min(rows, m_rows), copyCols = min(cols, m_cols);
+    for (int64_t i = 0; i < copyRows; ++i)
+    {
+        const float* inRow = getRow(i);
+        copy(inRow, inRow + copyCols, temp.getRow(i));
+    }
+    *this = temp;
+}
+
+void DenseMatrix::fill(const float& value)
+{
+    for (int64_t i = 0; i < m_rows; ++i)
+    {
+        float* row = getRow(i);
+        for (int64_t j = 0; j < m_cols; ++j)
+        {
+            row[j] = value;
+        }
+    }
+}
+
+vector<vector<float> > DenseMatrix::toVectorVector() const
+{
+    vector<vector<float> > ret(m_rows);
+    for (int64_t i = 0; i < m_rows; ++i)
+    {
+        const float* row = getRow(i);
+        ret[i].assign(row, row + m_cols);
+    }
+    return ret;
+}
+
+DenseMatrix DenseMatrix::transpose() const
+{
+    DenseMatrix ret(m_cols, m_rows);
+    const int64_t BLOCK = 32;//transpose in tiles, so both sides are read and written a cache line at a time
+    for (int64_t ib = 0; ib < m_rows; ib += BLOCK)
+    {
+        const int64_t iend = min(ib + BLOCK, m_rows);
+        for (int64_t jb = 0; jb < m_cols; jb += BLOCK)
+        {
+            const int64_t jend = min(jb + BLOCK, m_cols);
+            for (int64_t i = ib; i < iend; ++i)
+            {
+                const float* inRow = getRow(i);
+                for (int64_t j = jb; j < jend; ++j)
+                {
+                    ret(j, i) = inRow[j];
+                }
+            }
+        }
+    }
+    return ret;
+}
+
+void DenseMatrix::multiply(const DenseMatrix& left, const DenseMatrix& right, DenseMatrix& result)
+{
+    if (left.m_cols != right.m_rows) throw CaretException("matrix multiply called with mismatched dimensions");
+    const int64_t rows = left.m_rows, cols = right.m_cols, inner = left.m_cols;
+    if (&result == &left || &result == &right)
+    {
+        DenseMatrix temp;
+        multiply(left, right, temp);
+        result = temp;
+        return;
+    }
+    result.allocate(rows, cols);
+    if (rows == 0 || cols == 0) return;
+    const int64_t numRowBlocks = (rows + ROW_BLOCK - 1) / ROW_BLOCK;
+    const bool parallel = (rows * cols * inner > PARALLEL_WORK && numRowBlocks > 1);
+#pragma omp CARET_PAR if (parallel)
+    {
+        vector<double> accum(ROW_BLOCK * COL_BLOCK);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t rowBlock = 0; rowBlock < numRowBlocks; ++rowBlock)
+        {
+            const int64_t ib = rowBlock * ROW_BLOCK, iend = min(ib + ROW_BLOCK, rows);
+            for (int64_t jb = 0; jb < cols; jb += COL_BLOCK)
+            {
+                const int64_t jend = min(jb + COL_BLOCK, cols), jsize = jend - jb;
+                std::fill(accum.begin(), accum.end(), 0.0);
+                for (int64_t kb = 0; kb < inner; kb += INNER_BLOCK)
+                {
+                    const int64_t kend = min(kb + INNER_BLOCK, inner);
+                    for (int64_t i = ib; i < iend; ++i)
+                    {
+                        const float* leftRow = left.getRow(i);
+                        double* accumRow = accum.data() + (i - ib) * COL_BLOCK;
+                        for (int64_t k = kb; k < kend; ++k)
+                        {
+                            const double leftVal = leftRow[k];
+                            const float* rightRow = right.getRow(k) + jb;
+                            for (int64_t j = 0; j < jsize; ++j)
+                            {
+                                accumRow[j] += leftVal * rightRow[j];
+                            }
+                        }
+                    }
+                }
+                for (int64_t i = ib; i < iend; ++i)
+                {
+                    const double* accumRow = accum.data() + (i - ib) * COL_BLOCK;
+                    float* outRow = result.getRow(i) + jb;
+                    for (int64_t j = 0; j < jsize; ++j)
+                    {
+                        outRow[j] = (float)accumRow[j];
+                    }
+                }
+            }
+        }
+    }
+}
+
+void DenseMatrix::multiplyTransposed(const DenseMatrix& right, DenseMatrix& result) const
+{
+    if (m_rows != right.m_rows) throw CaretException("transposed matrix multiply called with mismatched dimensions");
+    if (&result == this || &result == &right)
+    {
+        DenseMatrix temp;
+        multiplyTransposed(right, temp);
+        result = temp;
+        return;
+    }
+    const int64_t rows = m_cols, cols = right.m_cols, inner = m_rows;
+    result.allocate(rows, cols);
+    if (rows == 0 || cols == 0) return;
+    const bool parallel = (rows * cols * inner > PARALLEL_WORK && rows > 1);
+#pragma omp CARET_PAR if (parallel)
+    {
+        vector<double> accum(cols);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t i = 0; i < rows; ++i)
+        {//each output row is a sum of outer products down the shared dimension, reads both inputs contiguously
+            std::fill(accum.begin(), accum.end(), 0.0);
+            for (int64_t k = 0; k < inner; ++k)
+            {
+                const double leftVal = getRow(k)[i];
+                const float* rightRow = right.getRow(k);
+                for (int64_t j = 0; j < cols; ++j)
+                {
+                    accum[j] += leftVal * rightRow[j];
+                }
+            }
+            float* outRow = result.getRow(i);
+            for (int64_t j = 0; j < cols; ++j)
+            {
+                outRow[j] = (float)accum[j];
+            }
+        }
+    }
+}
+
+void DenseMatrix::copyToDouble(const DenseMatrix& in, vector<double>& out)
+{
+    out.resize(in.m_rows * in.m_cols);
+    for (int64_t i = 0; i < in.m_rows; ++i)
+    {
+        const float* row = in.getRow(i);
+        for (int64_t j = 0; j < in.m_cols; ++j)
+        {
+            out[i * in.m_cols + j] = row[j];
+        }
+    }
+}
+
+bool DenseMatrix::luSolve(const DenseMatrix& rhs, DenseMatrix& result) const
+{
+    if (m_rows != m_cols) throw CaretException("luSolve called on non-square matrix");
+    if (rhs.m_rows != m_rows) throw CaretException("luSolve called with mismatched right hand side");
+    const int64_t n = m_rows, numRhs = rhs.m_cols;
+    vector<double> lu, work;
+    copyToDouble(*this, lu);
+    copyToDouble(rhs, work);
+    vector<int64_t> pivots;
+    int swapSign;
+    if (!luDecompose(lu, n, pivots, swapSign)) return false;
+    for (int64_t i = 0; i < n; ++i)
+    {//apply the row swaps to the right hand side in the order they were made
+        if (pivots[i] != i) swap_ranges(work.begin() + i * numRhs, work.begin() + (i + 1) * numRhs, work.begin() + pivots[i] * numRhs);
+    }
+    for (int64_t i = 0; i < n; ++i)
+    {//forward substitution, L has an implicit unit diagonal
+        double* workRow = work.data() + i * numRhs;
+        for (int64_t k = 0; k < i; ++k)
+        {
+            const double factor = lu[i * n + k];
+            if (factor == 0.0) continue;
+            const double* otherRow = work.data() + k * numRhs;
+            for (int64_t j = 0; j < numRhs; ++j) workRow[j] -= factor * otherRow[j];
+        }
+    }
+    for (int64_t i = n - 1; i >= 0; --i)
+    {//back substitution
+        double* workRow = work.data() + i * numRhs;
+        for (int64_t k = i + 1; k < n; ++k)
+        {
+            const double factor = lu[i * n + k];
+            if (factor == 0.0) continue;
+            const double* otherRow = work.data() + k * numRhs;
+            for (int64_t j = 0; j < numRhs; ++j) workRow[j] -= factor * otherRow[j];
+        }
+        const double invDiag = 1.0 / lu[i * n + i];
+        for (int64_t j = 0; j < numRhs; ++j) workRow[j] *= invDiag;
+    }
+    result.allocate(n, numRhs);
+    for (int64_t i = 0; i < n; ++i)
+    {
+        float* outRow = result.getRow(i);
+        for (int64_t j = 0; j < numRhs; ++j) outRow[j] = (float)work[i * numRhs + j];
+    }
+    return true;
+}
+
+bool DenseMatrix::choleskySolve(const DenseMatrix& rhs, DenseMatrix& result) const
+{
+    if (m_rows != m_cols) throw CaretException("choleskySolve called on non-square matrix");
+    if (rhs.m_rows != m_rows) throw CaretException("choleskySolve called with mismatched right hand side");
+    const int64_t n = m_rows, numRhs = rhs.m_cols;
+    vector<double> chol, work;
+    copyToDouble(*this, chol);
+    copyToDouble(rhs, work);
+    for (int64_t i = 0; i < n; ++i)
+    {//lower triangle, row by row
+        for (int64_t j = 0; j <= i; ++j)
+        {
+            double sum = chol[i * n + j];
+            for (int64_t k = 0; k < j; ++k) sum -= chol[i * n + k] * chol[j * n + k];
+            if (i == j)
+            {
+                if (!(sum > 0.0)) return false;//not positive definite, or NaN
+                chol[i * n + i] = sqrt(sum);
+            } else {
+                chol[i * n + j] = sum / chol[j * n + j];
+            }
+        }
+    }
+    for (int64_t i = 0; i < n; ++i)
+    {//solve L y = b
+        double* workRow = work.data() + i * numRhs;
+        for (int64_t k = 0; k < i; ++k)
+        {
+            const double factor = chol[i * n + k];
+            const double* otherRow = work.data() + k * numRhs;
+            for (int64_t j = 0; j < numRhs; ++j) workRow[j] -= factor * otherRow[j];
+        }
+        const double invDiag = 1.0 / chol[i * n + i];
+        for (int64_t j = 0; j < numRhs; ++j) workRow[j] *= invDiag;
+    }
+    for (int64_t i = n - 1; i >= 0; --i)
+    {//solve L^T x = y
+        double* workRow = work.data() + i * numRhs;
+        for (int64_t k = i + 1; k < n; ++k)
+        {
+            const double factor = chol[k * n + i];
+            const double* otherRow = work.data() + k * numRhs;
+            for (int64_t j = 0; j < numRhs; ++j) workRow[j] -= factor * otherRow[j];
+        }
+        const double invDiag = 1.0 / chol[i * n + i];
+        for (int64_t j = 0; j < numRhs; ++j) workRow[j] *= invDiag;
+    }
+    result.allocate(n, numRhs);
+    for (int64_t i = 0; i < n; ++i)
+    {
+        float* outRow = result.getRow(i);
+        for (int64_t j = 0; j < numRhs; ++j) outRow[j] = (float)work[i * numRhs + j];
+    }
+    return true;
+}
+
+bool DenseMatrix::qrSolve(const DenseMatrix& rhs, DenseMatrix& result) const
+{
+    if (m_rows < m_cols) throw CaretException("qrSolve called on matrix with fewer rows than columns");
+    if (rhs.m_rows != m_rows) throw CaretException("qrSolve called with mismatched right hand side");
+    const int64_t rows = m_rows, cols = m_cols, numRhs = rhs.m_cols;
+    vector<double> qr, work, reflectors, reflectorNorms;
+    copyToDouble(*this, qr);
+    copyToDouble(rhs, work);
+    if (!householderQR(qr, rows, cols, reflectors, reflectorNorms)) return false;
+    for (int64_t k = 0; k < cols; ++k)
+    {//apply Q^T to the right hand side
+        if (reflectorNorms[k] == 0.0) continue;
+        const double* householder = reflectors.data() + k * rows;
+        for (int64_t j = 0; j < numRhs; ++j)
+        {
+            double dot = 0.0;
+            for (int64_t i = k; i < rows; ++i) dot += householder[i] * work[i * numRhs + j];
+            const double factor = 2.0 * dot / reflectorNorms[k];
+            for (int64_t i = k; i < rows; ++i) work[i * numRhs + j] -= factor * householder[i];
+        }
+    }
+    for (int64_t i = cols - 1; i >= 0; --i)
+    {//back substitution with R
+        double* workRow = work.data() + i * numRhs;
+        for (int64_t k = i + 1; k < cols; ++k)
+        {
+            const double factor = qr[i * cols + k];
+            const double* otherRow = work.data() + k * numRhs;
+            for (int64_t j = 0; j < numRhs; ++j) workRow[j] -= factor * otherRow[j];
+        }
+        const double diag = qr[i * cols + i];
+        for (int64_t j = 0; j < numRhs; ++j) workRow[j] /= diag;
+    }
+    result.allocate(cols, numRhs);
+    for (int64_t i = 0; i < cols; ++i)
+    {
+        float* outRow = result.getRow(i);
+        for (int64_t j = 0; j < numRhs; ++j) outRow[j] = (float)work[i * numRhs + j];
+    }
+    return true;
+}
+
+bool DenseMatrix::pseudoInverse(DenseMatrix& result) const
+{
+    if (m_rows < m_cols) throw CaretException("pseudoInverse called on matrix with fewer rows than columns");
+    const int64_t rows = m_rows, cols = m_cols;
+    vector<double> qr, reflectors, reflectorNorms;
+    copyToDouble(*this, qr);
+    if (!householderQR(qr, rows, cols, reflectors, reflectorNorms)) return false;
+    vector<double> thinQ(rows * cols, 0.0);//first cols columns of Q, from applying the reflections in reverse to the identity
+    for (int64_t i = 0; i < cols; ++i) thinQ[i * cols + i] = 1.0;
+    for (int64_t k = cols - 1; k >= 0; --k)
+    {
+        if (reflectorNorms[k] == 0.0) continue;
+        const double* householder = reflectors.data() + k * rows;
+        for (int64_t j = 0; j < cols; ++j)
+        {
+            double dot = 0.0;
+            for (int64_t i = k; i < rows; ++i) dot += householder[i] * thinQ[i * cols + j];
+            const double factor = 2.0 * dot / reflectorNorms[k];
+            for (int64_t i = k; i < rows; ++i) thinQ[i * cols + j] -= factor * householder[i];
+        }
+    }
+    vector<double> work(cols * rows);//solve R * result = Q^T
+    for (int64_t i = 0; i < cols; ++i)
+    {
+        for (int64_t t = 0; t < rows; ++t) work[i * rows + t] = thinQ[t * cols + i];
+    }
+    for (int64_t i = cols - 1; i >= 0; --i)
+    {
+        double* workRow = work.data() + i * rows;
+        for (int64_t k = i + 1; k < cols; ++k)
+        {
+            const double factor = qr[i * cols + k];
+            const double* otherRow = work.data() + k * rows;
+            for (int64_t t = 0; t < rows; ++t) workRow[t] -= factor * otherRow[t];
+        }
+        const double diag = qr[i * cols + i];
+        for (int64_t t = 0; t < rows; ++t) workRow[t] /= diag;
+    }
+    result.allocate(cols, rows);
+    for (int64_t i = 0; i < cols; ++i)
+    {
+        float* outRow = result.getRow(i);
+        for (int64_t t = 0; t < rows; ++t) outRow[t] = (float)work[i * rows + t];
+    }
+    return true;
+}
+
+bool DenseMatrix::inverse(DenseMatrix& result) const
+{
+    if (m_rows != m_cols) throw CaretException("inverse called on non-square matrix");
+    DenseMatrix ident(m_rows, m_rows);
+    for (int64_t i = 0; i < m_rows; ++i) ident(i, i) = 1.0f;
+    return luSolve(ident, result);
+}
+
+double DenseMatrix::determinant() const
+{
+    if (m_rows != m_cols) throw CaretException("determinant() called on non-square matrix");
+    if (m_rows == 0) return 1.0;
+    vector<double> lu;
+    copyToDouble(*this, lu);
+    vector<int64_t> pivots;
+    int swapSign;
+    if (!luDecompose(lu, m_rows, pivots, swapSign)) return 0.0;
+    double ret = swapSign;
+    for (int64_t i = 0; i < m_rows; ++i) ret *= lu[i * m_rows + i];
+    return ret;
+}
@@ -0,0 +1,81 @@
+#ifndef __DENSE_MATRIX_H__
+#define __DENSE_MATRIX_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <vector>
+#include "stdint.h"
+
+namespace caret {
+
+    ///contiguous row-major single precision matrix, rows of 16 or more floats are padded to start on 64 byte boundaries so kernels can vectorize, narrower rows are packed
+    ///products accumulate in double, decompositions are done in double, solvers return false on a zero pivot (QR: on a column that is dependent to within float rounding)
+    class DenseMatrix
+    {
+        std::vector<float> m_storage;
+        int64_t m_rows, m_cols, m_stride, m_offset;//m_offset aligns the first row within m_storage
+        void allocate(const int64_t& rows, const int64_t& cols);
+        static void copyToDouble(const DenseMatrix& in, std::vector<double>& out);
+    public:
+        DenseMatrix();
+        ///construct with given size, filled with initVal
+        DenseMatrix(const int64_t& rows, const int64_t& cols, const float& initVal = 0.0f);
+        ///construct from rectangular vector<vector>
+        DenseMatrix(const std::vector<std::vector<float> >& matrixIn);
+        DenseMatrix(const DenseMatrix& right);
+        DenseMatrix& operator=(const DenseMatrix& right);
+        
+        int64_t getNumberOfRows() const { return m_rows; }
+        int64_t getNumberOfColumns() const { return m_cols; }
+        ///distance in floats between the starts of consecutive rows
+        int64_t getRowStride() const { return m_stride; }
+        float* getRow(const int64_t& row) { return m_storage.data() + m_offset + row * m_stride; }
+        const float* getRow(const int64_t& row) const { return m_storage.data() + m_offset + row * m_stride; }
+        float& operator()(const int64_t& row, const int64_t& col) { return getRow(row)[col]; }
+        const float& operator()(const int64_t& row, const int64_t& col) const { return getRow(row)[col]; }
+        
+        ///resize - keeps contents within bounds unless destructive is true, new elements are zero
+        void resize(const int64_t& rows, const int64_t& cols, const bool& destructive = false);
+        void fill(const float& value);
+        std::vector<std::vector<float> > toVectorVector() const;
+        DenseMatrix transpose() const;
+        
+        ///result = left * right, blocked for cache and parallelized for large products, throws on mismatched dimensions
+        static void multiply(const DenseMatrix& left, const DenseMatrix& right, DenseMatrix& result);
+        ///result = this^T * right without forming the transpose, useful for X^T X and X^T Y in regressions
+        void multiplyTransposed(const DenseMatrix& right, DenseMatrix& result) const;
+        
+        ///solve this * result = rhs for square this, with partially pivoted LU
+        bool luSolve(const DenseMatrix& rhs, DenseMatrix& result) const;
+        ///solve this * result = rhs for symmetric positive definite this, about twice as fast as LU
+        bool choleskySolve(const DenseMatrix& rhs, DenseMatrix& result) const;
+        ///least squares solution of this * result = rhs with householder QR, needs at least as many rows as columns
+        bool qrSolve(const DenseMatrix& rhs, DenseMatrix& result) const;
+        ///moore-penrose pseudoinverse of a full column rank matrix via householder QR, (cols x rows), for applying one least squares fit to many right hand sides
+        bool pseudoInverse(DenseMatrix& result) const;
+        bool inverse(DenseMatrix& result) const;
+        ///determinant via LU, throws if not square
+        double determinant() const;
+    };
+
+}
+
+#endif //__DENSE_MATRIX_H__
@@ -25,33 +25,17 @@
 #include "FloatMatrix.h"
 #include "MatrixFunctions.h"
 
+#include <algorithm>
+
 using namespace caret;
 using namespace std;
 
-bool FloatMatrix::checkDimensions() const
-{
-   uint64_t rows = m_matrix.size(), cols;
-   if (rows == 0) return true;//treat it as fine for now
-   cols = m_matrix[0].size();
-   for (uint64_t i = 1; i < rows; ++i)
-   {
-      if (m_matrix[i].size() != cols)
-      {
-         return false;
-      }
-   }
-   return true;
-}
-
-FloatMatrix::FloatMatrix(const vector<vector<float> >& matrixIn)
+FloatMatrix::FloatMatrix(const vector<vector<float> >& matrixIn) : m_matrix(matrixIn)
 {
-   m_matrix = matrixIn;
-   CaretAssert(checkDimensions());
 }
 
-FloatMatrix::FloatMatrix(const int64_t& rows, const int64_t& cols)
+FloatMatrix::FloatMatrix(const int64_t& rows, const int64_t& cols) : m_matrix(rows, cols)
 {
-    resize(rows, cols, true);
 }
 
 bool FloatMatrix::operator!=(const FloatMatrix& right) const
@@ -62,93 +46,179 @@ bool FloatMatrix::operator!=(const FloatMatrix& right) const
 FloatMatrix FloatMatrix::operator*(const FloatMatrix& right) const
 {
    FloatMatrix ret;
-   MatrixFunctions::multiply<float, float, float, double>(m_matrix, right.m_matrix, ret.m_matrix);
+   if (getNumberOfRows() == 0 || getNumberOfColumns() == 0 || right.getNumberOfColumns() == 0 || getNumberOfColumns() != right.getNumberOfRows())
+   {
+      return ret;//error gives 0x0
+   }
+   DenseMatrix::multiply(m_matrix, right.m_matrix, ret.m_matrix);
    return ret;
 }
 
 FloatMatrix& FloatMatrix::operator*=(const FloatMatrix& right)
 {
-   MatrixFunctions::multiply<float, float, float, double>(m_matrix, right.m_matrix, m_matrix);//would need a copy anyway, so let it make the copy internally
+   *this = *this * right;
    return *this;
 }
 
 FloatMatrix FloatMatrix::concatHoriz(const FloatMatrix& right) const
 {
-   FloatMatrix ret;
-   MatrixFunctions::horizCat(m_matrix, right.m_matrix, ret.m_matrix);
+   int64_t rows = getNumberOfRows();
+   if (rows == 0) return right;//allow concatenating any empty matrix to any matrix
+   if (right.getNumberOfRows() == 0) return *this;
+   if (rows != right.getNumberOfRows()) return FloatMatrix();
+   int64_t leftCols = getNumberOfColumns(), rightCols = right.getNumberOfColumns();
+   FloatMatrix ret(rows, leftCols + rightCols);
+   for (int64_t i = 0; i < rows; ++i)
+   {
+      const float* leftRow = m_matrix.getRow(i), *rightRow = right.m_matrix.getRow(i);
+      float* outRow = ret.m_matrix.getRow(i);
+      copy(leftRow, leftRow + leftCols, outRow);
+      copy(rightRow, rightRow + rightCols, outRow + leftCols);
+   }
    return ret;
 }
 
 FloatMatrix FloatMatrix::concatVert(const FloatMatrix& bottom) const
 {
-   FloatMatrix ret;
-   MatrixFunctions::vertCat(m_matrix, bottom.m_matrix, ret.m_matrix);
+   int64_t topRows = getNumberOfRows(), bottomRows = bottom.getNumberOfRows(), cols = getNumberOfColumns();
+   if (topRows == 0) return bottom;//allow concatenation of empty matrix to any matrix
+   if (bottomRows == 0) return *this;
+   if (cols != bottom.getNumberOfColumns()) return FloatMatrix();
+   FloatMatrix ret(topRows + bottomRows, cols);
+   for (int64_t i = 0; i < topRows; ++i)
+   {
+      const float* inRow = m_matrix.getRow(i);
+      copy(inRow, inRow + cols, ret.m_matrix.getRow(i));
+   }
+   for (int64_t i = 0; i < bottomRows; ++i)
+   {
+      const float* inRow = bottom.m_matrix.getRow(i);
+      copy(inRow, inRow + cols, ret.m_matrix.getRow(i + topRows));
+   }
    return ret;
 }
 
 FloatMatrix FloatMatrix::getRange(const int64_t firstRow, const int64_t afterLastRow, const int64_t firstCol, const int64_t afterLastCol) const
 {
-   FloatMatrix ret;
-   MatrixFunctions::getChunk(firstRow, afterLastRow, firstCol, afterLastCol, m_matrix, ret.m_matrix);
+   if (afterLastRow <= firstRow || afterLastCol <= firstCol || firstRow < 0 || firstCol < 0 || afterLastRow > getNumberOfRows() || afterLastCol > getNumberOfColumns())
+   {
+      return FloatMatrix();
+   }
+   FloatMatrix ret(afterLastRow - firstRow, afterLastCol - firstCol);
+   for (int64_t i = firstRow; i < afterLastRow; ++i)
+   {
+      const float* inRow = m_matrix.getRow(i);
+      copy(inRow + firstCol, inRow + afterLastCol, ret.m_matrix.getRow(i - firstRow));
+   }
    return ret;
 }
 
 FloatMatrix FloatMatrix::identity(const int64_t rows)
 {
-   FloatMatrix ret;
-   MatrixFunctions::identity(rows, ret.m_matrix);
+   FloatMatrix ret(rows, rows);
+   for (int64_t i = 0; i < rows; ++i)
+   {
+      ret.m_matrix(i, i) = 1.0f;
+   }
    return ret;
 }
 
 FloatMatrix FloatMatrix::inverse() const
 {
    FloatMatrix ret;
-   MatrixFunctions::inverse(m_matrix, ret.m_matrix);
+   if (getNumberOfRows() == 0 || getNumberOfRows() != getNumberOfColumns()) return ret;
+   if (!m_matrix.inverse(ret.m_matrix))
+   {//singular, give back whatever the old rref method gives, for compatibility
+      vector<vector<float> > result;
+      MatrixFunctions::inverse(m_matrix.toVectorVector(), result);
+      return FloatMatrix(result);
+   }
    return ret;
 }
 
 FloatMatrix& FloatMatrix::operator*=(const float& right)
 {
-   MatrixFunctions::multiply(m_matrix, right, m_matrix);//internally makes a copy
+   for (int64_t i = 0; i < getNumberOfRows(); ++i)
+   {
+      float* row = m_matrix.getRow(i);
+      for (int64_t j = 0; j < getNumberOfColumns(); ++j)
+      {
+         row[j] *= right;
+      }
+   }
    return *this;
 }
 
 FloatMatrix FloatMatrix::operator+(const FloatMatrix& right) const
 {
-   FloatMatrix ret;
-   MatrixFunctions::add(m_matrix, right.m_matrix, ret.m_matrix);
+   FloatMatrix ret(*this);
+   ret += right;
    return ret;
 }
 
 FloatMatrix& FloatMatrix::operator+=(const FloatMatrix& right)
 {
-   MatrixFunctions::add(m_matrix, right.m_matrix, m_matrix);
+   int64_t rows = getNumberOfRows(), cols = getNumberOfColumns();
+   if (rows == 0 || rows != right.getNumberOfRows() || cols != right.getNumberOfColumns())
+   {
+      m_matrix = DenseMatrix();//use empty matrix for error condition
+      return *this;
+   }
+   for (int64_t i = 0; i < rows; ++i)
+   {
+      float* row = m_matrix.getRow(i);
+      const float* rightRow = right.m_matrix.getRow(i);
+      for (int64_t j = 0; j < cols; ++j)
+      {
+         row[j] += rightRow[j];
+      }
+   }
    return *this;
 }
 
 FloatMatrix& FloatMatrix::operator+=(const float& right)
 {
-   MatrixFunctions::add(m_matrix, right, m_matrix);
+   for (int64_t i = 0; i < getNumberOfRows(); ++i)
+   {
+      float* row = m_matrix.getRow(i);
+      for (int64_t j = 0; j < getNumberOfColumns(); ++j)
+      {
+         row[j] += right;
+      }
+   }
    return *this;
 }
 
 FloatMatrix FloatMatrix::operator-(const FloatMatrix& right) const
 {
-   FloatMatrix ret;
-   MatrixFunctions::subtract(m_matrix, right.m_matrix, ret.m_matrix);
+   FloatMatrix ret(*this);
+   ret -= right;
    return ret;
 }
 
 FloatMatrix& FloatMatrix::operator-=(const FloatMatrix& right)
 {
-   MatrixFunctions::subtract(m_matrix, right.m_matrix, m_matrix);
+   int64_t rows = getNumberOfRows(), cols = getNumberOfColumns();
+   if (rows == 0 || rows != right.getNumberOfRows() || cols != right.getNumberOfColumns())
+   {
+      m_matrix = DenseMatrix();//use empty matrix for error condition
+      return *this;
+   }
+   for (int64_t i = 0; i < rows; ++i)
+   {
+      float* row = m_matrix.getRow(i);
+      const float* rightRow = right.m_matrix.getRow(i);
+      for (int64_t j = 0; j < cols; ++j)
+      {
+         row[j] -= rightRow[j];
+      }
+   }
    return *this;
 }
 
 FloatMatrix& FloatMatrix::operator-=(const float& right)
 {
-   MatrixFunctions::add(m_matrix, (-right), m_matrix);
-   return *this;
+   return ((*this) += (-right));
 }
 
 FloatMatrix& FloatMatrix::operator/=(const float& right)
@@ -162,28 +232,16 @@ bool FloatMatrix::operator==(const FloatMatrix& right) const
    {
       return true;//short circuit true on pointer equivalence
    }
-   int64_t i, j, rows = (int64_t)m_matrix.size(), cols;
-   if (rows != (int64_t)right.m_matrix.size())
+   int64_t rows = getNumberOfRows(), cols = getNumberOfColumns();
+   if (rows != right.getNumberOfRows() || cols != right.getNumberOfColumns())
    {
       return false;
    }
-   if (rows == 0)
+   for (int64_t i = 0; i < rows; ++i)
    {
-      return true;//don't try to get the second dimension
-   }
-   cols = (int64_t)m_matrix[0].size();
-   if (cols != (int64_t)right.m_matrix[0].size())
-   {
-      return false;
-   }
-   for (i = 0; i < rows; ++i)
-   {
-      for (j = 0; j < cols; ++j)
+      if (!equal(m_matrix.getRow(i), m_matrix.getRow(i) + cols, right.m_matrix.getRow(i)))
       {
-         if (m_matrix[i][j] != right.m_matrix[i][j])
-         {
-            return false;
-         }
+         return false;
       }
    }
    return true;
@@ -191,46 +249,39 @@ bool FloatMatrix::operator==(const FloatMatrix& right) const
 
 void FloatMatrix::getDimensions(int64_t& rows, int64_t& cols) const
 {
-   rows = (int64_t)m_matrix.size();
-   if (rows == 0)
-   {
-      cols = 0;
-   } else {
-      cols = (int64_t)m_matrix[0].size();
-   }
+   rows = getNumberOfRows();
+   cols = getNumberOfColumns();
 }
 
 FloatMatrixRowRef FloatMatrix::operator[](const int64_t& index)
 {
-   CaretAssert(index > -1 && index < (int64_t)m_matrix.size());
-   FloatMatrixRowRef ret(m_matrix[index]);
+   CaretAssert(index > -1 && index < getNumberOfRows());
+   FloatMatrixRowRef ret(m_matrix.getRow(index), getNumberOfColumns());
    return ret;
 }
 
 ConstFloatMatrixRowRef FloatMatrix::operator[](const int64_t& index) const
 {
-   CaretAssert(index > -1 && index < (int64_t)m_matrix.size());
-   ConstFloatMatrixRowRef ret(m_matrix[index]);
+   CaretAssert(index > -1 && index < getNumberOfRows());
+   ConstFloatMatrixRowRef ret(m_matrix.getRow(index), getNumberOfColumns());
    return ret;
 }
 
 FloatMatrix FloatMatrix::reducedRowEchelon() const
 {
-   FloatMatrix ret(*this);
-   MatrixFunctions::rref(ret.m_matrix);
-   return ret;
+   vector<vector<float> > temp = m_matrix.toVectorVector();
+   MatrixFunctions::rref(temp);
+   return FloatMatrix(temp);
 }
 
 void FloatMatrix::resize(const int64_t rows, const int64_t cols, const bool destructive)
 {
-   MatrixFunctions::resize(rows, cols, m_matrix, destructive);
+   m_matrix.resize(rows, cols, destructive);
 }
 
 FloatMatrix FloatMatrix::transpose() const
 {
-   FloatMatrix ret;
-   MatrixFunctions::transpose(m_matrix, ret.m_matrix);
-   return ret;
+   return FloatMatrix(m_matrix.transpose());
 }
 
 float FloatMatrix::determinant() const
@@ -238,57 +289,44 @@ float FloatMatrix::determinant() const
     int64_t numRows = getNumberOfRows(), numCols = getNumberOfColumns();
     if (numRows != numCols) throw CaretException("determinant() called on non-square matrix");
     if (numRows == 0) return 1;//whatever
-    if (numRows == 1) return m_matrix[0][0];
-    if (numRows == 2) return m_matrix[0][0] * m_matrix[1][1] - m_matrix[0][1] * m_matrix[1][0];
-    if (numRows == 3) return m_matrix[0][0] * m_matrix[1][1] * m_matrix[2][2] +
-                             m_matrix[0][1] * m_matrix[1][2] * m_matrix[2][0] +
-                             m_matrix[0][2] * m_matrix[1][0] * m_matrix[2][1] -
-                             m_matrix[0][0] * m_matrix[1][2] * m_matrix[2][1] -
-                             m_matrix[0][1] * m_matrix[1][0] * m_matrix[2][2] -
-                             m_matrix[0][2] * m_matrix[1][1] * m_matrix[2][0];
-    if (numRows > 7)
-    {
-        CaretLogWarning("determinant() called on matrix with size " + AString::number(numRows) + ", current algorithm is slow, O(n!) recursive");
-    }
-    double ret = 0.0;//replace with LU decomposition if we need it before adding a real matrix library
-    for (int64_t i = 0; i < numRows; ++i)//warning, O(n!) runtime
-    {
-        float minor = this->getRange(0, i, 1, numCols).concatVert(this->getRange(i + 1, numRows, 1, numCols)).determinant(),
-            factor = (i % 2 ? -1.0f : 1.0f);
-        ret += minor * factor;
-    }
-    return ret;
+    const DenseMatrix& m = m_matrix;
+    if (numRows == 1) return m(0, 0);
+    if (numRows == 2) return m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0);
+    if (numRows == 3) return m(0, 0) * m(1, 1) * m(2, 2) +
+                             m(0, 1) * m(1, 2) * m(2, 0) +
+                             m(0, 2) * m(1, 0) * m(2, 1) -
+                             m(0, 0) * m(1, 2) * m(2, 1) -
+                             m(0, 1) * m(1, 0) * m(2, 2) -
+                             m(0, 2) * m(1, 1) * m(2, 0);
+    return m_matrix.determinant();
 }
 
 FloatMatrix FloatMatrix::zeros(const int64_t rows, const int64_t cols)
 {
-   FloatMatrix ret;
-   MatrixFunctions::zeros(rows, cols, ret.m_matrix);
-   return ret;
+   return FloatMatrix(rows, cols);
 }
 
 FloatMatrix FloatMatrix::ones(const int64_t rows, const int64_t cols)
 {
-   FloatMatrix ret;
-   MatrixFunctions::ones(rows, cols, ret.m_matrix);
-   return ret;
+   return FloatMatrix(DenseMatrix(rows, cols, 1.0f));
 }
 
-const vector<vector<float> >& FloatMatrix::getMatrix() const
+vector<vector<float> > FloatMatrix::getMatrix() const
 {
-   return m_matrix;
+   return m_matrix.toVectorVector();
 }
 
 void FloatMatrix::getAffineVectors(Vector3D& xvec, Vector3D& yvec, Vector3D& zvec, Vector3D& offset) const
 {
-    if (m_matrix.size() < 3 || m_matrix.size() > 4 || m_matrix[0].size() != 4)
+    if (getNumberOfRows() < 3 || getNumberOfRows() > 4 || getNumberOfColumns() != 4)
     {
         throw CaretException("getAffineVectors called on incorrectly sized matrix");
     }
-    xvec[0] = m_matrix[0][0]; xvec[1] = m_matrix[1][0]; xvec[2] = m_matrix[2][0];
-    yvec[0] = m_matrix[0][1]; yvec[1] = m_matrix[1][1]; yvec[2] = m_matrix[2][1];
-    zvec[0] = m_matrix[0][2]; zvec[1] = m_matrix[1][2]; zvec[2] = m_matrix[2][2];
-    offset[0] = m_matrix[0][3]; offset[1] = m_matrix[1][3]; offset[2] = m_matrix[2][3];
+    const DenseMatrix& m = m_matrix;
+    xvec[0] = m(0, 0); xvec[1] = m(1, 0); xvec[2] = m(2, 0);
+    yvec[0] = m(0, 1); yvec[1] = m(1, 1); yvec[2] = m(2, 1);
+    zvec[0] = m(0, 2); zvec[1] = m(1, 2); zvec[2] = m(2, 2);
+    offset[0] = m(0, 3); offset[1] = m(1, 3); offset[2] = m(2, 3);
 }
 
 FloatMatrix FloatMatrix::operator-() const
@@ -300,24 +338,24 @@ FloatMatrix FloatMatrix::operator-() const
    return ret;
 }
 
-FloatMatrixRowRef::FloatMatrixRowRef(vector<float>& therow) : m_row(therow)
+FloatMatrixRowRef::FloatMatrixRowRef(float* therow, const int64_t& size) : m_row(therow), m_size(size)
 {
 }
 
 FloatMatrixRowRef& FloatMatrixRowRef::operator=(const FloatMatrixRowRef& right)
 {
-   if (&m_row == &(right.m_row))
-   {//just in case vector isn't smart enough to check self assignment
+   if (m_row == right.m_row)
+   {
       return *this;
    }
-   CaretAssert(m_row.size() == right.m_row.size());//maybe this should be an exception, not an assertion?
-   m_row = right.m_row;
+   CaretAssert(m_size == right.m_size);//maybe this should be an exception, not an assertion?
+   copy(right.m_row, right.m_row + m_size, m_row);
    return *this;
 }
 
 FloatMatrixRowRef& FloatMatrixRowRef::operator=(const float& right)
 {
-   for (int64_t i = 0; i < (int64_t)m_row.size(); ++i)
+   for (int64_t i = 0; i < m_size; ++i)
    {
       m_row[i] = right;
    }
@@ -326,35 +364,35 @@ FloatMatrixRowRef& FloatMatrixRowRef::operator=(const float& right)
 
 float& FloatMatrixRowRef::operator[](const int64_t& index)
 {
-   CaretAssert(index > -1 && index < (int64_t)m_row.size());//instead of segfaulting, explicitly check in debug
+   CaretAssert(index > -1 && index < m_size);//instead of segfaulting, explicitly check in debug
    return m_row[index];
 }
 
-FloatMatrixRowRef::FloatMatrixRowRef(FloatMatrixRowRef& right) : m_row(right.m_row)
+FloatMatrixRowRef::FloatMatrixRowRef(FloatMatrixRowRef& right) : m_row(right.m_row), m_size(right.m_size)
 {
 }
 
 FloatMatrixRowRef& FloatMatrixRowRef::operator=(const ConstFloatMatrixRowRef& right)
 {
-   if (&m_row == &(right.m_row))
-   {//just in case vector isn't smart enough to check self assignment
+   if (m_row == right.m_row)
+   {
       return *this;
    }
-   CaretAssert(m_row.size() == right.m_row.size());
-   m_row = right.m_row;
+   CaretAssert(m_size == right.m_size);
+   copy(right.m_row, right.m_row + m_size, m_row);
    return *this;
 }
 
 const float& ConstFloatMatrixRowRef::operator[](const int64_t& index)
 {
-   CaretAssert(index > -1 && index < (int64_t)m_row.size());//instead of segfaulting, explicitly check in debug
+   CaretAssert(index > -1 && index < m_size);//instead of segfaulting, explicitly check in debug
    return m_row[index];
 }
 
-ConstFloatMatrixRowRef::ConstFloatMatrixRowRef(const ConstFloatMatrixRowRef& right) : m_row(right.m_row)
+ConstFloatMatrixRowRef::ConstFloatMatrixRowRef(const ConstFloatMatrixRowRef& right) : m_row(right.m_row), m_size(right.m_size)
 {
 }
 
-ConstFloatMatrixRowRef::ConstFloatMatrixRowRef(const vector<float>& therow) : m_row(therow)
+ConstFloatMatrixRowRef::ConstFloatMatrixRowRef(const float* therow, const int64_t& size) : m_row(therow), m_size(size)
 {
 }
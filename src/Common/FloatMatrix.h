@@ -24,45 +24,49 @@
 
 #include <vector>
 #include "stdint.h"
+#include "DenseMatrix.h"
 #include "Vector3D.h"
 
 namespace caret {
 
    class ConstFloatMatrixRowRef
    {//needed to do [][] on a const FloatMatrix
-      const std::vector<float>& m_row;
-      ConstFloatMatrixRowRef();//disallow default construction, this contains a reference
+      const float* m_row;
+      int64_t m_size;
+      ConstFloatMatrixRowRef();//disallow default construction
    public:
       ConstFloatMatrixRowRef(const ConstFloatMatrixRowRef& right);//copy constructor
-      ConstFloatMatrixRowRef(const std::vector<float>& therow);
+      ConstFloatMatrixRowRef(const float* therow, const int64_t& size);
       const float& operator[](const int64_t& index);//access element
       friend class FloatMatrixRowRef;//so it can check if it points to the same row
    };
 
    class FloatMatrixRowRef
    {//needed to ensure some joker doesn't call mymatrix[1].resize();, while still allowing mymatrix[1][2] = 5; and mymatrix[1] = mymatrix[2];
-      std::vector<float>& m_row;
-      FloatMatrixRowRef();//disallow default construction, this contains a reference
+      float* m_row;
+      int64_t m_size;
+      FloatMatrixRowRef();//disallow default construction
    public:
       FloatMatrixRowRef(FloatMatrixRowRef& right);//copy constructor
-      FloatMatrixRowRef(std::vector<float>& therow);
+      FloatMatrixRowRef(float* therow, const int64_t& size);
       FloatMatrixRowRef& operator=(const FloatMatrixRowRef& right);//NOTE: copy row contents!
       FloatMatrixRowRef& operator=(const ConstFloatMatrixRowRef& right);//NOTE: copy row contents!
       FloatMatrixRowRef& operator=(const float& right);//NOTE: set all row values!
       float& operator[](const int64_t& index);//access element
    };
 
-   ///class for using single precision matrices (insulates other code from the MatrixFunctions templated header)
-   ///errors will result in a matrix of size 0x0, or an assertion failure if the underlying vector<vector> isn't rectangular
+   ///class for using single precision matrices, now a compatibility wrapper around the contiguous DenseMatrix
+   ///errors will result in a matrix of size 0x0, use DenseMatrix directly for large problems and for the solvers
    class FloatMatrix
    {
-      std::vector<std::vector<float> > m_matrix;
-      bool checkDimensions() const;//put this inside asserts at the end of functions
+      DenseMatrix m_matrix;
    public:
       FloatMatrix() { };//to make the compiler happy
       ///construct from a simple vector<vector<float> >
       FloatMatrix(const std::vector<std::vector<float> >& matrixIn);
-      ///construct uninitialized with given size
+      ///construct from a DenseMatrix
+      FloatMatrix(const DenseMatrix& matrixIn) : m_matrix(matrixIn) { }
+      ///construct with given size, zero filled
       FloatMatrix(const int64_t& rows, const int64_t& cols);
       FloatMatrixRowRef operator[](const int64_t& index);//allow direct indexing to rows
       ConstFloatMatrixRowRef operator[](const int64_t& index) const;//allow direct indexing to rows while const
@@ -85,7 +89,7 @@ namespace caret {
       FloatMatrix reducedRowEchelon() const;
       ///return the transpose
       FloatMatrix transpose() const;
-      ///determinant - warning, uses slow O(n!) recursive algorithm
+      ///determinant, via LU decomposition for sizes over 3
       float determinant() const;
       ///resize the matrix - keeps contents within bounds unless destructive is true (destructive is faster)
       void resize(const int64_t rows, const int64_t cols, const bool destructive = false);
@@ -97,18 +101,16 @@ namespace caret {
       FloatMatrix concatVert(const FloatMatrix& bottom) const;
       ///get the dimensions
       void getDimensions(int64_t& rows, int64_t& cols) const;
-      ///get the matrix as a vector<vector>
-      const std::vector<std::vector<float> >& getMatrix() const;
+      ///get a copy of the matrix as a vector<vector>
+      std::vector<std::vector<float> > getMatrix() const;
+      ///get the underlying contiguous matrix
+      const DenseMatrix& getDenseMatrix() const { return m_matrix; }
       ///separate 3x4 or 4x4 into Vector3Ds, throw on wrong dimensions
       void getAffineVectors(Vector3D& xvec, Vector3D& yvec, Vector3D& zvec, Vector3D& offset) const;
       ///get number of rows
-      int64_t getNumberOfRows() const { return (int64_t)m_matrix.size(); }
+      int64_t getNumberOfRows() const { return m_matrix.getNumberOfRows(); }
       ///get number of columns
-      int64_t getNumberOfColumns() const
-      {
-          if (m_matrix.size() == 0) return 0;
-          return (int64_t)m_matrix[0].size();
-      }
+      int64_t getNumberOfColumns() const { return m_matrix.getNumberOfColumns(); }
       
       ///return a matrix of zeros
       static FloatMatrix zeros(const int64_t rows, const int64_t cols);
@@ -122,6 +122,15 @@ LevelProgress::LevelProgress(ProgressObject* myProgObj, const float finishedProg
     m_maximum = finishedProgress;
     m_progObjRef = myProgObj;
     m_internalResolution = max(internalResolution, ProgressObject::MAX_INTERNAL_RESOLUTION);//the lower the value, the more often it updates
+    if (CaretProfiler::isEnabled())
+    {//the caller usually sets its task to describe the subalgorithm before calling it
+        AString levelName = "algorithm";
+        if (m_progObjRef != NULL && m_progObjRef->m_parent != NULL && m_progObjRef->m_parent->m_description != "")
+        {
+            levelName = m_progObjRef->m_parent->m_description;
+        }
+        m_levelScope.start(levelName, "algorithm");
+    }
     if (m_progObjRef != NULL)
     {
         m_progObjRef->setInternalWeight(internalWeight);
@@ -231,6 +240,7 @@ void LevelProgress::reportProgress(const float currentTotal)
 
 void LevelProgress::setTask(const AString& taskDescription)
 {//maybe this should be in a setter in m_progObjRef, here for coherence with progress reporting
+    m_taskScope.start(taskDescription, "task");//ends the previous task
     if (m_progObjRef == NULL) return;
     m_progObjRef->m_description = taskDescription;
     EventProgressUpdate myUpdate(m_progObjRef);
@@ -240,6 +250,8 @@ void LevelProgress::setTask(const AString& taskDescription)
 
 LevelProgress::~LevelProgress()
 {
+    m_taskScope.end();
+    m_levelScope.end();
     if (m_progObjRef == NULL) return;
     m_progObjRef->finishLevel();//finish level on destruction of the object, for automatic detection of algorithm finishing
 }
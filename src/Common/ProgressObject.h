@@ -24,6 +24,7 @@
 #include "stdint.h"
 #include <vector>
 #include "AString.h"
+#include "CaretProfiler.h"
 
 namespace caret {
    
@@ -97,7 +98,10 @@ namespace caret {
       float m_lastReported;
       float m_internalResolution;
       ProgressObject* m_progObjRef;
+      CaretProfilerScope m_levelScope, m_taskScope;//only record anything with -profile
       LevelProgress();
+      LevelProgress(const LevelProgress&);
+      LevelProgress& operator=(const LevelProgress&);
    public:
       LevelProgress(ProgressObject* myProgObj, const float finishedProgress = 1.0f, const float internalWeight = 1.0f, const float internalResolution = ProgressObject::MAX_INTERNAL_RESOLUTION);
       
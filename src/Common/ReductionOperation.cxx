@@ -21,9 +21,11 @@
 #include "ReductionOperation.h"
 #include "CaretAssert.h"
 #include "CaretException.h"
+#include "CaretOMP.h"
 #include "MathFunctions.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <limits>
 #include <vector>
@@ -130,15 +132,16 @@ float ReductionOperation::reduce(const float* data, const int64_t& numElems, con
             return index + 1;
         }
         case ReductionEnum::MEDIAN:
-        {
-            vector<float> dataCopy(numElems);
-            for (int64_t i = 0; i < numElems; ++i) dataCopy[i] = data[i];
-            sort(dataCopy.begin(), dataCopy.end());
+        {//selection instead of a full sort, gives the same values as sorting
+            vector<float> dataCopy(data, data + numElems);
+            vector<float>::iterator center = dataCopy.begin() + numElems / 2;
+            nth_element(dataCopy.begin(), center, dataCopy.end());
             if ((numElems & 1) == 0)//if even, average middle two
             {
-                return (dataCopy[numElems / 2 - 1] + dataCopy[numElems / 2]) / 2.0f;
+                float below = *max_element(dataCopy.begin(), center);//everything before center is <= center after nth_element
+                return (below + *center) / 2.0f;
             } else {
-                return dataCopy[numElems / 2];//otherwise, take the center
+                return *center;//otherwise, take the center
             }
         }
         case ReductionEnum::MODE:
@@ -550,3 +553,313 @@ AString ReductionOperation::getHelpInfo()
     }
     return ret;
 }
+
+namespace
+{
+    //exceptions can't be allowed to escape an openmp region, so keep the first message and throw it after the region
+    class ThreadedErrorHolder
+    {
+        std::atomic<bool> m_failed;//other threads poll it without the critical section
+        AString m_message;
+    public:
+        ThreadedErrorHolder() { m_failed = false; }
+        bool failed() const { return m_failed.load(std::memory_order_relaxed); }//only a hint while threads are running, used to stop doing work early
+        void setError(const AString& message)
+        {
+#pragma omp critical
+            {
+                if (!m_failed.load(std::memory_order_relaxed))
+                {
+                    m_message = message;
+                    m_failed.store(true, std::memory_order_release);
+                }
+            }
+        }
+        void throwIfFailed() const
+        {
+            if (m_failed.load(std::memory_order_acquire)) throw CaretException(m_message);
+        }
+    };
+    
+    //these can be computed with one accumulator per column, reading each row in order
+    bool isAccumulatorReduction(const ReductionEnum::Enum& type)
+    {
+        switch (type)
+        {
+            case ReductionEnum::SUM:
+            case ReductionEnum::MEAN:
+            case ReductionEnum::STDEV:
+            case ReductionEnum::SAMPSTDEV:
+            case ReductionEnum::VARIANCE:
+            case ReductionEnum::TSNR:
+            case ReductionEnum::COV:
+            case ReductionEnum::PRODUCT:
+            case ReductionEnum::MAX:
+            case ReductionEnum::MIN:
+            case ReductionEnum::INDEXMAX:
+            case ReductionEnum::INDEXMIN:
+            case ReductionEnum::COUNT_NONZERO:
+                return true;
+            default:
+                return false;
+        }
+    }
+    
+    //same operations and order as reduce(), applied to a range of columns at once so the inner loops are contiguous
+    void accumulateColumns(const float* const* rows, const int64_t& numRows, const int64_t& start, const int64_t& end, const ReductionEnum::Enum& type, float* out,
+                           vector<double>& accum, vector<float>& extra, vector<int64_t>& index)
+    {
+        int64_t count = end - start;
+        switch (type)
+        {
+            case ReductionEnum::SUM:
+            case ReductionEnum::MEAN:
+            case ReductionEnum::STDEV:
+            case ReductionEnum::SAMPSTDEV:
+            case ReductionEnum::VARIANCE:
+            case ReductionEnum::TSNR:
+            case ReductionEnum::COV:
+            {
+                accum.assign(count, 0.0);
+                for (int64_t i = 0; i < numRows; ++i)
+                {
+                    const float* row = rows[i] + start;
+                    for (int64_t j = 0; j < count; ++j) accum[j] += row[j];
+                }
+                if (type == ReductionEnum::SUM)
+                {
+                    for (int64_t j = 0; j < count; ++j) out[start + j] = accum[j];
+                    return;
+                }
+                if (type == ReductionEnum::MEAN)
+                {
+                    for (int64_t j = 0; j < count; ++j) out[start + j] = accum[j] / numRows;
+                    return;
+                }
+                extra.resize(count);//means
+                for (int64_t j = 0; j < count; ++j) extra[j] = accum[j] / numRows;
+                accum.assign(count, 0.0);
+                for (int64_t i = 0; i < numRows; ++i)
+                {
+                    const float* row = rows[i] + start;
+                    for (int64_t j = 0; j < count; ++j)
+                    {
+                        float tempf = row[j] - extra[j];
+                        accum[j] += tempf * tempf;
+                    }
+                }
+                for (int64_t j = 0; j < count; ++j)
+                {
+                    double residsqr = accum[j];
+                    float mean = extra[j];
+                    switch (type)
+                    {
+                        case ReductionEnum::STDEV:
+                            out[start + j] = sqrt(residsqr / numRows);
+                            break;
+                        case ReductionEnum::SAMPSTDEV:
+                            out[start + j] = sqrt(residsqr / (numRows - 1));
+                            break;
+                        case ReductionEnum::VARIANCE:
+                            out[start + j] = residsqr / numRows;
+                            break;
+                        case ReductionEnum::TSNR:
+                            out[start + j] = mean / sqrt(residsqr / (numRows - 1));
+                            break;
+                        case ReductionEnum::COV:
+                            out[start + j] = sqrt(residsqr / (numRows - 1)) / mean;
+                            break;
+                        default:
+                            CaretAssertMessage(0, "unhandled type in sum-based reduction");
+                            out[start + j] = 0.0f;
+                    }
+                }
+                return;
+            }
+            case ReductionEnum::PRODUCT:
+            {
+                accum.assign(count, 1.0);
+                for (int64_t i = 0; i < numRows; ++i)
+                {
+                    const float* row = rows[i] + start;
+                    for (int64_t j = 0; j < count; ++j) accum[j] *= row[j];
+                }
+                for (int64_t j = 0; j < count; ++j) out[start + j] = accum[j];
+                return;
+            }
+            case ReductionEnum::MAX:
+            case ReductionEnum::MIN:
+            case ReductionEnum::INDEXMAX:
+            case ReductionEnum::INDEXMIN:
+            {
+                bool isMax = (type == ReductionEnum::MAX || type == ReductionEnum::INDEXMAX);
+                extra.assign(rows[0] + start, rows[0] + end);
+                index.assign(count, 0);
+                for (int64_t i = 1; i < numRows; ++i)
+                {
+                    const float* row = rows[i] + start;
+                    if (isMax)
+                    {
+                        for (int64_t j = 0; j < count; ++j)
+                        {
+                            if (row[j] > extra[j])
+                            {
+                                extra[j] = row[j];
+                                index[j] = i;
+                            }
+                        }
+                    } else {
+                        for (int64_t j = 0; j < count; ++j)
+                        {
+                            if (row[j] < extra[j])
+                            {
+                                extra[j] = row[j];
+                                index[j] = i;
+                            }
+                        }
+                    }
+                }
+                if (type == ReductionEnum::MAX || type == ReductionEnum::MIN)
+                {
+                    for (int64_t j = 0; j < count; ++j) out[start + j] = extra[j];
+                } else {
+                    for (int64_t j = 0; j < count; ++j) out[start + j] = index[j] + 1;//1-based, to match gui and column arguments
+                }
+                return;
+            }
+            case ReductionEnum::COUNT_NONZERO:
+            {
+                index.assign(count, 0);
+                for (int64_t i = 0; i < numRows; ++i)
+                {
+                    const float* row = rows[i] + start;
+                    for (int64_t j = 0; j < count; ++j) if (row[j] != 0.0f) ++index[j];
+                }
+                for (int64_t j = 0; j < count; ++j) out[start + j] = index[j];
+                return;
+            }
+            default:
+                CaretAssertMessage(0, "non-accumulator reduction given to accumulateColumns");
+        }
+    }
+    
+    const int64_t COLUMN_CHUNK = 1024;//columns per accumulator block, small enough to stay in cache
+}
+
+void ReductionOperation::reduceRows(const float* data, const int64_t& numArrays, const int64_t& numElems, const int64_t& stride, const ReductionEnum::Enum& type, float* out,
+                                    const bool& onlyNumeric)
+{
+    CaretAssert(numElems > 0);
+    ThreadedErrorHolder myError;
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < numArrays; ++i)
+    {
+        if (myError.failed()) continue;
+        try
+        {
+            if (onlyNumeric)
+            {
+                out[i] = reduceOnlyNumeric(data + i * stride, numElems, type);
+            } else {
+                out[i] = reduce(data + i * stride, numElems, type);
+            }
+        } catch (CaretException& e) {
+            myError.setError(e.whatString());
+        }
+    }
+    myError.throwIfFailed();
+}
+
+void ReductionOperation::reduceRowsExcludeDev(const float* data, const int64_t& numArrays, const int64_t& numElems, const int64_t& stride, const ReductionEnum::Enum& type,
+                                              const float& numDevBelow, const float& numDevAbove, float* out)
+{
+    CaretAssert(numElems > 0);
+    ThreadedErrorHolder myError;
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < numArrays; ++i)
+    {
+        if (myError.failed()) continue;
+        try
+        {
+            out[i] = reduceExcludeDev(data + i * stride, numElems, type, numDevBelow, numDevAbove);
+        } catch (CaretException& e) {
+            myError.setError(e.whatString());
+        }
+    }
+    myError.throwIfFailed();
+}
+
+void ReductionOperation::reduceColumns(const float* const* rows, const int64_t& numRows, const int64_t& rowLength, const ReductionEnum::Enum& type, float* out,
+                                       const bool& onlyNumeric)
+{
+    CaretAssert(numRows > 0);
+    if (type == ReductionEnum::INVALID) throw CaretException("reduction requested with 'INVALID' method");
+    if (!onlyNumeric && isAccumulatorReduction(type))
+    {
+        if (numRows < 2 && (type == ReductionEnum::SAMPSTDEV || type == ReductionEnum::TSNR || type == ReductionEnum::COV))
+        {
+            throw CaretException("taking the sample standard deviation of 1 element would require dividing by zero");
+        }
+        int64_t numChunks = (rowLength + COLUMN_CHUNK - 1) / COLUMN_CHUNK;
+#pragma omp CARET_PAR
+        {
+            vector<double> accum;
+            vector<float> extra;
+            vector<int64_t> index;
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t chunk = 0; chunk < numChunks; ++chunk)
+            {
+                int64_t start = chunk * COLUMN_CHUNK;
+                accumulateColumns(rows, numRows, start, min(start + COLUMN_CHUNK, rowLength), type, out, accum, extra, index);
+            }
+        }
+        return;
+    }//median, mode, and anything that drops values needs the whole column, so gather each one into contiguous scratch
+    ThreadedErrorHolder myError;
+#pragma omp CARET_PAR
+    {
+        vector<float> scratch(numRows);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t j = 0; j < rowLength; ++j)
+        {
+            if (myError.failed()) continue;
+            for (int64_t i = 0; i < numRows; ++i) scratch[i] = rows[i][j];
+            try
+            {
+                if (onlyNumeric)
+                {
+                    out[j] = reduceOnlyNumeric(&scratch[0], numRows, type);
+                } else {
+                    out[j] = reduce(&scratch[0], numRows, type);
+                }
+            } catch (CaretException& e) {
+                myError.setError(e.whatString());
+            }
+        }
+    }
+    myError.throwIfFailed();
+}
+
+void ReductionOperation::reduceColumnsExcludeDev(const float* const* rows, const int64_t& numRows, const int64_t& rowLength, const ReductionEnum::Enum& type,
+                                                 const float& numDevBelow, const float& numDevAbove, float* out)
+{
+    CaretAssert(numRows > 0);
+    ThreadedErrorHolder myError;
+#pragma omp CARET_PAR
+    {
+        vector<float> scratch(numRows);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t j = 0; j < rowLength; ++j)
+        {
+            if (myError.failed()) continue;
+            for (int64_t i = 0; i < numRows; ++i) scratch[i] = rows[i][j];
+            try
+            {
+                out[j] = reduceExcludeDev(&scratch[0], numRows, type, numDevBelow, numDevAbove);
+            } catch (CaretException& e) {
+                myError.setError(e.whatString());
+            }
+        }
+    }
+    myError.throwIfFailed();
+}
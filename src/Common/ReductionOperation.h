@@ -37,6 +37,16 @@ namespace caret {
         static float reduceWeighted(const float* data, const float* weights, const int64_t& numElems, const ReductionEnum::Enum& type);
         static float reduceWeightedExcludeDev(const float* data, const float* weights, const int64_t& numElems, const ReductionEnum::Enum& type, const float& numDevBelow, const float& numDevAbove);
         static float reduceWeightedOnlyNumeric(const float* data, const float* weights, const int64_t& numElems, const ReductionEnum::Enum& type);
+        ///block versions, use threads - reduce each of numArrays contiguous arrays, starting stride apart: out[i] = reduce(data + i * stride)
+        static void reduceRows(const float* data, const int64_t& numArrays, const int64_t& numElems, const int64_t& stride, const ReductionEnum::Enum& type, float* out,
+                               const bool& onlyNumeric = false);
+        static void reduceRowsExcludeDev(const float* data, const int64_t& numArrays, const int64_t& numElems, const int64_t& stride, const ReductionEnum::Enum& type,
+                                         const float& numDevBelow, const float& numDevAbove, float* out);
+        ///reduce across arrays: out[j] = reduction of rows[0][j], rows[1][j], ..., rows[numRows - 1][j], without transposing for sum/mean/stdev/min/max style reductions
+        static void reduceColumns(const float* const* rows, const int64_t& numRows, const int64_t& rowLength, const ReductionEnum::Enum& type, float* out,
+                                  const bool& onlyNumeric = false);
+        static void reduceColumnsExcludeDev(const float* const* rows, const int64_t& numRows, const int64_t& rowLength, const ReductionEnum::Enum& type,
+                                            const float& numDevBelow, const float& numDevAbove, float* out);
         static AString getHelpInfo();
     };
     
@@ -0,0 +1,383 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SIMDConversion.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef CARET_SIMD_AVX2
+extern "C"
+{
+#include "cpuinfo.h"
+}
+#endif
+
+#include <cstring>
+
+using namespace caret;
+
+namespace
+{
+    template<typename T>
+    inline T swappedCopy(const T& in)
+    {
+        T ret;
+        const char* from = (const char*)&in;
+        char* to = (char*)&ret;
+        for (int i = 0; i < (int)sizeof(T); ++i)
+        {
+            to[i] = from[sizeof(T) - i - 1];
+        }
+        return ret;
+    }
+
+    template<typename T>
+    void swapScalar(void* data, const int64_t& count)
+    {
+        T* typed = (T*)data;
+        for (int64_t i = 0; i < count; ++i)
+        {
+            typed[i] = swappedCopy(typed[i]);
+        }
+    }
+
+    template<typename T>
+    void toFloatScalar(float* out, const T* in, const int64_t& count, const bool& swap, const bool& doScale, const double& mult, const double& offset)
+    {
+        for (int64_t i = 0; i < count; ++i)
+        {
+            T value = swap ? swappedCopy(in[i]) : in[i];
+            out[i] = doScale ? (float)(offset + mult * (double)value) : (float)value;
+        }
+    }
+
+    void floatForWriteScalar(float* out, const float* in, const int64_t& count, const bool& swap, const bool& doScale, const double& mult, const double& offset)
+    {
+        for (int64_t i = 0; i < count; ++i)
+        {
+            float value = doScale ? (float)(((double)in[i] - offset) / mult) : in[i];
+            out[i] = swap ? swappedCopy(value) : value;
+        }
+    }
+
+#ifdef __SSE2__
+    //SSE2 is part of x86_64, so these need no runtime check
+    inline __m128i bswap16SSE2(const __m128i& v)
+    {
+        return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    }
+
+    inline __m128i bswap32SSE2(const __m128i& v)
+    {
+        __m128i temp = bswap16SSE2(v);
+        temp = _mm_shufflelo_epi16(temp, _MM_SHUFFLE(2, 3, 0, 1));
+        return _mm_shufflehi_epi16(temp, _MM_SHUFFLE(2, 3, 0, 1));
+    }
+
+    inline __m128i bswap64SSE2(const __m128i& v)
+    {
+        __m128i temp = bswap16SSE2(v);
+        temp = _mm_shufflelo_epi16(temp, _MM_SHUFFLE(0, 1, 2, 3));
+        return _mm_shufflehi_epi16(temp, _MM_SHUFFLE(0, 1, 2, 3));
+    }
+
+    //4 int32 to 4 floats, through double when scaling, to match the scalar expression
+    inline __m128 scaleToFloatSSE2(const __m128i& v, const bool& doScale, const __m128d& multVec, const __m128d& offsetVec)
+    {
+        if (!doScale) return _mm_cvtepi32_ps(v);
+        __m128d lo = _mm_add_pd(offsetVec, _mm_mul_pd(multVec, _mm_cvtepi32_pd(v)));
+        __m128d hi = _mm_add_pd(offsetVec, _mm_mul_pd(multVec, _mm_cvtepi32_pd(_mm_srli_si128(v, 8))));
+        return _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+    }
+
+    int64_t swap16SSE2(void* data, const int64_t count)
+    {
+        int64_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i* ptr = (__m128i*)((int16_t*)data + i);
+            _mm_storeu_si128(ptr, bswap16SSE2(_mm_loadu_si128(ptr)));
+        }
+        return i;
+    }
+
+    int64_t swap32SSE2(void* data, const int64_t count)
+    {
+        int64_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i* ptr = (__m128i*)((int32_t*)data + i);
+            _mm_storeu_si128(ptr, bswap32SSE2(_mm_loadu_si128(ptr)));
+        }
+        return i;
+    }
+
+    int64_t swap64SSE2(void* data, const int64_t count)
+    {
+        int64_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            __m128i* ptr = (__m128i*)((int64_t*)data + i);
+            _mm_storeu_si128(ptr, bswap64SSE2(_mm_loadu_si128(ptr)));
+        }
+        return i;
+    }
+
+    int64_t uint8ToFloatSSE2(float* out, const uint8_t* in, const int64_t count, const bool doScale, const double mult, const double offset)
+    {
+        const __m128d multVec = _mm_set1_pd(mult), offsetVec = _mm_set1_pd(offset);
+        const __m128i zero = _mm_setzero_si128();
+        int64_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i bytes = _mm_loadu_si128((const __m128i*)(in + i));
+            __m128i words[2] = { _mm_unpacklo_epi8(bytes, zero), _mm_unpackhi_epi8(bytes, zero) };
+            for (int j = 0; j < 2; ++j)
+            {
+                _mm_storeu_ps(out + i + j * 8, scaleToFloatSSE2(_mm_unpacklo_epi16(words[j], zero), doScale, multVec, offsetVec));
+                _mm_storeu_ps(out + i + j * 8 + 4, scaleToFloatSSE2(_mm_unpackhi_epi16(words[j], zero), doScale, multVec, offsetVec));
+            }
+        }
+        return i;
+    }
+
+    int64_t int16ToFloatSSE2(float* out, const int16_t* in, const int64_t count, const bool swap, const bool doScale, const double mult, const double offset)
+    {
+        const __m128d multVec = _mm_set1_pd(mult), offsetVec = _mm_set1_pd(offset);
+        int64_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i words = _mm_loadu_si128((const __m128i*)(in + i));
+            if (swap) words = bswap16SSE2(words);
+            __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16);//sign extend
+            __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(words, words), 16);
+            _mm_storeu_ps(out + i, scaleToFloatSSE2(lo, doScale, multVec, offsetVec));
+            _mm_storeu_ps(out + i + 4, scaleToFloatSSE2(hi, doScale, multVec, offsetVec));
+        }
+        return i;
+    }
+
+    int64_t uint16ToFloatSSE2(float* out, const uint16_t* in, const int64_t count, const bool swap, const bool doScale, const double mult, const double offset)
+    {
+        const __m128d multVec = _mm_set1_pd(mult), offsetVec = _mm_set1_pd(offset);
+        const __m128i zero = _mm_setzero_si128();
+        int64_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i words = _mm_loadu_si128((const __m128i*)(in + i));
+            if (swap) words = bswap16SSE2(words);
+            _mm_storeu_ps(out + i, scaleToFloatSSE2(_mm_unpacklo_epi16(words, zero), doScale, multVec, offsetVec));
+            _mm_storeu_ps(out + i + 4, scaleToFloatSSE2(_mm_unpackhi_epi16(words, zero), doScale, multVec, offsetVec));
+        }
+        return i;
+    }
+
+    int64_t floatToFloatSSE2(float* out, const float* in, const int64_t count, const bool swap, const bool doScale, const double mult, const double offset)
+    {
+        const __m128d multVec = _mm_set1_pd(mult), offsetVec = _mm_set1_pd(offset);
+        int64_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i raw = _mm_loadu_si128((const __m128i*)(in + i));
+            if (swap) raw = bswap32SSE2(raw);
+            __m128 values = _mm_castsi128_ps(raw);
+            if (doScale)
+            {
+                __m128d lo = _mm_add_pd(offsetVec, _mm_mul_pd(multVec, _mm_cvtps_pd(values)));
+                __m128d hi = _mm_add_pd(offsetVec, _mm_mul_pd(multVec, _mm_cvtps_pd(_mm_movehl_ps(values, values))));
+                values = _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+            }
+            _mm_storeu_ps(out + i, values);
+        }
+        return i;
+    }
+
+    int64_t doubleToFloatSSE2(float* out, const double* in, const int64_t count, const bool swap, const bool doScale, const double mult, const double offset)
+    {
+        const __m128d multVec = _mm_set1_pd(mult), offsetVec = _mm_set1_pd(offset);
+        int64_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i raw[2] = { _mm_loadu_si128((const __m128i*)(in + i)), _mm_loadu_si128((const __m128i*)(in + i + 2)) };
+            __m128 halves[2];
+            for (int j = 0; j < 2; ++j)
+            {
+                if (swap) raw[j] = bswap64SSE2(raw[j]);
+                __m128d values = _mm_castsi128_pd(raw[j]);
+                if (doScale) values = _mm_add_pd(offsetVec, _mm_mul_pd(multVec, values));
+                halves[j] = _mm_cvtpd_ps(values);
+            }
+            _mm_storeu_ps(out + i, _mm_movelh_ps(halves[0], halves[1]));
+        }
+        return i;
+    }
+
+    int64_t floatToFloatWriteSSE2(float* out, const float* in, const int64_t count, const bool swap, const bool doScale, const double mult, const double offset)
+    {
+        const __m128d multVec = _mm_set1_pd(mult), offsetVec = _mm_set1_pd(offset);
+        int64_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 values = _mm_loadu_ps(in + i);
+            if (doScale)
+            {
+                __m128d lo = _mm_div_pd(_mm_sub_pd(_mm_cvtps_pd(values), offsetVec), multVec);
+                __m128d hi = _mm_div_pd(_mm_sub_pd(_mm_cvtps_pd(_mm_movehl_ps(values, values)), offsetVec), multVec);
+                values = _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+            }
+            __m128i raw = _mm_castps_si128(values);
+            if (swap) raw = bswap32SSE2(raw);
+            _mm_storeu_si128((__m128i*)(out + i), raw);
+        }
+        return i;
+    }
+#endif //__SSE2__
+
+    SIMDConversion::Implementation bestSupported(const SIMDConversion::Implementation& requested)
+    {
+#ifdef CARET_SIMD_AVX2
+        if (requested >= SIMDConversion::AVX2 && hasAVX2()) return SIMDConversion::AVX2;
+#endif
+#ifdef __SSE2__
+        if (requested >= SIMDConversion::SSE2) return SIMDConversion::SSE2;
+#endif
+        return SIMDConversion::SCALAR;
+    }
+
+    SIMDConversion::Implementation& currentImplementation()
+    {
+        static SIMDConversion::Implementation ret = bestSupported(SIMDConversion::AVX2);//function static so that initialization is thread safe
+        return ret;
+    }
+}
+
+SIMDConversion::Implementation SIMDConversion::setImplementation(const Implementation& impl)
+{
+    currentImplementation() = bestSupported(impl);
+    return currentImplementation();
+}
+
+SIMDConversion::Implementation SIMDConversion::getImplementation()
+{
+    return currentImplementation();
+}
+
+const SIMDConversion::Kernels& SIMDConversion::getKernels()
+{
+    struct KernelTable
+    {
+        Kernels m_kernels[3];//indexed by Implementation, NULL means the scalar code does everything
+        KernelTable()
+        {
+            memset(m_kernels, 0, sizeof(m_kernels));
+#ifdef __SSE2__
+            m_kernels[SSE2].swap16 = &swap16SSE2;
+            m_kernels[SSE2].swap32 = &swap32SSE2;
+            m_kernels[SSE2].swap64 = &swap64SSE2;
+            m_kernels[SSE2].uint8ToFloat = &uint8ToFloatSSE2;
+            m_kernels[SSE2].int16ToFloat = &int16ToFloatSSE2;
+            m_kernels[SSE2].uint16ToFloat = &uint16ToFloatSSE2;
+            m_kernels[SSE2].floatToFloat = &floatToFloatSSE2;
+            m_kernels[SSE2].doubleToFloat = &doubleToFloatSSE2;
+            m_kernels[SSE2].floatToFloatWrite = &floatToFloatWriteSSE2;
+#endif
+#ifdef CARET_SIMD_AVX2
+            getAVX2Kernels(m_kernels[AVX2]);
+#endif
+        }
+    };
+    static const KernelTable table;//function static so that initialization is thread safe
+    return table.m_kernels[currentImplementation()];
+}
+
+void SIMDConversion::swap16(void* data, const int64_t& count)
+{
+    const Kernels& myKernels = getKernels();
+    int64_t done = (myKernels.swap16 == NULL ? 0 : myKernels.swap16(data, count));
+    swapScalar<int16_t>((int16_t*)data + done, count - done);
+}
+
+void SIMDConversion::swap32(void* data, const int64_t& count)
+{
+    const Kernels& myKernels = getKernels();
+    int64_t done = (myKernels.swap32 == NULL ? 0 : myKernels.swap32(data, count));
+    swapScalar<int32_t>((int32_t*)data + done, count - done);
+}
+
+void SIMDConversion::swap64(void* data, const int64_t& count)
+{
+    const Kernels& myKernels = getKernels();
+    int64_t done = (myKernels.swap64 == NULL ? 0 : myKernels.swap64(data, count));
+    swapScalar<int64_t>((int64_t*)data + done, count - done);
+}
+
+void SIMDConversion::toFloat(float* out, const uint8_t* in, const int64_t& count, const bool&, const bool& doScale, const double& mult, const double& offset)
+{//nothing to swap in single bytes
+    const Kernels& myKernels = getKernels();
+    int64_t done = (myKernels.uint8ToFloat == NULL ? 0 : myKernels.uint8ToFloat(out, in, count, doScale, mult, offset));
+    toFloatScalar(out + done, in + done, count - done, false, doScale, mult, offset);
+}
+
+void SIMDConversion::toFloat(float* out, const int16_t* in, const int64_t& count, const bool& swap, const bool& doScale, const double& mult, const double& offset)
+{
+    const Kernels& myKernels = getKernels();
+    int64_t done = (myKernels.int16ToFloat == NULL ? 0 : myKernels.int16ToFloat(out, in, count, swap, doScale, mult, offset));
+    toFloatScalar(out + done, in + done, count - done, swap, doScale, mult, offset);
+}
+
+void SIMDConversion::toFloat(float* out, const uint16_t* in, const int64_t& count, const bool& swap, const bool& doScale, const double& mult, const double& offset)
+{
+    const Kernels& myKernels = getKernels();
+    int64_t done = (myKernels.uint16ToFloat == NULL ? 0 : myKernels.uint16ToFloat(out, in, count, swap, doScale, mult, offset));
+    toFloatScalar(out + done, in + done, count - done, swap, doScale, mult, offset);
+}
+
+void SIMDConversion::toFloat(float* out, const float* in, const int64_t& count, const bool& swap, const bool& doScale, const double& mult, const double& offset)
+{
+    if (!swap && !doScale)
+    {
+        if (out != in) memmove(out, in, count * sizeof(float));
+        return;
+    }
+    const Kernels& myKernels = getKernels();
+    int64_t done = (myKernels.floatToFloat == NULL ? 0 : myKernels.floatToFloat(out, in, count, swap, doScale, mult, offset));
+    toFloatScalar(out + done, in + done, count - done, swap, doScale, mult, offset);
+}
+
+void SIMDConversion::toFloat(float* out, const double* in, const int64_t& count, const bool& swap, const bool& doScale, const double& mult, const double& offset)
+{
+    const Kernels& myKernels = getKernels();
+    int64_t done = (myKernels.doubleToFloat == NULL ? 0 : myKernels.doubleToFloat(out, in, count, swap, doScale, mult, offset));
+    toFloatScalar(out + done, in + done, count - done, swap, doScale, mult, offset);
+}
+
+void SIMDConversion::floatForWrite(float* out, const float* in, const int64_t& count, const bool& swap, const bool& doScale, const double& mult, const double& offset)
+{
+    if (!swap && !doScale)
+    {
+        if (out != in) memmove(out, in, count * sizeof(float));
+        return;
+    }
+    const Kernels& myKernels = getKernels();
+    int64_t done = (myKernels.floatToFloatWrite == NULL ? 0 : myKernels.floatToFloatWrite(out, in, count, swap, doScale, mult, offset));
+    floatForWriteScalar(out + done, in + done, count - done, swap, doScale, mult, offset);
+}
@@ -0,0 +1,78 @@
+#ifndef __SIMD_CONVERSION_H__
+#define __SIMD_CONVERSION_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "stdint.h"
+
+namespace caret
+{
+    ///byte swapping and conversion of file data to and from float, with the SIMD implementation chosen at runtime
+    ///all implementations compute the same expressions, scaling is done in double precision
+    class SIMDConversion
+    {
+    public:
+        enum Implementation
+        {
+            SCALAR = 0,
+            SSE2 = 1,
+            AVX2 = 2
+        };
+        ///vector bodies of the kernels, they return how many elements they did, the scalar code does the rest
+        struct Kernels
+        {
+            int64_t (*swap16)(void* data, const int64_t count);
+            int64_t (*swap32)(void* data, const int64_t count);
+            int64_t (*swap64)(void* data, const int64_t count);
+            int64_t (*uint8ToFloat)(float* out, const uint8_t* in, const int64_t count, const bool doScale, const double mult, const double offset);
+            int64_t (*int16ToFloat)(float* out, const int16_t* in, const int64_t count, const bool swap, const bool doScale, const double mult, const double offset);
+            int64_t (*uint16ToFloat)(float* out, const uint16_t* in, const int64_t count, const bool swap, const bool doScale, const double mult, const double offset);
+            int64_t (*floatToFloat)(float* out, const float* in, const int64_t count, const bool swap, const bool doScale, const double mult, const double offset);
+            int64_t (*doubleToFloat)(float* out, const double* in, const int64_t count, const bool swap, const bool doScale, const double mult, const double offset);
+            int64_t (*floatToFloatWrite)(float* out, const float* in, const int64_t count, const bool swap, const bool doScale, const double mult, const double offset);
+        };
+    private:
+        SIMDConversion();
+        static const Kernels& getKernels();
+        static void getAVX2Kernels(Kernels& kernelsOut);//in SIMDConversionAVX2.cxx, only built when the compiler can target AVX2
+    public:
+        ///returns the implementation actually selected, which is the next best one if the request isn't supported by the cpu or build
+        static Implementation setImplementation(const Implementation& impl);
+        static Implementation getImplementation();
+
+        //in place byte swapping of 2, 4 and 8 byte elements
+        static void swap16(void* data, const int64_t& count);
+        static void swap32(void* data, const int64_t& count);
+        static void swap64(void* data, const int64_t& count);
+
+        //for reading: swap the input bytes if requested (the input is not modified), then out = offset + mult * in if doScale, else out = in
+        static void toFloat(float* out, const uint8_t* in, const int64_t& count, const bool& swap, const bool& doScale, const double& mult, const double& offset);
+        static void toFloat(float* out, const int16_t* in, const int64_t& count, const bool& swap, const bool& doScale, const double& mult, const double& offset);
+        static void toFloat(float* out, const uint16_t* in, const int64_t& count, const bool& swap, const bool& doScale, const double& mult, const double& offset);
+        static void toFloat(float* out, const float* in, const int64_t& count, const bool& swap, const bool& doScale, const double& mult, const double& offset);
+        static void toFloat(float* out, const double* in, const int64_t& count, const bool& swap, const bool& doScale, const double& mult, const double& offset);
+
+        ///for writing float data: out = (in - offset) / mult if doScale, else out = in, then swap the output bytes if requested
+        static void floatForWrite(float* out, const float* in, const int64_t& count, const bool& swap, const bool& doScale, const double& mult, const double& offset);
+    };
+}
+
+#endif //__SIMD_CONVERSION_H__
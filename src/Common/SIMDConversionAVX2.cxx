@@ -0,0 +1,199 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+//this file is compiled with -mavx2, so nothing in it may run before the cpu check in SIMDConversion.cxx
+
+#include "SIMDConversion.h"
+
+#ifdef CARET_SIMD_AVX2
+
+#include <immintrin.h>
+
+using namespace caret;
+
+namespace
+{
+    inline __m256i bswapMask16()
+    {
+        return _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    }
+
+    inline __m256i bswapMask32()
+    {
+        return _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    }
+
+    inline __m256i bswapMask64()
+    {
+        return _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    }
+
+    //8 int32 to 8 floats, through double when scaling, to match the scalar expression
+    inline __m256 scaleToFloatAVX2(const __m256i& v, const bool& doScale, const __m256d& multVec, const __m256d& offsetVec)
+    {
+        if (!doScale) return _mm256_cvtepi32_ps(v);
+        __m256d lo = _mm256_add_pd(offsetVec, _mm256_mul_pd(multVec, _mm256_cvtepi32_pd(_mm256_castsi256_si128(v))));
+        __m256d hi = _mm256_add_pd(offsetVec, _mm256_mul_pd(multVec, _mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1))));
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)), _mm256_cvtpd_ps(hi), 1);
+    }
+
+    int64_t swapAVX2(void* data, const int64_t count, const int elemSize, const __m256i& mask)
+    {
+        const int64_t perVec = 32 / elemSize;
+        int64_t i = 0;
+        for (; i + perVec <= count; i += perVec)
+        {
+            __m256i* ptr = (__m256i*)((char*)data + i * elemSize);
+            _mm256_storeu_si256(ptr, _mm256_shuffle_epi8(_mm256_loadu_si256(ptr), mask));
+        }
+        return i;
+    }
+
+    int64_t swap16AVX2(void* data, const int64_t count)
+    {
+        return swapAVX2(data, count, 2, bswapMask16());
+    }
+
+    int64_t swap32AVX2(void* data, const int64_t count)
+    {
+        return swapAVX2(data, count, 4, bswapMask32());
+    }
+
+    int64_t swap64AVX2(void* data, const int64_t count)
+    {
+        return swapAVX2(data, count, 8, bswapMask64());
+    }
+
+    int64_t uint8ToFloatAVX2(float* out, const uint8_t* in, const int64_t count, const bool doScale, const double mult, const double offset)
+    {
+        const __m256d multVec = _mm256_set1_pd(mult), offsetVec = _mm256_set1_pd(offset);
+        int64_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i values = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(in + i)));
+            _mm256_storeu_ps(out + i, scaleToFloatAVX2(values, doScale, multVec, offsetVec));
+        }
+        return i;
+    }
+
+    int64_t int16ToFloatAVX2(float* out, const int16_t* in, const int64_t count, const bool swap, const bool doScale, const double mult, const double offset)
+    {
+        const __m256d multVec = _mm256_set1_pd(mult), offsetVec = _mm256_set1_pd(offset);
+        const __m128i mask = _mm256_castsi256_si128(bswapMask16());
+        int64_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i words = _mm_loadu_si128((const __m128i*)(in + i));
+            if (swap) words = _mm_shuffle_epi8(words, mask);
+            _mm256_storeu_ps(out + i, scaleToFloatAVX2(_mm256_cvtepi16_epi32(words), doScale, multVec, offsetVec));
+        }
+        return i;
+    }
+
+    int64_t uint16ToFloatAVX2(float* out, const uint16_t* in, const int64_t count, const bool swap, const bool doScale, const double mult, const double offset)
+    {
+        const __m256d multVec = _mm256_set1_pd(mult), offsetVec = _mm256_set1_pd(offset);
+        const __m128i mask = _mm256_castsi256_si128(bswapMask16());
+        int64_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i words = _mm_loadu_si128((const __m128i*)(in + i));
+            if (swap) words = _mm_shuffle_epi8(words, mask);
+            _mm256_storeu_ps(out + i, scaleToFloatAVX2(_mm256_cvtepu16_epi32(words), doScale, multVec, offsetVec));
+        }
+        return i;
+    }
+
+    int64_t floatToFloatAVX2(float* out, const float* in, const int64_t count, const bool swap, const bool doScale, const double mult, const double offset)
+    {
+        const __m256d multVec = _mm256_set1_pd(mult), offsetVec = _mm256_set1_pd(offset);
+        const __m256i mask = bswapMask32();
+        int64_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i raw = _mm256_loadu_si256((const __m256i*)(in + i));
+            if (swap) raw = _mm256_shuffle_epi8(raw, mask);
+            __m256 values = _mm256_castsi256_ps(raw);
+            if (doScale)
+            {
+                __m256d lo = _mm256_add_pd(offsetVec, _mm256_mul_pd(multVec, _mm256_cvtps_pd(_mm256_castps256_ps128(values))));
+                __m256d hi = _mm256_add_pd(offsetVec, _mm256_mul_pd(multVec, _mm256_cvtps_pd(_mm256_extractf128_ps(values, 1))));
+                values = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)), _mm256_cvtpd_ps(hi), 1);
+            }
+            _mm256_storeu_ps(out + i, values);
+        }
+        return i;
+    }
+
+    int64_t doubleToFloatAVX2(float* out, const double* in, const int64_t count, const bool swap, const bool doScale, const double mult, const double offset)
+    {
+        const __m256d multVec = _mm256_set1_pd(mult), offsetVec = _mm256_set1_pd(offset);
+        const __m256i mask = bswapMask64();
+        int64_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m256i raw = _mm256_loadu_si256((const __m256i*)(in + i));
+            if (swap) raw = _mm256_shuffle_epi8(raw, mask);
+            __m256d values = _mm256_castsi256_pd(raw);
+            if (doScale) values = _mm256_add_pd(offsetVec, _mm256_mul_pd(multVec, values));
+            _mm_storeu_ps(out + i, _mm256_cvtpd_ps(values));
+        }
+        return i;
+    }
+
+    int64_t floatToFloatWriteAVX2(float* out, const float* in, const int64_t count, const bool swap, const bool doScale, const double mult, const double offset)
+    {
+        const __m256d multVec = _mm256_set1_pd(mult), offsetVec = _mm256_set1_pd(offset);
+        const __m256i mask = bswapMask32();
+        int64_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 values = _mm256_loadu_ps(in + i);
+            if (doScale)
+            {
+                __m256d lo = _mm256_div_pd(_mm256_sub_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(values)), offsetVec), multVec);
+                __m256d hi = _mm256_div_pd(_mm256_sub_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(values, 1)), offsetVec), multVec);
+                values = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)), _mm256_cvtpd_ps(hi), 1);
+            }
+            __m256i raw = _mm256_castps_si256(values);
+            if (swap) raw = _mm256_shuffle_epi8(raw, mask);
+            _mm256_storeu_si256((__m256i*)(out + i), raw);
+        }
+        return i;
+    }
+}
+
+void SIMDConversion::getAVX2Kernels(Kernels& kernelsOut)
+{//only takes addresses, doesn't execute any AVX2 instructions
+    kernelsOut.swap16 = &swap16AVX2;
+    kernelsOut.swap32 = &swap32AVX2;
+    kernelsOut.swap64 = &swap64AVX2;
+    kernelsOut.uint8ToFloat = &uint8ToFloatAVX2;
+    kernelsOut.int16ToFloat = &int16ToFloatAVX2;
+    kernelsOut.uint16ToFloat = &uint16ToFloatAVX2;
+    kernelsOut.floatToFloat = &floatToFloatAVX2;
+    kernelsOut.doubleToFloat = &doubleToFloatAVX2;
+    kernelsOut.floatToFloatWrite = &floatToFloatWriteAVX2;
+}
+
+#endif //CARET_SIMD_AVX2
@@ -0,0 +1,440 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretCompressedSparseFile.h"
+
+#include "ByteOrderEnum.h"
+#include "ByteSwapping.h"
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+
+#include <QByteArray>
+#include "zlib.h"
+
+#include <cstring>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    const char compressedMagic[] = "\0\0\0\0csz\0";
+    const int64_t HEADER_SIZE = 8 + 5 * sizeof(int64_t);//magic, dims[2], value type, row table offset, xml offset
+    const int64_t ROW_ENTRY_SIZE = 4 * sizeof(int64_t);
+
+    int64_t valueSizeForType(const CaretCompressedSparseFile::ValueType& type)
+    {
+        switch (type)
+        {
+            case CaretCompressedSparseFile::INT64:
+                return sizeof(int64_t);
+            case CaretCompressedSparseFile::FLOAT32:
+                return sizeof(float);
+        }
+        CaretAssert(false);
+        return 0;
+    }
+
+    void appendVarint(vector<char>& out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back((char)((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back((char)value);
+    }
+
+    bool readVarint(const uchar*& pos, const uchar* end, uint64_t& valueOut)
+    {
+        valueOut = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (pos >= end) return false;
+            const uchar thisByte = *pos;
+            ++pos;
+            valueOut |= ((uint64_t)(thisByte & 0x7F)) << shift;
+            if ((thisByte & 0x80) == 0) return true;
+        }
+        return false;
+    }
+
+    int64_t readInt64(const uchar* pos)
+    {
+        int64_t ret;
+        memcpy(&ret, pos, sizeof(int64_t));
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes(&ret, 1);
+        }
+        return ret;
+    }
+
+    template<typename T>
+    void valuesToBytes(const vector<T>& values, vector<char>& bytesOut)
+    {
+        bytesOut.resize(values.size() * sizeof(T));
+        if (values.empty()) return;
+        memcpy(bytesOut.data(), values.data(), bytesOut.size());
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes((T*)bytesOut.data(), values.size());
+        }
+    }
+
+    template<typename T>
+    void bytesToValues(const vector<char>& bytes, vector<T>& valuesOut)
+    {
+        valuesOut.resize(bytes.size() / sizeof(T));
+        if (valuesOut.empty()) return;
+        memcpy(valuesOut.data(), bytes.data(), valuesOut.size() * sizeof(T));
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes(valuesOut.data(), valuesOut.size());
+        }
+    }
+}
+
+bool CaretCompressedSparseFile::isCompressedSparseMagic(const char firstBytes[8])
+{
+    return memcmp(firstBytes, compressedMagic, 8) == 0;
+}
+
+CaretCompressedSparseFile::CaretCompressedSparseFile(const AString& fileName)
+{
+    m_mapped = NULL;
+    readFile(fileName);
+}
+
+void CaretCompressedSparseFile::readFile(const AString& filename)
+{
+    close();
+    if (filename.endsWith(".gz"))
+    {
+        throw DataFileException("compressed sparse files are already compressed internally, and cannot be read while gzipped");
+    }
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        throw DataFileException("failed to open file '" + filename + "' for reading");
+    }
+    const int64_t fileSize = m_file.size();
+    if (fileSize < HEADER_SIZE) throw DataFileException("file '" + filename + "' is truncated");
+    m_mapped = m_file.map(0, fileSize);//row reads become memcpy/inflate from the page cache, with no seeks or per-row read calls
+    if (m_mapped == NULL) throw DataFileException("failed to memory map file '" + filename + "'");
+    if (!isCompressedSparseMagic((const char*)m_mapped)) throw DataFileException("file has the wrong magic string");
+    m_dims[0] = readInt64(m_mapped + 8);
+    m_dims[1] = readInt64(m_mapped + 16);
+    const int64_t valueType = readInt64(m_mapped + 24);
+    const int64_t tableOffset = readInt64(m_mapped + 32);
+    const int64_t xmlOffset = readInt64(m_mapped + 40);
+    if (m_dims[0] < 1 || m_dims[1] < 1) throw DataFileException("both dimensions must be positive");
+    if (valueType != INT64 && valueType != FLOAT32) throw DataFileException("unknown value type in compressed sparse file");
+    m_valueType = (ValueType)valueType;
+    if (tableOffset == 0) throw DataFileException("file '" + filename + "' was not finished being written");
+    if (tableOffset < HEADER_SIZE || m_dims[1] > (fileSize - tableOffset) / ROW_ENTRY_SIZE ||
+        xmlOffset != tableOffset + m_dims[1] * ROW_ENTRY_SIZE || xmlOffset >= fileSize)
+    {
+        throw DataFileException("file '" + filename + "' is truncated or has an invalid row table");
+    }
+    const int64_t valueSize = valueSizeForType(m_valueType);
+    m_rowTable.resize(m_dims[1]);
+    for (int64_t i = 0; i < m_dims[1]; ++i)
+    {
+        const uchar* entryPos = m_mapped + tableOffset + i * ROW_ENTRY_SIZE;
+        RowEntry& thisEntry = m_rowTable[i];
+        thisEntry.m_offset = readInt64(entryPos);
+        thisEntry.m_storedBytes = readInt64(entryPos + 8);
+        thisEntry.m_rawBytes = readInt64(entryPos + 16);
+        thisEntry.m_numNonzero = readInt64(entryPos + 24);
+        if (thisEntry.m_numNonzero < 0 || thisEntry.m_numNonzero > m_dims[0] ||
+            thisEntry.m_storedBytes < 0 || thisEntry.m_storedBytes > thisEntry.m_rawBytes ||
+            thisEntry.m_rawBytes < thisEntry.m_numNonzero * (valueSize + 1) ||
+            (thisEntry.m_numNonzero > 0 && (thisEntry.m_offset < HEADER_SIZE || thisEntry.m_offset > tableOffset - thisEntry.m_storedBytes)))
+        {
+            throw DataFileException("impossible value found in row table");
+        }
+    }
+    QByteArray myXMLBytes((const char*)(m_mapped + xmlOffset), fileSize - xmlOffset);
+    m_xml.readXML(myXMLBytes);
+    if (m_xml.getDimensionLength(CiftiXML::ALONG_ROW) != m_dims[0] || m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN) != m_dims[1])
+    {
+        throw DataFileException("cifti XML doesn't match dimensions of sparse file");
+    }
+}
+
+void CaretCompressedSparseFile::close()
+{
+    if (m_mapped != NULL)
+    {
+        m_file.unmap(m_mapped);
+        m_mapped = NULL;
+    }
+    m_file.close();
+    m_rowTable.clear();
+}
+
+CaretCompressedSparseFile::~CaretCompressedSparseFile()
+{
+    close();
+}
+
+int64_t CaretCompressedSparseFile::getRowNonzeroCount(const int64_t& index) const
+{
+    CaretAssert(index >= 0 && index < m_dims[1]);
+    return m_rowTable[index].m_numNonzero;
+}
+
+void CaretCompressedSparseFile::decodeRow(const int64_t& index, vector<int64_t>& indicesOut, vector<char>& valueBytesOut) const
+{
+    CaretAssert(m_mapped != NULL);
+    CaretAssert(index >= 0 && index < m_dims[1]);
+    const RowEntry& thisEntry = m_rowTable[index];
+    indicesOut.resize(thisEntry.m_numNonzero);
+    if (thisEntry.m_numNonzero == 0)
+    {
+        valueBytesOut.clear();
+        return;
+    }
+    const uchar* rawData = m_mapped + thisEntry.m_offset;
+    vector<char> inflated;
+    if (thisEntry.m_storedBytes != thisEntry.m_rawBytes)
+    {
+        inflated.resize(thisEntry.m_rawBytes);
+        uLongf inflatedSize = (uLongf)thisEntry.m_rawBytes;
+        if (uncompress((Bytef*)inflated.data(), &inflatedSize, (const Bytef*)rawData, (uLong)thisEntry.m_storedBytes) != Z_OK ||
+            (int64_t)inflatedSize != thisEntry.m_rawBytes)
+        {
+            throw DataFileException("failed to decompress row " + AString::number(index) + " of sparse file");
+        }
+        rawData = (const uchar*)inflated.data();
+    }
+    const uchar* pos = rawData, *end = rawData + thisEntry.m_rawBytes;
+    int64_t lastIndex = -1;
+    for (int64_t i = 0; i < thisEntry.m_numNonzero; ++i)
+    {
+        uint64_t delta;
+        if (!readVarint(pos, end, delta) || delta >= (uint64_t)(m_dims[0] - lastIndex - 1))
+        {
+            throw DataFileException("impossible index value found in file");
+        }
+        lastIndex += (int64_t)delta + 1;//deltas are stored minus one, since indices are strictly increasing
+        indicesOut[i] = lastIndex;
+    }
+    const int64_t valueBytes = thisEntry.m_numNonzero * valueSizeForType(m_valueType);
+    if (end - pos != valueBytes) throw DataFileException("row " + AString::number(index) + " of sparse file has the wrong length");
+    valueBytesOut.assign((const char*)pos, (const char*)end);
+}
+
+void CaretCompressedSparseFile::getRowSparse(const int64_t& index, vector<int64_t>& indicesOut, vector<int64_t>& valuesOut) const
+{
+    if (m_valueType != INT64) throw DataFileException("sparse file does not contain integer values");
+    vector<char> valueBytes;
+    decodeRow(index, indicesOut, valueBytes);
+    bytesToValues(valueBytes, valuesOut);
+}
+
+void CaretCompressedSparseFile::getRowSparse(const int64_t& index, vector<int64_t>& indicesOut, vector<float>& valuesOut) const
+{
+    if (m_valueType != FLOAT32) throw DataFileException("sparse file does not contain floating point values");
+    vector<char> valueBytes;
+    decodeRow(index, indicesOut, valueBytes);
+    bytesToValues(valueBytes, valuesOut);
+}
+
+void CaretCompressedSparseFile::getRow(const int64_t& index, int64_t* rowOut) const
+{
+    vector<int64_t> indices, values;
+    getRowSparse(index, indices, values);
+    for (int64_t i = 0; i < m_dims[0]; ++i)
+    {
+        rowOut[i] = 0;
+    }
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        rowOut[indices[i]] = values[i];
+    }
+}
+
+void CaretCompressedSparseFile::getRow(const int64_t& index, float* rowOut) const
+{
+    vector<int64_t> indices;
+    vector<float> values;
+    getRowSparse(index, indices, values);
+    for (int64_t i = 0; i < m_dims[0]; ++i)
+    {
+        rowOut[i] = 0.0f;
+    }
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        rowOut[indices[i]] = values[i];
+    }
+}
+
+void CaretCompressedSparseFile::getFibersRowSparse(const int64_t& index, vector<int64_t>& indicesOut, vector<FiberFractions>& valuesOut) const
+{
+    vector<int64_t> coded;
+    getRowSparse(index, indicesOut, coded);
+    size_t numNonzero = coded.size();
+    valuesOut.resize(numNonzero);
+    for (size_t i = 0; i < numNonzero; ++i)
+    {
+        CaretSparseFile::decodeFibers((uint64_t)coded[i], valuesOut[i]);
+    }
+}
+
+CaretCompressedSparseFileWriter::CaretCompressedSparseFileWriter(const AString& fileName, const CiftiXML& xml, const CaretCompressedSparseFile::ValueType& valueType)
+{
+    m_finished = false;
+    m_valueType = valueType;
+    m_dims[0] = xml.getDimensionLength(CiftiXML::ALONG_ROW);
+    m_dims[1] = xml.getDimensionLength(CiftiXML::ALONG_COLUMN);
+    if (m_dims[0] < 1 || m_dims[1] < 1) throw DataFileException("both dimensions must be positive");
+    m_xml = xml;
+    if (fileName.endsWith(".gz"))
+    {
+        throw DataFileException("compressed sparse files are already compressed internally, and cannot be written gzipped");
+    }//also, the header and row table are written after the data
+    m_file.open(fileName, CaretBinaryFile::WRITE_TRUNCATE);
+    int64_t header[5] = { m_dims[0], m_dims[1], (int64_t)m_valueType, 0, 0 };//zero offsets mark an unfinished file
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(header, 5);
+    }
+    m_file.write(compressedMagic, 8);
+    m_file.write(header, 5 * sizeof(int64_t));
+    m_nextOffset = HEADER_SIZE;
+    CaretCompressedSparseFile::RowEntry emptyEntry = { 0, 0, 0, 0 };
+    m_rowTable.resize(m_dims[1], emptyEntry);
+    m_rowWritten.resize(m_dims[1], false);
+}
+
+void CaretCompressedSparseFileWriter::writeEncodedRow(const int64_t& index, const vector<int64_t>& indices, const char* valueBytes, const int64_t& valueSize)
+{
+    if (index < 0 || index >= m_dims[1]) throw DataFileException("row index " + AString::number(index) + " is out of range for sparse file");
+    const int64_t numNonzero = (int64_t)indices.size();
+    vector<char> rawBlock;//encode and compress outside the lock, so that multiple writing threads only serialize on the file write itself
+    rawBlock.reserve(numNonzero * (valueSize + 2));
+    int64_t lastIndex = -1;
+    for (int64_t i = 0; i < numNonzero; ++i)
+    {
+        if (indices[i] <= lastIndex || indices[i] >= m_dims[0]) throw DataFileException("indices must be sorted when writing sparse rows");
+        appendVarint(rawBlock, (uint64_t)(indices[i] - lastIndex - 1));
+        lastIndex = indices[i];
+    }
+    rawBlock.insert(rawBlock.end(), valueBytes, valueBytes + numNonzero * valueSize);
+    const char* toWrite = rawBlock.data();
+    int64_t storedBytes = (int64_t)rawBlock.size();
+    vector<char> compressed;
+    if (numNonzero > 0)
+    {
+        uLongf compressedSize = compressBound((uLong)rawBlock.size());
+        compressed.resize(compressedSize);
+        //fastest level: the delta-encoded indices are already small, and inflate speed doesn't depend on the level
+        if (compress2((Bytef*)compressed.data(), &compressedSize, (const Bytef*)rawBlock.data(), (uLong)rawBlock.size(), Z_BEST_SPEED) == Z_OK &&
+            (int64_t)compressedSize < storedBytes)
+        {
+            toWrite = compressed.data();
+            storedBytes = (int64_t)compressedSize;
+        }//otherwise store it raw, which the reader detects by stored size == raw size
+    }
+    CaretMutexLocker locked(&m_mutex);
+    if (m_finished) throw DataFileException("cannot write rows to sparse file after finish() has been called");
+    if (m_rowWritten[index]) throw DataFileException("row " + AString::number(index) + " of sparse file was written more than once");
+    m_rowWritten[index] = true;
+    if (numNonzero == 0) return;
+    m_file.write(toWrite, storedBytes);//the file position is always at m_nextOffset, we only append until finish()
+    CaretCompressedSparseFile::RowEntry& thisEntry = m_rowTable[index];
+    thisEntry.m_offset = m_nextOffset;
+    thisEntry.m_storedBytes = storedBytes;
+    thisEntry.m_rawBytes = (int64_t)rawBlock.size();
+    thisEntry.m_numNonzero = numNonzero;
+    m_nextOffset += storedBytes;
+}
+
+void CaretCompressedSparseFileWriter::writeRowSparse(const int64_t& index, const vector<int64_t>& indices, const vector<int64_t>& values)
+{
+    CaretAssert(indices.size() == values.size());
+    if (m_valueType != CaretCompressedSparseFile::INT64) throw DataFileException("sparse file was not created for integer values");
+    vector<char> valueBytes;
+    valuesToBytes(values, valueBytes);
+    writeEncodedRow(index, indices, valueBytes.data(), sizeof(int64_t));
+}
+
+void CaretCompressedSparseFileWriter::writeRowSparse(const int64_t& index, const vector<int64_t>& indices, const vector<float>& values)
+{
+    CaretAssert(indices.size() == values.size());
+    if (m_valueType != CaretCompressedSparseFile::FLOAT32) throw DataFileException("sparse file was not created for floating point values");
+    vector<char> valueBytes;
+    valuesToBytes(values, valueBytes);
+    writeEncodedRow(index, indices, valueBytes.data(), sizeof(float));
+}
+
+void CaretCompressedSparseFileWriter::writeFibersRowSparse(const int64_t& index, const vector<int64_t>& indices, const vector<FiberFractions>& values)
+{
+    size_t numNonzero = values.size();//assume no zeros
+    vector<int64_t> coded(numNonzero);
+    for (size_t i = 0; i < numNonzero; ++i)
+    {
+        CaretSparseFileWriter::encodeFibers(values[i], ((uint64_t*)coded.data())[i]);
+    }
+    writeRowSparse(index, indices, coded);
+}
+
+void CaretCompressedSparseFileWriter::finish()
+{
+    CaretMutexLocker locked(&m_mutex);
+    if (m_finished) return;
+    m_finished = true;
+    const int64_t tableOffset = m_nextOffset;
+    vector<int64_t> table(m_dims[1] * 4);
+    for (int64_t i = 0; i < m_dims[1]; ++i)
+    {
+        table[i * 4] = m_rowTable[i].m_offset;
+        table[i * 4 + 1] = m_rowTable[i].m_storedBytes;
+        table[i * 4 + 2] = m_rowTable[i].m_rawBytes;
+        table[i * 4 + 3] = m_rowTable[i].m_numNonzero;
+    }
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(table.data(), table.size());
+    }
+    m_file.write(table.data(), table.size() * sizeof(int64_t));
+    QByteArray myXMLBytes = m_xml.writeXMLToQByteArray();
+    m_file.write(myXMLBytes.constData(), myXMLBytes.size());
+    int64_t offsets[2] = { tableOffset, tableOffset + m_dims[1] * ROW_ENTRY_SIZE };
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(offsets, 2);
+    }
+    m_file.seek(32);//written last, so an interrupted write is detected as unfinished rather than misread
+    m_file.write(offsets, 2 * sizeof(int64_t));
+    m_file.close();
+}
+
+CaretCompressedSparseFileWriter::~CaretCompressedSparseFileWriter()
+{
+    try
+    {
+        finish();
+    } catch (const DataFileException& e) {
+        CaretLogSevere("failed to finish writing sparse file: " + e.whatString());
+    }
+}
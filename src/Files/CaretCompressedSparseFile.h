@@ -0,0 +1,128 @@
+#ifndef __CARET_COMPRESSED_SPARSE_FILE_H__
+#define __CARET_COMPRESSED_SPARSE_FILE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <vector>
+#include "stdint.h"
+
+#include "AString.h"
+#include "CaretBinaryFile.h"
+#include "CaretMutex.h"
+#include "CaretSparseFile.h"
+#include "CiftiXML.h"
+#include "DataFileException.h"
+
+#include <QFile>
+
+namespace caret {
+
+    ///sparse matrix file where each row is a separately compressed block, with delta-encoded column indices, and a row table at the end
+    ///layout: magic, dims[2], value type, row table offset, xml offset, row blocks (any order), row table, xml
+    class CaretCompressedSparseFile
+    {
+    public:
+        enum ValueType
+        {
+            INT64 = 0,//also used for encoded fibers
+            FLOAT32 = 1
+        };
+
+        static bool isCompressedSparseMagic(const char firstBytes[8]);
+
+        CaretCompressedSparseFile() { m_mapped = NULL; m_dims[0] = 0; m_dims[1] = 0; m_valueType = INT64; }
+
+        CaretCompressedSparseFile(const AString& fileName);
+
+        void readFile(const AString& filename);
+
+        const int64_t* getDimensions() const { return m_dims; }
+
+        ValueType getValueType() const { return m_valueType; }
+
+        ///get a reference to the XML data
+        const CiftiXML& getCiftiXML() const { return m_xml; }
+
+        int64_t getRowNonzeroCount(const int64_t& index) const;
+
+        //the file is memory mapped and these don't use member scratch space, so they are safe to call from multiple threads
+        void getRow(const int64_t& index, int64_t* rowOut) const;
+
+        void getRow(const int64_t& index, float* rowOut) const;
+
+        void getRowSparse(const int64_t& index, std::vector<int64_t>& indicesOut, std::vector<int64_t>& valuesOut) const;
+
+        void getRowSparse(const int64_t& index, std::vector<int64_t>& indicesOut, std::vector<float>& valuesOut) const;
+
+        void getFibersRowSparse(const int64_t& index, std::vector<int64_t>& indicesOut, std::vector<FiberFractions>& valuesOut) const;
+
+        void close();
+
+        ~CaretCompressedSparseFile();
+    private:
+        struct RowEntry
+        {
+            int64_t m_offset, m_storedBytes, m_rawBytes, m_numNonzero;
+        };
+        QFile m_file;
+        uchar* m_mapped;
+        int64_t m_dims[2];
+        ValueType m_valueType;
+        std::vector<RowEntry> m_rowTable;
+        CiftiXML m_xml;
+        void decodeRow(const int64_t& index, std::vector<int64_t>& indicesOut, std::vector<char>& valueBytesOut) const;
+        CaretCompressedSparseFile(const CaretCompressedSparseFile&);
+        CaretCompressedSparseFile& operator=(const CaretCompressedSparseFile&);
+        friend class CaretCompressedSparseFileWriter;
+    };
+
+    class CaretCompressedSparseFileWriter
+    {
+        CaretBinaryFile m_file;
+        CaretMutex m_mutex;//protects everything below during writes
+        int64_t m_dims[2], m_nextOffset;
+        CaretCompressedSparseFile::ValueType m_valueType;
+        bool m_finished;
+        std::vector<CaretCompressedSparseFile::RowEntry> m_rowTable;
+        std::vector<bool> m_rowWritten;
+        CiftiXML m_xml;
+        void writeEncodedRow(const int64_t& index, const std::vector<int64_t>& indices, const char* valueBytes, const int64_t& valueSize);
+        CaretCompressedSparseFileWriter(const CaretCompressedSparseFileWriter&);
+        CaretCompressedSparseFileWriter& operator=(const CaretCompressedSparseFileWriter&);
+    public:
+        CaretCompressedSparseFileWriter(const AString& fileName, const CiftiXML& xml, const CaretCompressedSparseFile::ValueType& valueType = CaretCompressedSparseFile::INT64);
+
+        ~CaretCompressedSparseFileWriter();
+
+        //rows may be written in any order and from multiple threads at once, rows never written are empty, indices must be sorted
+        void writeRowSparse(const int64_t& index, const std::vector<int64_t>& indices, const std::vector<int64_t>& values);
+
+        void writeRowSparse(const int64_t& index, const std::vector<int64_t>& indices, const std::vector<float>& values);
+
+        void writeFibersRowSparse(const int64_t& index, const std::vector<int64_t>& indices, const std::vector<FiberFractions>& values);
+
+        ///call this when all rows have been written, must not be called while other threads are writing
+        void finish();
+    };
+
+}
+
+#endif //__CARET_COMPRESSED_SPARSE_FILE_H__
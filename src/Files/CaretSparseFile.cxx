@@ -23,6 +23,7 @@
 #include "ByteOrderEnum.h"
 #include "ByteSwapping.h"
 #include "CaretAssert.h"
+#include "CaretCompressedSparseFile.h"
 #include "CaretLogger.h"
 #include "FileInformation.h"
 
@@ -33,6 +34,10 @@ using namespace std;
 
 const char magic[] = "\0\0\0\0cst\0";
 
+CaretSparseFile::CaretSparseFile()
+{
+}
+
 CaretSparseFile::CaretSparseFile(const AString& fileName)
 {
     readFile(fileName);
@@ -41,6 +46,7 @@ CaretSparseFile::CaretSparseFile(const AString& fileName)
 void CaretSparseFile::readFile(const AString& filename)
 {
     m_file.close();
+    m_compressedFile.grabNew(NULL);
     if (filename.endsWith(".gz"))
     {
         throw DataFileException("wbsparse files cannot be read while compressed");
@@ -49,6 +55,19 @@ void CaretSparseFile::readFile(const AString& filename)
     FileInformation fileInfo(filename);//useful later for file size, but create it now to reduce the amount of time between file open and size check
     char buf[8];
     m_file.read(buf, 8);
+    if (CaretCompressedSparseFile::isCompressedSparseMagic(buf))
+    {//newer block compressed format, which has its own reader
+        m_file.close();
+        m_compressedFile.grabNew(new CaretCompressedSparseFile(filename));
+        if (m_compressedFile->getValueType() != CaretCompressedSparseFile::INT64)
+        {
+            throw DataFileException("compressed sparse file '" + filename + "' does not contain integer values");
+        }
+        m_dims[0] = m_compressedFile->getDimensions()[0];
+        m_dims[1] = m_compressedFile->getDimensions()[1];
+        m_xml = m_compressedFile->getCiftiXML();
+        return;
+    }
     for (int i = 0; i < 8; ++i)
     {
         if (buf[i] != magic[i]) throw DataFileException("file has the wrong magic string");
@@ -103,6 +122,11 @@ CaretSparseFile::~CaretSparseFile()
 void CaretSparseFile::getRow(const int64_t& index, int64_t* rowOut)
 {
     CaretAssert(index >= 0 && index < m_dims[1]);
+    if (m_compressedFile != NULL)
+    {
+        m_compressedFile->getRow(index, rowOut);
+        return;
+    }
     int64_t start = m_indexArray[index], end = m_indexArray[index + 1];
     int64_t numToRead = (end - start) * 2;
     m_scratchArray.resize(numToRead);
@@ -135,6 +159,11 @@ void CaretSparseFile::getRow(const int64_t& index, int64_t* rowOut)
 void CaretSparseFile::getRowSparse(const int64_t& index, vector<int64_t>& indicesOut, vector<int64_t>& valuesOut)
 {
     CaretAssert(index >= 0 && index < m_dims[1]);
+    if (m_compressedFile != NULL)
+    {
+        m_compressedFile->getRowSparse(index, indicesOut, valuesOut);
+        return;
+    }
     int64_t start = m_indexArray[index], end = m_indexArray[index + 1];
     int64_t numToRead = (end - start) * 2, numNonzero = end - start;
     m_scratchArray.resize(numToRead);
@@ -26,6 +26,7 @@
 
 #include "AString.h"
 #include "CaretBinaryFile.h"
+#include "CaretPointer.h"
 #include "CiftiXML.h"
 #include "DataFile.h"
 #include "DataFileException.h"
@@ -40,6 +41,8 @@ namespace caret {
         void zero();
     };
     
+    class CaretCompressedSparseFile;
+    
     class CaretSparseFile /* : public DataFile */
     {
         static void decodeFibers(const uint64_t& coded, FiberFractions& decoded);//takes a uint because right shift on signed is implementation dependent
@@ -49,10 +52,12 @@ namespace caret {
         std::vector<int64_t> m_scratchArray, m_scratchSparseRow;
         CaretSparseFile(const CaretSparseFile& rhs);
         CiftiXML m_xml;
+        CaretPointer<CaretCompressedSparseFile> m_compressedFile;//set when the file is in the block compressed format, which then does all reading
+        friend class CaretCompressedSparseFile;
     public:
         const int64_t* getDimensions() { return m_dims; }
 
-        CaretSparseFile() {};
+        CaretSparseFile();
         
         virtual void readFile(const AString& filename);
         
@@ -85,6 +90,7 @@ namespace caret {
         std::vector<int64_t> m_scratchArray, m_scratchSparseRow;
         CaretSparseFileWriter(const CaretSparseFileWriter& rhs);
         CiftiXML m_xml;
+        friend class CaretCompressedSparseFileWriter;
     public:
         CaretSparseFileWriter(const AString& fileName, const CiftiXML& xml);
         
@@ -0,0 +1,263 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiConnectivityMatrixRowPrefetcher.h"
+
+#include <algorithm>
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretLogger.h"
+#include "CiftiFile.h"
+
+using namespace caret;
+
+/**
+ * \class caret::CiftiConnectivityMatrixRowPrefetcher
+ * \brief Reads connectivity matrix rows ahead of need in a background thread.
+ * \ingroup Files
+ *
+ * Rows that are likely to be loaded next (such as those for vertices
+ * near the vertex under the mouse) are requested and read from the file
+ * by a background thread into a bounded, least recently used row cache.
+ * A new request replaces all pending requests, so rows for positions
+ * the mouse has already left are never read.
+ *
+ * The CiftiFile must be reading from disk (reading rows must be
+ * thread safe) and must not be destroyed before this prefetcher.
+ */
+
+/**
+ * Constructor.  Starts the prefetch thread.
+ *
+ * @param ciftiFile
+ *    File from which rows are read.
+ * @param maximumNumberOfCachedRows
+ *    Maximum number of rows kept in the cache.
+ */
+CiftiConnectivityMatrixRowPrefetcher::CiftiConnectivityMatrixRowPrefetcher(const CiftiFile* ciftiFile,
+                                                                           const int64_t maximumNumberOfCachedRows)
+: QThread(),
+m_ciftiFile(ciftiFile),
+m_rowLength(ciftiFile->getNumberOfColumns()),
+m_maximumNumberOfCachedRows(std::max(maximumNumberOfCachedRows, (int64_t)1)),
+m_stopFlag(false)
+{
+    CaretAssert(m_ciftiFile);
+    start(QThread::LowPriority);
+}
+
+/**
+ * Destructor.  Stops and waits for the prefetch thread.
+ */
+CiftiConnectivityMatrixRowPrefetcher::~CiftiConnectivityMatrixRowPrefetcher()
+{
+    stopPrefetching();
+}
+
+/**
+ * Stop the prefetch thread and wait for it to finish any read
+ * in progress.  Must be called before the CiftiFile is destroyed.
+ */
+void
+CiftiConnectivityMatrixRowPrefetcher::stopPrefetching()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopFlag = true;
+        m_pendingRows.clear();
+        m_waitCondition.wakeAll();
+    }
+    wait();
+}
+
+/**
+ * Get a row from the cache.
+ *
+ * @param rowIndex
+ *    Index of the row.
+ * @param dataOut
+ *    Output with the row's data, must have room for a full row.
+ * @return
+ *    True if the row was in the cache and copied to dataOut, else false.
+ */
+bool
+CiftiConnectivityMatrixRowPrefetcher::getRowFromCache(const int64_t rowIndex,
+                                                      float* dataOut)
+{
+    QMutexLocker locker(&m_mutex);
+
+    std::map<int64_t, CachedRow>::iterator iter = m_cachedRows.find(rowIndex);
+    if (iter == m_cachedRows.end()) {
+        return false;
+    }
+
+    m_recentlyUsedRows.splice(m_recentlyUsedRows.begin(),
+                              m_recentlyUsedRows,
+                              iter->second.m_recentIter);
+    std::copy(iter->second.m_data.begin(),
+              iter->second.m_data.end(),
+              dataOut);
+    return true;
+}
+
+/**
+ * Add a row that was read without the prefetcher to the cache,
+ * so that returning to it does not read the file again.
+ *
+ * @param rowIndex
+ *    Index of the row.
+ * @param data
+ *    The row's data.
+ */
+void
+CiftiConnectivityMatrixRowPrefetcher::addRowToCache(const int64_t rowIndex,
+                                                    const float* data)
+{
+    std::vector<float> rowData(data, data + m_rowLength);
+
+    QMutexLocker locker(&m_mutex);
+    insertRowWithLock(rowIndex,
+                      rowData);
+}
+
+/**
+ * Request rows to be read ahead.  Any rows still waiting from a
+ * previous request are discarded.
+ *
+ * @param rowIndices
+ *    Indices of rows, most likely to be needed first.
+ */
+void
+CiftiConnectivityMatrixRowPrefetcher::requestRows(const std::vector<int64_t>& rowIndices)
+{
+    const int64_t numberOfRows = m_ciftiFile->getNumberOfRows();
+
+    QMutexLocker locker(&m_mutex);
+    m_pendingRows.clear();
+    for (std::vector<int64_t>::const_iterator iter = rowIndices.begin();
+         iter != rowIndices.end();
+         iter++) {
+        const int64_t rowIndex = *iter;
+        if ((rowIndex >= 0)
+            && (rowIndex < numberOfRows)
+            && (m_cachedRows.find(rowIndex) == m_cachedRows.end())) {
+            m_pendingRows.push_back(rowIndex);
+        }
+
+        /*
+         * Prefetching more rows than the cache holds would
+         * evict the most likely rows with the least likely.
+         */
+        if (static_cast<int64_t>(m_pendingRows.size()) >= m_maximumNumberOfCachedRows / 2) {
+            break;
+        }
+    }
+
+    if ( ! m_pendingRows.empty()) {
+        m_waitCondition.wakeAll();
+    }
+}
+
+/**
+ * Insert a row into the cache and evict the least recently used
+ * rows if the cache is full.  Caller must hold the mutex.
+ *
+ * @param rowIndex
+ *    Index of the row.
+ * @param data
+ *    The row's data, contents are moved into the cache.
+ */
+void
+CiftiConnectivityMatrixRowPrefetcher::insertRowWithLock(const int64_t rowIndex,
+                                                        std::vector<float>& data)
+{
+    std::map<int64_t, CachedRow>::iterator iter = m_cachedRows.find(rowIndex);
+    if (iter != m_cachedRows.end()) {
+        m_recentlyUsedRows.splice(m_recentlyUsedRows.begin(),
+                                  m_recentlyUsedRows,
+                                  iter->second.m_recentIter);
+        return;
+    }
+
+    while (static_cast<int64_t>(m_cachedRows.size()) >= m_maximumNumberOfCachedRows) {
+        CaretAssert( ! m_recentlyUsedRows.empty());
+        m_cachedRows.erase(m_recentlyUsedRows.back());
+        m_recentlyUsedRows.pop_back();
+    }
+
+    m_recentlyUsedRows.push_front(rowIndex);
+    CachedRow& cachedRow = m_cachedRows[rowIndex];
+    cachedRow.m_data.swap(data);
+    cachedRow.m_recentIter = m_recentlyUsedRows.begin();
+}
+
+/**
+ * Prefetch thread, reads requested rows until stopped.
+ */
+void
+CiftiConnectivityMatrixRowPrefetcher::run()
+{
+    std::vector<float> rowData;
+
+    while (true) {
+        int64_t rowIndex = -1;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_pendingRows.empty()
+                   && ( ! m_stopFlag)) {
+                m_waitCondition.wait(&m_mutex);
+            }
+            if (m_stopFlag) {
+                return;
+            }
+            rowIndex = m_pendingRows.front();
+            m_pendingRows.pop_front();
+            if (m_cachedRows.find(rowIndex) != m_cachedRows.end()) {
+                continue;
+            }
+        }
+
+        /*
+         * Read without holding the mutex so that the GUI can
+         * use the cache and replace requests during the read.
+         */
+        rowData.resize(m_rowLength);
+        try {
+            m_ciftiFile->getRow(&rowData[0],
+                                rowIndex);
+        }
+        catch (const CaretException& e) {
+            CaretLogFine("Prefetch of row "
+                         + AString::number(rowIndex)
+                         + " failed: "
+                         + e.whatString());
+            continue;
+        }
+
+        QMutexLocker locker(&m_mutex);
+        if (m_stopFlag) {
+            return;
+        }
+        insertRowWithLock(rowIndex,
+                          rowData);
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef __CIFTI_CONNECTIVITY_MATRIX_ROW_PREFETCHER_H__
+#define __CIFTI_CONNECTIVITY_MATRIX_ROW_PREFETCHER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <deque>
+#include <list>
+#include <map>
+#include <vector>
+
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <stdint.h>
+
+namespace caret {
+
+    class CiftiFile;
+
+    class CiftiConnectivityMatrixRowPrefetcher : public QThread
+    {
+    public:
+        CiftiConnectivityMatrixRowPrefetcher(const CiftiFile* ciftiFile,
+                                             const int64_t maximumNumberOfCachedRows);
+
+        virtual ~CiftiConnectivityMatrixRowPrefetcher();
+
+        bool getRowFromCache(const int64_t rowIndex,
+                             float* dataOut);
+
+        void addRowToCache(const int64_t rowIndex,
+                           const float* data);
+
+        void requestRows(const std::vector<int64_t>& rowIndices);
+
+        void stopPrefetching();
+
+    protected:
+        virtual void run();
+
+    private:
+        CiftiConnectivityMatrixRowPrefetcher(const CiftiConnectivityMatrixRowPrefetcher&);
+
+        CiftiConnectivityMatrixRowPrefetcher& operator=(const CiftiConnectivityMatrixRowPrefetcher&);
+
+        struct CachedRow {
+            std::vector<float> m_data;
+
+            std::list<int64_t>::iterator m_recentIter;
+        };
+
+        void insertRowWithLock(const int64_t rowIndex,
+                               std::vector<float>& data);
+
+        /** File from which rows are read, must outlive this prefetcher */
+        const CiftiFile* m_ciftiFile;
+
+        /** Number of elements in a row */
+        const int64_t m_rowLength;
+
+        /** Maximum number of rows kept in the cache */
+        const int64_t m_maximumNumberOfCachedRows;
+
+        /** Protects all members below */
+        QMutex m_mutex;
+
+        /** Wakes the prefetch thread when rows are requested or when stopping */
+        QWaitCondition m_waitCondition;
+
+        /** Rows waiting to be read, most likely next first */
+        std::deque<int64_t> m_pendingRows;
+
+        /** Row indices, most recently used first */
+        std::list<int64_t> m_recentlyUsedRows;
+
+        /** Cached rows by row index */
+        std::map<int64_t, CachedRow> m_cachedRows;
+
+        /** Set when the thread should exit */
+        bool m_stopFlag;
+    };
+
+} // namespace
+#endif  //__CIFTI_CONNECTIVITY_MATRIX_ROW_PREFETCHER_H__
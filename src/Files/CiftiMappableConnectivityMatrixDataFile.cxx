@@ -23,7 +23,10 @@
 #include "CiftiMappableConnectivityMatrixDataFile.h"
 #undef __CIFTI_MAPPABLE_CONNECTIVITY_MATRIX_DATA_FILE_DECLARE__
 
+#include <algorithm>
+
 #include "CaretAssert.h"
+#include "CiftiConnectivityMatrixRowPrefetcher.h"
 #include "CiftiFile.h"
 #include "CaretLogger.h"
 #include "ChartableMatrixParcelInterface.h"
@@ -52,6 +55,7 @@ CiftiMappableConnectivityMatrixDataFile::CiftiMappableConnectivityMatrixDataFile
 : CiftiMappableDataFile(dataFileType)
 {
     m_connectivityDataLoaded = new ConnectivityDataLoaded();
+    m_rowPrefetcher = NULL;
     
     /*
      * This method initializes some members
@@ -83,6 +87,11 @@ CiftiMappableConnectivityMatrixDataFile::~CiftiMappableConnectivityMatrixDataFil
 void
 CiftiMappableConnectivityMatrixDataFile::clear()
 {
+    /*
+     * Prefetcher reads from the CiftiFile that is
+     * destroyed by the parent class.
+     */
+    deleteRowPrefetcher();
     CiftiMappableDataFile::clear();
     clearPrivate();
 }
@@ -94,6 +103,7 @@ CiftiMappableConnectivityMatrixDataFile::clear()
 void
 CiftiMappableConnectivityMatrixDataFile::clearPrivate()
 {
+    deleteRowPrefetcher();
     m_loadedRowData.clear();
     m_rowLoadedTextForMapName = "";
     m_rowLoadedText = "";
@@ -371,22 +381,40 @@ CiftiMappableConnectivityMatrixDataFile::getRowColumnAverageForIndices(const std
     const int64_t numIndices = static_cast<int64_t>(indices.size());
     if (numIndices > 0) {
         std::vector<double> sum(dataLength, 0.0);
-        std::vector<float>  data(dataLength);
         
-        for (std::vector<int64_t>::const_iterator iter = indices.begin();
-             iter != indices.end();
-             iter++) {
-            if (doRowsFlag) {
-                getDataForRow(&data[0], *iter);
-            }
-            else {
-                getDataForColumn(&data[0], *iter);
-            }
+        if (doRowsFlag
+            && (getDataFileType() != DataFileTypeEnum::CONNECTIVITY_DENSE_DYNAMIC)) {
+            /*
+             * Rows are not processed after reading so read them
+             * in file order, with adjacent rows read together.
+             * Dense dynamic rows are computed, one at a time, below.
+             */
+            std::vector<std::vector<double> > sums(1);
+            sums[0].swap(sum);
+            const std::vector<float> weights(numIndices, 1.0f);
+            m_ciftiFile->addWeightedRows(sums,
+                                         indices,
+                                         weights);
+            sum.swap(sums[0]);
+        }
+        else {
+            std::vector<float>  data(dataLength);
             
-            for (int64_t i = 0; i < dataLength; i++) {
-                CaretAssertVectorIndex(sum, i);
-                CaretAssertVectorIndex(data, i);
-                sum[i] += data[i];
+            for (std::vector<int64_t>::const_iterator iter = indices.begin();
+                 iter != indices.end();
+                 iter++) {
+                if (doRowsFlag) {
+                    getDataForRow(&data[0], *iter);
+                }
+                else {
+                    getDataForColumn(&data[0], *iter);
+                }
+                
+                for (int64_t i = 0; i < dataLength; i++) {
+                    CaretAssertVectorIndex(sum, i);
+                    CaretAssertVectorIndex(data, i);
+                    sum[i] += data[i];
+                }
             }
         }
 
@@ -628,6 +656,125 @@ CiftiMappableConnectivityMatrixDataFile::getProcessedDataForRow(float* dataOut,
                         index);
 }
 
+/**
+ * Load PROCESSED data for the given row, from the row prefetcher's
+ * cache when the row has been read ahead.  Rows not in the cache are
+ * read from the file and added to the cache.
+ *
+ * @param dataOut
+ *     Output with data.
+ * @param index of the row.
+ */
+void
+CiftiMappableConnectivityMatrixDataFile::getProcessedDataForRowUsingCache(float* dataOut,
+                                                                          const int64_t& index)
+{
+    if (m_rowPrefetcher != NULL) {
+        if (m_rowPrefetcher->getRowFromCache(index,
+                                             dataOut)) {
+            CaretLogFine("Row " + AString::number(index) + " from prefetch cache");
+            return;
+        }
+    }
+    
+    getProcessedDataForRow(dataOut,
+                           index);
+    
+    if (m_rowPrefetcher != NULL) {
+        m_rowPrefetcher->addRowToCache(index,
+                                       dataOut);
+    }
+}
+
+/**
+ * Stop and delete the row prefetcher, if there is one.
+ */
+void
+CiftiMappableConnectivityMatrixDataFile::deleteRowPrefetcher()
+{
+    if (m_rowPrefetcher != NULL) {
+        delete m_rowPrefetcher;
+        m_rowPrefetcher = NULL;
+    }
+}
+
+/**
+ * Read ahead, in a background thread, the rows for surface nodes that
+ * are likely to be loaded next, such as nodes near the node under the
+ * mouse.  Requests that have not been read yet are replaced.
+ *
+ * Rows are only prefetched from files read from disk whose rows
+ * do not need additional processing.
+ *
+ * @param surfaceNumberOfNodes
+ *    Number of nodes in surface.
+ * @param structure
+ *    Surface's structure.
+ * @param nodeIndices
+ *    Indices of nodes, most likely to be loaded first.
+ */
+void
+CiftiMappableConnectivityMatrixDataFile::prefetchRowsForSurfaceNodes(const int32_t surfaceNumberOfNodes,
+                                                                     const StructureEnum::Enum structure,
+                                                                     const std::vector<int32_t>& nodeIndices)
+{
+    if ( ! isEnabledAsLayer()) {
+        return;
+    }
+    if (m_ciftiFile == NULL) {
+        return;
+    }
+    if ( ! m_dataLoadingEnabled) {
+        return;
+    }
+    if (getDataFileType() == DataFileTypeEnum::CONNECTIVITY_DENSE_DYNAMIC) {
+        return;
+    }
+    if (m_ciftiFile->isInMemory()
+        || DataFile::isFileOnNetwork(getFileName())) {
+        return;
+    }
+    
+    const int64_t rowLength = m_ciftiFile->getNumberOfColumns();
+    if (rowLength <= 0) {
+        return;
+    }
+    
+    std::vector<int64_t> rowIndices;
+    rowIndices.reserve(nodeIndices.size());
+    for (std::vector<int32_t>::const_iterator iter = nodeIndices.begin();
+         iter != nodeIndices.end();
+         iter++) {
+        int64_t rowIndex = -1;
+        int64_t columnIndex = -1;
+        getRowColumnIndexForNodeWhenLoading(structure,
+                                            surfaceNumberOfNodes,
+                                            *iter,
+                                            rowIndex,
+                                            columnIndex);
+        if (rowIndex >= 0) {
+            rowIndices.push_back(rowIndex);
+        }
+    }
+    if (rowIndices.empty()) {
+        return;
+    }
+    
+    if (m_rowPrefetcher == NULL) {
+        /*
+         * Limit the cache to about 256MB but keep enough
+         * rows for the neighborhood of a few vertices.
+         */
+        const int64_t maximumCacheBytes = 256 * 1024 * 1024;
+        const int64_t maximumRows = std::max(maximumCacheBytes / (rowLength * static_cast<int64_t>(sizeof(float))),
+                                             static_cast<int64_t>(64));
+        m_rowPrefetcher = new CiftiConnectivityMatrixRowPrefetcher(m_ciftiFile,
+                                                                   maximumRows);
+    }
+    
+    m_rowPrefetcher->requestRows(rowIndices);
+}
+
 /**
  * Some file types may perform additional processing of row average data and
  * can override this method.
@@ -671,8 +818,8 @@ CiftiMappableConnectivityMatrixDataFile::loadDataForRowIndex(const int64_t rowIn
             CaretAssert((rowIndex >= 0) && (rowIndex < m_ciftiFile->getNumberOfRows()));
             m_loadedRowData.resize(dataCount);
             
-            getProcessedDataForRow(&m_loadedRowData[0],
-                                   rowIndex);
+            getProcessedDataForRowUsingCache(&m_loadedRowData[0],
+                                             rowIndex);
             
             CaretLogFine("Read row " + AString::number(rowIndex + CIFTI_FILE_ROW_COLUMN_INDEX_BASE_FOR_GUI));
             m_connectivityDataLoaded->setRowColumnLoading(rowIndex,
@@ -820,8 +967,8 @@ CiftiMappableConnectivityMatrixDataFile::loadMapDataForSurfaceNode(const int32_t
                                    + StructureEnum::toGuiName(structure));
                 CaretAssert((rowIndex >= 0) && (rowIndex < m_ciftiFile->getNumberOfRows()));
                 m_loadedRowData.resize(dataCount);
-                getProcessedDataForRow(&m_loadedRowData[0],
-                                    rowIndex);
+                getProcessedDataForRowUsingCache(&m_loadedRowData[0],
+                                                 rowIndex);
                 
                 CaretLogFine("Read row for vertex " + AString::number(nodeIndex));
                 
@@ -1060,8 +1207,8 @@ CiftiMappableConnectivityMatrixDataFile::loadMapDataForVoxelAtCoordinate(const i
         if (dataCount > 0) {
             m_loadedRowData.resize(dataCount);
             CaretAssert((rowIndex >= 0) && (rowIndex < m_ciftiFile->getNumberOfRows()));
-            getProcessedDataForRow(&m_loadedRowData[0],
-                                   rowIndex);
+            getProcessedDataForRowUsingCache(&m_loadedRowData[0],
+                                             rowIndex);
             
             m_rowLoadedTextForMapName = ("Row: "
                                         + AString::number(rowIndex + CIFTI_FILE_ROW_COLUMN_INDEX_BASE_FOR_GUI)
@@ -30,6 +30,7 @@
 
 namespace caret {
 
+    class CiftiConnectivityMatrixRowPrefetcher;
     class ConnectivityDataLoaded;
     class SceneClassAssistant;
     
@@ -68,6 +69,10 @@ namespace caret {
                                                        const int64_t volumeDimensionIJK[3],
                                                        const std::vector<VoxelIJK>& voxelIndices);
 
+        void prefetchRowsForSurfaceNodes(const int32_t surfaceNumberOfNodes,
+                                         const StructureEnum::Enum structure,
+                                         const std::vector<int32_t>& nodeIndices);
+
         void loadDataForRowIndex(const int64_t rowIndex);
         
         void loadDataForColumnIndex(const int64_t rowIndex);
@@ -139,6 +144,11 @@ namespace caret {
         
         void clearPrivate();
         
+        void deleteRowPrefetcher();
+        
+        void getProcessedDataForRowUsingCache(float* dataOut,
+                                              const int64_t& index);
+        
         void getRowColumnIndexForNodeWhenLoading(const StructureEnum::Enum structure,
                                                  const int64_t surfaceNumberOfNodes,
                                                  const int64_t nodeIndex,
@@ -185,6 +195,9 @@ namespace caret {
         
         ConnectivityDataLoaded* m_connectivityDataLoaded;
         
+        /** Reads rows ahead of need when browsing, NULL until rows are first prefetched */
+        CiftiConnectivityMatrixRowPrefetcher* m_rowPrefetcher;
+        
         /*
          * This is really a member of parcel file since it the parcel
          * file is the only file that can load by row or column.
@@ -0,0 +1,273 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "ConnectedComponents.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "TopologyHelper.h"
+
+#include <algorithm>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    //parent pointers are only valid for marked indices, roots point to themselves
+    int64_t findRoot(vector<int64_t>& parent, int64_t index)
+    {
+        while (parent[index] != index)
+        {
+            parent[index] = parent[parent[index]];//path halving
+            index = parent[index];
+        }
+        return index;
+    }
+
+    int64_t findRootReadOnly(const vector<int64_t>& parent, int64_t index)
+    {
+        while (parent[index] != index)
+        {
+            index = parent[index];
+        }
+        return index;
+    }
+
+    void unite(vector<int64_t>& parent, const int64_t& a, const int64_t& b)
+    {
+        int64_t rootA = findRoot(parent, a), rootB = findRoot(parent, b);
+        if (rootA == rootB) return;
+        if (rootA < rootB)//the root is always the lowest index in the component, which gives the numbering order
+        {
+            parent[rootB] = rootA;
+        } else {
+            parent[rootA] = rootB;
+        }
+    }
+
+    int getNumChunks(const bool& parallel, const int64_t& maxChunks)
+    {
+        int ret = 1;
+#ifdef CARET_OMP
+        if (parallel) ret = omp_get_max_threads();
+#endif
+        if (ret > maxChunks) ret = (int)max(maxChunks, (int64_t)1);
+        return ret;
+    }
+
+    //turn roots into sequential component numbers, in index order
+    int64_t finalizeLabels(vector<int64_t>& parent, const char* marked, const int64_t& count, vector<int64_t>& labelsOut, vector<int64_t>* sizesOut, const bool& parallel)
+    {
+        labelsOut.resize(count);
+        int numChunks = getNumChunks(parallel, count / 4096);
+        vector<int64_t> chunkStarts(numChunks + 1, 0);
+#pragma omp CARET_PARFOR schedule(static)
+        for (int chunk = 0; chunk < numChunks; ++chunk)
+        {
+            int64_t start = count * chunk / numChunks, end = count * (chunk + 1) / numChunks, numRoots = 0;
+            for (int64_t i = start; i < end; ++i)
+            {
+                if (marked[i])
+                {
+                    labelsOut[i] = findRootReadOnly(parent, i);//no compression, other threads are reading
+                    if (labelsOut[i] == i) ++numRoots;
+                } else {
+                    labelsOut[i] = -1;
+                }
+            }
+            chunkStarts[chunk + 1] = numRoots;
+        }
+        for (int chunk = 0; chunk < numChunks; ++chunk)
+        {
+            chunkStarts[chunk + 1] += chunkStarts[chunk];
+        }
+#pragma omp CARET_PARFOR schedule(static)
+        for (int chunk = 0; chunk < numChunks; ++chunk)
+        {
+            int64_t start = count * chunk / numChunks, end = count * (chunk + 1) / numChunks, next = chunkStarts[chunk];
+            for (int64_t i = start; i < end; ++i)
+            {
+                if (labelsOut[i] == i) parent[i] = next++;//roots are no longer needed as parents, reuse them for the component number
+            }
+        }
+#pragma omp CARET_PARFOR schedule(static)
+        for (int chunk = 0; chunk < numChunks; ++chunk)
+        {
+            int64_t start = count * chunk / numChunks, end = count * (chunk + 1) / numChunks;
+            for (int64_t i = start; i < end; ++i)
+            {
+                if (labelsOut[i] != -1) labelsOut[i] = parent[labelsOut[i]];
+            }
+        }
+        int64_t numComponents = chunkStarts[numChunks];
+        if (sizesOut != NULL)
+        {
+            sizesOut->assign(numComponents, 0);
+            for (int64_t i = 0; i < count; ++i)
+            {
+                if (labelsOut[i] != -1) ++((*sizesOut)[labelsOut[i]]);
+            }
+        }
+        return numComponents;
+    }
+
+    void thresholdMap(const float* data, const int64_t& count, const float& threshold, const bool& lessThan, const float* roi, vector<char>& markedOut)
+    {
+        markedOut.resize(count);
+        if (lessThan)
+        {
+            for (int64_t i = 0; i < count; ++i)
+            {
+                markedOut[i] = ((roi == NULL || roi[i] > 0.0f) && data[i] < threshold) ? 1 : 0;
+            }
+        } else {
+            for (int64_t i = 0; i < count; ++i)
+            {
+                markedOut[i] = ((roi == NULL || roi[i] > 0.0f) && data[i] > threshold) ? 1 : 0;
+            }
+        }
+    }
+}
+
+int64_t ConnectedComponents::labelGrid(const int64_t dims[3], const char* marked, vector<int64_t>& labelsOut, vector<int64_t>* sizesOut, const bool& parallel)
+{
+    const int64_t sliceSize = dims[0] * dims[1], frameSize = sliceSize * dims[2];
+    vector<int64_t> parent(frameSize);
+    int numSlabs = getNumChunks(parallel, dims[2]);
+#pragma omp CARET_PARFOR schedule(static)
+    for (int slab = 0; slab < numSlabs; ++slab)
+    {//unions only within the slab, so each thread only touches its own part of parent
+        int64_t kStart = dims[2] * slab / numSlabs, kEnd = dims[2] * (slab + 1) / numSlabs;
+        for (int64_t k = kStart; k < kEnd; ++k)
+        {
+            for (int64_t j = 0; j < dims[1]; ++j)
+            {
+                int64_t index = dims[0] * (j + dims[1] * k);
+                for (int64_t i = 0; i < dims[0]; ++i, ++index)
+                {
+                    if (!marked[index]) continue;
+                    parent[index] = index;
+                    if (i > 0 && marked[index - 1]) unite(parent, index - 1, index);
+                    if (j > 0 && marked[index - dims[0]]) unite(parent, index - dims[0], index);
+                    if (k > kStart && marked[index - sliceSize]) unite(parent, index - sliceSize, index);
+                }
+            }
+        }
+    }
+    for (int slab = 1; slab < numSlabs; ++slab)
+    {//merge across the slab borders
+        int64_t base = sliceSize * (dims[2] * slab / numSlabs);
+        for (int64_t index = base; index < base + sliceSize; ++index)
+        {
+            if (marked[index] && marked[index - sliceSize]) unite(parent, index - sliceSize, index);
+        }
+    }
+    return finalizeLabels(parent, marked, frameSize, labelsOut, sizesOut, parallel);
+}
+
+int64_t ConnectedComponents::labelGraph(const TopologyHelper* topoHelp, const char* marked, vector<int64_t>& labelsOut, vector<int64_t>* sizesOut, const bool& parallel)
+{
+    CaretAssert(topoHelp != NULL);
+    const int64_t numNodes = topoHelp->getNumberOfNodes();
+    vector<int64_t> parent(numNodes);
+    int numChunks = getNumChunks(parallel, numNodes / 4096);
+    vector<vector<int64_t> > crossEdges(numChunks);//edges to earlier chunks, as pairs
+#pragma omp CARET_PARFOR schedule(static)
+    for (int chunk = 0; chunk < numChunks; ++chunk)
+    {
+        int64_t start = numNodes * chunk / numChunks, end = numNodes * (chunk + 1) / numChunks;
+        for (int64_t node = start; node < end; ++node)
+        {
+            if (!marked[node]) continue;
+            parent[node] = node;
+            int32_t numNeigh = 0;
+            const int32_t* neighbors = topoHelp->getNodeNeighbors(node, numNeigh);
+            for (int32_t n = 0; n < numNeigh; ++n)
+            {
+                const int64_t neighbor = neighbors[n];
+                if (neighbor >= node || !marked[neighbor]) continue;//each edge is seen from both ends, only use it from the later one
+                if (neighbor >= start)
+                {
+                    unite(parent, neighbor, node);
+                } else {
+                    crossEdges[chunk].push_back(neighbor);
+                    crossEdges[chunk].push_back(node);
+                }
+            }
+        }
+    }
+    for (int chunk = 1; chunk < numChunks; ++chunk)
+    {
+        const vector<int64_t>& edges = crossEdges[chunk];
+        for (size_t i = 0; i < edges.size(); i += 2)
+        {
+            unite(parent, edges[i], edges[i + 1]);
+        }
+    }
+    return finalizeLabels(parent, marked, numNodes, labelsOut, sizesOut, parallel);
+}
+
+void ConnectedComponents::thresholdAndLabelGrid(const int64_t dims[3], const vector<const float*>& maps, const float& threshold, const bool& lessThan, const float* roi,
+                                                vector<vector<int64_t> >& labelsOut, vector<int64_t>& countsOut, vector<vector<int64_t> >* sizesOut)
+{
+    const int64_t numMaps = (int64_t)maps.size(), frameSize = dims[0] * dims[1] * dims[2];
+    labelsOut.resize(numMaps);
+    countsOut.resize(numMaps);
+    if (sizesOut != NULL) sizesOut->resize(numMaps);
+    if (numMaps == 1)
+    {//label within the map in parallel, nested parallel regions would run it serially
+        vector<char> marked;
+        thresholdMap(maps[0], frameSize, threshold, lessThan, roi, marked);
+        countsOut[0] = labelGrid(dims, marked.data(), labelsOut[0], (sizesOut == NULL ? NULL : &((*sizesOut)[0])), true);
+        return;
+    }
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t m = 0; m < numMaps; ++m)
+    {//one map per thread is simpler and has no merge step
+        vector<char> marked;
+        thresholdMap(maps[m], frameSize, threshold, lessThan, roi, marked);
+        countsOut[m] = labelGrid(dims, marked.data(), labelsOut[m], (sizesOut == NULL ? NULL : &((*sizesOut)[m])), false);
+    }
+}
+
+void ConnectedComponents::thresholdAndLabelGraph(const TopologyHelper* topoHelp, const vector<const float*>& maps, const float& threshold, const bool& lessThan, const float* roi,
+                                                 vector<vector<int64_t> >& labelsOut, vector<int64_t>& countsOut, vector<vector<int64_t> >* sizesOut)
+{
+    CaretAssert(topoHelp != NULL);
+    const int64_t numMaps = (int64_t)maps.size(), numNodes = topoHelp->getNumberOfNodes();
+    labelsOut.resize(numMaps);
+    countsOut.resize(numMaps);
+    if (sizesOut != NULL) sizesOut->resize(numMaps);
+    if (numMaps == 1)
+    {
+        vector<char> marked;
+        thresholdMap(maps[0], numNodes, threshold, lessThan, roi, marked);
+        countsOut[0] = labelGraph(topoHelp, marked.data(), labelsOut[0], (sizesOut == NULL ? NULL : &((*sizesOut)[0])), true);
+        return;
+    }
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t m = 0; m < numMaps; ++m)
+    {
+        vector<char> marked;
+        thresholdMap(maps[m], numNodes, threshold, lessThan, roi, marked);
+        countsOut[m] = labelGraph(topoHelp, marked.data(), labelsOut[m], (sizesOut == NULL ? NULL : &((*sizesOut)[m])), false);
+    }
+}
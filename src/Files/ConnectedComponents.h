@@ -0,0 +1,60 @@
+#ifndef __CONNECTED_COMPONENTS_H__
+#define __CONNECTED_COMPONENTS_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "stdint.h"
+#include <cstddef>
+#include <vector>
+
+namespace caret {
+
+    class TopologyHelper;
+
+    ///union-find connected component labeling of voxel grids and surface graphs
+    ///a single map is split into chunks that are labeled in parallel, then the chunk borders are merged
+    ///components are numbered in order of their lowest index, the same order a flood fill in index order finds them, regardless of thread count
+    class ConnectedComponents
+    {
+        ConnectedComponents();
+    public:
+        ///label the face-connected components of marked voxels, labelsOut gets -1 for unmarked voxels, returns the number of components
+        static int64_t labelGrid(const int64_t dims[3], const char* marked, std::vector<int64_t>& labelsOut,
+                                 std::vector<int64_t>* sizesOut = NULL, const bool& parallel = true);
+
+        ///label the edge-connected components of marked vertices
+        static int64_t labelGraph(const TopologyHelper* topoHelp, const char* marked, std::vector<int64_t>& labelsOut,
+                                  std::vector<int64_t>* sizesOut = NULL, const bool& parallel = true);
+
+        ///threshold and label many maps in one pass, parallel across maps, for all frames of a file or a batch of permutations
+        ///marks values above the threshold (below, if lessThan) where roi is positive, roi may be NULL
+        static void thresholdAndLabelGrid(const int64_t dims[3], const std::vector<const float*>& maps, const float& threshold, const bool& lessThan, const float* roi,
+                                          std::vector<std::vector<int64_t> >& labelsOut, std::vector<int64_t>& countsOut,
+                                          std::vector<std::vector<int64_t> >* sizesOut = NULL);
+
+        static void thresholdAndLabelGraph(const TopologyHelper* topoHelp, const std::vector<const float*>& maps, const float& threshold, const bool& lessThan, const float* roi,
+                                           std::vector<std::vector<int64_t> >& labelsOut, std::vector<int64_t>& countsOut,
+                                           std::vector<std::vector<int64_t> >* sizesOut = NULL);
+    };
+
+}
+
+#endif //__CONNECTED_COMPONENTS_H__
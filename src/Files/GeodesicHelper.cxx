@@ -23,11 +23,14 @@
 #include "CaretAssert.h"
 #include "CaretHeap.h"
 #include "CaretMutex.h"
+#include "CaretOMP.h"
 #include "FastStatistics.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <iostream>
 #include <stdint.h>
 
@@ -163,6 +166,28 @@ GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float
         distances2[baseNode].push_back(tempf);
         neighbors2PathInfo[baseNode].push_back(tempInfo);
     }
+    m_flatStart.resize(numNodes + 1);//flatten the neighbor lists so that many threads can walk them without chasing per-node allocations
+    m_flatSmoothStart.resize(numNodes + 1);
+    m_flatStart[0] = 0;
+    m_flatSmoothStart[0] = 0;
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        m_flatStart[i + 1] = m_flatStart[i] + nodeNeighbors[i].size();
+        m_flatSmoothStart[i + 1] = m_flatSmoothStart[i] + nodeNeighbors[i].size() + nodeNeighbors2[i].size();
+    }
+    m_flatNeighbors.reserve(m_flatStart[numNodes]);
+    m_flatDists.reserve(m_flatStart[numNodes]);
+    m_flatSmoothNeighbors.reserve(m_flatSmoothStart[numNodes]);
+    m_flatSmoothDists.reserve(m_flatSmoothStart[numNodes]);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        m_flatNeighbors.insert(m_flatNeighbors.end(), nodeNeighbors[i].begin(), nodeNeighbors[i].end());
+        m_flatDists.insert(m_flatDists.end(), distances[i].begin(), distances[i].end());
+        m_flatSmoothNeighbors.insert(m_flatSmoothNeighbors.end(), nodeNeighbors[i].begin(), nodeNeighbors[i].end());
+        m_flatSmoothNeighbors.insert(m_flatSmoothNeighbors.end(), nodeNeighbors2[i].begin(), nodeNeighbors2[i].end());
+        m_flatSmoothDists.insert(m_flatSmoothDists.end(), distances[i].begin(), distances[i].end());
+        m_flatSmoothDists.insert(m_flatSmoothDists.end(), distances2[i].begin(), distances2[i].end());
+    }
 }
 
 GeodesicHelper::GeodesicHelper(const CaretPointer<const GeodesicHelperBase>& baseIn)
@@ -1528,3 +1553,225 @@ int32_t GeodesicHelper::getClosestNodeInRoi(const int32_t& root, const char* roi
     }
     return ret;
 }
+
+namespace
+{
+    //nonnegative floats sort in the same order as their bit patterns, so distances can be used directly as radix heap keys
+    uint32_t distanceKey(const float& dist)
+    {
+        CaretAssert(dist >= 0.0f);
+        uint32_t ret;
+        memcpy(&ret, &dist, sizeof(float));
+        return ret;
+    }
+    
+    class RadixHeap
+    {//monotone priority queue, keys pushed must not be less than the last key popped, which dijkstra guarantees
+        std::vector<std::pair<uint32_t, int32_t> > m_buckets[33];//bucket 0 is keys equal to m_last, bucket i is keys whose highest differing bit from m_last is i - 1
+        uint32_t m_last;
+        int64_t m_size;
+        static int bucketIndex(const uint32_t& key, const uint32_t& last)
+        {
+            uint32_t diff = key ^ last;
+            int ret = 0;
+            while (diff != 0)
+            {
+                diff >>= 1;
+                ++ret;
+            }
+            return ret;
+        }
+    public:
+        RadixHeap() { clear(); }
+        void clear()
+        {
+            for (int i = 0; i < 33; ++i) m_buckets[i].clear();//keeps capacity, so reuse across roots doesn't reallocate
+            m_last = 0;
+            m_size = 0;
+        }
+        bool isEmpty() const { return m_size == 0; }
+        void push(const uint32_t& key, const int32_t& value)
+        {
+            CaretAssert(key >= m_last);
+            m_buckets[bucketIndex(key, m_last)].push_back(make_pair(key, value));
+            ++m_size;
+        }
+        int32_t pop(uint32_t& keyOut)
+        {
+            CaretAssert(m_size > 0);
+            if (m_buckets[0].empty())
+            {
+                int i = 1;
+                while (m_buckets[i].empty()) ++i;
+                std::vector<std::pair<uint32_t, int32_t> >& toSplit = m_buckets[i];
+                uint32_t newLast = toSplit[0].first;
+                for (size_t j = 1; j < toSplit.size(); ++j)
+                {
+                    if (toSplit[j].first < newLast) newLast = toSplit[j].first;
+                }
+                m_last = newLast;
+                for (size_t j = 0; j < toSplit.size(); ++j)
+                {//everything in bucket i now differs from m_last only in lower bits, so it all moves to lower buckets
+                    m_buckets[bucketIndex(toSplit[j].first, m_last)].push_back(toSplit[j]);
+                }
+                toSplit.clear();
+            }
+            std::pair<uint32_t, int32_t> ret = m_buckets[0].back();
+            m_buckets[0].pop_back();
+            --m_size;
+            keyOut = ret.first;
+            return ret.second;
+        }
+    };
+    
+    class MultiRootWorker
+    {//per-thread scratch for GeodesicMultiRootHelper, node state is reset only where it was changed
+        const int64_t* m_start;
+        const int32_t* m_neighbors;
+        const float* m_dists;
+        std::vector<float> m_output;
+        std::vector<char> m_state;//0 = not reached, 1 = has tentative distance, 2 = frozen
+        std::vector<int32_t> m_changed;
+        RadixHeap m_active;
+    public:
+        MultiRootWorker(const int32_t& numNodes, const int64_t* start, const int32_t* neighbors, const float* dists)
+        {
+            m_start = start;
+            m_neighbors = neighbors;
+            m_dists = dists;
+            m_output.resize(numNodes);
+            m_state.resize(numNodes, 0);
+        }
+        //dijkstra with lazy deletion: stale heap entries are skipped when popped, instead of using changekey
+        void run(const int32_t& root, const bool& limited, const float& maxdist, std::vector<std::pair<int32_t, float> >& foundOut)
+        {
+            foundOut.clear();
+            m_changed.clear();
+            m_active.clear();
+            m_output[root] = 0.0f;
+            m_state[root] = 1;
+            m_changed.push_back(root);
+            m_active.push(distanceKey(0.0f), root);
+            uint32_t key;
+            while (!m_active.isEmpty())
+            {
+                int32_t whichnode = m_active.pop(key);
+                if (m_state[whichnode] == 2 || key != distanceKey(m_output[whichnode])) continue;//frozen, or a stale entry
+                m_state[whichnode] = 2;
+                const float nodeDist = m_output[whichnode];
+                foundOut.push_back(make_pair(whichnode, nodeDist));
+                const int64_t end = m_start[whichnode + 1];
+                for (int64_t j = m_start[whichnode]; j < end; ++j)
+                {
+                    const int32_t whichneigh = m_neighbors[j];
+                    if (m_state[whichneigh] == 2) continue;
+                    const float tempf = nodeDist + m_dists[j];
+                    if (limited && tempf > maxdist) continue;//keep it off the heap if it is too far
+                    if (m_state[whichneigh] == 0)
+                    {
+                        m_state[whichneigh] = 1;
+                        m_changed.push_back(whichneigh);
+                    } else if (!(tempf < m_output[whichneigh])) {
+                        continue;
+                    }
+                    m_output[whichneigh] = tempf;
+                    m_active.push(distanceKey(tempf), whichneigh);
+                }
+            }
+            for (size_t i = 0; i < m_changed.size(); ++i)
+            {
+                m_state[m_changed[i]] = 0;
+            }
+        }
+    };
+}
+
+GeodesicMultiRootHelper::GeodesicMultiRootHelper(const CaretPointer<const GeodesicHelperBase>& baseIn)
+{
+    m_myBase = baseIn;
+}
+
+void GeodesicMultiRootHelper::getNodesToGeoDist(const vector<int32_t>& roots, const float& maxdist, vector<int64_t>& rowStartsOut,
+                                                vector<int32_t>& nodesOut, vector<float>& distsOut, const bool smoothflag) const
+{
+    const int32_t numNodes = m_myBase->numNodes;
+    const int64_t numRoots = (int64_t)roots.size();
+    rowStartsOut.assign(numRoots + 1, 0);
+    nodesOut.clear();
+    distsOut.clear();
+    for (int64_t i = 0; i < numRoots; ++i)
+    {
+        CaretAssert(roots[i] >= 0 && roots[i] < numNodes);
+        if (roots[i] < 0 || roots[i] >= numNodes) return;//check what we asserted so release doesn't do strange things
+    }
+    if (maxdist < 0.0f) return;
+    const GeodesicHelperBase& myBase = *m_myBase;
+    vector<vector<int32_t> > rowNodes(numRoots);
+    vector<vector<float> > rowDists(numRoots);
+#pragma omp CARET_PAR
+    {
+        MultiRootWorker myWorker(numNodes, (smoothflag ? myBase.m_flatSmoothStart.data() : myBase.m_flatStart.data()),
+                                 (smoothflag ? myBase.m_flatSmoothNeighbors.data() : myBase.m_flatNeighbors.data()),
+                                 (smoothflag ? myBase.m_flatSmoothDists.data() : myBase.m_flatDists.data()));
+        vector<pair<int32_t, float> > found;
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t i = 0; i < numRoots; ++i)
+        {
+            myWorker.run(roots[i], true, maxdist, found);
+            sort(found.begin(), found.end());//sorted by node, so rows can be written directly into a matrix
+            int64_t numFound = (int64_t)found.size();
+            rowNodes[i].resize(numFound);
+            rowDists[i].resize(numFound);
+            for (int64_t j = 0; j < numFound; ++j)
+            {
+                rowNodes[i][j] = found[j].first;
+                rowDists[i][j] = found[j].second;
+            }
+        }
+    }
+    for (int64_t i = 0; i < numRoots; ++i)
+    {
+        rowStartsOut[i + 1] = rowStartsOut[i] + rowNodes[i].size();
+    }
+    nodesOut.reserve(rowStartsOut[numRoots]);
+    distsOut.reserve(rowStartsOut[numRoots]);
+    for (int64_t i = 0; i < numRoots; ++i)
+    {
+        nodesOut.insert(nodesOut.end(), rowNodes[i].begin(), rowNodes[i].end());
+        distsOut.insert(distsOut.end(), rowDists[i].begin(), rowDists[i].end());
+        vector<int32_t>().swap(rowNodes[i]);//release memory as we go
+        vector<float>().swap(rowDists[i]);
+    }
+}
+
+void GeodesicMultiRootHelper::getGeoFromNodes(const vector<int32_t>& roots, float* valuesOut, const bool smoothflag) const
+{
+    const int32_t numNodes = m_myBase->numNodes;
+    const int64_t numRoots = (int64_t)roots.size();
+    CaretAssert(valuesOut != NULL);
+    if (valuesOut == NULL) return;
+    for (int64_t i = 0; i < numRoots; ++i)
+    {
+        CaretAssert(roots[i] >= 0 && roots[i] < numNodes);
+        if (roots[i] < 0 || roots[i] >= numNodes) return;
+    }
+    const GeodesicHelperBase& myBase = *m_myBase;
+#pragma omp CARET_PAR
+    {
+        MultiRootWorker myWorker(numNodes, (smoothflag ? myBase.m_flatSmoothStart.data() : myBase.m_flatStart.data()),
+                                 (smoothflag ? myBase.m_flatSmoothNeighbors.data() : myBase.m_flatNeighbors.data()),
+                                 (smoothflag ? myBase.m_flatSmoothDists.data() : myBase.m_flatDists.data()));
+        vector<pair<int32_t, float> > found;
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t i = 0; i < numRoots; ++i)
+        {
+            myWorker.run(roots[i], false, 0.0f, found);
+            float* row = valuesOut + i * numNodes;
+            for (int32_t j = 0; j < numNodes; ++j) row[j] = -1.0f;//disconnected vertices get -1
+            for (size_t j = 0; j < found.size(); ++j)
+            {
+                row[found[j].first] = found[j].second;
+            }
+        }
+    }
+}
@@ -58,9 +58,14 @@ namespace caret {
         int32_t numNodes;
         float m_avgNodeSpacing;//to use for balancing line following penalty
         float m_corrAreaSmallestFactor;//so that heuristics can be consistent despite corrected areas
+        std::vector<int64_t> m_flatStart, m_flatSmoothStart;//flat (CSR) copies of the neighbor lists, smooth version has neighbors and crawled neighbors together, for GeodesicMultiRootHelper
+        std::vector<int32_t> m_flatNeighbors, m_flatSmoothNeighbors;
+        std::vector<float> m_flatDists, m_flatSmoothDists;
     public:
         explicit GeodesicHelperBase(const SurfaceFile* surfaceIn, const float* correctedAreas = NULL);//NOTE: this is only an APPROXIMATE correction, use the real surface whenever possible
+        int32_t getNumberOfNodes() const { return numNodes; }
         friend class GeodesicHelper;//let it grab the private variables it needs
+        friend class GeodesicMultiRootHelper;
     };
 
     class GeodesicHelper
@@ -143,6 +148,24 @@ namespace caret {
         int32_t getClosestNodeInRoi(const int32_t& root, const char* roi, std::vector<int32_t>& pathNodesOut, std::vector<float>& pathDistsOut, bool smoothflag);
     };
 
+    ///computes distances from many roots at once, one root per thread, all threads sharing the flat neighbor lists in the base
+    ///NOTE: uses an exact radix heap instead of CaretMinHeap, distances are identical to those from GeodesicHelper
+    class GeodesicMultiRootHelper
+    {
+        CaretPointer<const GeodesicHelperBase> m_myBase;
+        GeodesicMultiRootHelper();
+    public:
+        explicit GeodesicMultiRootHelper(const CaretPointer<const GeodesicHelperBase>& baseIn);
+        
+        /// Get distances from each root up to a geodesic distance cutoff, output is sparse and grouped by root:
+        /// elements rowStartsOut[i] through rowStartsOut[i + 1] - 1 of nodesOut and distsOut belong to roots[i], sorted by node
+        void getNodesToGeoDist(const std::vector<int32_t>& roots, const float& maxdist, std::vector<int64_t>& rowStartsOut,
+                               std::vector<int32_t>& nodesOut, std::vector<float>& distsOut, const bool smoothflag = true) const;
+        
+        /// Get distances from each root to entire surface, valuesOut must be allocated to roots.size() * number of nodes, one row per root
+        void getGeoFromNodes(const std::vector<int32_t>& roots, float* valuesOut, const bool smoothflag = true) const;
+    };
+
 } //namespace caret
 
 #endif
@@ -0,0 +1,235 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "GeodesicNeighborhood.h"
+
+#include "CaretAssert.h"
+#include "CaretBinaryFile.h"
+#include "CaretException.h"
+#include "CaretLogger.h"
+#include "CaretMutex.h"
+#include "GeodesicHelper.h"
+#include "SurfaceFile.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <cstring>
+#include <limits>
+#include <map>
+#include <new>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    const char GEODESIC_NEIGHBORHOOD_MAGIC[8] = { 'W', 'B', 'G', 'E', 'O', 'N', 'B', '1' };
+    const int32_t GEODESIC_NEIGHBORHOOD_VERSION = 1;//change this if the distances GeodesicHelper computes change
+    
+    CaretMutex g_neighborhoodMutex;//protects everything below
+    AString g_cacheDirectory;
+    map<QByteArray, CaretPointer<const GeodesicNeighborhood> > g_neighborhoodCache;//the most recent one is kept even when unused, so consecutive algorithms can share it
+    
+    void trimCache(const QByteArray& keepKey)
+    {//drop neighborhoods nobody else is using, they can be large
+        map<QByteArray, CaretPointer<const GeodesicNeighborhood> >::iterator iter = g_neighborhoodCache.begin();
+        while (iter != g_neighborhoodCache.end())
+        {
+            if (iter->first != keepKey && iter->second.getReferenceCount() == 1)
+            {
+                g_neighborhoodCache.erase(iter++);
+            } else {
+                ++iter;
+            }
+        }
+    }
+    
+    AString cacheFileName(const QByteArray& key)
+    {
+        if (g_cacheDirectory == "") return "";
+        return QDir(g_cacheDirectory).filePath("geodesic_neighborhood_" + QString(key.toHex()) + ".bin");
+    }
+}
+
+void GeodesicNeighborhood::setCacheDirectory(const AString& directory)
+{
+    CaretMutexLocker myLock(&g_neighborhoodMutex);
+    g_cacheDirectory = directory;
+}
+
+QByteArray GeodesicNeighborhood::computeKey(const SurfaceFile* surf, const float& distance, const float* correctedAreas)
+{
+    QCryptographicHash myHash(QCryptographicHash::Sha1);
+    int32_t numNodes = surf->getNumberOfNodes(), numTris = surf->getNumberOfTriangles();
+    myHash.addData((const char*)&GEODESIC_NEIGHBORHOOD_VERSION, sizeof(int32_t));
+    myHash.addData((const char*)&numNodes, sizeof(int32_t));
+    myHash.addData((const char*)&numTris, sizeof(int32_t));
+    myHash.addData((const char*)surf->getCoordinateData(), sizeof(float) * 3 * numNodes);
+    for (int32_t i = 0; i < numTris; ++i)
+    {
+        myHash.addData((const char*)surf->getTriangle(i), sizeof(int32_t) * 3);
+    }
+    char hasAreas = (correctedAreas != NULL) ? 1 : 0;
+    myHash.addData(&hasAreas, 1);
+    if (correctedAreas != NULL)
+    {
+        myHash.addData((const char*)correctedAreas, sizeof(float) * numNodes);
+    }
+    myHash.addData((const char*)&distance, sizeof(float));
+    return myHash.result();
+}
+
+CaretPointer<const GeodesicNeighborhood> GeodesicNeighborhood::lookup(const QByteArray& key, const int32_t& numNodes)
+{//caller must hold the mutex
+    map<QByteArray, CaretPointer<const GeodesicNeighborhood> >::iterator iter = g_neighborhoodCache.find(key);
+    if (iter != g_neighborhoodCache.end()) return iter->second;
+    AString fileName = cacheFileName(key);
+    if (fileName != "" && QFileInfo(fileName).exists())
+    {
+        CaretPointer<GeodesicNeighborhood> ret(new GeodesicNeighborhood());
+        if (ret->readFile(fileName) && ret->m_key == key && ret->getNumberOfNodes() == numNodes)
+        {
+            trimCache(key);
+            g_neighborhoodCache[key] = ret;
+            return ret;
+        }
+        CaretLogWarning("ignoring unreadable or mismatched geodesic neighborhood cache file '" + fileName + "'");
+    }
+    return CaretPointer<const GeodesicNeighborhood>();
+}
+
+CaretPointer<const GeodesicNeighborhood> GeodesicNeighborhood::getIfCached(const SurfaceFile* surf, const float& distance, const float* correctedAreas)
+{
+    QByteArray myKey = computeKey(surf, distance, correctedAreas);
+    CaretMutexLocker myLock(&g_neighborhoodMutex);
+    return lookup(myKey, surf->getNumberOfNodes());
+}
+
+CaretPointer<const GeodesicNeighborhood> GeodesicNeighborhood::get(const SurfaceFile* surf, const float& distance, const float* correctedAreas)
+{
+    CaretAssert(distance >= 0.0f);
+    QByteArray myKey = computeKey(surf, distance, correctedAreas);
+    int32_t numNodes = surf->getNumberOfNodes();
+    {
+        CaretMutexLocker myLock(&g_neighborhoodMutex);
+        CaretPointer<const GeodesicNeighborhood> cached = lookup(myKey, numNodes);
+        if (cached != NULL) return cached;
+    }
+    CaretPointer<GeodesicNeighborhood> ret(new GeodesicNeighborhood());
+    ret->m_distance = distance;
+    ret->m_key = myKey;
+    CaretPointer<GeodesicHelperBase> myBase(new GeodesicHelperBase(surf, correctedAreas));
+    GeodesicMultiRootHelper myHelp(myBase);
+    vector<int32_t> roots(numNodes);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        roots[i] = i;
+    }
+    myHelp.getNodesToGeoDist(roots, distance, ret->m_rowStarts, ret->m_nodes, ret->m_dists);//parallel over roots
+    CaretMutexLocker myLock(&g_neighborhoodMutex);
+    AString fileName = cacheFileName(myKey);
+    if (fileName != "")
+    {
+        try
+        {
+            ret->writeFile(fileName);
+        } catch (CaretException& e) {//the cache is optional, don't fail the algorithm
+            CaretLogWarning("failed to save geodesic neighborhood cache file: " + e.whatString());
+        }
+    }
+    trimCache(myKey);
+    g_neighborhoodCache[myKey] = ret;
+    return ret;
+}
+
+void GeodesicNeighborhood::getNodesToGeoDist(const int32_t& node, vector<int32_t>& neighborsOut, vector<float>& distsOut) const
+{
+    CaretAssert(node >= 0 && node < getNumberOfNodes());
+    neighborsOut.assign(m_nodes.begin() + m_rowStarts[node], m_nodes.begin() + m_rowStarts[node + 1]);
+    distsOut.assign(m_dists.begin() + m_rowStarts[node], m_dists.begin() + m_rowStarts[node + 1]);
+}
+
+bool GeodesicNeighborhood::readFile(const AString& fileName)
+{
+    try
+    {
+        CaretBinaryFile myFile(fileName, CaretBinaryFile::READ);
+        char magic[8];
+        myFile.read(magic, 8);
+        if (memcmp(magic, GEODESIC_NEIGHBORHOOD_MAGIC, 8) != 0) return false;
+        char keyBytes[20];
+        myFile.read(keyBytes, 20);
+        m_key = QByteArray(keyBytes, 20);
+        myFile.read(&m_distance, sizeof(float));
+        int64_t numNodes = 0, numEntries = 0;
+        myFile.read(&numNodes, sizeof(int64_t));
+        myFile.read(&numEntries, sizeof(int64_t));
+        if (numNodes < 0 || numNodes > numeric_limits<int32_t>::max() || numEntries < 0 || numEntries > numNodes * numNodes) return false;
+        m_rowStarts.resize(numNodes + 1);
+        m_nodes.resize(numEntries);
+        m_dists.resize(numEntries);
+        myFile.read(m_rowStarts.data(), sizeof(int64_t) * (numNodes + 1));
+        myFile.read(m_nodes.data(), sizeof(int32_t) * numEntries);
+        myFile.read(m_dists.data(), sizeof(float) * numEntries);
+        if (m_rowStarts[0] != 0 || m_rowStarts[numNodes] != numEntries) return false;
+        for (int64_t i = 0; i < numNodes; ++i)
+        {//a damaged file could still have a matching key, don't let the accessors read out of bounds
+            if (m_rowStarts[i + 1] < m_rowStarts[i]) return false;
+        }
+        for (int64_t i = 0; i < numEntries; ++i)
+        {
+            if (m_nodes[i] < 0 || m_nodes[i] >= numNodes) return false;
+        }
+    } catch (CaretException&) {
+        return false;
+    } catch (bad_alloc&) {//garbage sizes
+        return false;
+    }
+    return true;
+}
+
+void GeodesicNeighborhood::writeFile(const AString& fileName) const
+{//native byte order, these are a local cache, not an interchange format
+    AString tempName = fileName + ".tmp" + AString::number(QCoreApplication::applicationPid());//another process may be writing the same file, rename when done
+    {
+        CaretBinaryFile myFile(tempName, CaretBinaryFile::WRITE_TRUNCATE);
+        myFile.write(GEODESIC_NEIGHBORHOOD_MAGIC, 8);
+        CaretAssert(m_key.size() == 20);
+        myFile.write(m_key.constData(), 20);
+        myFile.write(&m_distance, sizeof(float));
+        int64_t numNodes = getNumberOfNodes(), numEntries = (int64_t)m_nodes.size();
+        myFile.write(&numNodes, sizeof(int64_t));
+        myFile.write(&numEntries, sizeof(int64_t));
+        myFile.write(m_rowStarts.data(), sizeof(int64_t) * (numNodes + 1));
+        myFile.write(m_nodes.data(), sizeof(int32_t) * numEntries);
+        myFile.write(m_dists.data(), sizeof(float) * numEntries);
+    }
+    QFile::remove(fileName);
+    if (!QFile::rename(tempName, fileName))
+    {
+        QFile::remove(tempName);
+        throw CaretException("could not rename '" + tempName + "' to '" + fileName + "'");
+    }
+}
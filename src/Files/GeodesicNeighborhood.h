@@ -0,0 +1,71 @@
+#ifndef __GEODESIC_NEIGHBORHOOD_H__
+#define __GEODESIC_NEIGHBORHOOD_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+#include "CaretPointer.h"
+
+#include <QByteArray>
+
+#include <vector>
+#include "stdint.h"
+
+namespace caret {
+    
+    class SurfaceFile;
+    
+    ///geodesic neighborhoods of every vertex within a distance, in CSR form, computed in parallel and shared between algorithms
+    ///each neighborhood includes the vertex itself and is sorted by vertex, distances match GeodesicHelper::getNodesToGeoDist
+    class GeodesicNeighborhood
+    {
+        std::vector<int64_t> m_rowStarts;
+        std::vector<int32_t> m_nodes;
+        std::vector<float> m_dists;
+        float m_distance;
+        QByteArray m_key;//hash of the surface, corrected areas, and distance
+        GeodesicNeighborhood() { }
+        GeodesicNeighborhood(const GeodesicNeighborhood&);
+        GeodesicNeighborhood& operator=(const GeodesicNeighborhood&);
+        bool readFile(const AString& fileName);
+        void writeFile(const AString& fileName) const;
+        static QByteArray computeKey(const SurfaceFile* surf, const float& distance, const float* correctedAreas);
+        static CaretPointer<const GeodesicNeighborhood> lookup(const QByteArray& key, const int32_t& numNodes);
+    public:
+        ///get the neighborhoods of all vertices, from memory or the cache directory if they were already computed for the same surface, areas and distance
+        static CaretPointer<const GeodesicNeighborhood> get(const SurfaceFile* surf, const float& distance, const float* correctedAreas = NULL);
+        ///only return neighborhoods that don't need computing, otherwise NULL, for callers that only need a few vertices
+        static CaretPointer<const GeodesicNeighborhood> getIfCached(const SurfaceFile* surf, const float& distance, const float* correctedAreas = NULL);
+        ///directory to save computed neighborhoods to and load them from, empty (the default) disables saving
+        static void setCacheDirectory(const AString& directory);
+        
+        float getDistance() const { return m_distance; }
+        int32_t getNumberOfNodes() const { return (int32_t)m_rowStarts.size() - 1; }
+        int64_t getNeighborCount(const int32_t& node) const { return m_rowStarts[node + 1] - m_rowStarts[node]; }
+        const int32_t* getNeighbors(const int32_t& node) const { return m_nodes.data() + m_rowStarts[node]; }
+        const float* getDistances(const int32_t& node) const { return m_dists.data() + m_rowStarts[node]; }
+        ///copy one neighborhood, in the same form as GeodesicHelper::getNodesToGeoDist
+        void getNodesToGeoDist(const int32_t& node, std::vector<int32_t>& neighborsOut, std::vector<float>& distsOut) const;
+    };
+    
+}
+
+#endif //__GEODESIC_NEIGHBORHOOD_H__
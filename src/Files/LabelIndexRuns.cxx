@@ -0,0 +1,91 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "LabelIndexRuns.h"
+
+#include "CaretAssert.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace caret;
+using namespace std;
+
+const vector<LabelIndexRuns::Run> LabelIndexRuns::s_noRuns;
+
+void LabelIndexRuns::build(const float* labelData, const int64_t& size)
+{
+    m_runs.clear();
+    m_size = size;
+    int64_t runStart = 0;
+    while (runStart < size)
+    {
+        const int32_t key = (int32_t)floor(labelData[runStart] + 0.5f);
+        int64_t runEnd = runStart + 1;
+        while (runEnd < size && (int32_t)floor(labelData[runEnd] + 0.5f) == key) ++runEnd;
+        m_runs[key].push_back(Run(runStart, runEnd - runStart));//runs of one key are found in index order
+        runStart = runEnd;
+    }
+}
+
+vector<int32_t> LabelIndexRuns::getKeys() const
+{
+    vector<int32_t> ret;
+    ret.reserve(m_runs.size());
+    for (map<int32_t, vector<Run> >::const_iterator iter = m_runs.begin(); iter != m_runs.end(); ++iter)
+    {
+        ret.push_back(iter->first);
+    }
+    return ret;
+}
+
+const vector<LabelIndexRuns::Run>& LabelIndexRuns::getRuns(const int32_t& key) const
+{
+    map<int32_t, vector<Run> >::const_iterator iter = m_runs.find(key);
+    if (iter == m_runs.end()) return s_noRuns;
+    return iter->second;
+}
+
+int64_t LabelIndexRuns::getCount(const int32_t& key) const
+{
+    const vector<Run>& runs = getRuns(key);
+    int64_t ret = 0;
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        ret += runs[i].length;
+    }
+    return ret;
+}
+
+void LabelIndexRuns::fillRuns(const int32_t& key, float* dataOut, const float& value) const
+{
+    const vector<Run>& runs = getRuns(key);
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        CaretAssert(runs[i].start + runs[i].length <= m_size);
+        fill(dataOut + runs[i].start, dataOut + runs[i].start + runs[i].length, value);
+    }
+}
+
+void LabelIndexRuns::getROI(const int32_t& key, float* roiOut) const
+{
+    fill(roiOut, roiOut + m_size, 0.0f);
+    fillRuns(key, roiOut, 1.0f);
+}
@@ -0,0 +1,67 @@
+#ifndef __LABEL_INDEX_RUNS_H__
+#define __LABEL_INDEX_RUNS_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "stdint.h"
+
+#include <map>
+#include <vector>
+
+namespace caret {
+
+    ///sparse form of the ROIs of every key in one label map: for each key, the runs of consecutive indices that have it
+    ///built in one pass, memory is proportional to the number of runs rather than the number of keys times the map size
+    class LabelIndexRuns
+    {
+    public:
+        struct Run
+        {
+            int64_t start, length;
+            Run(const int64_t& startIn, const int64_t& lengthIn) : start(startIn), length(lengthIn) { }
+        };
+    private:
+        std::map<int32_t, std::vector<Run> > m_runs;
+        int64_t m_size;
+        static const std::vector<Run> s_noRuns;
+    public:
+        LabelIndexRuns() { m_size = 0; }
+        ///label data is stored as float, keys are rounded the same way the label algorithms do
+        LabelIndexRuns(const float* labelData, const int64_t& size) { build(labelData, size); }
+        void build(const float* labelData, const int64_t& size);
+
+        int64_t getSize() const { return m_size; }
+        ///only the keys that occur in the data, in ascending order
+        std::vector<int32_t> getKeys() const;
+        bool hasKey(const int32_t& key) const { return m_runs.find(key) != m_runs.end(); }
+        ///runs in ascending index order, empty if the key doesn't occur
+        const std::vector<Run>& getRuns(const int32_t& key) const;
+        int64_t getCount(const int32_t& key) const;
+
+        ///set the indices that have the key to value, leaving everything else alone, for reusing a zeroed scratch frame
+        void fillRuns(const int32_t& key, float* dataOut, const float& value) const;
+        ///write a complete 0/1 ROI of the key, dataOut must have getSize() elements
+        void getROI(const int32_t& key, float* roiOut) const;
+    };
+
+}
+
+#endif //__LABEL_INDEX_RUNS_H__
@@ -0,0 +1,254 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "MetricGradientObject.h"
+
+#include "CaretAssert.h"
+#include "SurfaceFile.h"
+#include "TopologyHelper.h"
+#include "Vector3D.h"
+#include <cmath>
+
+using namespace std;
+using namespace caret;
+
+namespace
+{
+    //same elimination order as MatrixFunctions::rref for small matrices, without allocating
+    void rref3x4(float mat[3][4])
+    {
+        int myrow = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            if (myrow >= 3) break;
+            float tempval = 0;
+            int pivotrow = -1;
+            for (int j = myrow; j < 3; ++j)
+            {
+                if (abs(mat[j][i]) > tempval)
+                {
+                    pivotrow = j;
+                    tempval = abs(mat[j][i]);
+                }
+            }
+            if (pivotrow == -1) continue;
+            if (pivotrow != myrow)
+            {
+                for (int k = 0; k < 4; ++k)
+                {
+                    float swapval = mat[pivotrow][k];
+                    mat[pivotrow][k] = mat[myrow][k];
+                    mat[myrow][k] = swapval;
+                }
+            }
+            tempval = mat[myrow][i];
+            mat[myrow][i] = 1;
+            for (int j = i + 1; j < 4; ++j)
+            {
+                mat[myrow][j] /= tempval;
+            }
+            for (int j = 0; j < 3; ++j)
+            {
+                if (j == myrow) continue;
+                tempval = mat[j][i];
+                mat[j][i] = 0;
+                for (int k = i + 1; k < 4; ++k)
+                {
+                    mat[j][k] -= tempval * mat[myrow][k];
+                }
+            }
+            ++myrow;
+        }
+    }
+}
+
+MetricGradientObject::MetricGradientObject(SurfaceFile* mySurf, const float* correctedAreas)
+{
+    CaretAssert(mySurf != NULL);
+    m_numNodes = mySurf->getNumberOfNodes();
+    mySurf->computeNormals();
+    const float* myNormals = mySurf->getNormalData();
+    const float* myCoords = mySurf->getCoordinateData();
+    vector<float> sqrtCorrAreas, sqrtVertAreas;
+    if (correctedAreas != NULL)
+    {
+        sqrtCorrAreas.resize(m_numNodes);
+        mySurf->computeNodeAreas(sqrtVertAreas);
+        m_vertAreas.resize(m_numNodes);
+        for (int32_t i = 0; i < m_numNodes; ++i)
+        {
+            sqrtCorrAreas[i] = sqrt(correctedAreas[i]);
+            sqrtVertAreas[i] = sqrt(sqrtVertAreas[i]);
+            m_vertAreas[i] = correctedAreas[i];
+        }
+    } else {
+        mySurf->computeNodeAreas(m_vertAreas);
+    }
+    CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
+    m_neighStart.resize(m_numNodes + 1);
+    m_neighStart[0] = 0;
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        int32_t numNeigh;
+        myTopoHelp->getNodeNeighbors(i, numNeigh);
+        m_neighStart[i + 1] = m_neighStart[i] + numNeigh;
+    }
+    int64_t numEdges = m_neighStart[m_numNodes];
+    m_neighbors.resize(numEdges);
+    m_xmag.resize(numEdges);
+    m_ymag.resize(numEdges);
+    m_xfallback.resize(numEdges);
+    m_yfallback.resize(numEdges);
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {//same math as AlgorithmMetricGradient, minus the parts that depend on the data
+        int32_t numNeigh;
+        int32_t i3 = i * 3;
+        const int32_t* myNeighbors = myTopoHelp->getNodeNeighbors(i, numNeigh);
+        Vector3D myNormal = Vector3D(myNormals + i3).normal();
+        Vector3D myCoord = myCoords + i3;
+        Vector3D somevec, xhat, yhat;
+        somevec[2] = 0.0;
+        if (abs(myNormal[0]) > abs(myNormal[1]))
+        {
+            somevec[0] = 0.0;
+            somevec[1] = 1.0;
+        } else {
+            somevec[0] = 1.0;
+            somevec[1] = 0.0;
+        }
+        xhat = myNormal.cross(somevec).normal();
+        yhat = myNormal.cross(xhat).normal();
+        int64_t base = m_neighStart[i];
+        for (int32_t j = 0; j < numNeigh; ++j)
+        {
+            int32_t whichNode = myNeighbors[j];
+            m_neighbors[base + j] = whichNode;
+            Vector3D neighCoord = myCoords + whichNode * 3;
+            somevec = neighCoord - myCoord;
+            float origMag = somevec.length();
+            float unrollMag = origMag;
+            float opposite = somevec.dot(myNormal);
+            if (abs(opposite) > 0.035f * origMag)
+            {
+                unrollMag = origMag * asin(opposite / origMag) * origMag / opposite;
+            }
+            if (correctedAreas != NULL)
+            {
+                unrollMag *= (sqrtCorrAreas[i] + sqrtCorrAreas[whichNode]) / (sqrtVertAreas[i] + sqrtVertAreas[whichNode]);
+            }
+            float xmag = xhat.dot(somevec);
+            float ymag = yhat.dot(somevec);
+            float mag2d = sqrt(xmag * xmag + ymag * ymag);
+            float divisor = unrollMag * mag2d;
+            m_xfallback[base + j] = xmag / divisor;
+            m_yfallback[base + j] = ymag / divisor;
+            m_xmag[base + j] = xmag * (unrollMag / mag2d);
+            m_ymag[base + j] = ymag * (unrollMag / mag2d);
+        }
+    }
+}
+
+bool MetricGradientObject::gradientArray(const float* dataIn, float* gradOut, const float* roi) const
+{
+    CaretAssert(dataIn != NULL);
+    CaretAssert(gradOut != NULL);
+    bool anyFailed = false;
+    const float* vertAreas = m_vertAreas.data();
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        if (roi != NULL && roi[i] <= 0.0f)
+        {
+            gradOut[i] = 0.0f;
+            continue;
+        }
+        float nodeValue = dataIn[i];
+        int64_t start = m_neighStart[i], end = m_neighStart[i + 1];
+        int32_t numNeigh = (int32_t)(end - start);
+        int neighCount = 0;
+        float xgrad = 0.0f, ygrad = 0.0f, sanity = 0.0f;
+        if (numNeigh >= 2)
+        {
+            float myRegress[3][4] = { { 0.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 0.0f } };
+            for (int64_t j = start; j < end; ++j)
+            {
+                int32_t whichNode = m_neighbors[j];
+                if (roi == NULL || roi[whichNode] > 0.0f)
+                {
+                    ++neighCount;
+                    float tempf = dataIn[whichNode] - nodeValue;
+                    float xmag = m_xmag[j], ymag = m_ymag[j], area = vertAreas[whichNode];
+                    myRegress[0][0] += xmag * xmag * area;
+                    myRegress[0][1] += xmag * ymag * area;
+                    myRegress[0][2] += xmag * area;
+                    myRegress[1][1] += ymag * ymag * area;
+                    myRegress[1][2] += ymag * area;
+                    myRegress[2][2] += area;
+                    myRegress[0][3] += xmag * tempf * area;
+                    myRegress[1][3] += ymag * tempf * area;
+                    myRegress[2][3] += tempf * area;
+                }
+            }
+            if (neighCount >= 2)
+            {
+                myRegress[1][0] = myRegress[0][1];
+                myRegress[2][0] = myRegress[0][2];
+                myRegress[2][1] = myRegress[1][2];
+                myRegress[2][2] += vertAreas[i];
+                rref3x4(myRegress);
+                xgrad = myRegress[0][3];
+                ygrad = myRegress[1][3];
+                sanity = xgrad + ygrad;
+            }
+        } else {
+            for (int64_t j = start; j < end; ++j)
+            {
+                if (roi == NULL || roi[m_neighbors[j]] > 0.0f) ++neighCount;
+            }
+        }
+        if (neighCount > 0 && (neighCount < 2 || sanity != sanity))
+        {
+            float totalWeight = 0.0f;
+            xgrad = 0.0f;
+            ygrad = 0.0f;
+            for (int64_t j = start; j < end; ++j)
+            {
+                int32_t whichNode = m_neighbors[j];
+                if (roi == NULL || roi[whichNode] > 0.0f)
+                {
+                    float tempf = dataIn[whichNode] - nodeValue;
+                    xgrad += m_xfallback[j] * tempf * vertAreas[whichNode];
+                    ygrad += m_yfallback[j] * tempf * vertAreas[whichNode];
+                    totalWeight += vertAreas[whichNode];
+                }
+            }
+            xgrad /= totalWeight;
+            ygrad /= totalWeight;
+            sanity = xgrad + ygrad;
+        }
+        if (neighCount <= 0 || sanity != sanity)
+        {
+            if (roi == NULL) anyFailed = true;
+            gradOut[i] = 0.0f;
+        } else {
+            gradOut[i] = sqrt(xgrad * xgrad + ygrad * ygrad);//xhat and yhat are orthonormal, so this is the length of the 3D gradient vector
+        }
+    }
+    return anyFailed;
+}
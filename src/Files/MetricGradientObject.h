@@ -0,0 +1,57 @@
+#ifndef __METRIC_GRADIENT_OBJECT_H__
+#define __METRIC_GRADIENT_OBJECT_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+//NOTE: this precomputes the per-vertex geometry that AlgorithmMetricGradient recomputes for every column (normals, tangent plane projection, unrolled
+//      neighbor distances, vertex areas), and stores it in flat arrays indexed by a per-vertex offset (CSR), so that computing the gradient magnitude
+//      of a column is just the regression.  Results match AlgorithmMetricGradient without presmoothing or normal averaging, up to float rounding.
+//
+//NOTE: this object contains no mutable members, and gradientArray() does not use threads, so that callers can compute many columns in parallel.
+
+#include "stdint.h"
+#include <vector>
+
+namespace caret {
+    
+    class SurfaceFile;
+    
+    class MetricGradientObject
+    {
+    public:
+        ///corrected areas are optional, and must have the same number of elements as the surface has vertices
+        MetricGradientObject(SurfaceFile* mySurf, const float* correctedAreas = NULL);
+        ///compute the gradient magnitude of a raw column of values, roi is optional and uses > 0.0f for inclusion, returns true if any vertex failed both methods
+        bool gradientArray(const float* dataIn, float* gradOut, const float* roi = NULL) const;
+        int32_t getNumberOfNodes() const { return m_numNodes; }
+    private:
+        int32_t m_numNodes;
+        std::vector<int64_t> m_neighStart;//size numNodes + 1
+        std::vector<int32_t> m_neighbors;
+        std::vector<float> m_xmag, m_ymag;//unrolled, projected neighbor offsets for the regression
+        std::vector<float> m_xfallback, m_yfallback;//projected direction divided by distance, for the point estimate fallback
+        std::vector<float> m_vertAreas;
+        MetricGradientObject();
+    };
+    
+}
+
+#endif //__METRIC_GRADIENT_OBJECT_H__
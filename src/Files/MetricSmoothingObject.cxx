@@ -140,6 +140,64 @@ void MetricSmoothingObject::smoothMetric(const MetricFile* metricIn, MetricFile*
     }
 }
 
+void MetricSmoothingObject::smoothArray(const float* dataIn, float* dataOut, const float* roi) const
+{
+    CaretAssert(dataIn != NULL);
+    CaretAssert(dataOut != NULL);
+    CaretAssert(dataIn != dataOut);
+    int32_t numNodes = (int32_t)m_weightLists.size();
+    if (roi == NULL)
+    {
+        for (int32_t i = 0; i < numNodes; ++i)
+        {
+            const WeightList& myWeightRef = m_weightLists[i];
+            if (myWeightRef.m_weightSum != 0.0f)
+            {
+                float sum = 0.0f;
+                int32_t numWeights = myWeightRef.m_nodes.size();
+                const int32_t* nodes = myWeightRef.m_nodes.data();
+                const float* weights = myWeightRef.m_weights.data();
+                for (int32_t j = 0; j < numWeights; ++j)
+                {
+                    sum += weights[j] * dataIn[nodes[j]];
+                }
+                dataOut[i] = sum / myWeightRef.m_weightSum;
+            } else {
+                dataOut[i] = 0.0f;
+            }
+        }
+    } else {
+        for (int32_t i = 0; i < numNodes; ++i)
+        {
+            const WeightList& myWeightRef = m_weightLists[i];
+            if (roi[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)
+            {
+                float sum = 0.0f, weightsum = 0.0f;
+                int32_t numWeights = myWeightRef.m_nodes.size();
+                const int32_t* nodes = myWeightRef.m_nodes.data();
+                const float* weights = myWeightRef.m_weights.data();
+                for (int32_t j = 0; j < numWeights; ++j)
+                {
+                    int32_t neighbor = nodes[j];
+                    if (roi[neighbor] > 0.0f)
+                    {
+                        sum += weights[j] * dataIn[neighbor];
+                        weightsum += weights[j];
+                    }
+                }
+                if (weightsum != 0.0f)
+                {
+                    dataOut[i] = sum / weightsum;
+                } else {
+                    dataOut[i] = 0.0f;
+                }
+            } else {
+                dataOut[i] = 0.0f;
+            }
+        }
+    }
+}
+
 void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const bool& fixZeros) const
 {
     CaretAssert(metricIn != NULL);//asserts only, and only basic checks, these functions are private
@@ -52,6 +52,9 @@ namespace caret {
         void smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* columnOut, const MetricFile* roi = NULL, const bool& fixZeros = false) const;
         void smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi = NULL, const int& whichRoiColumn = 0, const bool& fixZeros = false) const;
         void smoothMetric(const MetricFile* metricIn, MetricFile* metricOut, const MetricFile* roi = NULL, const bool& fixZeros = false) const;
+        ///smooth a raw column of values, single threaded so that callers can process many columns in parallel, roi is optional and uses > 0.0f for inclusion
+        void smoothArray(const float* dataIn, float* dataOut, const float* roi = NULL) const;
+        int32_t getNumberOfNodes() const { return (int32_t)m_weightLists.size(); }
     private:
         struct WeightList
         {
@@ -45,6 +45,7 @@
 #include "GeodesicHelper.h"
 #include "PlainTextStringBuilder.h"
 #include "SignedDistanceHelper.h"
+#include "SurfaceRayIntersector.h"
 #include "TopologyHelper.h"
 
 using namespace caret;
@@ -884,6 +885,11 @@ void SurfaceFile::invalidateHelpers()
         CaretMutexLocker myLock3(&m_locatorMutex);
         m_locator.grabNew(NULL);
     }
+    if (m_rayIntersector != NULL)
+    {
+        CaretMutexLocker myLock5(&m_rayIntersectorMutex);
+        m_rayIntersector.grabNew(NULL);
+    }
 }
 
 /**
@@ -1188,6 +1194,19 @@ CaretPointer<const CaretPointLocator> SurfaceFile::getPointLocator() const
     return m_locator;
 }
 
+CaretPointer<const SurfaceRayIntersector> SurfaceFile::getRayIntersector() const
+{
+    if (m_rayIntersector == NULL)
+    {
+        CaretMutexLocker myLock(&m_rayIntersectorMutex);
+        if (m_rayIntersector == NULL)
+        {
+            m_rayIntersector.grabNew(new SurfaceRayIntersector(this));
+        }
+    }
+    return m_rayIntersector;
+}
+
 void SurfaceFile::clearCachedHelpers() const
 {
     {
@@ -1212,6 +1231,10 @@ void SurfaceFile::clearCachedHelpers() const
         CaretMutexLocker locked(&m_locatorMutex);
         m_locator.grabNew(NULL);
     }
+    {
+        CaretMutexLocker locked(&m_rayIntersectorMutex);
+        m_rayIntersector.grabNew(NULL);
+    }
 }
 
 /**
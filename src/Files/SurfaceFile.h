@@ -46,6 +46,7 @@ namespace caret {
     class PlainTextStringBuilder;
     class SignedDistanceHelper;
     class SignedDistanceHelperBase;
+    class SurfaceRayIntersector;
     class TopologyHelper;
     class TopologyHelperBase;
     
@@ -138,6 +139,8 @@ namespace caret {
         
         CaretPointer<const CaretPointLocator> getPointLocator() const;
         
+        CaretPointer<const SurfaceRayIntersector> getRayIntersector() const;
+        
         void clearCachedHelpers() const;
         
         const BoundingBox* getBoundingBox() const;
@@ -292,12 +295,15 @@ namespace caret {
         ///used to search for the closest point in the surface
         mutable CaretPointer<CaretPointLocator> m_locator;
         
+        ///used to find the triangle under the mouse without rendering
+        mutable CaretPointer<SurfaceRayIntersector> m_rayIntersector;
+        
         ///used to track when the surface file gets changed
         void invalidateHelpers();
         
         mutable BoundingBox* boundingBox;
         
-        mutable CaretMutex m_topoHelperMutex, m_geoHelperMutex, m_locatorMutex, m_distHelperMutex;
+        mutable CaretMutex m_topoHelperMutex, m_geoHelperMutex, m_locatorMutex, m_distHelperMutex, m_rayIntersectorMutex;
     };
 
 } // namespace
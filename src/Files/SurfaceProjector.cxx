@@ -21,12 +21,15 @@
 #include <cmath>
 #include <cstdlib>
 #include <limits>
+#include <map>
 
 #define __SURFACE_PROJECTOR_DEFINE__
 #include "SurfaceProjector.h"
 #undef __SURFACE_PROJECTOR_DEFINE__
 
 #include "CaretLogger.h"
+#include "CaretOMP.h"
+#include "CaretPointer.h"
 #include "FociFile.h"
 #include "Focus.h"
 #include "MathFunctions.h"
@@ -109,6 +112,29 @@ m_surfaceFileRight(rightSurfaceFile),
 m_surfaceFileCerebellum(cerebellumSurfaceFile),
 m_mode(MODE_LEFT_RIGHT_CEREBELLUM)
 {
+    initializeMembersSurfaceProjector();
+}
+
+/**
+ * Copy constructor.  Copies the surfaces and settings, but not the
+ * state of any projection in progress, so that each thread of a
+ * batch projection has its own projector.
+ *
+ * @param o
+ *     Projector that is copied.
+ */
+SurfaceProjector::SurfaceProjector(const SurfaceProjector& o)
+: CaretObject(o),
+m_surfaceFiles(o.m_surfaceFiles),
+m_surfaceFileLeft(o.m_surfaceFileLeft),
+m_surfaceFileRight(o.m_surfaceFileRight),
+m_surfaceFileCerebellum(o.m_surfaceFileCerebellum),
+m_mode(o.m_mode)
+{
+    initializeMembersSurfaceProjector();
+    m_surfaceOffset = o.m_surfaceOffset;
+    m_surfaceOffsetValid = o.m_surfaceOffsetValid;
+    m_validateFlag = o.m_validateFlag;
 }
 
 
@@ -135,6 +161,9 @@ SurfaceProjector::initializeMembersSurfaceProjector()
      */
     m_validateFlag = CaretLogger::getLogger()->isFine();
     m_validateItemName = "";
+    m_allowEdgeProjection = true;
+    m_deferPerturbationFlag = false;
+    m_perturbationDeferredFlag = false;
 }
 
 
@@ -164,28 +193,161 @@ SurfaceProjector::projectFociFile(FociFile* fociFile)
     CaretAssert(fociFile);
     const int32_t numberOfFoci = fociFile->getNumberOfFoci();
     
-    AString errorMessage = "";
+    std::vector<Focus*> foci(numberOfFoci);
+    std::vector<int32_t> focusIndices(numberOfFoci);
+    for (int32_t i = 0; i < numberOfFoci; i++) {
+        foci[i] = fociFile->getFocus(i);
+        focusIndices[i] = i;
+    }
+    
+    projectFoci(foci,
+                focusIndices);
+}
+
+/**
+ * Project many foci.  Foci are projected in parallel, and the
+ * results are identical to projecting each focus with projectFocus()
+ * in the order given.
+ *
+ * @param foci
+ *     The foci.
+ * @param focusIndices
+ *     Index of each focus, used in warning and error messages.
+ * @throws SurfaceProjectorException
+ *      If projecting any of the foci failed, after attempting all foci.
+ */
+void
+SurfaceProjector::projectFoci(const std::vector<Focus*>& foci,
+                              const std::vector<int32_t>& focusIndices)
+{
+    projectFoci(std::vector<SurfaceProjector*>(foci.size(), this),
+                foci,
+                focusIndices);
+}
+
+/**
+ * Project many foci, each with its own projector (such as one projector
+ * per structure).  Foci are projected in parallel, and the results are
+ * identical to projecting each focus with its projector's projectFocus()
+ * in the order given.
+ *
+ * Foci whose first projection has a large error are moved by small
+ * random amounts and projected again.  So that the sequence of random
+ * numbers is the same as projecting one at a time, these foci are
+ * projected again, serially and in order, after the parallel pass.
+ * This pass covers the foci of all projectors, so foci of different
+ * projectors must be given in one call to keep the random sequence.
+ *
+ * @param projectors
+ *     Projector for each focus.
+ * @param foci
+ *     The foci.
+ * @param focusIndices
+ *     Index of each focus, used in warning and error messages.
+ * @throws SurfaceProjectorException
+ *      If projecting any of the foci failed, after attempting all foci.
+ */
+void
+SurfaceProjector::projectFoci(const std::vector<SurfaceProjector*>& projectors,
+                              const std::vector<Focus*>& foci,
+                              const std::vector<int32_t>& focusIndices)
+{
+    CaretAssert(foci.size() == focusIndices.size());
+    CaretAssert(foci.size() == projectors.size());
+    const int32_t numberOfFoci = static_cast<int32_t>(foci.size());
+    
+    std::vector<AString> errorMessages(numberOfFoci);
+    std::vector<AString> warningMessages(numberOfFoci);
+    std::vector<char> serialFlags(numberOfFoci, 1);
+    
+    /*
+     * Validation logs each item as it is projected, and debug
+     * builds record each CaretObject (projections create them)
+     * in an unsynchronized map, so both project serially.
+     */
+#ifdef NDEBUG
+    bool parallelFlag = true;
+    for (int32_t i = 0; i < numberOfFoci; i++) {
+        CaretAssert(projectors[i]);
+        if (projectors[i]->m_validateFlag) {
+            parallelFlag = false;
+            break;
+        }
+    }
+#else
+    const bool parallelFlag = false;
+#endif
+    
+    if (parallelFlag) {
+#pragma omp CARET_PAR
+        {
+            std::map<const SurfaceProjector*, CaretPointer<SurfaceProjector> > threadProjectors;
+#pragma omp CARET_FOR schedule(dynamic, 16)
+            for (int32_t i = 0; i < numberOfFoci; i++) {
+                CaretPointer<SurfaceProjector>& threadProjector = threadProjectors[projectors[i]];
+                if (threadProjector == NULL) {
+                    threadProjector.grabNew(new SurfaceProjector(*projectors[i]));
+                    threadProjector->m_deferPerturbationFlag = true;
+                }
+                threadProjector->m_perturbationDeferredFlag = false;
+                try {
+                    threadProjector->projectFocusItems(foci[i]);
+                    if ( ! threadProjector->m_perturbationDeferredFlag) {
+                        warningMessages[i] = threadProjector->getFocusWarningMessage(focusIndices[i],
+                                                                                     foci[i]);
+                        serialFlags[i] = 0;
+                    }
+                }
+                catch (const CaretException& e) {
+                    /*
+                     * If perturbation was deferred, the serial pass
+                     * needs to consume its random numbers before failing.
+                     */
+                    if ( ! threadProjector->m_perturbationDeferredFlag) {
+                        errorMessages[i] = e.whatString();
+                        serialFlags[i] = 0;
+                    }
+                }
+            }
+        }
+    }
+    
     for (int32_t i = 0; i < numberOfFoci; i++) {
-        Focus* focus = fociFile->getFocus(i);
+        if (serialFlags[i] == 0) {
+            continue;
+        }
+        SurfaceProjector* projector = projectors[i];
+        Focus* focus = foci[i];
         try {
-            if (m_validateFlag) {
-                m_validateItemName = ("Focus "
-                                      + AString::number(i)
-                                      + ", "
-                                      + focus->getName());
+            if (projector->m_validateFlag) {
+                projector->m_validateItemName = ("Focus "
+                                                 + AString::number(focusIndices[i])
+                                                 + ", "
+                                                 + focus->getName());
             }
-            projectFocus(i,
-                         focus);
+            projector->projectFocusItems(focus);
+            warningMessages[i] = projector->getFocusWarningMessage(focusIndices[i],
+                                                                   focus);
         }
         catch (const SurfaceProjectorException& spe) {
+            errorMessages[i] = spe.whatString();
+        }
+    }
+    
+    AString errorMessage = "";
+    for (int32_t i = 0; i < numberOfFoci; i++) {
+        if (warningMessages[i].isEmpty() == false) {
+            CaretLogWarning(warningMessages[i]);
+        }
+        if (errorMessages[i].isEmpty() == false) {
             if (errorMessage.isEmpty() == false) {
                 errorMessage += "\n";
             }
-            errorMessage += (focus->getName()
+            errorMessage += (foci[i]->getName()
                              + ", index="
-                             + AString::number(i)
+                             + AString::number(focusIndices[i])
                              + ": "
-                             + spe.whatString());
+                             + errorMessages[i]);
         }
     }
     
@@ -206,6 +368,25 @@ SurfaceProjector::projectFociFile(FociFile* fociFile)
 void
 SurfaceProjector::projectFocus(const int32_t focusIndex,
                                Focus* focus)
+{
+    projectFocusItems(focus);
+    
+    const AString msg = getFocusWarningMessage(focusIndex,
+                                               focus);
+    if (msg.isEmpty() == false) {
+        CaretLogWarning(msg);
+    }
+}
+
+/**
+ * Project a focus without logging any warning.
+ * @param focus
+ *    The focus.
+ * @throws SurfaceProjectorException
+ *      If projecting an item failed.
+ */
+void
+SurfaceProjector::projectFocusItems(Focus* focus)
 {
     const int32_t numberOfProjections = focus->getNumberOfProjections();
     CaretAssert(numberOfProjections > 0);
@@ -221,8 +402,14 @@ SurfaceProjector::projectFocus(const int32_t focusIndex,
     }
     
     m_allowEdgeProjection = true;
-    projectItem(spi,
-                spiSecond);
+    try {
+        projectItem(spi,
+                    spiSecond);
+    }
+    catch (const SurfaceProjectorException&) {
+        delete spiSecond;
+        throw;
+    }
     
     if (spiSecond != NULL) {
         if (spiSecond->hasValidProjection()) {
@@ -233,18 +420,33 @@ SurfaceProjector::projectFocus(const int32_t focusIndex,
             spiSecond = NULL;
         }
     }
+}
+
+/**
+ * @return Warning message for the most recently projected focus,
+ * empty if there was no warning.
+ * @param focusIndex
+ *    Index of the focus (negative indicates no index)
+ * @param focus
+ *    The focus.
+ */
+AString
+SurfaceProjector::getFocusWarningMessage(const int32_t focusIndex,
+                                         const Focus* focus) const
+{
+    if (m_projectionWarning.isEmpty()) {
+        return "";
+    }
     
-    if (m_projectionWarning.isEmpty() == false) {
-        AString msg = ("Focus: Name="
-                       + focus->getName());
-        if (focusIndex >= 0) {
-            msg += (", Index="
-                    + AString::number(focusIndex));
-        }
-        msg += (": "
-                + m_projectionWarning);
-        CaretLogWarning(msg);;
+    AString msg = ("Focus: Name="
+                   + focus->getName());
+    if (focusIndex >= 0) {
+        msg += (", Index="
+                + AString::number(focusIndex));
     }
+    msg += (": "
+            + m_projectionWarning);
+    return msg;
 }
 
 /**
@@ -486,6 +688,14 @@ SurfaceProjector::projectItemToSurfaceFile(const SurfaceFile* surfaceFile,
     }
     
     if (distanceError > s_projectionDistanceError) {
+        if (m_deferPerturbationFlag) {
+            /*
+             * Perturbation uses std::rand(), leave it for the serial
+             * pass so the random sequence matches projecting in order.
+             */
+            m_perturbationDeferredFlag = true;
+            return;
+        }
         bool perturbIfError = true;
         if (perturbIfError) {
             /*
@@ -28,6 +28,7 @@
 #include <stdint.h>
 
 #include <set>
+#include <vector>
 
 namespace caret {
     
@@ -62,6 +63,13 @@ namespace caret {
         
         void projectFociFile(FociFile* fociFile);
         
+        void projectFoci(const std::vector<Focus*>& foci,
+                         const std::vector<int32_t>& focusIndices);
+        
+        static void projectFoci(const std::vector<SurfaceProjector*>& projectors,
+                                const std::vector<Focus*>& foci,
+                                const std::vector<int32_t>& focusIndices);
+        
         void projectFocus(const int32_t focusIndex,
                           Focus* focus);
         
@@ -122,6 +130,11 @@ namespace caret {
 
         void initializeMembersSurfaceProjector();
         
+        void projectFocusItems(Focus* focus);
+        
+        AString getFocusWarningMessage(const int32_t focusIndex,
+                                       const Focus* focus) const;
+        
         void getProjectionLocation(const SurfaceFile* surfaceFile,
                                    const float xyz[3],
                                    ProjectionLocation& projectionLocation) const;
@@ -193,6 +206,12 @@ namespace caret {
         
         bool m_validateFlag;
         
+        /** When set, an item needing random perturbation is left for a later serial pass */
+        bool m_deferPerturbationFlag;
+        
+        /** Set when an item was left for the serial pass */
+        bool m_perturbationDeferredFlag;
+        
         AString m_validateItemName;
         
         AString m_projectionWarning;
@@ -0,0 +1,248 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SurfaceRayIntersector.h"
+
+#include "CaretAssert.h"
+#include "SurfaceFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+using namespace caret;
+
+namespace
+{
+    struct CenterLess
+    {
+        const float* m_centers;
+        int m_axis;
+        CenterLess(const float* centers, const int axis) : m_centers(centers), m_axis(axis) { }
+        bool operator()(const int32_t& lhs, const int32_t& rhs) const
+        {
+            return m_centers[lhs * 3 + m_axis] < m_centers[rhs * 3 + m_axis];
+        }
+    };
+
+    ///returns whether the ray enters the box between tMin and tMax, and where
+    bool rayHitsBox(const float boxMin[3], const float boxMax[3], const double origin[3], const double invDir[3],
+                    const double& tMin, const double& tMax, double& tEnterOut)
+    {
+        double enter = tMin, leave = tMax;
+        for (int i = 0; i < 3; ++i)
+        {
+            double t1 = (boxMin[i] - origin[i]) * invDir[i];
+            double t2 = (boxMax[i] - origin[i]) * invDir[i];
+            if (t1 > t2) swap(t1, t2);
+            if (t1 > enter) enter = t1;//NaN from 0 * inf (ray in the slab plane) fails both comparisons, which leaves the interval alone
+            if (t2 < leave) leave = t2;
+            if (enter > leave) return false;
+        }
+        tEnterOut = enter;
+        return true;
+    }
+}
+
+SurfaceRayIntersector::SurfaceRayIntersector(const SurfaceFile* mySurf)
+{
+    CaretAssert(mySurf != NULL);
+    const int32_t numNodes = mySurf->getNumberOfNodes();
+    const int32_t numTris = mySurf->getNumberOfTriangles();
+    m_coordList.resize(numNodes * 3);
+    if (numNodes > 0)
+    {
+        const float* coords = mySurf->getCoordinateData();
+        for (int32_t i = 0; i < numNodes * 3; ++i)
+        {
+            m_coordList[i] = coords[i];
+        }
+    }
+    m_triangleList.resize(numTris * 3);
+    m_triOrder.resize(numTris);
+    vector<float> centers(numTris * 3);
+    for (int32_t i = 0; i < numTris; ++i)
+    {
+        const int32_t* thisTri = mySurf->getTriangle(i);
+        for (int j = 0; j < 3; ++j)
+        {
+            m_triangleList[i * 3 + j] = thisTri[j];
+            centers[i * 3 + j] = (m_coordList[thisTri[0] * 3 + j] + m_coordList[thisTri[1] * 3 + j] + m_coordList[thisTri[2] * 3 + j]) / 3.0f;
+        }
+        m_triOrder[i] = i;
+    }
+    if (numTris > 0)
+    {
+        m_nodes.reserve(2 * (numTris / LEAF_SIZE + 1));
+        build(centers, 0, numTris);
+    }
+}
+
+void SurfaceRayIntersector::build(vector<float>& centers, const int32_t start, const int32_t end)
+{
+    const int32_t myIndex = (int32_t)m_nodes.size();
+    m_nodes.push_back(Node());
+    float boxMin[3], boxMax[3], centerMin[3], centerMax[3];
+    for (int j = 0; j < 3; ++j)
+    {
+        boxMin[j] = centerMin[j] = numeric_limits<float>::max();
+        boxMax[j] = centerMax[j] = -numeric_limits<float>::max();
+    }
+    for (int32_t i = start; i < end; ++i)
+    {
+        const int32_t tri = m_triOrder[i];
+        for (int k = 0; k < 3; ++k)
+        {
+            const float* coord = m_coordList.data() + m_triangleList[tri * 3 + k] * 3;
+            for (int j = 0; j < 3; ++j)
+            {
+                boxMin[j] = min(boxMin[j], coord[j]);
+                boxMax[j] = max(boxMax[j], coord[j]);
+            }
+        }
+        for (int j = 0; j < 3; ++j)
+        {
+            centerMin[j] = min(centerMin[j], centers[tri * 3 + j]);
+            centerMax[j] = max(centerMax[j], centers[tri * 3 + j]);
+        }
+    }
+    for (int j = 0; j < 3; ++j)
+    {
+        m_nodes[myIndex].m_min[j] = boxMin[j];
+        m_nodes[myIndex].m_max[j] = boxMax[j];
+    }
+    int axis = 0;
+    for (int j = 1; j < 3; ++j)
+    {
+        if (centerMax[j] - centerMin[j] > centerMax[axis] - centerMin[axis]) axis = j;
+    }
+    if (end - start <= LEAF_SIZE || !(centerMax[axis] > centerMin[axis]))//also stop if all centers coincide, splitting can't separate them
+    {
+        m_nodes[myIndex].m_start = start;
+        m_nodes[myIndex].m_count = end - start;
+        return;
+    }
+    const int32_t mid = start + (end - start) / 2;
+    nth_element(m_triOrder.begin() + start, m_triOrder.begin() + mid, m_triOrder.begin() + end, CenterLess(centers.data(), axis));
+    build(centers, start, mid);
+    m_nodes[myIndex].m_start = (int32_t)m_nodes.size();//don't hold a reference across build(), push_back can reallocate
+    m_nodes[myIndex].m_count = 0;
+    build(centers, mid, end);
+}
+
+bool SurfaceRayIntersector::testTriangle(const int32_t triangle, const double origin[3], const double direction[3], double& tInOut, double baryOut[3]) const
+{//Moller-Trumbore, in double so that nearly edge-on triangles of large surfaces still resolve
+    const float* v0 = m_coordList.data() + m_triangleList[triangle * 3] * 3;
+    const float* v1 = m_coordList.data() + m_triangleList[triangle * 3 + 1] * 3;
+    const float* v2 = m_coordList.data() + m_triangleList[triangle * 3 + 2] * 3;
+    double edge1[3], edge2[3], s[3], p[3], q[3];
+    for (int j = 0; j < 3; ++j)
+    {
+        edge1[j] = (double)v1[j] - v0[j];
+        edge2[j] = (double)v2[j] - v0[j];
+        s[j] = origin[j] - v0[j];
+    }
+    p[0] = direction[1] * edge2[2] - direction[2] * edge2[1];
+    p[1] = direction[2] * edge2[0] - direction[0] * edge2[2];
+    p[2] = direction[0] * edge2[1] - direction[1] * edge2[0];
+    const double det = edge1[0] * p[0] + edge1[1] * p[1] + edge1[2] * p[2];
+    if (det == 0.0) return false;//ray parallel to triangle, or degenerate triangle
+    const double invDet = 1.0 / det;
+    const double u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * invDet;
+    if (u < 0.0 || u > 1.0) return false;
+    q[0] = s[1] * edge1[2] - s[2] * edge1[1];
+    q[1] = s[2] * edge1[0] - s[0] * edge1[2];
+    q[2] = s[0] * edge1[1] - s[1] * edge1[0];
+    const double v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * invDet;
+    if (v < 0.0 || u + v > 1.0) return false;
+    const double t = (edge2[0] * q[0] + edge2[1] * q[1] + edge2[2] * q[2]) * invDet;
+    if (t > tInOut) return false;
+    tInOut = t;
+    baryOut[0] = 1.0 - u - v;
+    baryOut[1] = u;
+    baryOut[2] = v;
+    return true;
+}
+
+int32_t SurfaceRayIntersector::intersect(const double origin[3], const double direction[3], const double& tMin, const double& tMax,
+                                         double* tOut, double baryOut[3]) const
+{
+    if (m_nodes.empty()) return -1;
+    double invDir[3];
+    for (int j = 0; j < 3; ++j)
+    {
+        invDir[j] = 1.0 / direction[j];//division by zero gives inf, which the slab test handles
+    }
+    int32_t bestTri = -1;
+    double bestT = tMax, bestBary[3] = { 0.0, 0.0, 0.0 };
+    double tEnter;
+    if (!rayHitsBox(m_nodes[0].m_min, m_nodes[0].m_max, origin, invDir, tMin, bestT, tEnter)) return -1;
+    vector<int32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (!stack.empty())
+    {
+        const Node& thisNode = m_nodes[stack.back()];
+        stack.pop_back();
+        if (thisNode.m_count > 0)
+        {
+            for (int32_t i = thisNode.m_start; i < thisNode.m_start + thisNode.m_count; ++i)
+            {
+                double tempT = bestT, tempBary[3];
+                if (testTriangle(m_triOrder[i], origin, direction, tempT, tempBary) && tempT >= tMin)
+                {
+                    bestT = tempT;
+                    bestTri = m_triOrder[i];
+                    for (int j = 0; j < 3; ++j) bestBary[j] = tempBary[j];
+                }
+            }
+        } else {
+            const int32_t first = (int32_t)(&thisNode - m_nodes.data()) + 1, second = thisNode.m_start;
+            double firstEnter, secondEnter;
+            const bool hitFirst = rayHitsBox(m_nodes[first].m_min, m_nodes[first].m_max, origin, invDir, tMin, bestT, firstEnter);
+            const bool hitSecond = rayHitsBox(m_nodes[second].m_min, m_nodes[second].m_max, origin, invDir, tMin, bestT, secondEnter);
+            if (hitFirst && hitSecond)
+            {//visit the nearer child first, so the farther one is more likely to be culled by bestT
+                if (firstEnter < secondEnter)
+                {
+                    stack.push_back(second);
+                    stack.push_back(first);
+                } else {
+                    stack.push_back(first);
+                    stack.push_back(second);
+                }
+            } else if (hitFirst) {
+                stack.push_back(first);
+            } else if (hitSecond) {
+                stack.push_back(second);
+            }
+        }
+    }
+    if (bestTri != -1)
+    {
+        if (tOut != NULL) *tOut = bestT;
+        if (baryOut != NULL)
+        {
+            for (int j = 0; j < 3; ++j) baryOut[j] = bestBary[j];
+        }
+    }
+    return bestTri;
+}
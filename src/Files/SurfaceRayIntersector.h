@@ -0,0 +1,58 @@
+#ifndef __SURFACE_RAY_INTERSECTOR_H__
+#define __SURFACE_RAY_INTERSECTOR_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace caret {
+
+    class SurfaceFile;
+
+    ///bounding volume hierarchy over the triangles of a surface, for finding what a ray (such as a mouse click) hits first
+    class SurfaceRayIntersector
+    {
+        struct Node
+        {
+            float m_min[3], m_max[3];
+            int32_t m_start, m_count;//leaf: range into m_triOrder, internal: m_start is the index of the second child (first child is always next), m_count is 0
+        };
+        static const int LEAF_SIZE = 8;
+        std::vector<Node> m_nodes;
+        std::vector<int32_t> m_triOrder;
+        std::vector<float> m_coordList;//make a copy of what we need from SurfaceFile so that if the SurfaceFile gets destroyed, we don't crash
+        std::vector<int32_t> m_triangleList;
+        void build(std::vector<float>& centers, const int32_t start, const int32_t end);
+        bool testTriangle(const int32_t triangle, const double origin[3], const double direction[3], double& tInOut, double baryOut[3]) const;
+        SurfaceRayIntersector();
+    public:
+        SurfaceRayIntersector(const SurfaceFile* mySurf);
+
+        ///find the first triangle hit by origin + t * direction with tMin <= t <= tMax, returns -1 if no hit, t is in units of direction's length
+        int32_t intersect(const double origin[3], const double direction[3], const double& tMin, const double& tMax,
+                          double* tOut = NULL, double baryOut[3] = NULL) const;
+    };
+
+}
+
+#endif //__SURFACE_RAY_INTERSECTOR_H__
@@ -0,0 +1,116 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SurfaceSmoothingObject.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "MathFunctions.h"
+#include "SurfaceFile.h"
+#include "TopologyHelper.h"
+
+using namespace std;
+using namespace caret;
+
+SurfaceSmoothingObject::SurfaceSmoothingObject(const SurfaceFile* mySurf)
+{
+    CaretAssert(mySurf != NULL);
+    const int32_t numNodes = mySurf->getNumberOfNodes();
+    m_neighborStart.resize(numNodes + 1);
+    m_neighborStart[0] = 0;
+    if (numNodes == 0) return;
+    CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper(true);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        int32_t numNeighbors = 0;
+        myTopoHelp->getNodeNeighbors(i, numNeighbors);
+        m_neighborStart[i + 1] = m_neighborStart[i] + numNeighbors;
+    }
+    m_neighbors.resize(m_neighborStart[numNodes]);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        int32_t numNeighbors = 0;
+        const int32_t* neighbors = myTopoHelp->getNodeNeighbors(i, numNeighbors);
+        for (int32_t j = 0; j < numNeighbors; ++j)
+        {
+            m_neighbors[m_neighborStart[i] + j] = neighbors[j];
+        }
+    }
+}
+
+void SurfaceSmoothingObject::smoothIteration(const float* coordsIn, float* coordsOut, const float& strength) const
+{
+    CaretAssert(coordsIn != coordsOut);
+    const int32_t numNodes = getNumberOfNodes();
+    const float inverseStrength = 1.0 - strength;
+#pragma omp CARET_PAR
+    {
+        vector<float> triangleAreas, triangleCenters;//per thread scratch, grown to the largest neighbor count seen
+#pragma omp CARET_FOR schedule(static, 1024)
+        for (int32_t iNode = 0; iNode < numNodes; ++iNode)
+        {
+            const int32_t* neighbors = m_neighbors.data() + m_neighborStart[iNode];
+            const int32_t numNeighbors = (int32_t)(m_neighborStart[iNode + 1] - m_neighborStart[iNode]);
+            const float* c1 = coordsIn + iNode * 3;
+            float* myOut = coordsOut + iNode * 3;
+            if (numNeighbors < 2)
+            {
+                myOut[0] = c1[0];
+                myOut[1] = c1[1];
+                myOut[2] = c1[2];
+                continue;
+            }
+            if (numNeighbors > (int32_t)triangleAreas.size())
+            {
+                triangleAreas.resize(numNeighbors);
+                triangleCenters.resize(numNeighbors * 3);
+            }
+            double totalArea = 0.0;
+            for (int32_t jn = 0; jn < numNeighbors; ++jn)
+            {//triangle formed by the node and two consecutive neighbors
+                const float* c2 = coordsIn + neighbors[jn] * 3;
+                const float* c3 = coordsIn + neighbors[(jn + 1 < numNeighbors) ? jn + 1 : 0] * 3;
+                const float area = MathFunctions::triangleArea(c1, c2, c3);
+                triangleAreas[jn] = area;
+                totalArea += area;
+                for (int k = 0; k < 3; ++k)
+                {
+                    triangleCenters[jn * 3 + k] = (c1[k] + c2[k] + c3[k]) / 3.0;
+                }
+            }
+            float neighborAverage[3] = { 0.0f, 0.0f, 0.0f };
+            for (int32_t j = 0; j < numNeighbors; ++j)
+            {
+                if (triangleAreas[j] > 0.0)
+                {
+                    const float weight = triangleAreas[j] / totalArea;
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        neighborAverage[k] += weight * triangleCenters[j * 3 + k];
+                    }
+                }
+            }
+            for (int k = 0; k < 3; ++k)
+            {
+                myOut[k] = c1[k] * inverseStrength + neighborAverage[k] * strength;
+            }
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef __SURFACE_SMOOTHING_OBJECT_H__
+#define __SURFACE_SMOOTHING_OBJECT_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+//NOTE: this is the coordinate smoothing kernel shared by AlgorithmSurfaceSmoothing and AlgorithmSurfaceInflation, it captures the topology once in
+//      a flat (CSR) neighbor list so that repeated smoothing calls don't need a TopologyHelper, which is invalidated every time the coordinates change.
+//
+//NOTE: the iteration is a Jacobi update (reads only the input array), so nodes are processed in parallel, and the result doesn't depend on the number of threads.
+
+#include "stdint.h"
+#include <vector>
+
+namespace caret {
+    
+    class SurfaceFile;
+    
+    class SurfaceSmoothingObject
+    {
+        std::vector<int64_t> m_neighborStart;//numNodes + 1 entries, neighbors of node i are m_neighbors[m_neighborStart[i]] to m_neighborStart[i + 1] - 1
+        std::vector<int32_t> m_neighbors;//in sorted (ring) order, as the triangles around a node are formed by consecutive neighbors
+        SurfaceSmoothingObject();
+    public:
+        SurfaceSmoothingObject(const SurfaceFile* mySurf);
+        
+        ///one iteration of area-weighted triangle center averaging, coordsIn and coordsOut are numNodes * 3 and must not overlap
+        void smoothIteration(const float* coordsIn, float* coordsOut, const float& strength) const;
+        
+        int32_t getNumberOfNodes() const { return (int32_t)m_neighborStart.size() - 1; }
+    };
+    
+}
+
+#endif //__SURFACE_SMOOTHING_OBJECT_H__
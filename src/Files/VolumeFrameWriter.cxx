@@ -0,0 +1,103 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "VolumeFrameWriter.h"
+
+#include "ApplicationInformation.h"
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "DataFileException.h"
+#include "Palette.h"
+#include "XmlWriter.h"
+
+#include <sstream>
+#include <string>
+
+using namespace caret;
+using namespace std;
+
+VolumeFrameWriter::VolumeFrameWriter(const AString& filename, const vector<int64_t>& spatialDims, const vector<vector<float> >& sform,
+                                     const vector<AString>& mapNames, const SubvolumeAttributes::VolumeType& whatType,
+                                     const GiftiMetaData* fileMetaData)
+{
+    CaretAssert(spatialDims.size() == 3);
+    if (whatType == SubvolumeAttributes::LABEL) throw DataFileException(filename, "streaming volume writer does not support label volumes");//would need a label table per frame
+    if (!(filename.endsWith(".nii.gz") || filename.endsWith(".nii")))
+    {
+        CaretLogWarning("volume file '" + filename + "' should be saved ending in .nii.gz or .nii, other formats are not supported");
+    }
+    m_filename = filename;
+    m_numFrames = (int64_t)mapNames.size();
+    m_framesWritten = 0;
+    if (m_numFrames < 1) throw DataFileException(filename, "volume file must have at least one frame");
+    CaretVolumeExtension myExtension;//same defaults as VolumeFile::validateMembers
+    if (fileMetaData != NULL) myExtension.m_metadata = *fileMetaData;
+    myExtension.m_attributes.resize(m_numFrames);
+    for (int64_t i = 0; i < m_numFrames; ++i)
+    {
+        myExtension.m_attributes[i].grabNew(new SubvolumeAttributes());
+        myExtension.m_attributes[i]->m_type = whatType;
+        myExtension.m_attributes[i]->m_guiLabel = mapNames[i];
+        myExtension.m_attributes[i]->m_palette.grabNew(new PaletteColorMapping());
+        if (whatType == SubvolumeAttributes::ANATOMY)
+        {
+            myExtension.m_attributes[i]->m_palette->setSelectedPaletteName(Palette::GRAY_INTERP_POSITIVE_PALETTE_NAME);
+            myExtension.m_attributes[i]->m_palette->setScaleMode(PaletteScaleModeEnum::MODE_AUTO_SCALE_PERCENTAGE);
+        }
+    }
+    stringstream mystream;
+    XmlWriter myWriter(mystream);
+    myExtension.writeAsXML(myWriter);
+    string myStr = mystream.str();
+    const int NIFTI_ECODE_CARET = 30;//same as VolumeFile
+    CaretPointer<NiftiExtension> newExt(new NiftiExtension());
+    newExt->m_ecode = NIFTI_ECODE_CARET;
+    newExt->m_bytes.assign(myStr.begin(), myStr.end());
+    newExt->m_bytes.push_back('\0');//null byte for safety
+    NiftiHeader outHeader;
+    outHeader.m_extensions.push_back(newExt);
+    outHeader.setDescription(("Connectome Workbench, version " + ApplicationInformation().getVersion()).toLatin1().constData());
+    outHeader.setSForm(sform);
+    vector<int64_t> outDims = spatialDims;
+    if (m_numFrames > 1) outDims.push_back(m_numFrames);
+    outHeader.setDimensions(outDims);
+    outHeader.setDataType(NIFTI_TYPE_FLOAT32);
+    int outVersion = 1;
+    if (!outHeader.canWriteVersion(1)) outVersion = 2;
+    m_io.writeNew(filename, outHeader, outVersion);
+}
+
+void VolumeFrameWriter::writeFrame(const float* frameData)
+{
+    if (m_framesWritten >= m_numFrames) throw DataFileException(m_filename, "too many frames written to volume file");
+    if (m_numFrames > 1)
+    {
+        m_io.writeData(frameData, 3, vector<int64_t>(1, m_framesWritten));
+    } else {
+        m_io.writeData(frameData, 3, vector<int64_t>());
+    }
+    ++m_framesWritten;
+}
+
+void VolumeFrameWriter::close()
+{
+    if (m_framesWritten != m_numFrames) throw DataFileException(m_filename, "only " + AString::number(m_framesWritten) + " of " + AString::number(m_numFrames) + " frames were written to volume file");
+    m_io.close();//explicit close, to get a throw rather than a severe log on problems
+}
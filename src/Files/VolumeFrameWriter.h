@@ -0,0 +1,54 @@
+#ifndef __VOLUME_FRAME_WRITER_H__
+#define __VOLUME_FRAME_WRITER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+#include "CaretVolumeExtension.h"
+#include "NiftiIO.h"
+
+#include <vector>
+
+namespace caret {
+
+    ///writes a float volume file one frame at a time, for outputs with too many frames to hold in memory
+    ///the header and caret extension (map names, type, default palettes) match what VolumeFile::writeFile would produce
+    class VolumeFrameWriter
+    {
+        NiftiIO m_io;
+        int64_t m_numFrames, m_framesWritten;
+        AString m_filename;
+        VolumeFrameWriter(const VolumeFrameWriter&);
+        VolumeFrameWriter& operator=(const VolumeFrameWriter&);
+    public:
+        ///spatialDims must have 3 elements, the number of frames is the number of map names, fileMetaData (such as provenance) may be NULL
+        VolumeFrameWriter(const AString& filename, const std::vector<int64_t>& spatialDims, const std::vector<std::vector<float> >& sform,
+                          const std::vector<AString>& mapNames, const SubvolumeAttributes::VolumeType& whatType = SubvolumeAttributes::ANATOMY,
+                          const GiftiMetaData* fileMetaData = NULL);
+        ///frames must be written in order
+        void writeFrame(const float* frameData);
+        ///throws if not every frame was written, if this isn't called, the file is closed on destruction without checking
+        void close();
+    };
+
+}
+
+#endif //__VOLUME_FRAME_WRITER_H__
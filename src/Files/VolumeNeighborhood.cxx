@@ -0,0 +1,179 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "VolumeNeighborhood.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "FloatMatrix.h"
+#include "Vector3D.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    const int64_t BRICK_SIZE = 16;//16^3 voxels, plus a modest stencil, stays in L2 across all frames' neighbors
+    
+    struct StencilSortEntry
+    {
+        VoxelIJK m_ijk;
+        float m_distance;
+        bool operator<(const StencilSortEntry& rhs) const { return m_distance < rhs.m_distance; }
+    };
+}
+
+VolumeNeighborhood::VolumeNeighborhood(const int64_t dims[3], const vector<vector<float> >& sform, const float& distance, const int& flags)
+{
+    Vector3D ivec, jvec, kvec, origin, ijorth, jkorth, kiorth;
+    FloatMatrix(sform).getAffineVectors(ivec, jvec, kvec, origin);
+    ijorth = ivec.cross(jvec).normal();//find the bounding box that encloses a sphere of radius distance
+    jkorth = jvec.cross(kvec).normal();
+    kiorth = kvec.cross(ivec).normal();
+    int range[3] = { (int)floor(abs(distance / ivec.dot(jkorth))),
+                     (int)floor(abs(distance / jvec.dot(kiorth))),
+                     (int)floor(abs(distance / kvec.dot(ijorth))) };
+    for (int i = 0; i < 3; ++i)
+    {
+        if (range[i] < 1) range[i] = 1;//don't underflow, and leave room for face neighbors
+    }
+    const bool faceNeighbors = (flags & INCLUDE_FACE_NEIGHBORS) != 0, strict = (flags & EXCLUDE_AT_DISTANCE) != 0;
+    const float dist2 = distance * distance;
+    vector<StencilSortEntry> entries;
+    for (int k = -range[2]; k <= range[2]; ++k)//generate in index order, so a stable sort breaks ties the same way every time
+    {
+        Vector3D kpart = kvec * k;
+        for (int j = -range[1]; j <= range[1]; ++j)
+        {
+            Vector3D jpart = kpart + jvec * j;
+            for (int i = -range[0]; i <= range[0]; ++i)
+            {
+                if (k == 0 && j == 0 && i == 0) continue;
+                float thisDist2 = (jpart + ivec * i).lengthsquared();
+                bool inRange = strict ? (thisDist2 < dist2) : (thisDist2 <= dist2);
+                if (inRange || (faceNeighbors && abs(i) + abs(j) + abs(k) == 1))
+                {
+                    StencilSortEntry temp;
+                    temp.m_ijk = VoxelIJK(i, j, k);
+                    temp.m_distance = sqrt(thisDist2);
+                    entries.push_back(temp);
+                }
+            }
+        }
+    }
+    if ((flags & SORT_BY_DISTANCE) != 0)
+    {
+        stable_sort(entries.begin(), entries.end());
+    }
+    m_stencilIJK.resize(entries.size());
+    m_stencilDistance.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        m_stencilIJK[i] = entries[i].m_ijk;
+        m_stencilDistance[i] = entries[i].m_distance;
+    }
+    setupOffsets(dims);
+}
+
+VolumeNeighborhood::VolumeNeighborhood(const int64_t dims[3], const vector<VoxelIJK>& stencil)
+{
+    m_stencilIJK = stencil;
+    setupOffsets(dims);
+}
+
+void VolumeNeighborhood::setupOffsets(const int64_t dims[3])
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        m_dims[i] = dims[i];
+        m_range[i] = 0;
+    }
+    int64_t stencilSize = (int64_t)m_stencilIJK.size();
+    for (int64_t s = 0; s < stencilSize; ++s)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            m_range[i] = max(m_range[i], (int)abs(m_stencilIJK[s].m_ijk[i]));
+        }
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        m_paddedDims[i] = m_dims[i] + 2 * m_range[i];
+    }
+    m_paddedOffset.resize(stencilSize);
+    m_frameOffset.resize(stencilSize);
+    for (int64_t s = 0; s < stencilSize; ++s)
+    {
+        const int64_t* ijk = m_stencilIJK[s].m_ijk;
+        m_paddedOffset[s] = ijk[0] + m_paddedDims[0] * (ijk[1] + m_paddedDims[1] * ijk[2]);
+        m_frameOffset[s] = ijk[0] + m_dims[0] * (ijk[1] + m_dims[1] * ijk[2]);
+    }
+    m_bricks.clear();
+    for (int64_t k = 0; k < m_dims[2]; k += BRICK_SIZE)
+    {
+        for (int64_t j = 0; j < m_dims[1]; j += BRICK_SIZE)
+        {
+            for (int64_t i = 0; i < m_dims[0]; i += BRICK_SIZE)
+            {
+                Brick temp;
+                temp.m_start[0] = i; temp.m_end[0] = min(i + BRICK_SIZE, m_dims[0]);
+                temp.m_start[1] = j; temp.m_end[1] = min(j + BRICK_SIZE, m_dims[1]);
+                temp.m_start[2] = k; temp.m_end[2] = min(k + BRICK_SIZE, m_dims[2]);
+                m_bricks.push_back(temp);
+            }
+        }
+    }
+}
+
+void VolumeNeighborhood::initPaddedMask(vector<char>& maskOut) const
+{
+    maskOut.assign(m_paddedDims[0] * m_paddedDims[1] * m_paddedDims[2], 0);
+}
+
+void VolumeNeighborhood::makePaddedMask(vector<char>& maskOut, const float* frame) const
+{
+    initPaddedMask(maskOut);
+#pragma omp CARET_PARFOR schedule(static)
+    for (int64_t k = 0; k < m_dims[2]; ++k)
+    {
+        for (int64_t j = 0; j < m_dims[1]; ++j)
+        {
+            char* maskRow = maskOut.data() + getPaddedIndex(0, j, k);
+            if (frame == NULL)
+            {
+                for (int64_t i = 0; i < m_dims[0]; ++i)
+                {
+                    maskRow[i] = 1;
+                }
+            } else {
+                const float* frameRow = frame + getFrameIndex(0, j, k);
+                for (int64_t i = 0; i < m_dims[0]; ++i)
+                {
+                    maskRow[i] = (frameRow[i] > 0.0f) ? 1 : 0;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef __VOLUME_NEIGHBORHOOD_H__
+#define __VOLUME_NEIGHBORHOOD_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "VoxelIJK.h"
+
+#include "stdint.h"
+#include <cstddef>
+#include <vector>
+
+namespace caret {
+    
+    ///precomputed voxel stencil for neighborhood operations, as linear offsets into a padded mask so the inner loops don't need bounds checks
+    class VolumeNeighborhood
+    {
+    public:
+        enum StencilFlags
+        {
+            INCLUDE_FACE_NEIGHBORS = 1,//always include the 6 face neighbors, regardless of distance
+            SORT_BY_DISTANCE = 2,//nearest first, ties in index order, otherwise the stencil is in index order
+            EXCLUDE_AT_DISTANCE = 4//use strictly less than distance, instead of less than or equal
+        };
+        ///a block of voxels to traverse together, for cache locality and as the unit of parallel work
+        struct Brick
+        {
+            int64_t m_start[3], m_end[3];
+        };
+        VolumeNeighborhood() { }
+        ///stencil is all voxels (excluding the center) within distance center to center, in the space of the sform
+        VolumeNeighborhood(const int64_t dims[3], const std::vector<std::vector<float> >& sform, const float& distance, const int& flags = 0);
+        ///use an explicit list of offsets
+        VolumeNeighborhood(const int64_t dims[3], const std::vector<VoxelIJK>& stencil);
+        
+        int64_t getStencilSize() const { return (int64_t)m_stencilIJK.size(); }
+        const std::vector<VoxelIJK>& getStencilIJK() const { return m_stencilIJK; }
+        ///center to center distances, only valid when constructed from a distance
+        const std::vector<float>& getStencilDistances() const { return m_stencilDistance; }
+        ///add to the padded index of the center voxel to get the padded index of the neighbor
+        const int64_t* getPaddedOffsets() const { return m_paddedOffset.data(); }
+        ///add to the frame index of the center voxel to get the frame index of the neighbor, only meaningful when the neighbor is inside the volume
+        const int64_t* getFrameOffsets() const { return m_frameOffset.data(); }
+        ///the padding on each side, which is also the largest stencil offset along each axis
+        const int* getRange() const { return m_range; }
+        const int64_t* getDimensions() const { return m_dims; }
+        
+        int64_t getPaddedIndex(const int64_t& i, const int64_t& j, const int64_t& k) const
+        {
+            return (i + m_range[0]) + m_paddedDims[0] * ((j + m_range[1]) + m_paddedDims[1] * (k + m_range[2]));
+        }
+        int64_t getFrameIndex(const int64_t& i, const int64_t& j, const int64_t& k) const
+        {
+            return i + m_dims[0] * (j + m_dims[1] * k);
+        }
+        
+        ///padded mask initialized to zero everywhere, for the caller to mark voxels inside the volume
+        void initPaddedMask(std::vector<char>& maskOut) const;
+        ///padded mask of voxels inside the volume where frame is positive, or all voxels inside the volume if frame is NULL
+        void makePaddedMask(std::vector<char>& maskOut, const float* frame = NULL) const;
+        
+        ///bricks covering the volume, in index order
+        const std::vector<Brick>& getBricks() const { return m_bricks; }
+    private:
+        int64_t m_dims[3], m_paddedDims[3];
+        int m_range[3];
+        std::vector<VoxelIJK> m_stencilIJK;
+        std::vector<float> m_stencilDistance;
+        std::vector<int64_t> m_paddedOffset, m_frameOffset;
+        std::vector<Brick> m_bricks;
+        void setupOffsets(const int64_t dims[3]);
+    };
+    
+}
+
+#endif //__VOLUME_NEIGHBORHOOD_H__
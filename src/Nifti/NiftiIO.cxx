@@ -21,6 +21,7 @@
 #include "NiftiIO.h"
 
 #include "DataFileException.h"
+#include "SIMDConversion.h"
 
 using namespace std;
 using namespace caret;
@@ -108,3 +109,51 @@ int NiftiIO::numBytesPerElem()
             throw DataFileException("internal error, report what you did to the developers");
     }
 }
+
+template<>
+void NiftiIO::convertRead(float* out, uint8_t* in, const int64_t& count)
+{
+    double mult, offset;
+    bool doScale = m_header.getDataScaling(mult, offset);
+    SIMDConversion::toFloat(out, in, count, false, doScale, mult, offset);
+}
+
+template<>
+void NiftiIO::convertRead(float* out, int16_t* in, const int64_t& count)
+{
+    double mult, offset;
+    bool doScale = m_header.getDataScaling(mult, offset);
+    SIMDConversion::toFloat(out, in, count, m_header.isSwapped(), doScale, mult, offset);//swaps while converting, scratch stays as read
+}
+
+template<>
+void NiftiIO::convertRead(float* out, uint16_t* in, const int64_t& count)
+{
+    double mult, offset;
+    bool doScale = m_header.getDataScaling(mult, offset);
+    SIMDConversion::toFloat(out, in, count, m_header.isSwapped(), doScale, mult, offset);
+}
+
+template<>
+void NiftiIO::convertRead(float* out, float* in, const int64_t& count)
+{
+    double mult, offset;
+    bool doScale = m_header.getDataScaling(mult, offset);
+    SIMDConversion::toFloat(out, in, count, m_header.isSwapped(), doScale, mult, offset);
+}
+
+template<>
+void NiftiIO::convertRead(float* out, double* in, const int64_t& count)
+{
+    double mult, offset;
+    bool doScale = m_header.getDataScaling(mult, offset);
+    SIMDConversion::toFloat(out, in, count, m_header.isSwapped(), doScale, mult, offset);
+}
+
+template<>
+void NiftiIO::convertWrite(float* out, const float* in, const int64_t& count)
+{
+    double mult, offset;
+    bool doScale = m_header.getDataScaling(mult, offset);
+    SIMDConversion::floatForWrite(out, in, count, m_header.isSwapped(), doScale, mult, offset);
+}
@@ -64,15 +64,36 @@ namespace caret
         //NOTE: you need to provide storage for all components within the range, if getNumComponents() == 3 and fullDims == 0, you need 3 elements allocated
         template<typename T>
         void readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead = false);
+        //same, but reads numSelect consecutive indexes of the first selected dimension, starting at indexSelect[0], in one read call
+        template<typename T>
+        void readDataRange(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const int64_t& numSelect, const bool& tolerateShortRead = false);
         template<typename T>
         void writeData(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect);
+        //same, but writes numSelect consecutive indexes of the first selected dimension, starting at indexSelect[0], in one write call
+        template<typename T>
+        void writeDataRange(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect, const int64_t& numSelect);
     };
     
+    //the common conversions to float use the runtime-selected SIMD kernels, these are defined in NiftiIO.cxx
+    template<> void NiftiIO::convertRead(float* out, uint8_t* in, const int64_t& count);
+    template<> void NiftiIO::convertRead(float* out, int16_t* in, const int64_t& count);
+    template<> void NiftiIO::convertRead(float* out, uint16_t* in, const int64_t& count);
+    template<> void NiftiIO::convertRead(float* out, float* in, const int64_t& count);
+    template<> void NiftiIO::convertRead(float* out, double* in, const int64_t& count);
+    template<> void NiftiIO::convertWrite(float* out, const float* in, const int64_t& count);
+    
     template<typename T>
     void NiftiIO::readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead)
+    {
+        readDataRange(dataOut, fullDims, indexSelect, 1, tolerateShortRead);
+    }
+    
+    template<typename T>
+    void NiftiIO::readDataRange(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const int64_t& numSelect, const bool& tolerateShortRead)
     {
         CaretAssert(fullDims >= 0 && fullDims <= (int)m_dims.size());
         CaretAssert((size_t)fullDims + indexSelect.size() == m_dims.size());//could be >=, but should catch more stupid mistakes as ==
+        CaretAssert(numSelect >= 1 && (numSelect == 1 || !indexSelect.empty()));
         int64_t numElems = getNumComponents();//for now, calculate read size on the fly, as the read call will be the slowest part
         int curDim;
         for (curDim = 0; curDim < fullDims; ++curDim)
@@ -86,6 +107,8 @@ namespace caret
             numSkip += indexSelect[curDim - fullDims] * numDimSkip;
             numDimSkip *= m_dims[curDim];
         }
+        CaretAssert(numSelect == 1 || indexSelect[0] + numSelect <= m_dims[fullDims]);
+        numElems *= numSelect;//consecutive indexes of the first selected dimension are adjacent in the file
         CaretMutexLocker locked(&m_mutex);//protect starting with resizing until we are done converting, because we use an internal variable for scratch space
         //we can't guarantee that the output memory is enough to use as scratch space, as we might be doing a narrowing conversion
         //we are doing FILE ACCESS, so cpu performance isn't really something to worry about
@@ -144,9 +167,16 @@ namespace caret
     
     template<typename T>
     void NiftiIO::writeData(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect)
+    {
+        writeDataRange(dataIn, fullDims, indexSelect, 1);
+    }
+    
+    template<typename T>
+    void NiftiIO::writeDataRange(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect, const int64_t& numSelect)
     {
         CaretAssert(fullDims >= 0 && fullDims <= (int)m_dims.size());
         CaretAssert((size_t)fullDims + indexSelect.size() == m_dims.size());//could be >=, but should catch more stupid mistakes as ==
+        CaretAssert(numSelect >= 1 && (numSelect == 1 || !indexSelect.empty()));
         int64_t numElems = getNumComponents();//for now, calculate read size on the fly, as the read call will be the slowest part
         int curDim;
         for (curDim = 0; curDim < fullDims; ++curDim)
@@ -160,6 +190,8 @@ namespace caret
             numSkip += indexSelect[curDim - fullDims] * numDimSkip;
             numDimSkip *= m_dims[curDim];
         }
+        CaretAssert(numSelect == 1 || indexSelect[0] + numSelect <= m_dims[fullDims]);
+        numElems *= numSelect;//consecutive indexes of the first selected dimension are adjacent in the file
         CaretMutexLocker locked(&m_mutex);//protect starting with resizing until we are done writing, because we use an internal variable for scratch space
         //we are doing FILE ACCESS, so cpu performance isn't really something to worry about
         m_scratch.resize(numElems * numBytesPerElem());
@@ -236,9 +268,25 @@ namespace caret
         } else {
             if (doScale)
             {
-                for (int64_t i = 0; i < count; ++i)
-                {
-                    out[i] = (TO)(offset + mult * (long double)in[i]);//we don't always need that much precision, but it will still be faster than hard drives
+                typedef std::numeric_limits<FROM> fromlimits;
+                const int64_t tableSize = ((int64_t)1) << (sizeof(FROM) <= 2 ? 8 * sizeof(FROM) : 0);//don't shift by the full width of wider types, they don't use the table anyway
+                if (fromlimits::is_integer && sizeof(FROM) <= 2 && count >= tableSize)
+                {//compactly stored (8 or 16 bit) scaled data, like a quantized dconn: decode through a table of every possible value, computed the same way as below
+                    std::vector<TO> table(tableSize);
+                    for (int64_t j = 0; j < tableSize; ++j)
+                    {
+                        table[j] = (TO)(offset + mult * (long double)(j + (int64_t)fromlimits::min()));
+                    }
+                    const TO* tableBase = table.data() - (int64_t)fromlimits::min();//so that it can be indexed directly by the signed stored value
+                    for (int64_t i = 0; i < count; ++i)
+                    {
+                        out[i] = tableBase[(int64_t)in[i]];
+                    }
+                } else {
+                    for (int64_t i = 0; i < count; ++i)
+                    {
+                        out[i] = (TO)(offset + mult * (long double)in[i]);//we don't always need that much precision, but it will still be faster than hard drives
+                    }
                 }
             } else {
                 for (int64_t i = 0; i < count; ++i)
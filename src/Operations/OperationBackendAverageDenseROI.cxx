@@ -108,30 +108,29 @@ void OperationBackendAverageDenseROI::useParameters(OperationParameters* myParam
         if (baseXML.getNumberOfDimensions() != 2) throw OperationException("this command currently only supports 2D cifti");
         int numRows = baseXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
         int rowSize = baseXML.getDimensionLength(CiftiXML::ALONG_ROW);
-        vector<double> accum(rowSize, 0.0);
+        vector<vector<double> > accum(1, vector<double>(rowSize, 0.0));
         vector<float> rowScratch(rowSize);
+        vector<int64_t> rowIndices(numStrings);
+        for (int j = 0; j < numStrings; ++j)
+        {
+            if (indexList[j] >= numRows)
+            {
+                throw OperationException("error, cifti index outside number of rows");
+            }
+            rowIndices[j] = indexList[j];
+        }
+        vector<float> weights(numStrings, 1.0f);
         for (int i = 0; i < numCifti; ++i)
         {
             if (baseXML != ciftiList[i]->getCiftiXML())//equality testing is smart, compares mapping equivalence, despite multiple ways to specify some mappings
             {
                 throw OperationException("error, cifti header of file #" + AString::number(i + 1) + " doesn't match");
             }
-            for (int j = 0; j < numStrings; ++j)
-            {
-                if (indexList[j] >= numRows)
-                {
-                    throw OperationException("error, cifti index outside number of rows");
-                }
-                ciftiList[i]->getRow(rowScratch.data(), indexList[j]);
-                for (int k = 0; k < rowSize; ++k)
-                {
-                    accum[k] += rowScratch[k];
-                }
-            }
+            ciftiList[i]->addWeightedRows(accum, rowIndices, weights);//sorts the rows and reads adjacent ones together
         }
         for (int k = 0; k < rowSize; ++k)
         {
-            rowScratch[k] = accum[k] / numCifti / numStrings;
+            rowScratch[k] = accum[0][k] / numCifti / numStrings;
         }
         int32_t outSize = rowSize;
         if (ByteOrderEnum::isSystemBigEndian())
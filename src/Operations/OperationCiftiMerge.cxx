@@ -54,12 +54,16 @@ OperationParameters* OperationCiftiMerge::getParameters()
     upToOpt->addStringParameter(1, "last-column", "the number or name of the last column to include");
     upToOpt->createOptionalParameter(2, "-reverse", "use the range in reverse order");
     
+    OptionalParameter* memLimitOpt = ret->createOptionalParameter(3, "-mem-limit", "restrict memory usage");
+    memLimitOpt->addDoubleParameter(1, "limit-GB", "memory limit in gigabytes");
+    
     ret->setHelpText(
         AString("Given input CIFTI files which have matching mappings along columns, and for which mappings along rows ") +
         "are the same type, all either series, scalars, or labels, this command concatenates the specified columns horizontally (rows become longer).\n\n" +
         "Example: wb_command -cifti-merge out.dtseries.nii -cifti first.dtseries.nii -column 1 -cifti second.dtseries.nii\n\n" +
         "This example would take the first column from first.dtseries.nii, followed by all columns from second.dtseries.nii, " +
-        "and write these columns to out.dtseries.nii."
+        "and write these columns to out.dtseries.nii.\n\n" +
+        "Rows are merged in blocks, reading each input file sequentially for each block, the -mem-limit option sets how much memory the blocks may use."
     );
     return ret;
 }
@@ -85,7 +89,16 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
         default:
             throw OperationException("row mapping type must be series, scalars, or labels");
     }
+    OptionalParameter* memLimitOpt = myParams->getOptionalParameter(3);
+    int64_t memLimitBytes = 512 * (int64_t)1024 * 1024;//default is large enough for long sequential reads
+    if (memLimitOpt->m_present)
+    {
+        double memLimitGB = memLimitOpt->getDouble(1);
+        if (memLimitGB < 0.0) throw OperationException("memory limit cannot be negative");
+        memLimitBytes = (int64_t)(memLimitGB * 1024 * 1024 * 1024);
+    }
     int64_t numOutColumns = 0;//output row length
+    vector<vector<int64_t> > inputColumns(numInputs);//which columns to use from each input, in output order, empty means the entire row
     for (int i = 0; i < numInputs; ++i)
     {
         const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
@@ -109,8 +122,15 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
                     if (finalColumn < 0 || finalColumn >= thisDims[0]) throw OperationException("ending column '" + columnOpts[j]->getString(1) + "' not valid in file '" + ciftiIn->getFileName() + "'");
                     if (finalColumn < initialColumn) throw OperationException("ending column occurs before starting column in file '" + ciftiIn->getFileName() + "'");
                     numOutColumns += finalColumn - initialColumn + 1;//inclusive - we don't need to worry about reversing for counting, though
+                    if (upToOpt->getOptionalParameter(2)->m_present)
+                    {
+                        for (int64_t c = finalColumn; c >= initialColumn; --c) inputColumns[i].push_back(c);
+                    } else {
+                        for (int64_t c = initialColumn; c <= finalColumn; ++c) inputColumns[i].push_back(c);
+                    }
                 } else {
                     numOutColumns += 1;
+                    inputColumns[i].push_back(initialColumn);
                 }
             }
         } else {
@@ -256,53 +276,43 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
     }
     ciftiOut->setCiftiXML(outXML);
     int64_t numRows = baseColMapping.getLength();
-    vector<float> outRow(numOutColumns), scratchRow(scratchRowLength);
-    for (int64_t row = 0; row < numRows; ++row)
+    int64_t blockRows = memLimitBytes / (numOutColumns * sizeof(float));//read a block of rows from one input at a time, rather than alternating between inputs every row
+    if (blockRows < 1) blockRows = 1;
+    if (blockRows > numRows) blockRows = numRows;
+    vector<float> outBlock(blockRows * numOutColumns), scratchRow(scratchRowLength);
+    for (int64_t blockStart = 0; blockStart < numRows; blockStart += blockRows)
     {
+        int64_t blockEnd = min(blockStart + blockRows, numRows);
         curCol = 0;
         for (int i = 0; i < numInputs; ++i)
         {
             const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
-            vector<int64_t> thisDims = ciftiIn->getDimensions();
-            const CiftiXML& thisXML = ciftiIn->getCiftiXML();
-            const vector<ParameterComponent*>& columnOpts = *(myInputs[i]->getRepeatableParameterInstances(2));
-            int numColumnOpts = (int)columnOpts.size();
-            if (numColumnOpts > 0)
+            const vector<int64_t>& thisColumns = inputColumns[i];
+            int64_t numThisColumns = (int64_t)thisColumns.size();
+            if (numThisColumns > 0)
             {
-                ciftiIn->getRow(scratchRow.data(), row);
-                for (int j = 0; j < numColumnOpts; ++j)
+                for (int64_t row = blockStart; row < blockEnd; ++row)
                 {
-                    int64_t initialColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(columnOpts[j]->getString(1));//this function has the 1-indexing convention built in
-                    OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);//we already checked that these strings give a valid column
-                    if (upToOpt->m_present)
+                    ciftiIn->getRow(scratchRow.data(), row);
+                    float* outRow = outBlock.data() + (row - blockStart) * numOutColumns + curCol;
+                    for (int64_t c = 0; c < numThisColumns; ++c)
                     {
-                        int finalColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1));//ditto
-                        bool reverse = upToOpt->getOptionalParameter(2)->m_present;
-                        if (reverse)
-                        {
-                            for (int c = finalColumn; c >= initialColumn; --c)
-                            {
-                                outRow[curCol] = scratchRow[c];
-                                ++curCol;
-                            }
-                        } else {
-                            for (int c = initialColumn; c <= finalColumn; ++c)
-                            {
-                                outRow[curCol] = scratchRow[c];
-                                ++curCol;
-                            }
-                        }
-                    } else {
-                        outRow[curCol] = scratchRow[initialColumn];
-                        ++curCol;
+                        outRow[c] = scratchRow[thisColumns[c]];
                     }
                 }
+                curCol += numThisColumns;
             } else {
-                ciftiIn->getRow(outRow.data() + curCol, row);
-                curCol += thisDims[0];
+                for (int64_t row = blockStart; row < blockEnd; ++row)
+                {
+                    ciftiIn->getRow(outBlock.data() + (row - blockStart) * numOutColumns + curCol, row);
+                }
+                curCol += ciftiIn->getDimensions()[0];
             }
         }
         CaretAssert(curCol == numOutColumns);
-        ciftiOut->setRow(outRow.data(), row);
+        for (int64_t row = blockStart; row < blockEnd; ++row)
+        {
+            ciftiOut->setRow(outBlock.data() + (row - blockStart) * numOutColumns, row);
+        }
     }
 }
@@ -21,6 +21,7 @@
 #include "OperationCiftiStats.h"
 #include "OperationException.h"
 
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "ReductionOperation.h"
 
@@ -77,14 +78,12 @@ OperationParameters* OperationCiftiStats::getParameters()
 
 namespace
 {
-    float reduce(const vector<float>& data, const ReductionEnum::Enum& myop, const vector<float>& roiData)
+    float reduce(const float* data, const int64_t& numElems, const ReductionEnum::Enum& myop, const float* roiData)
     {
-        if (roiData.empty())
+        if (roiData == NULL)
         {
-            return ReductionOperation::reduce(data.data(), data.size(), myop);
+            return ReductionOperation::reduce(data, numElems, myop);
         } else {
-            int64_t numElems = (int64_t)data.size();
-            CaretAssert(numElems == (int64_t)roiData.size());
             vector<float> toUse;
             toUse.reserve(numElems);
             for (int64_t i = 0; i < numElems; ++i)
@@ -99,16 +98,14 @@ namespace
         }
     }
     
-    float percentile(const vector<float>& data, const float& percent, const vector<float>& roiData)
+    float percentile(const float* data, const int64_t& numElems, const float& percent, const float* roiData)
     {
         CaretAssert(percent >= 0.0f && percent <= 100.0f);
         vector<float> toUse;
-        if (roiData.empty())
+        if (roiData == NULL)
         {
-            toUse = data;
+            toUse.assign(data, data + numElems);
         } else {
-            int64_t numElems = (int64_t)data.size();
-            CaretAssert(numElems == (int64_t)roiData.size());
             toUse.reserve(numElems);
             for (int i = 0; i < numElems; ++i)
             {
@@ -163,7 +160,6 @@ void OperationCiftiStats::useParameters(OperationParameters* myParams, ProgressO
         useColumn = columnOpt->getInteger(1) - 1;
         if (useColumn < 0 || useColumn >= numCols) throw OperationException("invalid column specified");
     }
-    vector<float> roiData;
     bool matchColumnMode = false;
     CiftiFile* roiCifti = NULL;
     int64_t numRois = 1;//trick: pretend we have 1 roi map when we don't have an roi file, for fewer special cases
@@ -175,7 +171,6 @@ void OperationCiftiStats::useParameters(OperationParameters* myParams, ProgressO
         {
             throw OperationException("roi cifti does not match input cifti along columns");
         }
-        roiData.resize(colLength);
         if (roiOpt->getOptionalParameter(2)->m_present)
         {
             if (myXML.getMap(CiftiXML::ALONG_ROW)->getLength() != roiCifti->getCiftiXML().getMap(CiftiXML::ALONG_ROW)->getLength())
@@ -188,7 +183,6 @@ void OperationCiftiStats::useParameters(OperationParameters* myParams, ProgressO
     }
     bool showMapName = myParams->getOptionalParameter(6)->m_present;
     const CiftiMappingType* rowMap = myXML.getMap(CiftiXML::ALONG_ROW);
-    vector<float> colScratch(colLength);
     int64_t columnStart, columnEnd;
     if (useColumn == -1)
     {
@@ -201,41 +195,70 @@ void OperationCiftiStats::useParameters(OperationParameters* myParams, ProgressO
         columnStart = useColumn;
         columnEnd = useColumn + 1;
     }
-    for (int i = columnStart; i < columnEnd; ++i)
+    int64_t roisPerColumn = (matchColumnMode ? 1 : numRois);
+    vector<float> roiData;//when not matching maps, every column uses the same roi maps, so only read them once
+    if (roiCifti != NULL && !matchColumnMode)
     {
-        myInput->getColumn(colScratch.data(), i);
-        if (showMapName)
+        roiData.resize(numRois * colLength);
+        for (int64_t j = 0; j < numRois; ++j)
         {
-            cout << AString::number(i + 1) << ":\t" << rowMap->getIndexName(i) << ":\t";
+            roiCifti->getColumn(roiData.data() + j * colLength, j);
         }
-        if (matchColumnMode)
-        {//trick: matchColumn is only true when we have an roi
-            roiCifti->getColumn(roiData.data(), i);
-            float result;
-            if (reduceOpt->m_present)
+    }
+    const int64_t BLOCK_COLS = 64;//read a block of columns, compute all their results in parallel, then print them in order
+    vector<float> colScratch(BLOCK_COLS * colLength), results(BLOCK_COLS * roisPerColumn);
+    vector<AString> errors(BLOCK_COLS * roisPerColumn);
+    vector<char> failed(BLOCK_COLS * roisPerColumn);//exceptions can't leave the parallel region, so keep them until their turn to print
+    if (matchColumnMode) roiData.resize(BLOCK_COLS * colLength);
+    for (int64_t blockStart = columnStart; blockStart < columnEnd; blockStart += BLOCK_COLS)
+    {
+        int64_t blockEnd = min(blockStart + BLOCK_COLS, columnEnd);
+        int64_t blockSize = blockEnd - blockStart;
+        for (int64_t i = 0; i < blockSize; ++i)
+        {
+            myInput->getColumn(colScratch.data() + i * colLength, blockStart + i);
+            if (matchColumnMode)
+            {//trick: matchColumn is only true when we have an roi
+                roiCifti->getColumn(roiData.data() + i * colLength, blockStart + i);
+            }
+        }
+        int64_t numJobs = blockSize * roisPerColumn;
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t job = 0; job < numJobs; ++job)
+        {
+            int64_t i = job / roisPerColumn, j = job % roisPerColumn;
+            const float* roiPtr = NULL;
+            if (roiCifti != NULL)
             {
-                result = reduce(colScratch, myop, roiData);
-            } else {
-                CaretAssert(percentileOpt->m_present);
-                result = percentile(colScratch, percent, roiData);
+                roiPtr = roiData.data() + (matchColumnMode ? i : j) * colLength;
             }
-            stringstream resultsstr;
-            resultsstr << setprecision(7) << result;
-            cout << resultsstr.str() << endl;
-        } else {
-            for (int64_t j = 0; j < numRois; ++j)
+            failed[job] = 0;
+            try
             {
-                if (roiCifti != NULL) roiCifti->getColumn(roiData.data(), j);
-                float result;
                 if (reduceOpt->m_present)
                 {
-                    result = reduce(colScratch, myop, roiData);
+                    results[job] = reduce(colScratch.data() + i * colLength, colLength, myop, roiPtr);
                 } else {
                     CaretAssert(percentileOpt->m_present);
-                    result = percentile(colScratch, percent, roiData);
+                    results[job] = percentile(colScratch.data() + i * colLength, colLength, percent, roiPtr);
                 }
+            } catch (CaretException& e) {
+                failed[job] = 1;
+                errors[job] = e.whatString();
+            }
+        }
+        for (int64_t i = 0; i < blockSize; ++i)
+        {
+            if (showMapName)
+            {
+                cout << AString::number(blockStart + i + 1) << ":\t" << rowMap->getIndexName(blockStart + i) << ":\t";
+            }
+            for (int64_t j = 0; j < roisPerColumn; ++j)
+            {
+                int64_t job = i * roisPerColumn + j;
+                if (failed[job]) throw OperationException(errors[job]);
                 stringstream resultsstr;
-                resultsstr << setprecision(7) << result;
+                resultsstr << setprecision(7) << results[job];
                 if (j != 0) cout << "\t";
                 cout << resultsstr.str();
             }
@@ -21,7 +21,9 @@
 #include "OperationConvertMatrix4ToWorkbenchSparse.h"
 #include "OperationException.h"
 
+#include "CaretCompressedSparseFile.h"
 #include "CaretHeap.h"
+#include "CaretOMP.h"
 #include "CaretSparseFile.h"
 #include "CiftiFile.h"
 #include "OxfordSparseThreeFile.h"
@@ -64,9 +66,13 @@ OperationParameters* OperationConvertMatrix4ToWorkbenchSparse::getParameters()
     volumeOpt->addCiftiParameter(1, "cifti-template", "cifti file to use the volume mappings from");
     volumeOpt->addStringParameter(2, "direction", "dimension along the cifti file to take the mapping from, ROW or COLUMN");
     
+    ret->createOptionalParameter(9, "-uncompressed", "write the older uncompressed format, for use with older versions of workbench");
+    
     ret->setHelpText(
         AString("Converts the matrix 4 output of probtrackx to workbench sparse file format.  ") +
-        "Exactly one of -surface-seeds and -volume-seeds must be specified."
+        "Exactly one of -surface-seeds and -volume-seeds must be specified.\n\n" +
+        "By default, the output is written with each row compressed separately, which is much smaller and faster to read, " +
+        "and rows are converted in parallel.  Use -uncompressed if the output must be read by versions of workbench that predate this format."
     );
     return ret;
 }
@@ -180,34 +186,81 @@ void OperationConvertMatrix4ToWorkbenchSparse::useParameters(OperationParameters
             rowReorder[i / 3] = tempInd;
         }
     }
-    CaretSparseFileWriter mywriter(outFileName, myXML);//NOTE: CaretSparseFile has a different encoding of fibers, ALWAYS use getFibersRow, etc
-    vector<int64_t> indicesIn, indicesOut;//this method knows about sparseness, does sorting of indexes in order to avoid scanning full rows
-    vector<FiberFractions> fibersIn, fibersOut;//can be slower if matrix isn't very sparse, but that is a problem for other reasons anyway
-    CaretMinHeap<FiberFractions, int64_t> myHeap;//use our heap to do heapsort, rather than coding a struct for stl sort
-    for (int64_t i = 0; i < sparseDims[1]; ++i)
+    if (myParams->getOptionalParameter(9)->m_present)
     {
-        inFile.getFibersRowSparse(i, indicesIn, fibersIn);
-        size_t numNonzero = indicesIn.size();
-        myHeap.reserve(numNonzero);
-        for (size_t j = 0; j < numNonzero; ++j)
+        CaretSparseFileWriter mywriter(outFileName, myXML);//NOTE: CaretSparseFile has a different encoding of fibers, ALWAYS use getFibersRow, etc
+        vector<int64_t> indicesIn, indicesOut;
+        vector<FiberFractions> fibersIn, fibersOut;
+        for (int64_t i = 0; i < sparseDims[1]; ++i)
         {
-            int64_t newIndex = rowReorder[indicesIn[j]];//reorder
-            if (newIndex != -1)
+            inFile.getFibersRowSparse(i, indicesIn, fibersIn);
+            reorderRow(rowReorder, indicesIn, fibersIn, indicesOut, fibersOut);
+            mywriter.writeFibersRowSparse(i, indicesOut, fibersOut);
+        }
+        mywriter.finish();
+        return;
+    }
+    CaretCompressedSparseFileWriter mywriter(outFileName, myXML);//rows can be written in any order, from any thread
+    const int64_t BATCH_ROWS = 256;//input reading isn't thread safe, so read a batch of rows, then reorder and compress them in parallel
+    vector<vector<int64_t> > batchIndices(BATCH_ROWS);
+    vector<vector<FiberFractions> > batchFibers(BATCH_ROWS);
+    for (int64_t batchStart = 0; batchStart < sparseDims[1]; batchStart += BATCH_ROWS)
+    {
+        const int64_t batchEnd = min(batchStart + BATCH_ROWS, sparseDims[1]);
+        for (int64_t i = batchStart; i < batchEnd; ++i)
+        {
+            inFile.getFibersRowSparse(i, batchIndices[i - batchStart], batchFibers[i - batchStart]);
+        }
+        bool failed = false;
+        AString errorMessage;
+#pragma omp CARET_PAR
+        {
+            vector<int64_t> indicesOut;
+            vector<FiberFractions> fibersOut;
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t i = batchStart; i < batchEnd; ++i)
             {
-                myHeap.push(fibersIn[j], newIndex);//heapify
+                try
+                {
+                    reorderRow(rowReorder, batchIndices[i - batchStart], batchFibers[i - batchStart], indicesOut, fibersOut);
+                    mywriter.writeFibersRowSparse(i, indicesOut, fibersOut);
+                } catch (const CaretException& e) {//exceptions must not leave an openmp region
+#pragma omp critical
+                    {
+                        if (!failed) errorMessage = e.whatString();
+                        failed = true;
+                    }
+                }
             }
         }
-        indicesOut.resize(myHeap.size());
-        fibersOut.resize(myHeap.size());
-        int64_t curIndex = 0;
-        while (!myHeap.isEmpty())
+        if (failed) throw OperationException(errorMessage);
+    }
+    mywriter.finish();
+}
+
+void OperationConvertMatrix4ToWorkbenchSparse::reorderRow(const vector<int64_t>& rowReorder, const vector<int64_t>& indicesIn, const vector<FiberFractions>& fibersIn,
+                                                          vector<int64_t>& indicesOut, vector<FiberFractions>& fibersOut)
+{//this method knows about sparseness, does sorting of indexes in order to avoid scanning full rows
+    //can be slower if matrix isn't very sparse, but that is a problem for other reasons anyway
+    CaretMinHeap<FiberFractions, int64_t> myHeap;//use our heap to do heapsort, rather than coding a struct for stl sort
+    size_t numNonzero = indicesIn.size();
+    myHeap.reserve(numNonzero);
+    for (size_t j = 0; j < numNonzero; ++j)
+    {
+        int64_t newIndex = rowReorder[indicesIn[j]];//reorder
+        if (newIndex != -1)
         {
-            int64_t newIndex;
-            fibersOut[curIndex] = myHeap.pop(&newIndex);
-            indicesOut[curIndex] = newIndex;
-            ++curIndex;
+            myHeap.push(fibersIn[j], newIndex);//heapify
         }
-        mywriter.writeFibersRowSparse(i, indicesOut, fibersOut);
     }
-    mywriter.finish();
+    indicesOut.resize(myHeap.size());
+    fibersOut.resize(myHeap.size());
+    int64_t curIndex = 0;
+    while (!myHeap.isEmpty())
+    {
+        int64_t newIndex;
+        fibersOut[curIndex] = myHeap.pop(&newIndex);
+        indicesOut[curIndex] = newIndex;
+        ++curIndex;
+    }
 }
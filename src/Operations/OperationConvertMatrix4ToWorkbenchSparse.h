@@ -23,10 +23,16 @@
 
 #include "AbstractOperation.h"
 
+#include <vector>
+
 namespace caret {
     
+    struct FiberFractions;
+    
     class OperationConvertMatrix4ToWorkbenchSparse : public AbstractOperation
     {
+        static void reorderRow(const std::vector<int64_t>& rowReorder, const std::vector<int64_t>& indicesIn, const std::vector<FiberFractions>& fibersIn,
+                               std::vector<int64_t>& indicesOut, std::vector<FiberFractions>& fibersOut);
     public:
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
@@ -20,7 +20,10 @@
 
 #include "OperationProbtrackXDotConvert.h"
 #include "OperationException.h"
+#include "CaretAssert.h"
+#include "CaretCompressedSparseFile.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "MetricFile.h"
 #include "StructureEnum.h"
@@ -45,6 +48,27 @@ struct SparseValue
     }
 };
 
+namespace
+{
+    //the same conversion CiftiFile does, without needing a CiftiFile (an in-memory one would allocate the dense matrix)
+    CiftiXML convertXML(const CiftiXMLOld& oldXML)
+    {
+        QString xmlText;
+        oldXML.writeXML(xmlText);
+        CiftiXML ret;
+        ret.readXML(xmlText);
+        if (ret.getDimensionLength(CiftiXML::ALONG_ROW) < 0)
+        {
+            ret.getSeriesMap(CiftiXML::ALONG_ROW).setLength(oldXML.getDimensionLength(CiftiXMLOld::ALONG_ROW));
+        }
+        if (ret.getDimensionLength(CiftiXML::ALONG_COLUMN) < 0)
+        {
+            ret.getSeriesMap(CiftiXML::ALONG_COLUMN).setLength(oldXML.getDimensionLength(CiftiXMLOld::ALONG_COLUMN));
+        }
+        return ret;
+    }
+}
+
 AString OperationProbtrackXDotConvert::getCommandSwitch()
 {
     return "-probtrackx-dot-convert";
@@ -61,6 +85,18 @@ OperationParameters* OperationProbtrackXDotConvert::getParameters()
     ret->addStringParameter(1, "dot-file", "input .dot file");
     ret->addCiftiOutputParameter(2, "cifti-out", "output cifti file");
     
+    addConversionOptions(ret);
+    
+    OptionalParameter* sparseOpt = ret->createOptionalParameter(11, "-sparse-out", "also write the matrix as a compressed sparse file");
+    sparseOpt->addStringParameter(1, "sparse-file", "output - the compressed sparse file");
+    
+    ret->setHelpText(getConversionHelpText(AString("Use -sparse-out to also write the matrix with only its nonzero elements, each row compressed separately, which is much smaller and faster to scan for tractography matrices.  ") +
+        "To write only the sparse file, use -probtrackx-dot-convert-sparse instead.  "));
+    return ret;
+}
+
+void OperationProbtrackXDotConvert::addConversionOptions(OperationParameters* ret)
+{
     OptionalParameter* rowVoxelOpt = ret->createOptionalParameter(3, "-row-voxels", "the output mapping along a row will be voxels");
     rowVoxelOpt->addStringParameter(1, "voxel-list-file", "a text file containing IJK indices for the voxels used");
     rowVoxelOpt->addVolumeParameter(2, "label-vol", "a label volume with the dimensions and sform used, with structure labels");
@@ -86,12 +122,16 @@ OperationParameters* OperationProbtrackXDotConvert::getParameters()
     ret->createOptionalParameter(7, "-transpose", "transpose the input matrix");
     
     ret->createOptionalParameter(8, "-make-symmetric", "transform half-square input into full matrix output");
-    
+}
+
+AString OperationProbtrackXDotConvert::getConversionHelpText(const AString& outputText)
+{
     AString myText = AString("NOTE: exactly one -row option and one -col option must be used.\n\n") +
         "If the input file does not have its indexes sorted in the correct ordering, this command may take longer than expected.  " +
         "Specifying -transpose will transpose the input matrix before trying to put its values into the cifti file, which is currently needed for at least matrix2 " +
         "in order to display it as intended.  " +
         "How the cifti file is displayed is based on which -row option is specified: if -row-voxels is specified, then it will display data on volume slices.  " +
+        outputText +
         "The label names in the label volume(s) must have the following names, other names are ignored:\n\n";
     vector<StructureEnum::Enum> myStructureEnums;
     StructureEnum::getAllEnums(myStructureEnums);
@@ -99,15 +139,26 @@ OperationParameters* OperationProbtrackXDotConvert::getParameters()
     {
         myText += "\n" + StructureEnum::toName(myStructureEnums[i]);
     }
-    ret->setHelpText(myText);
-    return ret;
+    return myText;
 }
 
 void OperationProbtrackXDotConvert::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
 {
-    LevelProgress myProgress(myProgObj);
     AString dotFileName = myParams->getString(1);
     CiftiFile* myCiftiOut = myParams->getOutputCifti(2);
+    AString sparseFileName;
+    OptionalParameter* sparseOpt = myParams->getOptionalParameter(11);
+    if (sparseOpt->m_present)
+    {
+        sparseFileName = sparseOpt->getString(1);
+    }
+    convert(myParams, myProgObj, dotFileName, myCiftiOut, sparseFileName);
+}
+
+void OperationProbtrackXDotConvert::convert(OperationParameters* myParams, ProgressObject* myProgObj, const AString& dotFileName, CiftiFile* myCiftiOut, const AString& sparseFileName)
+{
+    CaretAssert(myCiftiOut != NULL || !sparseFileName.isEmpty());
+    LevelProgress myProgress(myProgObj);
     OptionalParameter* rowVoxelOpt = myParams->getOptionalParameter(3);
     OptionalParameter* rowSurfaceOpt = myParams->getOptionalParameter(4);
     OptionalParameter* rowCiftiOpt = myParams->getOptionalParameter(9);
@@ -288,7 +339,7 @@ void OperationProbtrackXDotConvert::useParameters(OperationParameters* myParams,
     {
         CaretLogInfo("sorting finished");
     }
-    myCiftiOut->setCiftiXML(myXML);
+    if (myCiftiOut != NULL) myCiftiOut->setCiftiXML(myXML);
     int64_t cur = 0, end = (int64_t)dotFileContents.size();
     vector<float> scratchRow(myXML.getNumberOfColumns(), 0.0f);
     vector<bool> checkDuplicate(myXML.getNumberOfColumns(), false);
@@ -345,11 +396,14 @@ void OperationProbtrackXDotConvert::useParameters(OperationParameters* myParams,
                 checkDuplicate[outIndex] = true;
             }
         }
-        if (colVoxelOpt->m_present)
-        {
-            myCiftiOut->setRow(scratchRow.data(), colReorderMap[whichRow]);
-        } else {
-            myCiftiOut->setRow(scratchRow.data(), whichRow);
+        if (myCiftiOut != NULL)
+        {//without the dense output, this loop still does the duplicate checking
+            if (colVoxelOpt->m_present)
+            {
+                myCiftiOut->setRow(scratchRow.data(), colReorderMap[whichRow]);
+            } else {
+                myCiftiOut->setRow(scratchRow.data(), whichRow);
+            }
         }
         if (rowVoxelOpt->m_present)
         {
@@ -370,6 +424,58 @@ void OperationProbtrackXDotConvert::useParameters(OperationParameters* myParams,
         cur = next;
         ++whichRow;
     }
+    if (!sparseFileName.isEmpty())
+    {//duplicates were checked above, and dotFileContents is sorted by row
+        const int64_t numRows = myXML.getNumberOfRows();
+        vector<int64_t> rowStart(numRows + 1);
+        int64_t position = 0;
+        for (int64_t row = 0; row < numRows; ++row)
+        {
+            rowStart[row] = position;
+            while (position < end && dotFileContents[position].index[1] == row) ++position;
+        }
+        rowStart[numRows] = end;
+        CaretCompressedSparseFileWriter sparseWriter(sparseFileName, convertXML(myXML), CaretCompressedSparseFile::FLOAT32);
+        bool failed = false;
+        AString errorMessage;
+#pragma omp CARET_PAR
+        {
+            vector<pair<int64_t, float> > rowElements;
+            vector<int64_t> indices;
+            vector<float> values;
+#pragma omp CARET_FOR schedule(dynamic, 16)
+            for (int64_t row = 0; row < numRows; ++row)
+            {
+                rowElements.clear();
+                for (int64_t i = rowStart[row]; i < rowStart[row + 1]; ++i)
+                {
+                    int64_t outIndex = dotFileContents[i].index[0];
+                    if (rowVoxelOpt->m_present) outIndex = rowReorderMap[outIndex];
+                    rowElements.push_back(pair<int64_t, float>(outIndex, dotFileContents[i].value));
+                }
+                sort(rowElements.begin(), rowElements.end());
+                indices.resize(rowElements.size());
+                values.resize(rowElements.size());
+                for (size_t i = 0; i < rowElements.size(); ++i)
+                {
+                    indices[i] = rowElements[i].first;
+                    values[i] = rowElements[i].second;
+                }
+                try
+                {
+                    sparseWriter.writeRowSparse(colVoxelOpt->m_present ? colReorderMap[row] : row, indices, values);
+                } catch (const CaretException& e) {//exceptions must not leave an openmp region
+#pragma omp critical
+                    {
+                        if (!failed) errorMessage = e.whatString();
+                        failed = true;
+                    }
+                }
+            }
+        }
+        if (failed) throw OperationException(errorMessage);
+        sparseWriter.finish();
+    }
 }
 
 void OperationProbtrackXDotConvert::addVoxelMapping(const VolumeFile* myLabelVol, const AString& textFileName, CiftiXMLOld& myXML, vector<int64_t>& reorderMapping, const int& direction)
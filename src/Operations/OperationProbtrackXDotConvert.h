@@ -26,6 +26,7 @@
 
 namespace caret {
     
+    class CiftiFile;
     class CiftiXMLOld;
     
     class OperationProbtrackXDotConvert : public AbstractOperation
@@ -36,6 +37,12 @@ namespace caret {
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
         static AString getShortDescription();
+        
+        ///shared with -probtrackx-dot-convert-sparse: the mapping options use keys 3 through 10
+        static void addConversionOptions(OperationParameters* ret);
+        static AString getConversionHelpText(const AString& outputText);
+        ///myCiftiOut may be NULL, and sparseFileName may be empty, but not both
+        static void convert(OperationParameters* myParams, ProgressObject* myProgObj, const AString& dotFileName, CiftiFile* myCiftiOut, const AString& sparseFileName);
     };
 
     typedef TemplateAutoOperation<OperationProbtrackXDotConvert> AutoOperationProbtrackXDotConvert;
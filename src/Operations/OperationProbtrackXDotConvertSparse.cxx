@@ -0,0 +1,53 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "OperationProbtrackXDotConvertSparse.h"
+#include "OperationProbtrackXDotConvert.h"
+
+using namespace caret;
+using namespace std;
+
+AString OperationProbtrackXDotConvertSparse::getCommandSwitch()
+{
+    return "-probtrackx-dot-convert-sparse";
+}
+
+AString OperationProbtrackXDotConvertSparse::getShortDescription()
+{
+    return "CONVERT A .DOT FILE FROM PROBTRACKX TO A COMPRESSED SPARSE FILE";
+}
+
+OperationParameters* OperationProbtrackXDotConvertSparse::getParameters()
+{
+    OperationParameters* ret = new OperationParameters();
+    ret->addStringParameter(1, "dot-file", "input .dot file");
+    ret->addStringParameter(2, "sparse-out", "output - the compressed sparse file");
+    
+    OperationProbtrackXDotConvert::addConversionOptions(ret);
+    
+    ret->setHelpText(OperationProbtrackXDotConvert::getConversionHelpText(
+        "This is the same as -probtrackx-dot-convert with -sparse-out, but does not write the dense cifti file, so the matrix is never expanded to its full size.  "));
+    return ret;
+}
+
+void OperationProbtrackXDotConvertSparse::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
+{
+    OperationProbtrackXDotConvert::convert(myParams, myProgObj, myParams->getString(1), NULL, myParams->getString(2));
+}
@@ -0,0 +1,214 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "OperationSurfaceGeodesicDistanceAllToAll.h"
+#include "OperationException.h"
+
+#include "CaretAssert.h"
+#include "CaretCompressedSparseFile.h"
+#include "CiftiFile.h"
+#include "GeodesicHelper.h"
+#include "MetricFile.h"
+#include "SurfaceFile.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+AString OperationSurfaceGeodesicDistanceAllToAll::getCommandSwitch()
+{
+    return "-surface-geodesic-distance-all-to-all";
+}
+
+AString OperationSurfaceGeodesicDistanceAllToAll::getShortDescription()
+{
+    return "COMPUTE GEODESIC DISTANCE FROM EVERY VERTEX TO EVERY VERTEX";
+}
+
+OperationParameters* OperationSurfaceGeodesicDistanceAllToAll::getParameters()
+{
+    OperationParameters* ret = new OperationParameters();
+    ret->addSurfaceParameter(1, "surface", "the surface to compute on");
+    
+    OptionalParameter* denseOpt = ret->createOptionalParameter(2, "-dense-out", "output the full matrix as a dconn");
+    denseOpt->addCiftiOutputParameter(1, "cifti-out", "the output dconn");
+    
+    OptionalParameter* roiOpt = ret->createOptionalParameter(3, "-roi", "only output distances between vertices inside an roi");
+    roiOpt->addMetricParameter(1, "roi-metric", "metric file, positive values denote vertices to use");
+    
+    OptionalParameter* limitOpt = ret->createOptionalParameter(4, "-limit", "stop at a certain distance");
+    limitOpt->addDoubleParameter(1, "limit-mm", "distance in mm to stop at");
+    
+    OptionalParameter* corrAreaOpt = ret->createOptionalParameter(5, "-corrected-areas", "vertex areas to use instead of computing them from the surface");
+    corrAreaOpt->addMetricParameter(1, "area-metric", "the corrected vertex areas, as a metric");
+    
+    ret->createOptionalParameter(6, "-naive", "use only neighbors, don't crawl triangles (not recommended)");
+    
+    OptionalParameter* sparseOpt = ret->createOptionalParameter(7, "-sparse-out", "output only the computed distances, as a compressed sparse file");
+    sparseOpt->addStringParameter(1, "sparse-file", "output - the compressed sparse file");
+    
+    ret->setHelpText(
+        AString("Computes the geodesic distance from every vertex to every other vertex, with one row per starting vertex.  ") +
+        "At least one of -dense-out and -sparse-out must be specified.  " +
+        "If -limit is specified, distances beyond the limit are not computed.  " +
+        "In the -dense-out dconn, distances that were not computed have a value of -1, as do vertices that are not connected to the starting vertex.  " +
+        "The -sparse-out file stores only the computed distances, so it is much smaller when -limit is used, " +
+        "but note that reading a row of it as dense gives 0 rather than -1 for the missing elements.  " +
+        "Many starting vertices are computed at once in parallel, and rows are written to the output as they are finished, " +
+        "so the matrix is never held in memory.  " +
+        "If -naive is not specified, it uses not just immediate neighbors, but also neighbors derived from crawling across pairs of triangles that share an edge."
+    );
+    return ret;
+}
+
+void OperationSurfaceGeodesicDistanceAllToAll::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    SurfaceFile* mySurf = myParams->getSurface(1);
+    CiftiFile* myCiftiOut = NULL;
+    OptionalParameter* denseOpt = myParams->getOptionalParameter(2);
+    if (denseOpt->m_present)
+    {
+        myCiftiOut = denseOpt->getOutputCifti(1);
+    }
+    OptionalParameter* sparseOpt = myParams->getOptionalParameter(7);
+    if (myCiftiOut == NULL && !sparseOpt->m_present) throw OperationException("you must specify -dense-out, -sparse-out, or both");
+    int32_t numNodes = mySurf->getNumberOfNodes();
+    const float* roiData = NULL;
+    OptionalParameter* roiOpt = myParams->getOptionalParameter(3);
+    if (roiOpt->m_present)
+    {
+        MetricFile* myRoi = roiOpt->getMetric(1);
+        if (myRoi->getNumberOfNodes() != numNodes) throw OperationException("roi metric does not match surface number of vertices");
+        roiData = myRoi->getValuePointerForColumn(0);
+    }
+    bool limited = false;
+    float limit = -1.0f;
+    OptionalParameter* limitOpt = myParams->getOptionalParameter(4);
+    if (limitOpt->m_present)
+    {
+        limited = true;
+        limit = (float)limitOpt->getDouble(1);
+        if (!(limit >= 0.0f)) throw OperationException("limit must not be negative");
+    }
+    CaretPointer<GeodesicHelperBase> myBase;
+    OptionalParameter* corrAreaOpt = myParams->getOptionalParameter(5);
+    if (corrAreaOpt->m_present)
+    {
+        MetricFile* corrAreas = corrAreaOpt->getMetric(1);
+        if (corrAreas->getNumberOfNodes() != numNodes) throw OperationException("corrected vertex areas metric does not match surface number of vertices");
+        myBase.grabNew(new GeodesicHelperBase(mySurf, corrAreas->getValuePointerForColumn(0)));
+    } else {
+        myBase.grabNew(new GeodesicHelperBase(mySurf));
+    }
+    bool smooth = !(myParams->getOptionalParameter(6)->m_present);
+    CiftiBrainModelsMap myMap;
+    myMap.addSurfaceModel(numNodes, mySurf->getStructure(), roiData);
+    CiftiXML myXML;
+    myXML.setNumberOfDimensions(2);
+    myXML.setMap(CiftiXML::ALONG_ROW, myMap);
+    myXML.setMap(CiftiXML::ALONG_COLUMN, myMap);
+    if (myCiftiOut != NULL) myCiftiOut->setCiftiXML(myXML);
+    CaretPointer<CaretCompressedSparseFileWriter> sparseWriter;
+    if (sparseOpt->m_present)
+    {
+        sparseWriter.grabNew(new CaretCompressedSparseFileWriter(sparseOpt->getString(1), myXML, CaretCompressedSparseFile::FLOAT32));
+    }
+    vector<CiftiBrainModelsMap::SurfaceMap> surfMap = myMap.getSurfaceMap(mySurf->getStructure());
+    int64_t numUsed = (int64_t)surfMap.size();
+    vector<int64_t> nodeToIndex(numNodes, -1);//so we can drop vertices outside the roi
+    for (int64_t i = 0; i < numUsed; ++i)
+    {
+        nodeToIndex[surfMap[i].m_surfaceNode] = surfMap[i].m_ciftiIndex;
+    }
+    GeodesicMultiRootHelper myHelp(myBase);
+    const int64_t BLOCK_ROOTS = 256;//enough roots to keep all threads busy, few enough that a block of full rows is small
+    vector<float> rowScratch;
+    if (myCiftiOut != NULL) rowScratch.resize(numUsed);
+    vector<pair<int64_t, float> > rowElements;
+    vector<int64_t> sparseIndices;
+    vector<float> sparseValues;
+    vector<float> fullRows;
+    if (!limited) fullRows.resize(BLOCK_ROOTS * numNodes);
+    vector<int32_t> roots;
+    vector<int64_t> rowStarts;
+    vector<int32_t> foundNodes;
+    vector<float> foundDists;
+    for (int64_t blockStart = 0; blockStart < numUsed; blockStart += BLOCK_ROOTS)
+    {
+        int64_t blockEnd = min(blockStart + BLOCK_ROOTS, numUsed);
+        roots.resize(blockEnd - blockStart);
+        for (int64_t i = blockStart; i < blockEnd; ++i)
+        {
+            roots[i - blockStart] = (int32_t)surfMap[i].m_surfaceNode;
+        }
+        if (limited)
+        {
+            myHelp.getNodesToGeoDist(roots, limit, rowStarts, foundNodes, foundDists, smooth);
+        } else {
+            myHelp.getGeoFromNodes(roots, fullRows.data(), smooth);
+        }
+        for (int64_t i = blockStart; i < blockEnd; ++i)
+        {
+            int64_t whichRoot = i - blockStart;
+            rowElements.clear();//(cifti index, distance) of the computed distances
+            if (limited)
+            {
+                for (int64_t j = rowStarts[whichRoot]; j < rowStarts[whichRoot + 1]; ++j)
+                {
+                    int64_t outIndex = nodeToIndex[foundNodes[j]];
+                    if (outIndex >= 0) rowElements.push_back(pair<int64_t, float>(outIndex, foundDists[j]));
+                }
+            } else {
+                const float* fullRow = fullRows.data() + whichRoot * numNodes;
+                for (int64_t j = 0; j < numUsed; ++j)
+                {
+                    const float dist = fullRow[surfMap[j].m_surfaceNode];
+                    if (dist >= 0.0f) rowElements.push_back(pair<int64_t, float>(surfMap[j].m_ciftiIndex, dist));//unconnected vertices are -1
+                }
+            }
+            if (myCiftiOut != NULL)
+            {
+                rowScratch.assign(numUsed, -1.0f);//use -1 to specify not computed
+                for (size_t j = 0; j < rowElements.size(); ++j)
+                {
+                    rowScratch[rowElements[j].first] = rowElements[j].second;
+                }
+                myCiftiOut->setRow(rowScratch.data(), surfMap[i].m_ciftiIndex);
+            }
+            if (sparseWriter != NULL)
+            {
+                sort(rowElements.begin(), rowElements.end());//the limited search finds vertices in distance order
+                sparseIndices.resize(rowElements.size());
+                sparseValues.resize(rowElements.size());
+                for (size_t j = 0; j < rowElements.size(); ++j)
+                {
+                    sparseIndices[j] = rowElements[j].first;
+                    sparseValues[j] = rowElements[j].second;
+                }
+                sparseWriter->writeRowSparse(surfMap[i].m_ciftiIndex, sparseIndices, sparseValues);
+            }
+        }
+    }
+    if (sparseWriter != NULL) sparseWriter->finish();
+}
@@ -22,6 +22,7 @@
 #include "OperationException.h"
 
 #include "GeodesicHelper.h"
+#include "GeodesicNeighborhood.h"
 #include "MetricFile.h"
 #include "SurfaceFile.h"
 
@@ -176,12 +177,15 @@ void OperationSurfaceGeodesicROIs::useParameters(OperationParameters* myParams,
     }
     CaretPointer<GeodesicHelper> myhelp;
     CaretPointer<GeodesicHelperBase> mygeobase;
+    CaretPointer<const GeodesicNeighborhood> myGeoNeigh;//only use neighborhoods of all vertices if something already computed them, we only need the seeds
     if (corrAreas == NULL)
     {
         myhelp = mySurf->getGeodesicHelper();
+        myGeoNeigh = GeodesicNeighborhood::getIfCached(mySurf, limit);
     } else {
         mygeobase.grabNew(new GeodesicHelperBase(mySurf, corrAreas->getValuePointerForColumn(0)));
         myhelp.grabNew(new GeodesicHelper(mygeobase));
+        myGeoNeigh = GeodesicNeighborhood::getIfCached(mySurf, limit, corrAreas->getValuePointerForColumn(0));
     }
     switch (overlapType)
     {
@@ -190,7 +194,12 @@ void OperationSurfaceGeodesicROIs::useParameters(OperationParameters* myParams,
             {
                 vector<int32_t> roinodes;
                 vector<float> dists;
-                myhelp->getNodesToGeoDist(nodelist[i], limit, roinodes, dists);
+                if (myGeoNeigh != NULL)
+                {
+                    myGeoNeigh->getNodesToGeoDist(nodelist[i], roinodes, dists);
+                } else {
+                    myhelp->getNodesToGeoDist(nodelist[i], limit, roinodes, dists);
+                }
                 if (sigma > 0.0f)
                 {
                     double accum = 0.0;
@@ -222,7 +231,12 @@ void OperationSurfaceGeodesicROIs::useParameters(OperationParameters* myParams,
             {
                 vector<int32_t> roinodes;
                 vector<float> dists;
-                myhelp->getNodesToGeoDist(nodelist[i], limit, roinodes, dists);
+                if (myGeoNeigh != NULL)
+                {
+                    myGeoNeigh->getNodesToGeoDist(nodelist[i], roinodes, dists);
+                } else {
+                    myhelp->getNodesToGeoDist(nodelist[i], limit, roinodes, dists);
+                }
                 for (int j = 0; j < (int)roinodes.size(); ++j)
                 {
                     ++useCounts[roinodes[j]];
@@ -374,6 +374,14 @@ void ParameterComponent::addVolumeOutputParameter(const int32_t key, const AStri
     m_outputList.push_back(new VolumeParameter(key, name, description));
 }
 
+void ParameterComponent::addVolumeFramesOutputParameter(const int32_t key, const AString& name, const AString& description)
+{
+    CaretAssertMessage(checkUniqueOutput(key, OperationParametersEnum::VOLUME), "output volume parameter created with previously used key");
+    VolumeParameter* myParam = new VolumeParameter(key, name, description);
+    myParam->m_writeFrames = true;
+    m_outputList.push_back(myParam);
+}
+
 AString& OperationParameters::getHelpText()
 {
     return m_helpText;
@@ -468,6 +476,13 @@ VolumeFile* ParameterComponent::getOutputVolume(const int32_t key)
     return ((VolumeParameter*)getOutputParameter(key, OperationParametersEnum::VOLUME))->m_parameter.getPointer();
 }
 
+const AString& ParameterComponent::getOutputVolumeFramesFileName(const int32_t key)
+{
+    VolumeParameter* myParam = (VolumeParameter*)getOutputParameter(key, OperationParametersEnum::VOLUME);
+    CaretAssertMessage(myParam->m_writeFrames, "asked for frames file name of a volume output that isn't written by frames");
+    return myParam->m_framesFileName;
+}
+
 MetricFile* ParameterComponent::getOutputMetric(const int32_t key)
 {
     return ((MetricParameter*)getOutputParameter(key, OperationParametersEnum::METRIC))->m_parameter.getPointer();
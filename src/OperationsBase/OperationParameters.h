@@ -152,6 +152,12 @@ namespace caret {
         ///get a volume with a key
         VolumeFile* getOutputVolume(const int32_t key);
         
+        ///add a parameter to get next item as a volume that the operation writes one frame at a time
+        void addVolumeFramesOutputParameter(const int32_t key, const AString& name, const AString& description);
+        
+        ///get the file name to write frames to, empty if the output must go in getOutputVolume instead (such as when it collides with an input)
+        const AString& getOutputVolumeFramesFileName(const int32_t key);
+        
         ///add a parameter to get next item as a functional file (metric)
         void addMetricOutputParameter(const int32_t key, const AString& name, const AString& description);
         
@@ -326,7 +332,21 @@ namespace caret {
     
     //some friendlier names
     typedef PointerTemplateParameter<SurfaceFile, OperationParametersEnum::SURFACE> SurfaceParameter;
-    typedef PointerTemplateParameter<VolumeFile, OperationParametersEnum::VOLUME> VolumeParameter;
+    struct VolumeParameter : public PointerTemplateParameter<VolumeFile, OperationParametersEnum::VOLUME>
+    {//outputs can be written by the operation one frame at a time, for outputs too large to hold in memory
+        bool m_writeFrames;
+        AString m_framesFileName;//set by the parser when the operation should write the file, m_parameter still holds the provenance metadata
+        virtual AbstractParameter* cloneAbstractParameter()
+        {
+            VolumeParameter* ret = new VolumeParameter(m_key, m_shortName, m_description);
+            ret->m_writeFrames = m_writeFrames;
+            return ret;
+        }
+        VolumeParameter(const int32_t key, const AString& shortName, const AString& description) : PointerTemplateParameter<VolumeFile, OperationParametersEnum::VOLUME>(key, shortName, description)
+        {
+            m_writeFrames = false;
+        }
+    };
     typedef PointerTemplateParameter<MetricFile, OperationParametersEnum::METRIC> MetricParameter;
     typedef PointerTemplateParameter<LabelFile, OperationParametersEnum::LABEL> LabelParameter;
     typedef PointerTemplateParameter<CiftiFile, OperationParametersEnum::CIFTI> CiftiParameter;
@@ -0,0 +1,192 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "BenchmarkInterface.h"
+
+#include "AlgorithmSurfaceCreateSphere.h"
+#include "ApplicationInformation.h"
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "CiftiXML.h"
+#include "MetricFile.h"
+#include "SurfaceFile.h"
+#include "VolumeFile.h"
+
+#include <QDir>
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace caret;
+using namespace std;
+
+BenchmarkInterface::BenchmarkInterface(const AString& identifier)
+{
+    m_identifier = identifier;
+    m_results = NULL;
+    m_timingBytes = 0;
+    m_quick = false;
+    m_tempPath = QDir::tempPath();
+}
+
+BenchmarkInterface::~BenchmarkInterface()
+{
+}
+
+void BenchmarkInterface::run(vector<Result>& resultsOut)
+{
+    m_results = &resultsOut;
+    execute();
+    m_results = NULL;
+}
+
+void BenchmarkInterface::startTiming(const AString& name, const AString& size, const int64_t& bytes)
+{
+    m_timingName = name;
+    m_timingSize = size;
+    m_timingBytes = bytes;
+    m_timer.start();
+}
+
+void BenchmarkInterface::stopTiming()
+{
+    CaretAssert(m_results != NULL);
+    Result thisResult;
+    thisResult.m_seconds = m_timer.getElapsedTimeSeconds();
+    thisResult.m_benchmark = m_identifier;
+    thisResult.m_name = m_timingName;
+    thisResult.m_size = m_timingSize;
+    thisResult.m_bytes = m_timingBytes;
+    m_results->push_back(thisResult);
+    cerr << m_identifier << ": " << m_timingName << " (" << m_timingSize << "): " << thisResult.m_seconds << " seconds" << endl;//progress for humans goes to stderr, so stdout can be only the JSON
+}
+
+void BenchmarkInterface::fillRandom(float* data, const int64_t& count)
+{
+    for (int64_t i = 0; i < count; ++i)
+    {
+        data[i] = ((float)rand()) / RAND_MAX * 2.0f - 1.0f;
+    }
+}
+
+void BenchmarkInterface::createSphere(const int32_t& numVertices, const StructureEnum::Enum& structure, SurfaceFile& sphereOut)
+{
+    AlgorithmSurfaceCreateSphere(NULL, numVertices, &sphereOut);
+    sphereOut.setStructure(structure);
+}
+
+void BenchmarkInterface::createRandomMetric(const int32_t& numVertices, const int32_t& numColumns, MetricFile& metricOut)
+{
+    metricOut.setNumberOfNodesAndColumns(numVertices, numColumns);
+    vector<float> scratch(numVertices);
+    for (int32_t i = 0; i < numColumns; ++i)
+    {
+        fillRandom(scratch.data(), numVertices);
+        metricOut.setValuesForColumn(i, scratch.data());
+    }
+}
+
+void BenchmarkInterface::createRandomVolume(const int64_t dims[3], const float& spacing, const int64_t& numFrames, VolumeFile& volumeOut)
+{
+    vector<int64_t> volDims(dims, dims + 3);
+    if (numFrames > 1) volDims.push_back(numFrames);
+    vector<vector<float> > sform(3, vector<float>(4, 0.0f));
+    for (int i = 0; i < 3; ++i)
+    {
+        sform[i][i] = spacing;
+        sform[i][3] = -spacing * (dims[i] - 1) / 2.0f;//center it, like MNI
+    }
+    volumeOut.reinitialize(volDims, sform);
+    const int64_t frameSize = dims[0] * dims[1] * dims[2];
+    vector<float> scratch(frameSize);
+    for (int64_t i = 0; i < numFrames; ++i)
+    {
+        fillRandom(scratch.data(), frameSize);
+        volumeOut.setFrame(scratch.data(), i);
+    }
+}
+
+void BenchmarkInterface::createDenseSeriesXML(const int64_t& numVerticesPerHemisphere, const int64_t& numVoxels, const int64_t& numTimepoints, CiftiXML& xmlOut)
+{//both hemispheres fully included, plus a block of voxels in a 2mm MNI sized grid, like a 91k grayordinate dtseries
+    CiftiBrainModelsMap myMap;
+    myMap.addSurfaceModel(numVerticesPerHemisphere, StructureEnum::CORTEX_LEFT);
+    myMap.addSurfaceModel(numVerticesPerHemisphere, StructureEnum::CORTEX_RIGHT);
+    if (numVoxels > 0)
+    {
+        const int64_t volDims[3] = { 91, 109, 91 };
+        const float sform[12] = { -2.0f, 0.0f, 0.0f, 90.0f,
+                                  0.0f, 2.0f, 0.0f, -126.0f,
+                                  0.0f, 0.0f, 2.0f, -72.0f };
+        myMap.setVolumeSpace(VolumeSpace(volDims, sform));
+        vector<int64_t> ijkList;
+        ijkList.reserve(numVoxels * 3);
+        const int64_t start[3] = { 20, 20, 10 }, size[2] = { 50, 60 };//a slab, so neighboring voxels are realistic for smoothing
+        for (int64_t i = 0; i < numVoxels; ++i)
+        {
+            ijkList.push_back(start[0] + i % size[0]);
+            ijkList.push_back(start[1] + (i / size[0]) % size[1]);
+            ijkList.push_back(start[2] + i / (size[0] * size[1]));
+        }
+        myMap.addVolumeModel(StructureEnum::OTHER, ijkList);
+    }
+    xmlOut = CiftiXML();
+    xmlOut.setNumberOfDimensions(2);
+    xmlOut.setMap(CiftiXML::ALONG_COLUMN, myMap);
+    xmlOut.setMap(CiftiXML::ALONG_ROW, CiftiSeriesMap(numTimepoints, 0.0f, 0.72f));
+}
+
+namespace
+{
+    AString jsonString(const AString& in)
+    {
+        AString ret = in;
+        ret.replace("\\", "\\\\");
+        ret.replace("\"", "\\\"");
+        return "\"" + ret + "\"";
+    }
+}
+
+AString BenchmarkInterface::resultsToJSON(const vector<Result>& results, const bool& quick)
+{
+    ApplicationInformation appInfo;
+    int numThreads = 1;
+#ifdef CARET_OMP
+    numThreads = omp_get_max_threads();
+#endif
+    AString ret = "{\n";
+    ret += "  \"format\": 1,\n";
+    ret += "  \"version\": " + jsonString(appInfo.getVersion()) + ",\n";
+    ret += "  \"commit\": " + jsonString(appInfo.getCommit()) + ",\n";
+    ret += "  \"debug\": " + jsonString(appInfo.getCompiledWithDebugStatus()) + ",\n";
+    ret += "  \"threads\": " + AString::number(numThreads) + ",\n";
+    ret += "  \"quick\": " + AString(quick ? "true" : "false") + ",\n";
+    ret += "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        if (i != 0) ret += ",";
+        ret += "\n    { \"benchmark\": " + jsonString(results[i].m_benchmark) +
+               ", \"name\": " + jsonString(results[i].m_name) +
+               ", \"size\": " + jsonString(results[i].m_size) +
+               ", \"seconds\": " + AString::number(results[i].m_seconds, 'g', 6) +
+               ", \"bytes\": " + AString::number(results[i].m_bytes) + " }";
+    }
+    ret += "\n  ]\n}\n";
+    return ret;
+}
@@ -0,0 +1,82 @@
+#ifndef __BENCHMARK_INTERFACE_H__
+#define __BENCHMARK_INTERFACE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+#include "ElapsedTimer.h"
+#include "StructureEnum.h"
+
+#include <vector>
+#include "stdint.h"
+
+namespace caret {
+
+    class CiftiXML;
+    class MetricFile;
+    class SurfaceFile;
+    class VolumeFile;
+
+    class BenchmarkInterface
+    {
+    public:
+        struct Result
+        {
+            AString m_benchmark, m_name, m_size;
+            double m_seconds;
+            int64_t m_bytes;//data processed, for throughput, 0 if not meaningful
+        };
+    private:
+        AString m_identifier;
+        std::vector<Result>* m_results;
+        ElapsedTimer m_timer;
+        AString m_timingName, m_timingSize;
+        int64_t m_timingBytes;
+        BenchmarkInterface();
+        BenchmarkInterface& operator=(const BenchmarkInterface& right);
+    protected:
+        bool m_quick;//smaller data, for checking that benchmarks run rather than for timing
+        AString m_tempPath;
+        BenchmarkInterface(const AString& identifier);
+
+        //time one thing at a time: startTiming(), the code to time, stopTiming()
+        void startTiming(const AString& name, const AString& size, const int64_t& bytes = 0);
+        void stopTiming();
+
+        //synthetic data at realistic sizes, values from rand(), so seed it for repeatable data
+        static void createSphere(const int32_t& numVertices, const StructureEnum::Enum& structure, SurfaceFile& sphereOut);
+        static void createRandomMetric(const int32_t& numVertices, const int32_t& numColumns, MetricFile& metricOut);
+        static void createRandomVolume(const int64_t dims[3], const float& spacing, const int64_t& numFrames, VolumeFile& volumeOut);
+        static void createDenseSeriesXML(const int64_t& numVerticesPerHemisphere, const int64_t& numVoxels, const int64_t& numTimepoints, CiftiXML& xmlOut);
+        static void fillRandom(float* data, const int64_t& count);
+    public:
+        const AString& getIdentifier() const { return m_identifier; }
+        void setQuick(const bool& quick) { m_quick = quick; }
+        void setTempPath(const AString& tempPath) { m_tempPath = tempPath; }
+        void run(std::vector<Result>& resultsOut);
+        virtual void execute() = 0;//override this, call startTiming/stopTiming around each timed section
+        virtual ~BenchmarkInterface();
+
+        static AString resultsToJSON(const std::vector<Result>& results, const bool& quick);
+    };
+
+}
+#endif //__BENCHMARK_INTERFACE_H__
@@ -0,0 +1,228 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "BlockGzipTest.h"
+
+#include "CaretBinaryFile.h"
+#include "CaretBlockGzip.h"
+#include "DataFileException.h"
+
+#include <QDir>
+#include <QFile>
+
+#include "zlib.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+using namespace caret;
+using namespace std;
+
+BlockGzipTest::BlockGzipTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    //compressible but not trivial, so blocks have different compressed sizes
+    void makeData(vector<char>& dataOut, const int64_t& size)
+    {
+        dataOut.resize(size);
+        for (int64_t i = 0; i < size; ++i)
+        {
+            dataOut[i] = (i % 7 == 0) ? (char)(rand() & 0xff) : (char)((i / 1000) & 0x1f);
+        }
+    }
+    
+    bool readWhole(const AString& fileName, vector<char>& dataOut)
+    {
+        QFile myFile(fileName);
+        if (!myFile.open(QIODevice::ReadOnly)) return false;
+        QByteArray contents = myFile.readAll();
+        dataOut.assign(contents.constData(), contents.constData() + contents.size());
+        return true;
+    }
+    
+    bool writeWhole(const AString& fileName, const vector<char>& data)
+    {
+        QFile myFile(fileName);
+        if (!myFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+        return myFile.write(data.data(), data.size()) == (qint64)data.size();
+    }
+}
+
+void BlockGzipTest::checkRead(const AString& fileName, const vector<char>& reference, const AString& descrip)
+{
+    const int64_t size = (int64_t)reference.size();
+    CaretBinaryFile myFile(fileName);
+    vector<char> buffer(size);
+    int64_t position = 0;
+    int iteration = 0;
+    while (position < size)
+    {//mix of small reads like header parsing and large reads like whole frames
+        int64_t count = (iteration % 4 == 0) ? (rand() % 3000000) : (rand() % 3000);
+        count = min(count, size - position);
+        myFile.read(buffer.data(), count);
+        if (memcmp(buffer.data(), reference.data() + position, count) != 0)
+        {
+            setFailed(descrip + ": sequential read mismatch at " + AString::number(position));
+            return;
+        }
+        position += count;
+        if (myFile.pos() != position) setFailed(descrip + ": pos() is wrong after sequential read");
+        ++iteration;
+    }
+    int64_t numRead = -1;
+    myFile.read(buffer.data(), 10, &numRead);
+    if (numRead != 0) setFailed(descrip + ": read past the end returned " + AString::number(numRead) + " bytes");
+    for (int i = 0; i < 30; ++i)
+    {//seeks in both directions, from wherever the last read left off
+        const int64_t start = rand() % size, count = min((int64_t)(rand() % 2000000), size - start);
+        myFile.seek(start);
+        if (myFile.pos() != start) setFailed(descrip + ": pos() is wrong after seek");
+        myFile.read(buffer.data(), count);
+        if (memcmp(buffer.data(), reference.data() + start, count) != 0)
+        {
+            setFailed(descrip + ": read mismatch after seek to " + AString::number(start));
+            return;
+        }
+        const int64_t skipTo = start + count + rand() % 1000;//short forward seek, within what was probably already inflated
+        if (skipTo + 10 < size)
+        {
+            myFile.seek(skipTo);
+            myFile.read(buffer.data(), 10);
+            if (memcmp(buffer.data(), reference.data() + skipTo, 10) != 0) setFailed(descrip + ": read mismatch after short forward seek");
+        }
+    }
+    bool caught = false;
+    try
+    {
+        myFile.seek(size - 5);
+        myFile.read(buffer.data(), 10);
+    } catch (DataFileException&) {
+        caught = true;
+    }
+    if (!caught) setFailed(descrip + ": short read without numRead did not throw");
+    myFile.close();
+}
+
+void BlockGzipTest::execute()
+{
+    const int64_t SIZE = 20000000;//several read batches and read-ahead chunks
+    const int64_t GAP_START = 1234567, GAP_END = 1400000;
+    vector<char> reference;
+    makeData(reference, SIZE);
+    memset(reference.data() + GAP_START, 0, GAP_END - GAP_START);//written with a forward seek
+    const AString bgzfName = QDir::tempPath() + "/wb_block_gzip_test.nii.gz";
+    const AString plainName = QDir::tempPath() + "/wb_block_gzip_test_plain.nii.gz";
+    const AString badName = QDir::tempPath() + "/wb_block_gzip_test_bad.nii.gz";
+    {//write round trip
+        CaretBinaryFile myFile(bgzfName, CaretBinaryFile::WRITE_TRUNCATE);
+        int64_t position = 0;
+        while (position < SIZE)
+        {
+            if (position == GAP_START)
+            {
+                myFile.seek(GAP_END);
+                position = GAP_END;
+                continue;
+            }
+            int64_t count = (rand() % 3 == 0) ? rand() % 5000000 : rand() % 100;//writes both smaller and larger than a block
+            if (position < GAP_START) count = min(count, GAP_START - position);
+            count = min(count, SIZE - position);
+            myFile.write(reference.data() + position, count);
+            position += count;
+            if (myFile.pos() != position) setFailed("pos() is wrong during write");
+        }
+        bool caught = false;
+        try
+        {
+            myFile.seek(5);
+        } catch (DataFileException&) {
+            caught = true;
+        }
+        if (!caught) setFailed("backward seek while writing did not throw");
+        myFile.close();
+    }
+    if (!BlockGzip::isBlockGzip(bgzfName)) setFailed("written file is not detected as BGZF");
+    vector<char> compressed;
+    if (!readWhole(bgzfName, compressed)) setFailed("failed to read back written file");
+    vector<char> eofBlock;
+    BlockGzip::getEOFBlock(eofBlock);
+    if (compressed.size() < eofBlock.size() || !equal(eofBlock.begin(), eofBlock.end(), compressed.end() - eofBlock.size()))
+    {
+        setFailed("written file does not end with the BGZF EOF block");
+    }
+    {//any gzip reader must see the same data, check with plain zlib
+        gzFile zfile = gzopen(bgzfName.toLocal8Bit().constData(), "rb");
+        vector<char> buffer(SIZE + 10);
+        const int numRead = (zfile == NULL) ? -1 : gzread(zfile, buffer.data(), SIZE + 10);
+        if (zfile != NULL) gzclose(zfile);
+        if (numRead != SIZE || memcmp(buffer.data(), reference.data(), SIZE) != 0) setFailed("zlib does not read the BGZF file correctly");
+    }
+    checkRead(bgzfName, reference, "BGZF");
+    {//plain single member gzip goes through the read-ahead thread
+        gzFile zfile = gzopen(plainName.toLocal8Bit().constData(), "wb");
+        if (zfile == NULL || gzwrite(zfile, reference.data(), SIZE) != SIZE) setFailed("failed to write plain gzip file with zlib");
+        if (zfile != NULL) gzclose(zfile);
+    }
+    if (BlockGzip::isBlockGzip(plainName)) setFailed("plain gzip file is detected as BGZF");
+    checkRead(plainName, reference, "plain gzip");
+    {//a flipped crc must be detected, both by the block function and by reading the file
+        int64_t headerSize = 0;
+        const int64_t blockSize = BlockGzip::getBlockSize(compressed.data(), (int64_t)compressed.size(), &headerSize);
+        if (blockSize <= 0)
+        {
+            setFailed("failed to parse the first block header");
+        } else {
+            vector<char> bad = compressed;
+            bad[blockSize - 8] ^= 0x55;//first byte of the crc
+            vector<char> inflated(BlockGzip::getBlockInputSize(bad.data(), blockSize));
+            if (BlockGzip::decompressBlock(bad.data(), blockSize, inflated.data())) setFailed("decompressBlock accepted a bad crc");
+            if (!BlockGzip::decompressBlock(compressed.data(), blockSize, inflated.data())) setFailed("decompressBlock rejected a good block");
+            if (!writeWhole(badName, bad)) setFailed("failed to write corrupted file");
+            bool caught = false;
+            try
+            {
+                CaretBinaryFile myFile(badName);
+                vector<char> buffer(SIZE);
+                myFile.read(buffer.data(), SIZE);
+            } catch (DataFileException&) {
+                caught = true;
+            }
+            if (!caught) setFailed("reading a BGZF file with a bad crc did not throw");
+        }
+    }
+    {//empty file is just the EOF block
+        {
+            CaretBinaryFile myFile(bgzfName, CaretBinaryFile::WRITE_TRUNCATE);
+            myFile.close();
+        }
+        if (!readWhole(bgzfName, compressed) || compressed != eofBlock) setFailed("empty BGZF file is not exactly the EOF block");
+        CaretBinaryFile myFile(bgzfName);
+        char buffer[10];
+        int64_t numRead = -1;
+        myFile.read(buffer, 10, &numRead);
+        if (numRead != 0) setFailed("reading an empty BGZF file returned data");
+    }
+    QFile::remove(bgzfName);
+    QFile::remove(plainName);
+    QFile::remove(badName);
+}
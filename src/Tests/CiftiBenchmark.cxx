@@ -0,0 +1,109 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiBenchmark.h"
+
+#include "AlgorithmCiftiCorrelation.h"
+#include "CaretException.h"
+#include "CiftiFile.h"
+#include "MetricFile.h"
+
+#include <QCoreApplication>
+#include <QFile>
+
+#include <algorithm>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+CiftiBenchmark::CiftiBenchmark(const AString& identifier) : BenchmarkInterface(identifier)
+{
+}
+
+void CiftiBenchmark::execute()
+{
+    const int64_t numVertices = (m_quick ? 2562 : 32492), numVoxels = (m_quick ? 3000 : 26298), numTimepoints = (m_quick ? 100 : 1200);//full size is the 91282 x 1200 HCP dtseries
+    CiftiXML myXML;
+    createDenseSeriesXML(numVertices, numVoxels, numTimepoints, myXML);
+    const int64_t numRows = myXML.getDimensionLength(CiftiXML::ALONG_COLUMN), rowLength = myXML.getDimensionLength(CiftiXML::ALONG_ROW);
+    const AString sizeString = AString::number(numRows) + "x" + AString::number(rowLength);
+    const int64_t totalBytes = numRows * rowLength * (int64_t)sizeof(float);
+    const int64_t POOL_ROWS = 64;//generate random data ahead of time, so rand() isn't timed
+    vector<float> rowPool(POOL_ROWS * rowLength), scratch(max(rowLength, numRows));
+    fillRandom(rowPool.data(), (int64_t)rowPool.size());
+    const AString fileName = m_tempPath + "/wb_benchmark_" + AString::number(QCoreApplication::applicationPid()) + ".dtseries.nii";
+    try
+    {
+        {
+            CiftiFile outFile;
+            outFile.setWritingFile(fileName);
+            outFile.setCiftiXML(myXML);
+            startTiming("dtseries write rows on disk", sizeString, totalBytes);
+            for (int64_t i = 0; i < numRows; ++i)
+            {
+                outFile.setRow(rowPool.data() + (i % POOL_ROWS) * rowLength, i);
+            }
+            outFile.close();
+            stopTiming();
+        }
+        CiftiFile inFile(fileName);
+        startTiming("dtseries read rows on disk", sizeString, totalBytes);
+        for (int64_t i = 0; i < numRows; ++i)
+        {
+            inFile.getRow(scratch.data(), i);
+        }
+        stopTiming();
+        const int64_t numColumns = (m_quick ? 5 : 20);
+        startTiming("dtseries read columns on disk", sizeString, numColumns * numRows * (int64_t)sizeof(float));
+        for (int64_t i = 0; i < numColumns; ++i)
+        {
+            inFile.getColumn(scratch.data(), (i * rowLength) / numColumns);
+        }
+        stopTiming();
+        startTiming("dtseries convert to in memory", sizeString, totalBytes);
+        inFile.convertToInMemory();
+        stopTiming();
+        startTiming("dtseries read columns in memory", sizeString, numColumns * numRows * (int64_t)sizeof(float));
+        for (int64_t i = 0; i < numColumns; ++i)
+        {
+            inFile.getColumn(scratch.data(), (i * rowLength) / numColumns);
+        }
+        stopTiming();
+        const int32_t numSeeds = (m_quick ? 200 : 2000);//a full dconn is 33GB, correlate a left hemisphere ROI to everything instead
+        MetricFile seedRoi;
+        seedRoi.setNumberOfNodesAndColumns(numVertices, 1);
+        seedRoi.setStructure(StructureEnum::CORTEX_LEFT);
+        vector<float> roiData(numVertices, 0.0f);
+        for (int32_t i = 0; i < numSeeds; ++i)
+        {
+            roiData[(i * numVertices) / numSeeds] = 1.0f;
+        }
+        seedRoi.setValuesForColumn(0, roiData.data());
+        CiftiFile correlationOut;
+        startTiming("correlation", AString::number(numSeeds) + "x" + sizeString, totalBytes);
+        AlgorithmCiftiCorrelation(NULL, &inFile, &correlationOut, &seedRoi);
+        stopTiming();
+    } catch (const CaretException&) {
+        QFile::remove(fileName);
+        throw;
+    }
+    QFile::remove(fileName);
+}
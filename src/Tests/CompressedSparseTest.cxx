@@ -0,0 +1,138 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "CompressedSparseTest.h"
+
+#include "CaretCompressedSparseFile.h"
+#include "DataFileException.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+CompressedSparseTest::CompressedSparseTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void CompressedSparseTest::execute()
+{
+    const int64_t ROW_LENGTH = 1000, NUM_ROWS = 50;
+    CiftiXML myXML;
+    myXML.setNumberOfDimensions(2);
+    CiftiScalarsMap rowMap, colMap;
+    rowMap.setLength(ROW_LENGTH);
+    colMap.setLength(NUM_ROWS);
+    myXML.setMap(CiftiXML::ALONG_ROW, rowMap);
+    myXML.setMap(CiftiXML::ALONG_COLUMN, colMap);
+    vector<vector<int64_t> > indices(NUM_ROWS);
+    vector<vector<float> > values(NUM_ROWS);
+    for (int64_t row = 0; row < NUM_ROWS; ++row)
+    {
+        if (row % 7 == 3) continue;//some empty rows
+        int64_t index = rand() % 5;
+        while (index < ROW_LENGTH)
+        {
+            indices[row].push_back(index);
+            values[row].push_back(((float)rand()) / RAND_MAX * 100.0f - 50.0f);
+            index += 1 + rand() % (row + 1);//sparser rows later, and adjacent indices in row 0
+        }
+    }
+    indices[NUM_ROWS - 1].assign(1, ROW_LENGTH - 1);//largest possible index
+    values[NUM_ROWS - 1].assign(1, 1.0f);
+    AString fileName = QDir::tempPath() + "/wb_compressed_sparse_test.wbsparse";
+    {
+        CaretCompressedSparseFileWriter writer(fileName, myXML, CaretCompressedSparseFile::FLOAT32);
+        vector<int64_t> order(NUM_ROWS);
+        for (int64_t i = 0; i < NUM_ROWS; ++i) order[i] = i;
+        random_shuffle(order.begin(), order.end());//rows may be written in any order
+        for (int64_t i = 0; i < NUM_ROWS; ++i)
+        {
+            if (order[i] % 11 == 5) continue;//rows that are never written should read as empty
+            writer.writeRowSparse(order[i], indices[order[i]], values[order[i]]);
+        }
+        for (int64_t row = 0; row < NUM_ROWS; ++row)
+        {
+            if (row % 11 == 5)
+            {
+                indices[row].clear();
+                values[row].clear();
+            }
+        }
+        bool caught = false;
+        try
+        {
+            writer.writeRowSparse(0, indices[0], values[0]);
+        } catch (DataFileException&) {
+            caught = true;
+        }
+        if (!caught) setFailed("writing a row twice did not throw");
+        writer.finish();
+    }
+    CaretCompressedSparseFile reader(fileName);
+    if (reader.getDimensions()[0] != ROW_LENGTH || reader.getDimensions()[1] != NUM_ROWS)
+    {
+        setFailed("dimensions read back as " + AString::number(reader.getDimensions()[0]) + ", " + AString::number(reader.getDimensions()[1]));
+        QFile::remove(fileName);
+        return;
+    }
+    if (reader.getValueType() != CaretCompressedSparseFile::FLOAT32) setFailed("value type was not preserved");
+    if (reader.getCiftiXML().getDimensionLength(CiftiXML::ALONG_ROW) != ROW_LENGTH) setFailed("xml was not preserved");
+    vector<int64_t> readIndices;
+    vector<float> readValues, denseRow(ROW_LENGTH), expectedDense(ROW_LENGTH);
+    for (int64_t row = 0; row < NUM_ROWS; ++row)
+    {
+        if (reader.getRowNonzeroCount(row) != (int64_t)indices[row].size())
+        {
+            setFailed("row " + AString::number(row) + " has " + AString::number(reader.getRowNonzeroCount(row)) + " nonzeros, expected " + AString::number(indices[row].size()));
+        }
+        reader.getRowSparse(row, readIndices, readValues);
+        if (readIndices != indices[row] || readValues != values[row])//values are stored exactly
+        {
+            setFailed("sparse contents of row " + AString::number(row) + " do not match");
+        }
+        reader.getRow(row, denseRow.data());
+        fill(expectedDense.begin(), expectedDense.end(), 0.0f);
+        for (size_t i = 0; i < indices[row].size(); ++i) expectedDense[indices[row][i]] = values[row][i];
+        if (denseRow != expectedDense) setFailed("dense contents of row " + AString::number(row) + " do not match");
+        if (failed()) break;
+    }
+    reader.close();
+    QFile::remove(fileName);
+    {//an unfinished file must be rejected
+        CaretCompressedSparseFileWriter writer(fileName, myXML, CaretCompressedSparseFile::FLOAT32);
+        writer.writeRowSparse(0, indices[0], values[0]);
+        QFile::copy(fileName, fileName + ".partial");
+    }
+    bool caught = false;
+    try
+    {
+        CaretCompressedSparseFile partial(fileName + ".partial");
+    } catch (DataFileException&) {
+        caught = true;
+    }
+    if (!caught) setFailed("unfinished sparse file was not rejected");
+    QFile::remove(fileName);
+    QFile::remove(fileName + ".partial");
+}
@@ -0,0 +1,205 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "ConnectedComponentsTest.h"
+
+#include "ConnectedComponents.h"
+#include "SurfaceFile.h"
+#include "TopologyHelper.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+ConnectedComponentsTest::ConnectedComponentsTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    //serial flood fill in index order, the numbering ConnectedComponents promises
+    int64_t floodFillGrid(const int64_t dims[3], const vector<char>& marked, vector<int64_t>& labelsOut, vector<int64_t>& sizesOut)
+    {
+        const int64_t frameSize = dims[0] * dims[1] * dims[2];
+        labelsOut.assign(frameSize, -1);
+        sizesOut.clear();
+        vector<int64_t> stack;
+        for (int64_t seed = 0; seed < frameSize; ++seed)
+        {
+            if (!marked[seed] || labelsOut[seed] != -1) continue;
+            const int64_t component = (int64_t)sizesOut.size();
+            sizesOut.push_back(0);
+            labelsOut[seed] = component;
+            stack.push_back(seed);
+            while (!stack.empty())
+            {
+                const int64_t index = stack.back();
+                stack.pop_back();
+                ++sizesOut[component];
+                const int64_t ijk[3] = { index % dims[0], (index / dims[0]) % dims[1], index / (dims[0] * dims[1]) };
+                const int64_t strides[3] = { 1, dims[0], dims[0] * dims[1] };
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    for (int dir = -1; dir <= 1; dir += 2)
+                    {
+                        const int64_t neighCoord = ijk[axis] + dir;
+                        if (neighCoord < 0 || neighCoord >= dims[axis]) continue;
+                        const int64_t neighbor = index + dir * strides[axis];
+                        if (!marked[neighbor] || labelsOut[neighbor] != -1) continue;
+                        labelsOut[neighbor] = component;
+                        stack.push_back(neighbor);
+                    }
+                }
+            }
+        }
+        return (int64_t)sizesOut.size();
+    }
+    
+    int64_t floodFillGraph(const TopologyHelper* topoHelp, const vector<char>& marked, vector<int64_t>& labelsOut, vector<int64_t>& sizesOut)
+    {
+        const int64_t numNodes = topoHelp->getNumberOfNodes();
+        labelsOut.assign(numNodes, -1);
+        sizesOut.clear();
+        vector<int64_t> stack;
+        for (int64_t seed = 0; seed < numNodes; ++seed)
+        {
+            if (!marked[seed] || labelsOut[seed] != -1) continue;
+            const int64_t component = (int64_t)sizesOut.size();
+            sizesOut.push_back(0);
+            labelsOut[seed] = component;
+            stack.push_back(seed);
+            while (!stack.empty())
+            {
+                const int64_t node = stack.back();
+                stack.pop_back();
+                ++sizesOut[component];
+                int32_t numNeigh = 0;
+                const int32_t* neighbors = topoHelp->getNodeNeighbors(node, numNeigh);
+                for (int32_t n = 0; n < numNeigh; ++n)
+                {
+                    if (!marked[neighbors[n]] || labelsOut[neighbors[n]] != -1) continue;
+                    labelsOut[neighbors[n]] = component;
+                    stack.push_back(neighbors[n]);
+                }
+            }
+        }
+        return (int64_t)sizesOut.size();
+    }
+    
+    //noise with enough marked values that components span the chunk borders
+    void makeMaps(const int64_t& count, const int& numMaps, vector<vector<float> >& mapsOut, vector<const float*>& pointersOut)
+    {
+        mapsOut.resize(numMaps);
+        pointersOut.resize(numMaps);
+        for (int m = 0; m < numMaps; ++m)
+        {
+            mapsOut[m].resize(count);
+            for (int64_t i = 0; i < count; ++i)
+            {
+                mapsOut[m][i] = ((float)rand()) / RAND_MAX;
+            }
+            pointersOut[m] = mapsOut[m].data();
+        }
+    }
+    
+    void checkLabels(ConnectedComponentsTest* theTest, const AString& condition, const int64_t& count, const int64_t& expectedCount, const vector<int64_t>& expectedLabels,
+                     const vector<int64_t>& expectedSizes, const vector<int64_t>& labels, const vector<int64_t>& sizes)
+    {
+        if (count != expectedCount)
+        {
+            theTest->setFailed(condition + ", found " + AString::number(count) + " components instead of " + AString::number(expectedCount));
+            return;
+        }
+        if (labels != expectedLabels)
+        {
+            theTest->setFailed(condition + ", labels differ from serial flood fill");
+        }
+        if (sizes != expectedSizes)
+        {
+            theTest->setFailed(condition + ", component sizes differ from serial flood fill");
+        }
+    }
+}
+
+void ConnectedComponentsTest::execute()
+{
+    const float THRESHOLD = 0.6f;//40% of voxels marked, above the cubic site percolation threshold, so there is one large component crossing every chunk border and many small ones
+    const int NUM_MAPS = 5;
+    const int64_t dims[3] = { 40, 45, 50 };
+    const int64_t frameSize = dims[0] * dims[1] * dims[2];
+    for (int numMaps = 1; numMaps <= NUM_MAPS; numMaps += NUM_MAPS - 1)
+    {//one map labels within the map in parallel, several label one map per thread
+        vector<vector<float> > maps;
+        vector<const float*> mapPointers;
+        makeMaps(frameSize, numMaps, maps, mapPointers);
+        vector<vector<int64_t> > labels, sizes;
+        vector<int64_t> counts;
+        ConnectedComponents::thresholdAndLabelGrid(dims, mapPointers, THRESHOLD, false, NULL, labels, counts, &sizes);
+        for (int m = 0; m < numMaps; ++m)
+        {
+            vector<char> marked(frameSize);
+            for (int64_t i = 0; i < frameSize; ++i) marked[i] = (maps[m][i] > THRESHOLD) ? 1 : 0;
+            vector<int64_t> expectedLabels, expectedSizes;
+            int64_t expectedCount = floodFillGrid(dims, marked, expectedLabels, expectedSizes);
+            checkLabels(this, "grid with " + AString::number(numMaps) + " maps, map " + AString::number(m), counts[m], expectedCount, expectedLabels, expectedSizes, labels[m], sizes[m]);
+        }
+    }
+    const int GRID_SIZE = 200;
+    SurfaceFile mySurf;
+    mySurf.setNumberOfNodesAndTriangles(GRID_SIZE * GRID_SIZE, (GRID_SIZE - 1) * (GRID_SIZE - 1) * 2);
+    for (int j = 0; j < GRID_SIZE; ++j)
+    {
+        for (int i = 0; i < GRID_SIZE; ++i)
+        {
+            mySurf.setCoordinate(i + j * GRID_SIZE, i, j, 0.0f);
+        }
+    }
+    int tri = 0;
+    for (int j = 0; j < GRID_SIZE - 1; ++j)
+    {
+        for (int i = 0; i < GRID_SIZE - 1; ++i)
+        {
+            const int base = i + j * GRID_SIZE;
+            mySurf.setTriangle(tri++, base, base + 1, base + GRID_SIZE + 1);
+            mySurf.setTriangle(tri++, base, base + GRID_SIZE + 1, base + GRID_SIZE);
+        }
+    }
+    CaretPointer<TopologyHelper> myHelp = mySurf.getTopologyHelper();
+    const int64_t numNodes = GRID_SIZE * GRID_SIZE;
+    const float GRAPH_THRESHOLD = 0.5f;//triangulated grid percolates at 0.5
+    for (int numMaps = 1; numMaps <= NUM_MAPS; numMaps += NUM_MAPS - 1)
+    {
+        vector<vector<float> > maps;
+        vector<const float*> mapPointers;
+        makeMaps(numNodes, numMaps, maps, mapPointers);
+        vector<vector<int64_t> > labels, sizes;
+        vector<int64_t> counts;
+        ConnectedComponents::thresholdAndLabelGraph(myHelp, mapPointers, GRAPH_THRESHOLD, true, NULL, labels, counts, &sizes);
+        for (int m = 0; m < numMaps; ++m)
+        {
+            vector<char> marked(numNodes);
+            for (int64_t i = 0; i < numNodes; ++i) marked[i] = (maps[m][i] < GRAPH_THRESHOLD) ? 1 : 0;
+            vector<int64_t> expectedLabels, expectedSizes;
+            int64_t expectedCount = floodFillGraph(myHelp, marked, expectedLabels, expectedSizes);
+            checkLabels(this, "surface with " + AString::number(numMaps) + " maps, map " + AString::number(m), counts[m], expectedCount, expectedLabels, expectedSizes, labels[m], sizes[m]);
+        }
+    }
+}
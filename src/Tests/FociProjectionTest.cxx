@@ -0,0 +1,191 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "FociProjectionTest.h"
+
+#include "CaretException.h"
+#include "CaretPointer.h"
+#include "Focus.h"
+#include "SurfaceFile.h"
+#include "SurfaceProjectedItem.h"
+#include "SurfaceProjectionBarycentric.h"
+#include "SurfaceProjectionVanEssen.h"
+#include "SurfaceProjector.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+FociProjectionTest::FociProjectionTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    const int GRID_SIZE = 20;
+    
+    //bumpy square patch, foci beyond its corners project to a node with a large error, which triggers the random perturbation
+    void makeGridSurface(SurfaceFile& surfOut, const StructureEnum::Enum& structure, const float& xOffset)
+    {
+        surfOut.setNumberOfNodesAndTriangles(GRID_SIZE * GRID_SIZE, (GRID_SIZE - 1) * (GRID_SIZE - 1) * 2);
+        for (int j = 0; j < GRID_SIZE; ++j)
+        {
+            for (int i = 0; i < GRID_SIZE; ++i)
+            {
+                surfOut.setCoordinate(i + j * GRID_SIZE, xOffset + i, j, 0.8f * sin(i * 0.7f) * cos(j * 0.9f));
+            }
+        }
+        int tri = 0;
+        for (int j = 0; j < GRID_SIZE - 1; ++j)
+        {
+            for (int i = 0; i < GRID_SIZE - 1; ++i)
+            {
+                const int base = i + j * GRID_SIZE;
+                surfOut.setTriangle(tri++, base, base + 1, base + GRID_SIZE + 1);
+                surfOut.setTriangle(tri++, base, base + GRID_SIZE + 1, base + GRID_SIZE);
+            }
+        }
+        surfOut.setStructure(structure);
+    }
+    
+    Focus* makeFocus(const float xyz[3], const int& index)
+    {
+        Focus* ret = new Focus();
+        ret->setName("focus " + AString::number(index));
+        SurfaceProjectedItem* myItem = new SurfaceProjectedItem();
+        myItem->setStereotaxicXYZ(xyz);
+        ret->addProjection(myItem);
+        return ret;
+    }
+    
+    bool sameProjection(const SurfaceProjectedItem* left, const SurfaceProjectedItem* right)
+    {
+        const SurfaceProjectionBarycentric* leftBary = left->getBarycentricProjection();
+        const SurfaceProjectionBarycentric* rightBary = right->getBarycentricProjection();
+        if (leftBary->isValid() != rightBary->isValid()) return false;
+        if (leftBary->isValid())
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                if (leftBary->getTriangleNodes()[i] != rightBary->getTriangleNodes()[i]) return false;
+                if (leftBary->getTriangleAreas()[i] != rightBary->getTriangleAreas()[i]) return false;
+            }
+            if (leftBary->getSignedDistanceAboveSurface() != rightBary->getSignedDistanceAboveSurface()) return false;
+        }
+        const SurfaceProjectionVanEssen* leftVE = left->getVanEssenProjection();
+        const SurfaceProjectionVanEssen* rightVE = right->getVanEssenProjection();
+        if (leftVE->isValid() != rightVE->isValid()) return false;
+        if (leftVE->isValid())
+        {
+            if (leftVE->getDR() != rightVE->getDR() || leftVE->getThetaR() != rightVE->getThetaR() || leftVE->getPhiR() != rightVE->getPhiR() ||
+                leftVE->getFracRI() != rightVE->getFracRI() || leftVE->getFracRJ() != rightVE->getFracRJ()) return false;
+        }
+        return left->getStructure() == right->getStructure();
+    }
+}
+
+void FociProjectionTest::execute()
+{
+    const int NUM_STRUCTURES = 3;
+    const StructureEnum::Enum structures[NUM_STRUCTURES] = { StructureEnum::CORTEX_LEFT, StructureEnum::CORTEX_RIGHT, StructureEnum::CEREBELLUM };
+    SurfaceFile surfaces[NUM_STRUCTURES];
+    CaretPointer<SurfaceProjector> projectors[NUM_STRUCTURES];
+    for (int s = 0; s < NUM_STRUCTURES; ++s)
+    {
+        makeGridSurface(surfaces[s], structures[s], s * 100.0f);
+        projectors[s].grabNew(new SurfaceProjector(&(surfaces[s])));
+    }
+    //structures interleaved, the way a foci file mixes them, with foci inside the patches and beyond their corners
+    const int NUM_FOCI = 300;
+    vector<CaretPointer<Focus> > serialFoci(NUM_FOCI), batchFoci(NUM_FOCI);
+    vector<SurfaceProjector*> batchProjectors(NUM_FOCI);
+    vector<Focus*> batchFociPtrs(NUM_FOCI);
+    vector<int32_t> batchIndices(NUM_FOCI);
+    vector<int> whichStructure(NUM_FOCI);
+    srand(1234);
+    for (int i = 0; i < NUM_FOCI; ++i)
+    {
+        whichStructure[i] = rand() % NUM_STRUCTURES;
+        float xyz[3];
+        if (i % 4 == 0)
+        {
+            const float cornerDist = 2.0f + (rand() % 100) * 0.05f;
+            xyz[0] = whichStructure[i] * 100.0f + ((i / 4) % 2 == 0 ? -cornerDist : GRID_SIZE - 1 + cornerDist);
+            xyz[1] = ((i / 8) % 2 == 0 ? -cornerDist : GRID_SIZE - 1 + cornerDist);
+            xyz[2] = (rand() % 100) * 0.04f - 2.0f;
+        } else {
+            xyz[0] = whichStructure[i] * 100.0f + (rand() % 1000) * (GRID_SIZE - 1) / 1000.0f;
+            xyz[1] = (rand() % 1000) * (GRID_SIZE - 1) / 1000.0f;
+            xyz[2] = (rand() % 100) * 0.04f - 2.0f;
+        }
+        serialFoci[i].grabNew(makeFocus(xyz, i));
+        batchFoci[i].grabNew(makeFocus(xyz, i));
+        batchProjectors[i] = projectors[whichStructure[i]];
+        batchFociPtrs[i] = batchFoci[i];
+        batchIndices[i] = i;
+    }
+    const unsigned int SEED = 42;
+    srand(SEED);
+    const int unusedRandom = rand();
+    //reference: one focus at a time, in file order, as -foci-resample used to do
+    srand(SEED);
+    try
+    {
+        for (int i = 0; i < NUM_FOCI; ++i)
+        {
+            projectors[whichStructure[i]]->projectFocus(i, serialFoci[i]);
+        }
+    } catch (CaretException& e) {
+        setFailed("serial projection failed: " + e.whatString());
+        return;
+    }
+    const int serialNextRandom = rand();
+    if (serialNextRandom == unusedRandom)
+    {
+        cout << "no focus needed perturbation, only checking projections" << endl;
+    }
+    srand(SEED);
+    try
+    {
+        SurfaceProjector::projectFoci(batchProjectors, batchFociPtrs, batchIndices);
+    } catch (CaretException& e) {
+        setFailed("batch projection failed: " + e.whatString());
+        return;
+    }
+    if (rand() != serialNextRandom) setFailed("batch projection used a different number of random values than serial projection");
+    for (int i = 0; i < NUM_FOCI; ++i)
+    {
+        if (serialFoci[i]->getNumberOfProjections() != batchFoci[i]->getNumberOfProjections())
+        {
+            setFailed("focus " + AString::number(i) + " has a different number of projections in batch projection");
+            continue;
+        }
+        for (int p = 0; p < serialFoci[i]->getNumberOfProjections(); ++p)
+        {
+            if (!sameProjection(serialFoci[i]->getProjection(p), batchFoci[i]->getProjection(p)))
+            {
+                setFailed("focus " + AString::number(i) + " (" + StructureEnum::toName(structures[whichStructure[i]]) + ") projected differently in batch projection");
+            }
+        }
+    }
+}
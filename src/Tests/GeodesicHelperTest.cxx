@@ -22,6 +22,7 @@
 #include "GeodesicHelper.h"
 #include "SurfaceFile.h"
 
+#include <algorithm>
 #include <cstdlib>
 
 using namespace caret;
@@ -96,4 +97,34 @@ void GeodesicHelperTest::execute()
         checkNodeLists(this, "Comparing normal to quarter areas, getPathFollowingData", nodesNorm, nodesQuarter);
         checkNodeLists(this, "Comparing normal to quad areas, getPathFollowingData", nodesNorm, nodesQuad);
     }
+    vector<int32_t> roots(TEST_SAMPLES);
+    for (int i = 0; i < TEST_SAMPLES; ++i)
+    {
+        roots[i] = rand() % numNodes;
+    }
+    const float MULTI_GEO_DIST = 15.0f;
+    CaretPointer<GeodesicHelperBase> normalHelpBase(new GeodesicHelperBase(&mySurf));
+    GeodesicMultiRootHelper multiHelp(normalHelpBase);
+    vector<int64_t> rowStarts;
+    multiHelp.getNodesToGeoDist(roots, MULTI_GEO_DIST, rowStarts, nodesQuad, distsQuad);
+    for (int i = 0; !failed() && i < TEST_SAMPLES; ++i)
+    {//multi-root output is sorted by node, and should give exactly the same distances
+        normalHelp->getNodesToGeoDist(roots[i], MULTI_GEO_DIST, nodesNorm, distsNorm);
+        vector<pair<int32_t, float> > sorted(nodesNorm.size());
+        for (size_t j = 0; j < nodesNorm.size(); ++j) sorted[j] = make_pair(nodesNorm[j], distsNorm[j]);
+        sort(sorted.begin(), sorted.end());
+        if ((int64_t)sorted.size() != rowStarts[i + 1] - rowStarts[i])
+        {
+            setFailed("Comparing multi-root to single root, found different size node lists");
+            break;
+        }
+        for (size_t j = 0; j < sorted.size(); ++j)
+        {
+            if (sorted[j].first != nodesQuad[rowStarts[i] + j] || sorted[j].second != distsQuad[rowStarts[i] + j])
+            {
+                setFailed("Comparing multi-root to single root, found different result at position " + AString::number(j) + " of root " + AString::number(roots[i]));
+                break;
+            }
+        }
+    }
 }
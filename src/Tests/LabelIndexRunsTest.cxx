@@ -0,0 +1,191 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "LabelIndexRunsTest.h"
+
+#include "AlgorithmVolumeAllLabelsToROIs.h"
+#include "CaretException.h"
+#include "GiftiLabelTable.h"
+#include "GiftiMetaData.h"
+#include "LabelIndexRuns.h"
+#include "VolumeFile.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+
+using namespace caret;
+using namespace std;
+
+LabelIndexRunsTest::LabelIndexRunsTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    bool sameFrame(const float* left, const float* right, const int64_t& frameSize)
+    {
+        for (int64_t i = 0; i < frameSize; ++i)
+        {
+            if (left[i] != right[i]) return false;
+        }
+        return true;
+    }
+    
+    void checkROIVolume(LabelIndexRunsTest* theTest, const AString& condition, const VolumeFile& testVol, const vector<int64_t>& expectedDims,
+                        const vector<AString>& expectedNames, const vector<vector<float> >& expectedFrames)
+    {
+        vector<int64_t> dims = testVol.getDimensions();
+        for (int i = 0; i < 3; ++i)
+        {
+            if (dims[i] != expectedDims[i])
+            {
+                theTest->setFailed(condition + ", volume dimensions differ");
+                return;
+            }
+        }
+        if (dims[3] != (int64_t)expectedFrames.size())
+        {
+            theTest->setFailed(condition + ", found " + AString::number(dims[3]) + " frames instead of " + AString::number(expectedFrames.size()));
+            return;
+        }
+        const int64_t frameSize = expectedDims[0] * expectedDims[1] * expectedDims[2];
+        for (int64_t f = 0; f < dims[3]; ++f)
+        {
+            if (testVol.getMapName(f) != expectedNames[f]) theTest->setFailed(condition + ", frame " + AString::number(f) + " has map name '" + testVol.getMapName(f) + "' instead of '" + expectedNames[f] + "'");
+            if (!sameFrame(testVol.getFrame(f), expectedFrames[f].data(), frameSize)) theTest->setFailed(condition + ", frame " + AString::number(f) + " differs from per-voxel ROI");
+        }
+    }
+}
+
+void LabelIndexRunsTest::execute()
+{
+    vector<int64_t> dims(3);
+    dims[0] = 23; dims[1] = 19; dims[2] = 17;
+    const int64_t frameSize = dims[0] * dims[1] * dims[2];
+    vector<vector<float> > sform(4, vector<float>(4, 0.0f));
+    for (int i = 0; i < 4; ++i) sform[i][i] = 1.0f;
+    sform[0][3] = -11.0f;
+    VolumeFile labelVol(dims, sform, 1, SubvolumeAttributes::LABEL);
+    GiftiLabelTable* myTable = labelVol.getMapLabelTable(0);
+    vector<int32_t> tableKeys;
+    tableKeys.push_back(myTable->addLabel("first", 1.0f, 0.0f, 0.0f));
+    tableKeys.push_back(myTable->addLabel("second", 0.0f, 1.0f, 0.0f));
+    tableKeys.push_back(myTable->addLabel("third", 0.0f, 0.0f, 1.0f));
+    tableKeys.push_back(myTable->addLabel("unused", 1.0f, 1.0f, 0.0f));//in the table but not the data, gets an empty frame
+    const int32_t unassignedKey = myTable->getUnassignedLabelKey();
+    vector<float> labelData(frameSize);
+    int64_t index = 0;
+    while (index < frameSize)
+    {//runs of varied length, some crossing rows and slices, with values slightly off integer and a key that isn't in the table
+        int32_t thisKey = unassignedKey;
+        switch (rand() % 5)
+        {
+            case 0: thisKey = tableKeys[0]; break;
+            case 1: thisKey = tableKeys[1]; break;
+            case 2: thisKey = tableKeys[2]; break;
+            case 3: thisKey = 1000; break;
+            default: break;
+        }
+        const int64_t runEnd = min(frameSize, index + 1 + rand() % 60);
+        for (; index < runEnd; ++index)
+        {
+            labelData[index] = thisKey + ((rand() % 3) - 1) * 0.25f;
+        }
+    }
+    labelVol.setFrame(labelData.data());
+    //per-voxel reference, the way the algorithm worked before LabelIndexRuns
+    map<int32_t, vector<float> > keyROIs;
+    map<int32_t, int64_t> keyCounts;
+    for (int64_t i = 0; i < frameSize; ++i)
+    {
+        const int32_t thisKey = (int32_t)floor(labelData[i] + 0.5f);
+        vector<float>& thisROI = keyROIs[thisKey];
+        if (thisROI.empty()) thisROI.resize(frameSize, 0.0f);
+        thisROI[i] = 1.0f;
+        ++keyCounts[thisKey];
+    }
+    LabelIndexRuns myRuns(labelData.data(), frameSize);
+    vector<int32_t> runKeys = myRuns.getKeys();
+    if (runKeys.size() != keyROIs.size())
+    {
+        setFailed("LabelIndexRuns found " + AString::number(runKeys.size()) + " keys instead of " + AString::number(keyROIs.size()));
+    }
+    vector<float> scratch(frameSize, 0.0f);
+    for (map<int32_t, vector<float> >::iterator iter = keyROIs.begin(); iter != keyROIs.end(); ++iter)
+    {
+        const AString keyString = "key " + AString::number(iter->first);
+        if (!myRuns.hasKey(iter->first))
+        {
+            setFailed("LabelIndexRuns is missing " + keyString);
+            continue;
+        }
+        if (myRuns.getCount(iter->first) != keyCounts[iter->first]) setFailed("LabelIndexRuns has wrong count for " + keyString);
+        myRuns.getROI(iter->first, scratch.data());
+        if (!sameFrame(scratch.data(), iter->second.data(), frameSize)) setFailed("LabelIndexRuns has wrong ROI for " + keyString);
+        myRuns.fillRuns(iter->first, scratch.data(), 0.0f);
+        for (int64_t i = 0; i < frameSize; ++i)
+        {
+            if (scratch[i] != 0.0f)
+            {
+                setFailed("LabelIndexRuns fillRuns did not clear the ROI of " + keyString);
+                break;
+            }
+        }
+    }
+    if (myRuns.hasKey(tableKeys[3]) || myRuns.getCount(tableKeys[3]) != 0 || !myRuns.getRuns(tableKeys[3]).empty()) setFailed("LabelIndexRuns has runs for a key not in the data");
+    //expected output of -volume-all-labels-to-rois: every table key except ???, in key order
+    vector<AString> expectedNames;
+    vector<vector<float> > expectedFrames;
+    vector<int32_t> sortedKeys = tableKeys;
+    sort(sortedKeys.begin(), sortedKeys.end());
+    for (size_t i = 0; i < sortedKeys.size(); ++i)
+    {
+        expectedNames.push_back(myTable->getLabelName(sortedKeys[i]));
+        map<int32_t, vector<float> >::iterator iter = keyROIs.find(sortedKeys[i]);
+        if (iter == keyROIs.end())
+        {
+            expectedFrames.push_back(vector<float>(frameSize, 0.0f));
+        } else {
+            expectedFrames.push_back(iter->second);
+        }
+    }
+    try
+    {
+        VolumeFile denseOut;
+        AlgorithmVolumeAllLabelsToROIs(NULL, &labelVol, 0, &denseOut);
+        checkROIVolume(this, "in-memory output", denseOut, dims, expectedNames, expectedFrames);
+        const AString streamName = QDir::tempPath() + "/wb_label_index_runs_test.nii.gz";
+        GiftiMetaData outMetaData;
+        outMetaData.set("Provenance", "label index runs test");
+        AlgorithmVolumeAllLabelsToROIs(NULL, &labelVol, 0, streamName, &outMetaData);
+        VolumeFile streamOut;
+        streamOut.readFile(streamName);
+        checkROIVolume(this, "streamed output", streamOut, dims, expectedNames, expectedFrames);
+        if (streamOut.getFileMetaData()->get("Provenance") != "label index runs test") setFailed("streamed output lost its file metadata");
+        if (streamOut.getSform() != denseOut.getSform()) setFailed("streamed output has a different sform than in-memory output");
+        QFile::remove(streamName);
+    } catch (CaretException& e) {
+        setFailed("caught exception: " + e.whatString());
+    }
+}
@@ -0,0 +1,177 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "RegressionTest.h"
+
+#include "AlgorithmCiftiRegression.h"
+#include "AlgorithmException.h"
+#include "CiftiFile.h"
+#include "DenseMatrix.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+RegressionTest::RegressionTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    //least squares by the normal equations and gaussian elimination in double, independent of DenseMatrix
+    vector<double> directSolve(const vector<vector<double> >& design, const vector<double>& data)
+    {
+        const int numRows = (int)design.size(), numCols = (int)design[0].size();
+        vector<vector<double> > normal(numCols, vector<double>(numCols + 1, 0.0));
+        for (int i = 0; i < numCols; ++i)
+        {
+            for (int j = 0; j < numCols; ++j)
+            {
+                for (int t = 0; t < numRows; ++t) normal[i][j] += design[t][i] * design[t][j];
+            }
+            for (int t = 0; t < numRows; ++t) normal[i][numCols] += design[t][i] * data[t];
+        }
+        for (int i = 0; i < numCols; ++i)
+        {
+            int pivot = i;
+            for (int j = i + 1; j < numCols; ++j)
+            {
+                if (abs(normal[j][i]) > abs(normal[pivot][i])) pivot = j;
+            }
+            swap(normal[i], normal[pivot]);
+            for (int j = 0; j < numCols; ++j)
+            {
+                if (j == i) continue;
+                const double factor = normal[j][i] / normal[i][i];
+                for (int k = i; k <= numCols; ++k) normal[j][k] -= factor * normal[i][k];
+            }
+        }
+        vector<double> ret(numCols);
+        for (int i = 0; i < numCols; ++i) ret[i] = normal[i][numCols] / normal[i][i];
+        return ret;
+    }
+    
+    CiftiXML makeXML(const int64_t& numRows, const int64_t& rowLength)
+    {//dtseries-like: series along the row, the row dimension doesn't matter to the algorithm
+        CiftiXML ret;
+        ret.setNumberOfDimensions(2);
+        CiftiSeriesMap seriesMap;
+        seriesMap.setLength(rowLength);
+        ret.setMap(CiftiXML::ALONG_ROW, seriesMap);
+        CiftiScalarsMap rowsMap;
+        rowsMap.setLength(numRows);
+        ret.setMap(CiftiXML::ALONG_COLUMN, rowsMap);
+        return ret;
+    }
+}
+
+void RegressionTest::execute()
+{
+    const int NUM_TIMEPOINTS = 60, NUM_COLUMNS = 3, NUM_ROWS = 20, KEEP_COLUMN = 1;
+    const float TOLER_RATIO = 0.0001f, TOLER_ABS = 0.0001f;//float output, double reference
+    vector<vector<double> > designFull(NUM_TIMEPOINTS, vector<double>(NUM_COLUMNS + 1));//with the intercept last, as the algorithm adds it
+    DenseMatrix design(NUM_TIMEPOINTS, NUM_COLUMNS);
+    for (int t = 0; t < NUM_TIMEPOINTS; ++t)
+    {
+        design(t, 0) = ((float)rand()) / RAND_MAX;
+        design(t, 1) = t * 0.1f + 2.0f;//trend with nonzero mean, so demeaning matters
+        design(t, 2) = sin(t * 0.3f) + 0.5f;
+        for (int c = 0; c < NUM_COLUMNS; ++c) designFull[t][c] = design(t, c);
+        designFull[t][NUM_COLUMNS] = 1.0;
+    }
+    CiftiFile input;
+    input.setCiftiXML(makeXML(NUM_ROWS, NUM_TIMEPOINTS));
+    vector<vector<double> > inputData(NUM_ROWS, vector<double>(NUM_TIMEPOINTS));
+    vector<float> rowBuffer(NUM_TIMEPOINTS);
+    for (int i = 0; i < NUM_ROWS; ++i)
+    {
+        for (int t = 0; t < NUM_TIMEPOINTS; ++t)
+        {
+            rowBuffer[t] = 100.0f + (i + 1) * design(t, 0) - 0.5f * i * design(t, 1) + 3.0f * design(t, 2) + ((float)rand()) / RAND_MAX;
+            inputData[i][t] = rowBuffer[t];
+        }
+        input.setRow(rowBuffer.data(), i);
+    }
+    CiftiFile output, betas;
+    vector<int> keepColumns(1, KEEP_COLUMN);
+    AlgorithmCiftiRegression(NULL, &input, design, &output, keepColumns, &betas);
+    if (betas.getNumberOfColumns() != NUM_COLUMNS + 1)
+    {
+        setFailed("betas output has " + AString::number(betas.getNumberOfColumns()) + " maps, expected " + AString::number(NUM_COLUMNS + 1));
+        return;
+    }
+    vector<float> betasRow(NUM_COLUMNS + 1), outRow(NUM_TIMEPOINTS);
+    for (int i = 0; i < NUM_ROWS; ++i)
+    {
+        vector<double> reference = directSolve(designFull, inputData[i]);
+        betas.getRow(betasRow.data(), i);
+        for (int c = 0; c <= NUM_COLUMNS; ++c)
+        {
+            if (!(abs(betasRow[c] - reference[c]) < TOLER_ABS + TOLER_RATIO * abs(reference[c])))
+            {
+                setFailed("row " + AString::number(i) + " beta " + AString::number(c) + " is " + AString::number(betasRow[c]) + ", expected " + AString::number(reference[c]));
+            }
+        }
+        output.getRow(outRow.data(), i);
+        double inMean = 0.0, outMean = 0.0;
+        for (int t = 0; t < NUM_TIMEPOINTS; ++t)
+        {
+            double expected = inputData[i][t];
+            for (int c = 0; c < NUM_COLUMNS; ++c)
+            {
+                if (c == KEEP_COLUMN) continue;
+                double columnMean = 0.0;
+                for (int t2 = 0; t2 < NUM_TIMEPOINTS; ++t2) columnMean += designFull[t2][c];
+                columnMean /= NUM_TIMEPOINTS;
+                expected -= reference[c] * (designFull[t][c] - columnMean);
+            }
+            if (!(abs(outRow[t] - expected) < TOLER_ABS + TOLER_RATIO * abs(expected)))
+            {
+                setFailed("row " + AString::number(i) + " residual " + AString::number(t) + " is " + AString::number(outRow[t]) + ", expected " + AString::number(expected));
+            }
+            inMean += inputData[i][t];
+            outMean += outRow[t];
+        }
+        inMean /= NUM_TIMEPOINTS;
+        outMean /= NUM_TIMEPOINTS;
+        if (!(abs(outMean - inMean) < TOLER_ABS + TOLER_RATIO * abs(inMean)))
+        {
+            setFailed("row " + AString::number(i) + " mean changed from " + AString::number(inMean) + " to " + AString::number(outMean));
+        }
+        if (failed()) return;//don't spam the same problem for every row
+    }
+    DenseMatrix dependent = design;//a column that is a sum of others, after float rounding it isn't exactly dependent
+    dependent.resize(NUM_TIMEPOINTS, NUM_COLUMNS + 1);
+    for (int t = 0; t < NUM_TIMEPOINTS; ++t)
+    {
+        dependent(t, NUM_COLUMNS) = 0.3f * design(t, 0) + 0.7f * design(t, 2);
+    }
+    CiftiFile dependentOut;
+    bool caught = false;
+    try
+    {
+        AlgorithmCiftiRegression(NULL, &input, dependent, &dependentOut);
+    } catch (AlgorithmException&) {
+        caught = true;
+    }
+    if (!caught) setFailed("linearly dependent design was not rejected");
+}
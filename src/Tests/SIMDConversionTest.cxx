@@ -0,0 +1,192 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "SIMDConversionTest.h"
+
+#include "SIMDConversion.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace caret;
+using namespace std;
+
+SIMDConversionTest::SIMDConversionTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    const int NUM_COUNTS = 5;
+    const int64_t COUNTS[NUM_COUNTS] = { 1, 7, 15, 33, 1001 };//odd, so every vector kernel leaves a scalar tail
+    
+    template<typename T>
+    void byteSwap(T& value)
+    {
+        char* bytes = (char*)&value;
+        for (int i = 0; i < (int)sizeof(T) / 2; ++i)
+        {
+            char temp = bytes[i];
+            bytes[i] = bytes[sizeof(T) - i - 1];
+            bytes[sizeof(T) - i - 1] = temp;
+        }
+    }
+    
+    //integer types get their whole range, float types get finite values of mixed sign and magnitude, so exact comparison is meaningful
+    template<typename T>
+    T randValue()
+    {
+        return (T)(rand() % 65536);
+    }
+    
+    template<>
+    int16_t randValue<int16_t>()
+    {
+        return (int16_t)((rand() % 65536) - 32768);
+    }
+    
+    template<>
+    float randValue<float>()
+    {
+        return (((float)rand()) / RAND_MAX - 0.5f) * (float)(1 << (rand() % 30));
+    }
+    
+    template<>
+    double randValue<double>()
+    {
+        return (((double)rand()) / RAND_MAX - 0.5) * (double)(1 << (rand() % 30));
+    }
+    
+    template<typename T>
+    vector<char> toBytes(const vector<T>& data)
+    {
+        vector<char> ret(data.size() * sizeof(T));
+        if (!ret.empty()) memcpy(ret.data(), data.data(), ret.size());
+        return ret;
+    }
+    
+    template<typename T>
+    void runToFloat(const AString& typeName, vector<vector<char> >& results, vector<AString>& descrips)
+    {
+        for (int c = 0; c < NUM_COUNTS; ++c)
+        {
+            const int64_t count = COUNTS[c];
+            vector<T> values(count), swapped(count);
+            for (int64_t i = 0; i < count; ++i)
+            {
+                values[i] = randValue<T>();
+                swapped[i] = values[i];
+                byteSwap(swapped[i]);//so the swapped input converts to the same finite values
+            }
+            for (int swap = 0; swap < 2; ++swap)
+            {
+                for (int doScale = 0; doScale < 2; ++doScale)
+                {
+                    vector<float> out(count);
+                    SIMDConversion::toFloat(out.data(), (swap ? swapped.data() : values.data()), count, swap != 0, doScale != 0, 0.37, -12.5);
+                    results.push_back(toBytes(out));
+                    descrips.push_back("toFloat from " + typeName + ", count " + AString::number(count) +
+                                       (swap ? ", swapped" : "") + (doScale ? ", scaled" : ""));
+                }
+            }
+        }
+    }
+    
+    template<typename T>
+    void runSwap(void (*swapFunc)(void*, const int64_t&), const AString& funcName, vector<vector<char> >& results, vector<AString>& descrips)
+    {
+        for (int c = 0; c < NUM_COUNTS; ++c)
+        {
+            const int64_t count = COUNTS[c];
+            vector<T> values(count);
+            for (int64_t i = 0; i < count; ++i)
+            {
+                values[i] = randValue<T>();
+            }
+            swapFunc(values.data(), count);
+            results.push_back(toBytes(values));
+            descrips.push_back(funcName + ", count " + AString::number(count));
+        }
+    }
+}
+
+void SIMDConversionTest::runAll(vector<vector<char> >& results, vector<AString>& descrips)
+{
+    srand(42);//same inputs for every implementation
+    results.clear();
+    descrips.clear();
+    runSwap<uint16_t>(&SIMDConversion::swap16, "swap16", results, descrips);
+    runSwap<float>(&SIMDConversion::swap32, "swap32", results, descrips);
+    runSwap<double>(&SIMDConversion::swap64, "swap64", results, descrips);
+    runToFloat<uint8_t>("uint8", results, descrips);
+    runToFloat<int16_t>("int16", results, descrips);
+    runToFloat<uint16_t>("uint16", results, descrips);
+    runToFloat<float>("float32", results, descrips);
+    runToFloat<double>("float64", results, descrips);
+    for (int c = 0; c < NUM_COUNTS; ++c)
+    {
+        const int64_t count = COUNTS[c];
+        vector<float> values(count);
+        for (int64_t i = 0; i < count; ++i)
+        {
+            values[i] = randValue<float>();
+        }
+        for (int swap = 0; swap < 2; ++swap)
+        {
+            for (int doScale = 0; doScale < 2; ++doScale)
+            {
+                vector<float> out(count);
+                SIMDConversion::floatForWrite(out.data(), values.data(), count, swap != 0, doScale != 0, 0.37, -12.5);
+                results.push_back(toBytes(out));
+                descrips.push_back("floatForWrite, count " + AString::number(count) +
+                                   (swap ? ", swapped" : "") + (doScale ? ", scaled" : ""));
+            }
+        }
+    }
+}
+
+void SIMDConversionTest::execute()
+{
+    const SIMDConversion::Implementation original = SIMDConversion::getImplementation();
+    if (SIMDConversion::setImplementation(SIMDConversion::SCALAR) != SIMDConversion::SCALAR) setFailed("failed to set implementation to SCALAR");
+    vector<vector<char> > scalarResults, testResults;
+    vector<AString> descrips;
+    runAll(scalarResults, descrips);
+    const int numImpl = 2;
+    const SIMDConversion::Implementation testImpl[numImpl] = { SIMDConversion::SSE2, SIMDConversion::AVX2 };
+    const char* implNames[numImpl] = { "SSE2", "AVX2" };
+    for (int impl = 0; impl < numImpl; ++impl)
+    {
+        if (SIMDConversion::setImplementation(testImpl[impl]) != testImpl[impl])
+        {
+            cout << "skipping " << implNames[impl] << ", not supported" << endl;
+            continue;
+        }
+        runAll(testResults, descrips);
+        for (int i = 0; i < (int)scalarResults.size(); ++i)
+        {
+            if (testResults[i] != scalarResults[i])//bitwise, all implementations compute the same expressions
+            {
+                setFailed(AString(implNames[impl]) + " " + descrips[i] + " differs from scalar");
+            }
+        }
+    }
+    SIMDConversion::setImplementation(original);
+}
@@ -0,0 +1,123 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SurfaceBenchmark.h"
+
+#include "AlgorithmMetricResample.h"
+#include "AlgorithmMetricSmoothing.h"
+#include "AlgorithmMetricTFCE.h"
+#include "CaretException.h"
+#include "FastStatistics.h"
+#include "GeodesicHelper.h"
+#include "MetricFile.h"
+#include "NodeAndVoxelColoring.h"
+#include "PaletteColorMapping.h"
+#include "SurfaceFile.h"
+#include "SurfaceResamplingMethodEnum.h"
+
+#include <QCoreApplication>
+#include <QFile>
+
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+SurfaceBenchmark::SurfaceBenchmark(const AString& identifier) : BenchmarkInterface(identifier)
+{
+}
+
+void SurfaceBenchmark::execute()
+{
+    const int32_t lowVertices = (m_quick ? 2562 : 32492), highVertices = (m_quick ? 10242 : 163842);//32k and 164k meshes
+    const int32_t numColumns = (m_quick ? 2 : 10);
+    SurfaceFile lowSphere, highSphere;
+    createSphere(lowVertices, StructureEnum::CORTEX_LEFT, lowSphere);
+    createSphere(highVertices, StructureEnum::CORTEX_LEFT, highSphere);
+    const SurfaceFile* sphereList[2] = { &lowSphere, &highSphere };
+    const AString fileName = m_tempPath + "/wb_benchmark_" + AString::number(QCoreApplication::applicationPid()) + ".func.gii";
+    for (int whichSphere = 0; whichSphere < 2; ++whichSphere)
+    {
+        const SurfaceFile* mySphere = sphereList[whichSphere];
+        const int32_t numVertices = mySphere->getNumberOfNodes();
+        const AString vertString = AString::number(numVertices);
+        MetricFile myMetric, smoothOut;
+        createRandomMetric(numVertices, numColumns, myMetric);
+        try
+        {
+            startTiming("gifti metric write", vertString + "x" + AString::number(numColumns), numVertices * numColumns * (int64_t)sizeof(float));
+            myMetric.writeFile(fileName);
+            stopTiming();
+            MetricFile readMetric;
+            startTiming("gifti metric read", vertString + "x" + AString::number(numColumns), numVertices * numColumns * (int64_t)sizeof(float));
+            readMetric.readFile(fileName);
+            stopTiming();
+        } catch (const CaretException&) {
+            QFile::remove(fileName);
+            throw;
+        }
+        QFile::remove(fileName);
+        startTiming("metric smoothing", vertString + "x" + AString::number(numColumns), numVertices * numColumns * (int64_t)sizeof(float));
+        AlgorithmMetricSmoothing(NULL, mySphere, &myMetric, 2.0, &smoothOut);//includes building the per-vertex weights, which is most of the time for few columns
+        stopTiming();
+        MetricFile tfceIn, tfceOut;
+        tfceIn.setNumberOfNodesAndColumns(numVertices, 1);
+        tfceIn.setValuesForColumn(0, smoothOut.getValuePointerForColumn(0));//smoothed noise has clusters, like a statistic map
+        startTiming("metric TFCE", vertString, numVertices * (int64_t)sizeof(float));
+        AlgorithmMetricTFCE(NULL, mySphere, &tfceIn, &tfceOut);
+        stopTiming();
+        CaretPointer<GeodesicHelper> myGeoHelp = mySphere->getGeodesicHelper();
+        const int32_t numRoots = (m_quick ? 100 : 1000);
+        vector<int32_t> neighbors;
+        vector<float> dists;
+        startTiming("geodesic 10mm neighborhoods", vertString + ", " + AString::number(numRoots) + " roots");
+        for (int32_t i = 0; i < numRoots; ++i)
+        {
+            myGeoHelp->getNodesToGeoDist((int32_t)(((int64_t)i * numVertices) / numRoots), 10.0f, neighbors, dists);
+        }
+        stopTiming();
+        const int32_t numFullRoots = (m_quick ? 2 : 10);
+        vector<float> fullDists(numVertices);
+        startTiming("geodesic whole surface", vertString + ", " + AString::number(numFullRoots) + " roots");
+        for (int32_t i = 0; i < numFullRoots; ++i)
+        {
+            myGeoHelp->getGeoFromNode((int32_t)(((int64_t)i * numVertices) / numFullRoots), fullDists.data());
+        }
+        stopTiming();
+        FastStatistics myStats(myMetric.getValuePointerForColumn(0), numVertices);
+        PaletteColorMapping myMapping;
+        vector<uint8_t> rgba(numVertices * 4);
+        const int numColorings = (m_quick ? 10 : 100);//like scrolling through maps in the GUI
+        startTiming("palette coloring", vertString + ", " + AString::number(numColorings) + " times", numColorings * numVertices * (int64_t)sizeof(float));
+        for (int i = 0; i < numColorings; ++i)
+        {
+            const float* data = myMetric.getValuePointerForColumn(i % numColumns);
+            NodeAndVoxelColoring::colorScalarsWithPalette(&myStats, &myMapping, data, &myMapping, data, numVertices, rgba.data());
+        }
+        stopTiming();
+    }
+    MetricFile highMetric, resampleOut;
+    createRandomMetric(highVertices, numColumns, highMetric);
+    startTiming("metric resample barycentric", AString::number(highVertices) + " to " + AString::number(lowVertices) + "x" + AString::number(numColumns),
+                highVertices * numColumns * (int64_t)sizeof(float));
+    AlgorithmMetricResample(NULL, &highMetric, &highSphere, &lowSphere, SurfaceResamplingMethodEnum::BARYCENTRIC, &resampleOut);
+    stopTiming();
+}
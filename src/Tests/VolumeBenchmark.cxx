@@ -0,0 +1,75 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "VolumeBenchmark.h"
+
+#include "AlgorithmVolumeSmoothing.h"
+#include "AlgorithmVolumeTFCE.h"
+#include "CaretException.h"
+#include "VolumeFile.h"
+
+#include <QCoreApplication>
+#include <QFile>
+
+using namespace caret;
+using namespace std;
+
+VolumeBenchmark::VolumeBenchmark(const AString& identifier) : BenchmarkInterface(identifier)
+{
+}
+
+void VolumeBenchmark::execute()
+{
+    const int64_t dims2mm[3] = { 91, 109, 91 }, dimsHigh[3] = { 260, 311, 260 }, dimsQuickHigh[3] = { 130, 155, 130 };//MNI field of view
+    const int64_t* dimsList[2] = { dims2mm, (m_quick ? dimsQuickHigh : dimsHigh) };
+    const float spacingList[2] = { 2.0f, (m_quick ? 1.4f : 0.7f) };
+    const int64_t numFrames = (m_quick ? 2 : 10);
+    const AString fileName = m_tempPath + "/wb_benchmark_" + AString::number(QCoreApplication::applicationPid()) + ".nii";
+    for (int i = 0; i < 2; ++i)
+    {
+        const int64_t* dims = dimsList[i];
+        const int64_t thisNumFrames = (i == 0 ? numFrames : 1);//0.7mm frames are large, one is enough
+        const AString sizeString = AString::number(dims[0]) + "x" + AString::number(dims[1]) + "x" + AString::number(dims[2]) + "x" + AString::number(thisNumFrames) +
+                                   " at " + AString::number(spacingList[i]) + "mm";
+        const int64_t totalBytes = dims[0] * dims[1] * dims[2] * thisNumFrames * (int64_t)sizeof(float);
+        VolumeFile myVol, smoothOut, tfceOut;
+        createRandomVolume(dims, spacingList[i], thisNumFrames, myVol);
+        try
+        {
+            startTiming("nifti write", sizeString, totalBytes);
+            myVol.writeFile(fileName);
+            stopTiming();
+            VolumeFile readVol;
+            startTiming("nifti read", sizeString, totalBytes);
+            readVol.readFile(fileName);
+            stopTiming();
+        } catch (const CaretException&) {
+            QFile::remove(fileName);
+            throw;
+        }
+        QFile::remove(fileName);
+        startTiming("volume smoothing", sizeString, totalBytes);
+        AlgorithmVolumeSmoothing(NULL, &myVol, 2.0f, &smoothOut);//sigma 2mm, same physical kernel at both resolutions
+        stopTiming();
+        startTiming("volume TFCE", sizeString, totalBytes);
+        AlgorithmVolumeTFCE(NULL, &smoothOut, &tfceOut);
+        stopTiming();
+    }
+}
@@ -0,0 +1,155 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+//program for running benchmarks, prints JSON timing results for comparing builds
+//only the JSON goes to stdout (when there is no -output), usage, progress, and errors go to stderr
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "BenchmarkInterface.h"
+#include "SessionManager.h"
+#include "CaretCommandLine.h"
+#include "CaretException.h"
+
+#include <QCoreApplication>
+#include <QFile>
+
+//benchmarks
+#include "CiftiBenchmark.h"
+#include "SurfaceBenchmark.h"
+#include "VolumeBenchmark.h"
+
+using namespace std;
+using namespace caret;
+
+void freeBenchmarkList(vector<BenchmarkInterface*>& mylist)
+{
+    for (int i = 0; i < (int)mylist.size(); ++i)
+    {
+        delete mylist[i];
+    }
+}
+
+void printUsage(const vector<BenchmarkInterface*>& mylist)
+{
+    cerr << "usage: benchmark_driver [-quick] [-output <file.json>] [-temp-dir <directory>] <benchmark>... | all" << endl;
+    cerr << "   -quick: use small data, to check that the benchmarks run" << endl;
+    cerr << "available benchmarks:" << endl;
+    for (int i = 0; i < (int)mylist.size(); ++i)
+    {
+        cerr << mylist[i]->getIdentifier() << endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    srand(1);//same synthetic data every run
+    int ret = 0;
+    {
+        QCoreApplication myApp(argc, argv);
+        caret_global_commandLine_init(argc, argv);
+        SessionManager::createSessionManager(ApplicationTypeEnum::APPLICATION_TYPE_COMMAND_LINE);
+        vector<BenchmarkInterface*> mybenchmarks;
+        mybenchmarks.push_back(new CiftiBenchmark("cifti"));
+        mybenchmarks.push_back(new SurfaceBenchmark("surface"));
+        mybenchmarks.push_back(new VolumeBenchmark("volume"));
+        bool quick = false;
+        AString outputName, tempPath;
+        vector<AString> names;
+        for (int i = 1; i < argc; ++i)
+        {
+            AString thisArg(argv[i]);
+            if (thisArg == "-quick")
+            {
+                quick = true;
+            } else if (thisArg == "-output" || thisArg == "-temp-dir") {
+                if (i + 1 >= argc)
+                {
+                    cerr << "missing argument to " << thisArg << endl;
+                    freeBenchmarkList(mybenchmarks);
+                    return 1;
+                }
+                ++i;
+                if (thisArg == "-output")
+                {
+                    outputName = argv[i];
+                } else {
+                    tempPath = argv[i];
+                }
+            } else {
+                names.push_back(thisArg);
+            }
+        }
+        if (names.empty())
+        {
+            cerr << "No benchmark specified" << endl;
+            printUsage(mybenchmarks);
+            freeBenchmarkList(mybenchmarks);
+            return 1;
+        }
+        vector<BenchmarkInterface::Result> results;
+        for (int i = 0; i < (int)names.size(); ++i)
+        {
+            bool found = false;
+            for (int j = 0; j < (int)mybenchmarks.size(); ++j)
+            {
+                if (mybenchmarks[j]->getIdentifier() == names[i] || "all" == names[i])
+                {
+                    found = true;
+                    mybenchmarks[j]->setQuick(quick);
+                    if (tempPath != "") mybenchmarks[j]->setTempPath(tempPath);
+                    try
+                    {
+                        mybenchmarks[j]->run(results);
+                    } catch (CaretException& e) {
+                        ret = 1;
+                        cerr << "Benchmark " << mybenchmarks[j]->getIdentifier() << " failed, exception: " << e.whatString() << endl;
+                    }
+                }
+            }
+            if (!found)
+            {
+                ret = 1;
+                cerr << "Unknown benchmark: " << names[i] << endl;
+            }
+        }
+        freeBenchmarkList(mybenchmarks);
+        AString json = BenchmarkInterface::resultsToJSON(results, quick);
+        if (outputName == "")
+        {
+            cout << json;
+        } else {
+            QFile outFile(outputName);
+            if (outFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            {
+                outFile.write(json.toUtf8());
+                outFile.close();
+            } else {
+                ret = 1;
+                cerr << "Unable to open " << outputName << " for writing" << endl;
+            }
+        }
+        SessionManager::deleteSessionManager();
+        myApp.processEvents();
+    }
+    return ret;
+}
@@ -33,17 +33,24 @@
 #include "CaretException.h"
 
 //tests
+#include "BlockGzipTest.h"
 #include "CiftiFileTest.h"
+#include "CompressedSparseTest.h"
+#include "ConnectedComponentsTest.h"
 #include "DotTest.h"
+#include "FociProjectionTest.h"
 #include "GeodesicHelperTest.h"
 #include "HttpTest.h"
 #include "HeapTest.h"
+#include "LabelIndexRunsTest.h"
 #include "LookupTest.h"
 #include "MathExpressionTest.h"
 #include "NiftiTest.h"
 #include "PointerTest.h"
 #include "ProgressTest.h"
 #include "QuatTest.h"
+#include "RegressionTest.h"
+#include "SIMDConversionTest.h"
 #include "StatisticsTest.h"
 #include "TimerTest.h"
 #include "TopologyHelperTest.h"
@@ -69,11 +76,16 @@ int main(int argc, char** argv)
         caret_global_commandLine_init(argc, argv);
         SessionManager::createSessionManager(ApplicationTypeEnum::APPLICATION_TYPE_COMMAND_LINE);
         vector<TestInterface*> mytests;
+        mytests.push_back(new BlockGzipTest("blockgzip"));
         mytests.push_back(new CiftiFileTest("ciftifile"));
+        mytests.push_back(new CompressedSparseTest("compressedsparse"));
+        mytests.push_back(new ConnectedComponentsTest("connectedcomponents"));
         mytests.push_back(new DotTest("dotsimd"));
+        mytests.push_back(new FociProjectionTest("fociprojection"));
         mytests.push_back(new GeodesicHelperTest("geohelp"));
         mytests.push_back(new HeapTest("heap"));
         mytests.push_back(new HttpTest("http"));
+        mytests.push_back(new LabelIndexRunsTest("labelindexruns"));
         mytests.push_back(new LookupTest("lookup"));
         mytests.push_back(new MathExpressionTest("mathexpression"));
         mytests.push_back(new NiftiFileTest("niftifile"));
@@ -81,6 +93,8 @@ int main(int argc, char** argv)
         mytests.push_back(new PointerTest("pointer"));
         mytests.push_back(new ProgressTest("progress"));
         mytests.push_back(new QuatTest("quaternion"));
+        mytests.push_back(new RegressionTest("regression"));
+        mytests.push_back(new SIMDConversionTest("simdconversion"));
         mytests.push_back(new StatisticsTest("statistics"));
         mytests.push_back(new TimerTest("timer"));
         mytests.push_back(new TopologyHelperTest("topohelp"));